@@ -0,0 +1,325 @@
+#ifndef SMARTFARM_ALERT_RULES_H_
+#define SMARTFARM_ALERT_RULES_H_
+
+// Mesin aturan notifikasi berbasis tabel. Setiap aturan dievaluasi setiap
+// sampel dengan state masing-masing, jadi beberapa kondisi sekaligus (mis.
+// panas dan tanah basah) menghasilkan notifikasi masing-masing. Evaluasi
+// tidak mengalokasi memori; teks pesan baru disusun saat aturan terpicu.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tomato_logic.h"
+
+// Nilai masukan satu evaluasi. Kanal zona diisi dari zona yang dievaluasi.
+struct AlertInputs {
+  float temperature;
+  float humidity;
+  float soilPercent;
+  int soilThreshold;  // threshold tahap tanaman saat ini (%)
+  float brightnessPercent;
+  bool isDay;
+  bool manualPumpOn;  // pompa menyala bukan karena penyiraman otomatis
+  int plantAgeDays;
+  int plantStage;       // indeks tahap menurut profil budidaya aktif
+  bool stageStartDay;   // hari pertama tahap baru
+};
+
+enum AlertChannel {
+  ALERT_TEMPERATURE,
+  ALERT_HUMIDITY,
+  ALERT_SOIL,
+  ALERT_SOIL_MARGIN,  // kelembaban tanah - threshold tahap
+  ALERT_BRIGHTNESS,
+  ALERT_MANUAL_PUMP,  // 1 jika pompa menyala manual
+  ALERT_STAGE_START,  // 1 pada hari pertama tahap baru
+};
+
+enum AlertComparator {
+  ALERT_ABOVE,
+  ALERT_BELOW,
+};
+
+enum AlertSeverity {
+  ALERT_INFO,
+  ALERT_WARNING,
+  ALERT_CRITICAL,
+};
+
+// Aturan berlaku untuk seluruh papan (DHT bersama) atau per zona.
+enum AlertScope {
+  ALERT_SCOPE_DEVICE,
+  ALERT_SCOPE_ZONE,
+};
+
+// Flag tambahan aturan.
+const uint8_t ALERT_DAY_ONLY = 0x01;
+
+typedef void (*AlertFormatter)(char* out, size_t size, const AlertInputs& in);
+
+struct AlertRule {
+  const char* id;  // kunci di /config/<device>/alerts
+  const char* title;
+  AlertScope scope;
+  AlertChannel channel;
+  AlertComparator comparator;
+  float threshold;
+  // Aturan aktif baru padam setelah nilai kembali melewati threshold sejauh
+  // hysteresis, agar nilai yang bergoyang di sekitar batas tidak memicu ulang.
+  float hysteresis;
+  // Kondisi harus bertahan selama ini sebelum notifikasi dikirim.
+  unsigned long minDurationMs;
+  // Jarak minimum antar notifikasi aturan ini. Kejadian di dalam jeda
+  // dilipat ke ringkasan (digest) yang dikirim setelah jeda habis.
+  unsigned long cooldownMs;
+  AlertSeverity severity;
+  uint8_t flags;
+  AlertFormatter format;
+};
+
+// State per aturan. holding: kondisi sedang terpenuhi sejak `since`;
+// active: kejadian ini sudah ditangani (terkirim atau dilipat ke digest).
+struct AlertRuleState {
+  unsigned long since;
+  bool holding;
+  bool active;
+
+  // --- Cooldown & digest ---
+  bool hasSent;
+  unsigned long lastSentAt;
+  uint16_t digestCount;
+  unsigned long digestSince;
+  float digestMin;
+  float digestMax;
+};
+
+inline const char* alertSeverityName(AlertSeverity severity) {
+  switch (severity) {
+    case ALERT_CRITICAL: return "critical";
+    case ALERT_WARNING: return "warning";
+    default: return "info";
+  }
+}
+
+inline float alertChannelValue(AlertChannel channel, const AlertInputs& in) {
+  switch (channel) {
+    case ALERT_TEMPERATURE: return in.temperature;
+    case ALERT_HUMIDITY: return in.humidity;
+    case ALERT_SOIL: return in.soilPercent;
+    case ALERT_SOIL_MARGIN: return in.soilPercent - in.soilThreshold;
+    case ALERT_BRIGHTNESS: return in.brightnessPercent;
+    case ALERT_MANUAL_PUMP: return in.manualPumpOn ? 1.0f : 0.0f;
+    case ALERT_STAGE_START: return in.stageStartDay ? 1.0f : 0.0f;
+  }
+  return 0.0f;
+}
+
+// Kanal biner (0/1) tidak punya nilai min/maks yang berarti di digest.
+inline bool alertChannelIsLevel(AlertChannel channel) {
+  return channel != ALERT_MANUAL_PUMP && channel != ALERT_STAGE_START;
+}
+
+// Nilai yang ditampilkan ke pengguna; margin tanah ditampilkan sebagai %.
+inline float alertDisplayValue(AlertChannel channel, const AlertInputs& in) {
+  return channel == ALERT_SOIL_MARGIN ? in.soilPercent : alertChannelValue(channel, in);
+}
+
+// --- Format pesan (hanya dipanggil saat aturan terpicu) ---
+inline void formatTempHigh(char* out, size_t size, const AlertInputs& in) {
+  snprintf(out, size, "Suhu: %.1f°C - Risiko heat stress pada tanaman tomat!", in.temperature);
+}
+
+inline void formatTempLow(char* out, size_t size, const AlertInputs& in) {
+  snprintf(out, size, "Suhu: %.1f°C - Pertumbuhan tanaman lambat!", in.temperature);
+}
+
+inline void formatHumidityHigh(char* out, size_t size, const AlertInputs& in) {
+  snprintf(out, size, "Kelembaban: %.0f%% - Risiko jamur dan penyakit!", in.humidity);
+}
+
+inline void formatHumidityLow(char* out, size_t size, const AlertInputs& in) {
+  snprintf(out, size, "Kelembaban: %.0f%% - Tanaman mengalami stres!", in.humidity);
+}
+
+inline void formatSoilDry(char* out, size_t size, const AlertInputs& in) {
+  snprintf(out, size, "Kelembaban tanah: %.0f%% - Perlu penyiraman! Threshold: %d%%",
+           in.soilPercent, in.soilThreshold);
+}
+
+inline void formatSoilWet(char* out, size_t size, const AlertInputs& in) {
+  snprintf(out, size, "Kelembaban tanah: %.0f%% - Risiko busuk akar!", in.soilPercent);
+}
+
+inline void formatLightLow(char* out, size_t size, const AlertInputs& in) {
+  snprintf(out, size, "Cahaya: %.0f%% - Photosintesis rendah pada siang hari", in.brightnessPercent);
+}
+
+inline void formatLightHigh(char* out, size_t size, const AlertInputs& in) {
+  snprintf(out, size, "Cahaya: %.0f%% - Risiko daun terbakar", in.brightnessPercent);
+}
+
+inline void formatManualPump(char* out, size_t size, const AlertInputs& in) {
+  snprintf(out, size, "Pompa menyala untuk menyiram tanaman tomat. Kelembaban tanah: %.1f%%",
+           in.soilPercent);
+}
+
+inline void formatStageStart(char* out, size_t size, const AlertInputs& in) {
+  snprintf(out, size, "Tanaman masuk tahap: %s - Penyesuaian perawatan diperlukan",
+           plantStageName(in.plantStage));
+}
+
+// Tabel aturan bawaan. Urutan hanya menentukan urutan pengiriman dalam satu
+// putaran.
+static const AlertRule kAlertRules[] = {
+  // id               title                        scope               channel            cmp          thr    hyst  minMs  cooldownMs   severity       flags           format
+  {"temp_high",      "🔥 Suhu Terlalu Tinggi",     ALERT_SCOPE_DEVICE, ALERT_TEMPERATURE, ALERT_ABOVE, 32.0f, 1.0f, 0,     10 * 60000UL, ALERT_WARNING, 0,              formatTempHigh},
+  {"temp_low",       "❄️ Suhu Terlalu Rendah",     ALERT_SCOPE_DEVICE, ALERT_TEMPERATURE, ALERT_BELOW, 10.0f, 1.0f, 0,     10 * 60000UL, ALERT_WARNING, 0,              formatTempLow},
+  {"humidity_high",  "💨 Kelembaban Tinggi",        ALERT_SCOPE_DEVICE, ALERT_HUMIDITY,    ALERT_ABOVE, 80.0f, 3.0f, 15000, 15 * 60000UL, ALERT_WARNING, 0,              formatHumidityHigh},
+  {"humidity_low",   "🏜️ Kelembaban Rendah",        ALERT_SCOPE_DEVICE, ALERT_HUMIDITY,    ALERT_BELOW, 50.0f, 3.0f, 15000, 15 * 60000UL, ALERT_WARNING, 0,              formatHumidityLow},
+  {"soil_dry",       "💧 Tanah Kering",             ALERT_SCOPE_ZONE,   ALERT_SOIL_MARGIN, ALERT_BELOW, 0.0f,  3.0f, 0,     10 * 60000UL, ALERT_WARNING, 0,              formatSoilDry},
+  {"soil_wet",       "💦 Tanah Terlalu Basah",      ALERT_SCOPE_ZONE,   ALERT_SOIL,        ALERT_ABOVE, 80.0f, 3.0f, 10000, 30 * 60000UL, ALERT_WARNING, 0,              formatSoilWet},
+  {"light_low",      "🌑 Cahaya Kurang",            ALERT_SCOPE_ZONE,   ALERT_BRIGHTNESS,  ALERT_BELOW, 20.0f, 5.0f, 30000, 30 * 60000UL, ALERT_INFO,    ALERT_DAY_ONLY, formatLightLow},
+  {"light_high",     "☀️ Cahaya Berlebih",          ALERT_SCOPE_ZONE,   ALERT_BRIGHTNESS,  ALERT_ABOVE, 90.0f, 5.0f, 30000, 30 * 60000UL, ALERT_WARNING, 0,              formatLightHigh},
+  {"manual_pump",    "🚰 Penyiraman Aktif",         ALERT_SCOPE_ZONE,   ALERT_MANUAL_PUMP, ALERT_ABOVE, 0.5f,  0.0f, 0,     5 * 60000UL,  ALERT_INFO,    0,              formatManualPump},
+  {"stage_start",    "🌱 Tahap Pertumbuhan Baru",   ALERT_SCOPE_ZONE,   ALERT_STAGE_START, ALERT_ABOVE, 0.5f,  0.0f, 0,     24 * 3600000UL, ALERT_INFO,  0,              formatStageStart},
+};
+
+const int kAlertRuleCount = (int)(sizeof(kAlertRules) / sizeof(kAlertRules[0]));
+
+// Memperbarui state satu aturan; true jika aturan baru saja terpicu.
+// Pemanggil lalu mengirim (alertMarkSent) atau melipat ke digest
+// (alertFold); jika pengiriman gagal, aturan terpicu lagi di sampel
+// berikutnya.
+// threshold menggantikan rule.threshold (nilai dari /config/<device>).
+inline bool alertEvaluate(const AlertRule& rule, float threshold, AlertRuleState& st,
+                          const AlertInputs& in, unsigned long now) {
+  bool gated = (rule.flags & ALERT_DAY_ONLY) && !in.isDay;
+  float value = alertChannelValue(rule.channel, in);
+  bool held;
+  if (gated) {
+    held = false;
+  } else if (rule.comparator == ALERT_ABOVE) {
+    held = st.active ? value > threshold - rule.hysteresis : value > threshold;
+  } else {
+    held = st.active ? value < threshold + rule.hysteresis : value < threshold;
+  }
+
+  if (!held) {
+    st.holding = false;
+    st.active = false;
+    return false;
+  }
+  if (!st.holding) {
+    st.holding = true;
+    st.since = now;
+  }
+  return !st.active && now - st.since >= rule.minDurationMs;
+}
+
+inline bool alertEvaluate(const AlertRule& rule, AlertRuleState& st, const AlertInputs& in,
+                          unsigned long now) {
+  return alertEvaluate(rule, rule.threshold, st, in, now);
+}
+
+// Indeks aturan dengan id tersebut; -1 jika tidak ada.
+inline int findAlertRule(const char* id, size_t length) {
+  for (int r = 0; r < kAlertRuleCount; r++) {
+    if (strlen(kAlertRules[r].id) == length && memcmp(kAlertRules[r].id, id, length) == 0) return r;
+  }
+  return -1;
+}
+
+// Masih dalam jeda sejak notifikasi terakhir aturan ini?
+inline bool alertInCooldown(const AlertRule& rule, const AlertRuleState& st, unsigned long now) {
+  return st.hasSent && now - st.lastSentAt < rule.cooldownMs;
+}
+
+inline void alertMarkSent(AlertRuleState& st, unsigned long now) {
+  st.active = true;
+  st.hasSent = true;
+  st.lastSentAt = now;
+}
+
+// Kejadian ditangani tanpa kirim: dicatat ke digest.
+inline void alertFold(AlertRuleState& st, float value, unsigned long now) {
+  st.active = true;
+  if (st.digestCount == 0) {
+    st.digestSince = now;
+    st.digestMin = st.digestMax = value;
+  } else {
+    if (value < st.digestMin) st.digestMin = value;
+    if (value > st.digestMax) st.digestMax = value;
+  }
+  if (st.digestCount < 0xFFFF) st.digestCount++;
+}
+
+// Mode digest mati: kejadian di dalam jeda dibuang saja.
+inline void alertDrop(AlertRuleState& st) { st.active = true; }
+
+// Digest siap dikirim setelah jeda aturan habis.
+inline bool alertDigestDue(const AlertRule& rule, const AlertRuleState& st, unsigned long now) {
+  return st.digestCount > 0 && !alertInCooldown(rule, st, now);
+}
+
+inline void alertDigestSent(AlertRuleState& st, unsigned long now) {
+  st.digestCount = 0;
+  st.hasSent = true;
+  st.lastSentAt = now;
+}
+
+inline void formatAlertDigest(char* out, size_t size, const AlertRule& rule,
+                              const AlertRuleState& st, unsigned long now) {
+  unsigned long minutes = (now - st.digestSince) / 60000UL + 1;
+  if (alertChannelIsLevel(rule.channel)) {
+    snprintf(out, size, "Terjadi %u kali dalam %lu menit terakhir. Nilai min %.1f, maks %.1f",
+             (unsigned)st.digestCount, minutes, st.digestMin, st.digestMax);
+  } else {
+    snprintf(out, size, "Terjadi %u kali dalam %lu menit terakhir", (unsigned)st.digestCount,
+             minutes);
+  }
+}
+
+// --- Pembatas laju notifikasi per perangkat ---
+// Token bucket: maksimal `capacity` notifikasi beruntun, lalu satu token
+// baru setiap `refillMs`.
+struct TokenBucket {
+  int capacity;
+  unsigned long refillMs;
+  int tokens;
+  unsigned long lastRefill;
+};
+
+inline void tokenBucketInit(TokenBucket& bucket, int capacity, unsigned long refillMs,
+                            unsigned long now) {
+  bucket.capacity = capacity;
+  bucket.refillMs = refillMs;
+  bucket.tokens = capacity;
+  bucket.lastRefill = now;
+}
+
+inline void tokenBucketRefill(TokenBucket& bucket, unsigned long now) {
+  if (bucket.tokens >= bucket.capacity || bucket.refillMs == 0) {
+    bucket.lastRefill = now;
+    return;
+  }
+  unsigned long added = (now - bucket.lastRefill) / bucket.refillMs;
+  if (added == 0) return;
+  bucket.lastRefill += added * bucket.refillMs;
+  unsigned long room = (unsigned long)(bucket.capacity - bucket.tokens);
+  bucket.tokens += (int)(added < room ? added : room);
+}
+
+inline bool tokenBucketAvailable(TokenBucket& bucket, unsigned long now) {
+  tokenBucketRefill(bucket, now);
+  return bucket.tokens > 0;
+}
+
+inline bool tokenBucketTake(TokenBucket& bucket, unsigned long now) {
+  if (!tokenBucketAvailable(bucket, now)) return false;
+  bucket.tokens--;
+  return true;
+}
+
+#endif  // SMARTFARM_ALERT_RULES_H_
@@ -0,0 +1,583 @@
+#ifndef SMARTFARM_ARDUINO_PLATFORM_H_
+#define SMARTFARM_ARDUINO_PLATFORM_H_
+
+// Implementasi DevicePlatform/RtdbTransport/PumpActuator untuk ESP32
+// (Arduino core). Hanya di-include oleh sketch.
+
+#include <Arduino.h>
+#include <ESP32Servo.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <driver/gpio.h>
+#include <driver/rmt.h>
+#include <esp_heap_caps.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+
+#include "device_log.h"
+#include "dht22_sensor.h"
+#include "device_platform.h"
+#include "local_http_server.h"
+#include "ota_update.h"
+#include "tls_session_client.h"
+#include "tls_trust_store.h"
+#include "tomato_device.h"
+#include "udp_telemetry.h"
+
+class ArduinoPlatform : public DevicePlatform {
+ public:
+  unsigned long millis() override { return ::millis(); }
+  unsigned long micros() override { return ::micros(); }
+  int64_t monotonicUs() override { return esp_timer_get_time(); }
+
+  // gettimeofday, bukan getLocalTime: yang terakhir menunggu sampai 5 detik
+  // selama tahun masih < 2016.
+  bool wallClockMs(long long* out) override {
+    struct timeval now;
+    if (gettimeofday(&now, nullptr) != 0) return false;
+    *out = (long long)now.tv_sec * 1000 + now.tv_usec / 1000;
+    return true;
+  }
+  long random(long low, long high) override { return ::random(low, high); }
+
+  // ESP-IDF tidak punya penghitung alokasi murah, jadi allocationCount()
+  // tetap 0; jumlah blok hidup diambil dari heap_caps_get_info.
+  bool heapStats(HeapStats* out) override {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    out->freeBytes = ESP.getFreeHeap();
+    out->largestFreeBlock = ESP.getMaxAllocHeap();
+    out->minFreeBytes = ESP.getMinFreeHeap();
+    out->liveBlocks = info.allocated_blocks;
+    return true;
+  }
+
+  // Satu namespace NVS untuk semua blob firmware.
+  bool loadBlob(const char* key, void* data, size_t size) override {
+    Preferences prefs;
+    if (!prefs.begin("smartfarm", true)) return false;
+    bool ok = prefs.getBytesLength(key) == size && prefs.getBytes(key, data, size) == size;
+    prefs.end();
+    return ok;
+  }
+
+  bool saveBlob(const char* key, const void* data, size_t size) override {
+    Preferences prefs;
+    if (!prefs.begin("smartfarm", false)) return false;
+    bool ok = prefs.putBytes(key, data, size) == size;
+    prefs.end();
+    return ok;
+  }
+
+  // Sebelum beginLogTask() (awal setup) log langsung ke Serial. Setelahnya
+  // log() hanya menyalin ke ring; task penguras yang menunggu UART.
+  void log(const char* line) override {
+    if (!logTask_) {
+      Serial.println(line);
+      return;
+    }
+    logRing_.push(line, strlen(line));
+  }
+
+  uint32_t droppedLogLines() override { return logRing_.dropped(); }
+
+  // Prioritas 1 (di bawah loopTask) sehingga hanya memakai waktu idle CPU.
+  void beginLogTask() {
+    if (logTask_) return;
+    xTaskCreatePinnedToCore(&ArduinoPlatform::drainLog, "log", 3072, this, 1, &logTask_,
+                            tskNO_AFFINITY);
+  }
+
+ private:
+  static void drainLog(void* arg) {
+    ArduinoPlatform* self = static_cast<ArduinoPlatform*>(arg);
+    static char line[LogRing::kMaxLine + 1];
+    uint32_t reportedDrops = 0;
+    for (;;) {
+      size_t length;
+      while ((length = self->logRing_.pop(line, sizeof(line))) > 0) {
+        Serial.write((const uint8_t*)line, length);
+        Serial.write((const uint8_t*)"\r\n", 2);
+      }
+      uint32_t drops = self->logRing_.dropped();
+      if (drops != reportedDrops) {
+        Serial.printf("⚠️ Log: %lu baris dibuang\r\n", (unsigned long)(drops - reportedDrops));
+        reportedDrops = drops;
+      }
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+  }
+
+  LogRing logRing_;
+  TaskHandle_t logTask_ = nullptr;
+};
+
+// Satu koneksi TLS dipakai ulang untuk semua request (HTTP keep-alive), jadi
+// handshake hanya terjadi saat koneksi pertama atau setelah putus, bukan di
+// setiap request. Handshake itu pun melanjutkan sesi TLS tersimpan bila
+// server menerimanya (tls_session_client.h), juga setelah deep sleep.
+// Handshake dilakukan eksplisit agar durasinya bisa diukur; statistiknya
+// disimpan di RTC memory sehingga bertahan saat sleep.
+class ArduinoRtdbTransport : public RtdbTransport {
+ public:
+  // timeoutMs berlaku untuk connect, handshake dan baca; bawaan HTTPClient 5 detik.
+  ArduinoRtdbTransport(const char* url, uint16_t timeoutMs = 5000)
+      : url_(url), timeoutMs_(timeoutMs) {
+    const char* host = strstr(url, "://");
+    host = host ? host + 3 : url;
+    snprintf(host_, sizeof(host_), "%s", host);
+  }
+
+  // Dipanggil di setup() sebelum request pertama.
+  void begin() {
+    client_.setCACert(FIREBASE_ROOT_CA_PEM);
+    client_.setHandshakeTimeout((timeoutMs_ + 999) / 1000);
+    http_.setReuse(true);
+  }
+
+  bool connected() override { return WiFi.status() == WL_CONNECTED; }
+
+  int get(const char* path, char* body, size_t capacity, size_t* length) override {
+    *length = 0;
+    if (capacity > 0) body[0] = '\0';
+    if (!open(path)) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+    int httpCode = http_.GET();
+    if (httpCode > 0) {
+      String payload = http_.getString();
+      size_t n = payload.length();
+      if (n >= capacity) n = capacity - 1;
+      memcpy(body, payload.c_str(), n);
+      body[n] = '\0';
+      *length = n;
+    }
+    http_.end();
+    return httpCode;
+  }
+
+  int put(const char* path, const char* body, size_t length) override {
+    return send("PUT", path, body, length);
+  }
+
+  int patch(const char* path, const char* body, size_t length) override {
+    return send("PATCH", path, body, length);
+  }
+
+  const TlsStats* tlsStats() const override { return &rtcTlsStats(); }
+
+ private:
+  static TlsStats& rtcTlsStats() {
+    static RTC_DATA_ATTR TlsStats stats;
+    return stats;
+  }
+
+  // Buka koneksi (handshake bila perlu) lalu siapkan HTTPClient di atasnya.
+  bool open(const char* path) {
+    TlsStats& stats = rtcTlsStats();
+    if (client_.connected()) {
+      stats.reusedRequests++;
+    } else {
+      client_.stop();
+      unsigned long start = ::millis();
+      if (!client_.connect(host_, 443)) {
+        stats.handshakeFailures++;
+        return false;
+      }
+      uint32_t elapsed = (uint32_t)(::millis() - start);
+      stats.handshakes++;
+      if (client_.resumed()) stats.resumedHandshakes++;
+      stats.lastHandshakeMs = elapsed;
+      stats.totalHandshakeMs += elapsed;
+      if (elapsed > stats.maxHandshakeMs) stats.maxHandshakeMs = elapsed;
+    }
+
+    String url = url_;
+    url += path;
+    http_.begin(client_, url);
+    http_.setConnectTimeout(timeoutMs_);
+    http_.setTimeout(timeoutMs_);
+    return true;
+  }
+
+  int send(const char* method, const char* path, const char* body, size_t length) {
+    if (!open(path)) return HTTPC_ERROR_CONNECTION_REFUSED;
+    http_.addHeader("Content-Type", "application/json");
+    int httpCode = http_.sendRequest(method, (uint8_t*)body, length);
+    http_.end();
+    return httpCode;
+  }
+
+  const char* url_;
+  char host_[96];
+  uint16_t timeoutMs_;
+  TlsSessionClient client_;
+  HTTPClient http_;
+};
+
+// WiFiServer untuk LocalHttpServer. Koneksi yang sedang dilayani dipegang
+// di sini; accept() baru dipanggil lagi setelah close().
+class ArduinoLanConnection : public LanConnection {
+ public:
+  int read(char* buffer, size_t capacity) override {
+    int available = client_.available();
+    if (available <= 0) return client_.connected() ? 0 : -1;
+    if ((size_t)available > capacity) available = (int)capacity;
+    return client_.read((uint8_t*)buffer, available);
+  }
+
+  int write(const char* data, size_t length) override {
+    if (!client_.connected()) return -1;
+    return (int)client_.write((const uint8_t*)data, length);
+  }
+
+  void close() override { client_.stop(); }
+
+  WiFiClient client_;
+};
+
+class ArduinoLanListener : public LanListener {
+ public:
+  explicit ArduinoLanListener(uint16_t port) : server_(port) {}
+
+  // Dipanggil setelah WiFi terhubung.
+  void begin() {
+    server_.begin();
+    server_.setNoDelay(true);
+  }
+
+  LanConnection* accept() override {
+    WiFiClient client = server_.accept();
+    if (!client) return nullptr;
+    connection_.client_ = client;
+    return &connection_;
+  }
+
+ private:
+  WiFiServer server_;
+  ArduinoLanConnection connection_;
+};
+
+// WiFiUDP ke grup multicast telemetri; lwIP mengirim tanpa menunggu ACK.
+class ArduinoDatagramSink : public DatagramSink {
+ public:
+  ArduinoDatagramSink(const char* group, uint16_t port) : port_(port) { group_.fromString(group); }
+
+  bool send(const uint8_t* data, size_t length) override {
+    if (WiFi.status() != WL_CONNECTED) return false;
+    if (!udp_.beginPacket(group_, port_)) return false;
+    udp_.write(data, length);
+    return udp_.endPacket() == 1;
+  }
+
+ private:
+  WiFiUDP udp_;
+  IPAddress group_;
+  uint16_t port_;
+};
+
+// Relay pompa + servo (simulasi pompa di Wokwi) untuk setiap zona. Batas
+// waktu siram memakai esp_timer satu kali per zona; callback-nya berjalan di
+// task esp_timer sehingga pompa mati tepat waktu walaupun loop() tertahan.
+class ZonePumps : public PumpActuator {
+ public:
+  ZonePumps(const ZoneConfig* zones, int zoneCount) : zones_(zones), zoneCount_(zoneCount) {
+    memset(timers_, 0, sizeof(timers_));
+  }
+
+  void begin() {
+    for (int i = 0; i < zoneCount_ && i < TOMATO_MAX_ZONES; i++) {
+      pinMode(zones_[i].relayPin, OUTPUT);
+      digitalWrite(zones_[i].relayPin, LOW);
+      if (zones_[i].servoPin >= 0) {
+        servos_[i].setPeriodHertz(50);
+        servos_[i].attach(zones_[i].servoPin, 500, 2400);
+        servos_[i].write(0);
+      }
+      cutoffs_[i].pumps = this;
+      cutoffs_[i].zone = i;
+      cutoffs_[i].fired = false;
+      esp_timer_create_args_t args;
+      memset(&args, 0, sizeof(args));
+      args.callback = &ZonePumps::onCutoff;
+      args.arg = &cutoffs_[i];
+      args.dispatch_method = ESP_TIMER_TASK;
+      args.name = "pump_cutoff";
+      if (esp_timer_create(&args, &timers_[i]) != ESP_OK) timers_[i] = nullptr;
+    }
+  }
+
+  void setPump(int zone, bool on) override {
+    if (zone < 0 || zone >= zoneCount_) return;
+    digitalWrite(zones_[zone].relayPin, on ? HIGH : LOW);
+    if (zones_[zone].servoPin >= 0) servos_[zone].write(on ? 90 : 0);
+  }
+
+  bool armCutoff(int zone, unsigned long durationMs) override {
+    if (zone < 0 || zone >= zoneCount_ || !timers_[zone]) return false;
+    esp_timer_stop(timers_[zone]);
+    cutoffs_[zone].fired = false;
+    return esp_timer_start_once(timers_[zone], (uint64_t)durationMs * 1000ULL) == ESP_OK;
+  }
+
+  void cancelCutoff(int zone) override {
+    if (zone < 0 || zone >= zoneCount_ || !timers_[zone]) return;
+    esp_timer_stop(timers_[zone]);
+  }
+
+  bool takeCutoff(int zone, unsigned long* offAtMs) override {
+    if (zone < 0 || zone >= zoneCount_ || !cutoffs_[zone].fired) return false;
+    *offAtMs = cutoffs_[zone].offAt;
+    cutoffs_[zone].fired = false;
+    return true;
+  }
+
+ private:
+  struct Cutoff {
+    ZonePumps* pumps;
+    int zone;
+    volatile unsigned long offAt;
+    volatile bool fired;  // ditulis setelah offAt
+  };
+
+  static void onCutoff(void* arg) {
+    Cutoff* cutoff = static_cast<Cutoff*>(arg);
+    cutoff->pumps->setPump(cutoff->zone, false);
+    cutoff->offAt = ::millis();
+    cutoff->fired = true;
+  }
+
+  const ZoneConfig* zones_;
+  int zoneCount_;
+  Servo servos_[TOMATO_MAX_ZONES];
+  Cutoff cutoffs_[TOMATO_MAX_ZONES];
+  esp_timer_handle_t timers_[TOMATO_MAX_ZONES];
+};
+
+// DHT22 lewat RMT, pengganti library DHT yang men-bit-bang dengan interrupt
+// mati. Sinyal start (low 1.1 ms) diakhiri esp_timer; callback-nya melepas
+// jalur dan menyalakan penerima RMT, yang merekam lebar setiap pulsa dengan
+// resolusi 1 us sampai jalur diam. loop() hanya mengambil rekaman dari ring
+// buffer driver, tanpa menunggu.
+class ArduinoDhtBus : public DhtBus {
+ public:
+  // Kanal 4 ke atas bisa RX di semua varian ESP32 (S3: hanya 4-7).
+  explicit ArduinoDhtBus(int pin, rmt_channel_t channel = RMT_CHANNEL_4)
+      : pin_((gpio_num_t)pin), channel_(channel), ring_(nullptr), release_(nullptr) {}
+
+  // Dipanggil di setup() sebelum Dht22Sensor::begin().
+  bool begin() {
+    rmt_config_t config = RMT_DEFAULT_CONFIG_RX(pin_, channel_);
+    config.clk_div = 80;  // 80 MHz APB -> 1 tick = 1 us
+    config.mem_block_num = 1;  // 64 item, satu transaksi DHT22 butuh ~43
+    config.rx_config.filter_en = true;
+    config.rx_config.filter_ticks_thresh = 100;  // tick APB: buang glitch < 1.25 us
+    config.rx_config.idle_threshold = 200;  // high > 200 us = sensor selesai
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(channel_, 1024, 0) != ESP_OK ||
+        rmt_get_ringbuf_handle(channel_, &ring_) != ESP_OK) {
+      ring_ = nullptr;
+      return false;
+    }
+    gpio_set_pull_mode(pin_, GPIO_PULLUP_ONLY);
+    gpio_set_direction(pin_, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_level(pin_, 1);
+
+    esp_timer_create_args_t args;
+    memset(&args, 0, sizeof(args));
+    args.callback = &ArduinoDhtBus::onRelease;
+    args.arg = this;
+    args.name = "dht";
+    return esp_timer_create(&args, &release_) == ESP_OK;
+  }
+
+  bool startRead() override {
+    if (ring_ == nullptr || release_ == nullptr) return false;
+    discard();
+    gpio_set_level(pin_, 0);
+    return esp_timer_start_once(release_, 1100) == ESP_OK;
+  }
+
+  int takePulses(DhtPulse* out, size_t capacity) override {
+    size_t size = 0;
+    rmt_item32_t* items = (rmt_item32_t*)xRingbufferReceive(ring_, &size, 0);
+    if (items == nullptr) return 0;
+    size_t count = 0;
+    for (size_t i = 0; i < size / sizeof(rmt_item32_t) && count + 2 <= capacity; i++) {
+      out[count].level = items[i].level0;
+      out[count++].us = items[i].duration0;
+      out[count].level = items[i].level1;
+      out[count++].us = items[i].duration1;
+    }
+    vRingbufferReturnItem(ring_, items);
+    rmt_rx_stop(channel_);
+    return (int)count;
+  }
+
+  void cancelRead() override {
+    esp_timer_stop(release_);
+    rmt_rx_stop(channel_);
+    gpio_set_level(pin_, 1);
+  }
+
+ private:
+  // Task esp_timer: lepas jalur (pull-up menariknya high) dan mulai rekam.
+  static void onRelease(void* arg) {
+    ArduinoDhtBus* bus = static_cast<ArduinoDhtBus*>(arg);
+    gpio_set_level(bus->pin_, 1);
+    rmt_rx_start(bus->channel_, true);
+  }
+
+  // Rekaman yang tertinggal dari baca sebelumnya yang dibatalkan.
+  void discard() {
+    size_t size = 0;
+    void* item;
+    while ((item = xRingbufferReceive(ring_, &size, 0)) != nullptr) {
+      vRingbufferReturnItem(ring_, item);
+    }
+  }
+
+  gpio_num_t pin_;
+  rmt_channel_t channel_;
+  RingbufHandle_t ring_;
+  esp_timer_handle_t release_;
+};
+
+// Partisi OTA ESP-IDF (ota_0/ota_1). Rollback butuh
+// CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE; tanpa itu pendingVerify() selalu
+// false dan image baru langsung dianggap sehat.
+class ArduinoFirmwareSlots : public FirmwareSlots {
+ public:
+  bool readRunning(uint32_t offset, uint8_t* out, size_t length) override {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (running == nullptr || offset + length > running->size) return false;
+    return esp_partition_read(running, offset, out, length) == ESP_OK;
+  }
+
+  uint32_t updateCapacity() override {
+    const esp_partition_t* next = esp_ota_get_next_update_partition(nullptr);
+    return next != nullptr ? next->size : 0;
+  }
+
+  bool beginUpdate(uint32_t size) override {
+    target_ = esp_ota_get_next_update_partition(nullptr);
+    if (target_ == nullptr || size > target_->size) return false;
+    // Hapus per sektor sambil menulis, bukan seluruh partisi di depan:
+    // erase 1 MB sekaligus menahan loop() beberapa detik.
+    if (esp_ota_begin(target_, OTA_WITH_SEQUENTIAL_WRITES, &handle_) != ESP_OK) {
+      target_ = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  bool writeUpdate(const uint8_t* data, size_t length) override {
+    return target_ != nullptr && esp_ota_write(handle_, data, length) == ESP_OK;
+  }
+
+  // esp_ota_end() memeriksa header image dan SHA-256-nya (serta tanda tangan
+  // jika secure boot / signed app aktif) sebelum partisi boleh di-boot.
+  bool finishUpdate() override {
+    if (target_ == nullptr) return false;
+    bool ok = esp_ota_end(handle_) == ESP_OK &&
+              esp_ota_set_boot_partition(target_) == ESP_OK;
+    target_ = nullptr;
+    return ok;
+  }
+
+  void abortUpdate() override {
+    if (target_ != nullptr) esp_ota_abort(handle_);
+    target_ = nullptr;
+  }
+
+  bool pendingVerify() override {
+    esp_ota_img_states_t state;
+    return esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK &&
+           state == ESP_OTA_IMG_PENDING_VERIFY;
+  }
+
+  void markValid() override { esp_ota_mark_app_valid_cancel_rollback(); }
+  void rollback() override { esp_ota_mark_app_invalid_rollback_and_reboot(); }
+  void restart() override { ESP.restart(); }
+
+ private:
+  const esp_partition_t* target_ = nullptr;
+  esp_ota_handle_t handle_ = 0;
+};
+
+// HTTP polos ke server update di LAN (linux/tools/ota_server). Server tidak
+// dipercaya: keaslian image dijaga tanda tangan Ed25519 yang dicek OtaUpdater
+// sebelum finishUpdate(), kerusakan oleh CRC dan esp_ota_end().
+class ArduinoUpdateTransport : public UpdateTransport {
+ public:
+  ArduinoUpdateTransport(const char* baseUrl, uint16_t timeoutMs = 5000)
+      : baseUrl_(baseUrl), timeoutMs_(timeoutMs) {}
+
+  int get(const char* path, char* body, size_t capacity, size_t* length) override {
+    *length = 0;
+    if (capacity > 0) body[0] = '\0';
+    if (WiFi.status() != WL_CONNECTED) return HTTPC_ERROR_CONNECTION_REFUSED;
+    open(path);
+    int httpCode = http_.GET();
+    if (httpCode > 0) {
+      String payload = http_.getString();
+      size_t n = payload.length();
+      if (n >= capacity) n = capacity - 1;
+      memcpy(body, payload.c_str(), n);
+      body[n] = '\0';
+      *length = n;
+    }
+    http_.end();
+    return httpCode;
+  }
+
+  int openStream(const char* path, uint32_t offset, uint32_t* length) override {
+    *length = 0;
+    if (WiFi.status() != WL_CONNECTED) return HTTPC_ERROR_CONNECTION_REFUSED;
+    open(path);
+    if (offset > 0) {
+      char range[24];
+      snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)offset);
+      http_.addHeader("Range", range);
+    }
+    int httpCode = http_.GET();
+    if (httpCode == 200 || httpCode == 206) {
+      int size = http_.getSize();
+      *length = size > 0 ? (uint32_t)size : 0;
+    } else {
+      http_.end();
+    }
+    return httpCode;
+  }
+
+  int read(uint8_t* buffer, size_t capacity) override {
+    WiFiClient* stream = http_.getStreamPtr();
+    if (stream == nullptr) return -1;
+    int available = stream->available();
+    if (available > 0) {
+      size_t n = (size_t)available < capacity ? (size_t)available : capacity;
+      return (int)stream->readBytes((char*)buffer, n);
+    }
+    return http_.connected() ? 0 : -1;
+  }
+
+  void closeStream() override { http_.end(); }
+
+ private:
+  void open(const char* path) {
+    String url = baseUrl_;
+    url += path;
+    http_.begin(client_, url);
+    http_.setConnectTimeout(timeoutMs_);
+    http_.setTimeout(timeoutMs_);
+  }
+
+  const char* baseUrl_;
+  uint16_t timeoutMs_;
+  WiFiClient client_;
+  HTTPClient http_;
+};
+
+#endif  // SMARTFARM_ARDUINO_PLATFORM_H_
@@ -0,0 +1,109 @@
+#ifndef SMARTFARM_DEVICE_CLOCK_H_
+#define SMARTFARM_DEVICE_CLOCK_H_
+
+// Jam dinding perangkat. Saat sinkron (setelah NTP, lalu setiap jam untuk
+// mengikuti koreksi SNTP) waktu RTC sistem dijangkarkan ke jam monotonik
+// 64-bit (esp_timer di ESP32). Setelah itu nowMs() hanya satu pembacaan jam
+// monotonik dan satu penjumlahan: tanpa getLocalTime (yang di ESP32 bisa
+// menunggu sampai 5 detik selama jam belum tersinkron), tanpa mktime dan
+// tanpa log.
+//
+// Tanggal dan jam terformat disimpan di buffer tetap dan diformat ulang
+// paling sering sekali per detik, jadi semua pemakai dalam satu siklus
+// (JSON data, notifikasi, log serial) berbagi satu localtime_r + strftime.
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "device_platform.h"
+
+class DeviceClock {
+ public:
+  static const long long kMinValidEpochMs = 1577836800000LL;  // 2020-01-01
+  // Sebelum sinkron: base + uptime, supaya timestamp tetap naik.
+  static const long long kFallbackBaseMs = 1700000000000LL;
+  static const int64_t kResyncUs = 60LL * 60 * 1000000;  // 1 jam
+
+  explicit DeviceClock(DevicePlatform& platform)
+      : platform_(platform),
+        synced_(false),
+        anchorEpochMs_(0),
+        anchorUs_(0),
+        lastMs_(0),
+        second_(-1) {
+    memset(&tm_, 0, sizeof(tm_));
+    strcpy(dateTime_, "Tunggu sinkronisasi...");
+    strcpy(date_, "Sinkronisasi...");
+    strcpy(time_, "--:--:--");
+  }
+
+  bool synced() const { return synced_; }
+  bool needsSync() { return !synced_ || platform_.monotonicUs() - anchorUs_ >= kResyncUs; }
+
+  // Jangkar ulang dari RTC sistem. false (jangkar lama tetap) jika RTC belum
+  // menunjukkan waktu yang masuk akal.
+  bool sync() {
+    long long wall;
+    if (!platform_.wallClockMs(&wall) || wall < kMinValidEpochMs) return false;
+    anchorUs_ = platform_.monotonicUs();
+    anchorEpochMs_ = wall;
+    // Lompatan dari waktu fallback ke waktu sungguhan boleh mundur; koreksi
+    // SNTP setelahnya tidak.
+    if (!synced_) lastMs_ = 0;
+    synced_ = true;
+    second_ = -1;
+    return true;
+  }
+
+  // Epoch milidetik. Tidak pernah mundur antar pemanggilan setelah sinkron.
+  long long nowMs() {
+    int64_t elapsedMs = (platform_.monotonicUs() - anchorUs_) / 1000;
+    long long ms = synced_ ? anchorEpochMs_ + elapsedMs : kFallbackBaseMs + elapsedMs;
+    if (ms < lastMs_) ms = lastMs_;
+    lastMs_ = ms;
+    return ms;
+  }
+
+  // Waktu lokal, teks penunggu sebelum sinkron. Pointer tetap valid; isinya
+  // berganti paling cepat sekali per detik.
+  const char* dateTime() { refresh(); return dateTime_; }  // "YYYY-MM-DD HH:MM:SS"
+  const char* date() { refresh(); return date_; }          // "YYYY-MM-DD"
+  const char* time() { refresh(); return time_; }          // "HH:MM:SS"
+
+  // false sebelum sinkron.
+  bool localTime(struct tm* out) {
+    refresh();
+    if (!synced_) return false;
+    *out = tm_;
+    return true;
+  }
+
+ private:
+  void refresh() {
+    if (!synced_) return;
+    long long second = nowMs() / 1000;
+    if (second == second_) return;
+    second_ = second;
+    time_t seconds = (time_t)second;
+    localtime_r(&seconds, &tm_);
+    strftime(dateTime_, sizeof(dateTime_), "%Y-%m-%d %H:%M:%S", &tm_);
+    memcpy(date_, dateTime_, 10);
+    date_[10] = '\0';
+    memcpy(time_, dateTime_ + 11, 8);
+    time_[8] = '\0';
+  }
+
+  DevicePlatform& platform_;
+  bool synced_;
+  long long anchorEpochMs_;  // waktu RTC saat sinkron terakhir
+  int64_t anchorUs_;         // monotonicUs() saat itu
+  long long lastMs_;
+  long long second_;         // detik epoch isi buffer di bawah
+  struct tm tm_;
+  char dateTime_[32];
+  char date_[16];
+  char time_[16];
+};
+
+#endif  // SMARTFARM_DEVICE_CLOCK_H_
@@ -0,0 +1,113 @@
+#ifndef SMARTFARM_DEVICE_LOG_H_
+#define SMARTFARM_DEVICE_LOG_H_
+
+// Log bertingkat untuk firmware.
+//
+// Tingkat di bawah SMARTFARM_LOG_LEVEL dibuang saat kompilasi: SF_LOGD(...)
+// pada level INFO menjadi if (0), jadi string format dan argumennya tidak
+// ikut ke flash dan tidak dievaluasi. Makro memanggil logf() milik objek
+// tempat ia dipakai (TomatoDevice).
+//
+// Di ESP32 baris log tidak langsung ke Serial: ArduinoPlatform menyalinnya
+// ke LogRing dan task berprioritas rendah yang mengurasnya ke UART, sehingga
+// FIFO UART yang penuh tidak pernah menahan loop(). Jika ring penuh, baris
+// dibuang dan dihitung; penguras mencetak jumlahnya begitu ada ruang.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#define SMARTFARM_LOG_NONE 0
+#define SMARTFARM_LOG_ERROR 1
+#define SMARTFARM_LOG_WARN 2
+#define SMARTFARM_LOG_INFO 3
+#define SMARTFARM_LOG_DEBUG 4
+
+// -DSMARTFARM_LOG_LEVEL=SMARTFARM_LOG_DEBUG untuk dump tiap sampel.
+#ifndef SMARTFARM_LOG_LEVEL
+#define SMARTFARM_LOG_LEVEL SMARTFARM_LOG_INFO
+#endif
+
+#define SF_LOG_AT(level, ...)                                \
+  do {                                                       \
+    if ((level) <= SMARTFARM_LOG_LEVEL) logf(__VA_ARGS__);   \
+  } while (0)
+#define SF_LOGE(...) SF_LOG_AT(SMARTFARM_LOG_ERROR, __VA_ARGS__)
+#define SF_LOGW(...) SF_LOG_AT(SMARTFARM_LOG_WARN, __VA_ARGS__)
+#define SF_LOGI(...) SF_LOG_AT(SMARTFARM_LOG_INFO, __VA_ARGS__)
+#define SF_LOGD(...) SF_LOG_AT(SMARTFARM_LOG_DEBUG, __VA_ARGS__)
+
+// Ring byte satu penulis, satu pembaca, tanpa lock. Penulis hanya task
+// loop() (setup(), loop() dan semua yang dipanggilnya); pembaca hanya task
+// penguras. Setiap baris disimpan sebagai panjang 2 byte lalu teksnya,
+// boleh melingkar di ujung buffer.
+class LogRing {
+ public:
+  static const uint32_t kCapacity = 8192;  // pangkat dua
+  static const size_t kMaxLine = 320;      // sama dengan buffer logf()
+
+  LogRing() : head_(0), tail_(0), dropped_(0) {}
+
+  // Tidak pernah menunggu. false (dan dropped() naik) jika ring penuh.
+  bool push(const char* text, size_t length) {
+    if (length > kMaxLine) length = kMaxLine;
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    uint32_t need = (uint32_t)length + 2;
+    if (kCapacity - (head - tail) < need) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    uint8_t header[2] = {(uint8_t)(length & 0xFF), (uint8_t)(length >> 8)};
+    copyIn(head, header, 2);
+    copyIn(head + 2, text, length);
+    head_.store(head + need, std::memory_order_release);
+    return true;
+  }
+
+  // Baris tertua ke out (diakhiri '\0'); 0 jika kosong.
+  size_t pop(char* out, size_t capacity) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if (tail == head) return 0;
+    uint8_t header[2];
+    copyOut(tail, header, 2);
+    size_t length = (size_t)header[0] | ((size_t)header[1] << 8);
+    size_t copied = length < capacity - 1 ? length : capacity - 1;
+    copyOut(tail + 2, out, copied);
+    out[copied] = '\0';
+    tail_.store(tail + 2 + (uint32_t)length, std::memory_order_release);
+    return copied;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+  // Kumulatif sejak boot.
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  void copyIn(uint32_t at, const void* data, size_t length) {
+    uint32_t offset = at & (kCapacity - 1);
+    size_t first = length < kCapacity - offset ? length : kCapacity - offset;
+    memcpy(buffer_ + offset, data, first);
+    memcpy(buffer_, (const uint8_t*)data + first, length - first);
+  }
+
+  void copyOut(uint32_t at, void* data, size_t length) const {
+    uint32_t offset = at & (kCapacity - 1);
+    size_t first = length < kCapacity - offset ? length : kCapacity - offset;
+    memcpy(data, buffer_ + offset, first);
+    memcpy((uint8_t*)data + first, buffer_, length - first);
+  }
+
+  std::atomic<uint32_t> head_;  // ditulis penulis
+  std::atomic<uint32_t> tail_;  // ditulis pembaca
+  std::atomic<uint32_t> dropped_;
+  uint8_t buffer_[kCapacity];
+};
+
+#endif  // SMARTFARM_DEVICE_LOG_H_
@@ -0,0 +1,127 @@
+#ifndef SMARTFARM_DEVICE_PLATFORM_H_
+#define SMARTFARM_DEVICE_PLATFORM_H_
+
+// Batas antara logika tanaman (tomato_device.h) dan dunia luar: waktu,
+// jaringan ke Firebase RTDB, dan aktuator pompa. Implementasi ESP32 ada di
+// arduino_platform.h; implementasi host (simulator) ada di linux/tools.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Jumlah maksimum zona (bedengan) per papan ESP32.
+#ifndef TOMATO_MAX_ZONES
+#define TOMATO_MAX_ZONES 4
+#endif
+
+// Kondisi heap saat ini (lihat memory_telemetry.h).
+struct HeapStats {
+  uint32_t freeBytes;
+  uint32_t largestFreeBlock;  // alokasi terbesar yang masih mungkin
+  uint32_t minFreeBytes;      // free heap terendah sejak boot
+  uint32_t liveBlocks;        // jumlah blok yang sedang teralokasi
+};
+
+class DevicePlatform {
+ public:
+  virtual ~DevicePlatform() {}
+
+  virtual unsigned long millis() = 0;
+  // Untuk mengukur durasi (loop_profiler.h); boleh meluap (wrap).
+  virtual unsigned long micros() = 0;
+  // Jam monotonik 64-bit (esp_timer di ESP32); tidak meluap seperti micros().
+  virtual int64_t monotonicUs() = 0;
+  // Epoch milidetik dari RTC sistem, tanpa menunggu. Waktu lokal diturunkan
+  // DeviceClock (device_clock.h) dengan localtime_r dan TZ sistem.
+  virtual bool wallClockMs(long long* out) = 0;
+  // Sama dengan random(low, high) Arduino: low <= hasil < high.
+  virtual long random(long low, long high) = 0;
+
+  // false jika platform tidak bisa membaca heap.
+  virtual bool heapStats(HeapStats* out) { (void)out; return false; }
+  // Penghitung alokasi kumulatif; 0 jika tidak tersedia.
+  virtual uint32_t allocationCount() { return 0; }
+
+  // Penyimpanan non-volatil kecil (NVS di ESP32), misalnya cache
+  // /config/<device>. load() false jika kunci belum ada atau ukurannya beda.
+  virtual bool loadBlob(const char* key, void* data, size_t size) {
+    (void)key; (void)data; (void)size;
+    return false;
+  }
+  virtual bool saveBlob(const char* key, const void* data, size_t size) {
+    (void)key; (void)data; (void)size;
+    return false;
+  }
+
+  virtual bool logEnabled() { return true; }
+  // Tidak boleh menunggu UART; platform boleh membuang baris jika antrean
+  // penuh (lihat device_log.h).
+  virtual void log(const char* line) = 0;
+  // Baris log yang dibuang sejak boot.
+  virtual uint32_t droppedLogLines() { return 0; }
+};
+
+// Statistik koneksi TLS transport (lihat ArduinoRtdbTransport).
+struct TlsStats {
+  uint32_t handshakes;        // handshake (koneksi baru), termasuk yang dilanjutkan
+  uint32_t resumedHandshakes; // handshake singkat dengan sesi TLS tersimpan
+  uint32_t handshakeFailures;
+  uint32_t reusedRequests;    // request lewat koneksi yang sudah terbuka
+  uint32_t lastHandshakeMs;
+  uint32_t maxHandshakeMs;
+  uint32_t totalHandshakeMs;
+};
+
+// REST ke Firebase RTDB. Path sudah termasuk ".json" dan query string.
+// Kode kembali mengikuti HTTPClient: > 0 kode HTTP, <= 0 error koneksi.
+class RtdbTransport {
+ public:
+  virtual ~RtdbTransport() {}
+
+  virtual bool connected() = 0;
+  // Body respons ditulis ke buffer (selalu diakhiri '\0', dipotong jika penuh).
+  virtual int get(const char* path, char* body, size_t capacity, size_t* length) = 0;
+  virtual int put(const char* path, const char* body, size_t length) = 0;
+  // Multi-location update: body berisi {"path/relatif": nilai, ...} terhadap path.
+  virtual int patch(const char* path, const char* body, size_t length) = 0;
+  // nullptr jika transport tidak memakai TLS atau tidak mencatatnya.
+  virtual const TlsStats* tlsStats() const { return nullptr; }
+};
+
+class PumpActuator {
+ public:
+  virtual ~PumpActuator() {}
+  virtual void setPump(int zone, bool on) = 0;
+
+  // Timer satu kali yang mematikan pompa tanpa menunggu loop() (lihat
+  // pump_service.h). false jika tidak tersedia; batas waktu lalu dicek
+  // perangkat lunak.
+  virtual bool armCutoff(int zone, unsigned long durationMs) {
+    (void)zone; (void)durationMs;
+    return false;
+  }
+  virtual void cancelCutoff(int zone) { (void)zone; }
+  // true sekali setelah timer mematikan pompa; *offAtMs = millis() saat itu.
+  virtual bool takeCutoff(int zone, unsigned long* offAtMs) {
+    (void)zone; (void)offAtMs;
+    return false;
+  }
+};
+
+// Data sensor mentah satu putaran: DHT dipakai bersama, tanah dan LDR per
+// zona (ADC 12-bit).
+struct RawSample {
+  float temperature;
+  float humidity;
+  int soilRaw[TOMATO_MAX_ZONES];
+  int ldrRaw[TOMATO_MAX_ZONES];
+};
+
+class SensorSource {
+ public:
+  virtual ~SensorSource() {}
+  // Membaca semua zona sekaligus dalam satu putaran.
+  virtual void read(RawSample* sample, int zoneCount) = 0;
+};
+
+#endif  // SMARTFARM_DEVICE_PLATFORM_H_
@@ -0,0 +1,237 @@
+#ifndef SMARTFARM_DHT22_SENSOR_H_
+#define SMARTFARM_DHT22_SENSOR_H_
+
+// Pembacaan DHT22 tanpa memblokir. Library DHT bawaan men-bit-bang
+// protokolnya dengan interrupt mati sekitar 5 ms per baca, sehingga PWM servo
+// dan timer lain ikut tertunda. Di sini pulsa balasan sensor ditangkap
+// perangkat keras (RMT di ESP32, lihat ArduinoDhtBus) dan loop() hanya:
+//   1. memulai baca (tarik jalur low ~1 ms lewat esp_timer, lalu RMT
+//      merekam), paling cepat setiap kMinIntervalMs karena DHT22 butuh 2 s;
+//   2. di putaran berikutnya mengambil rekaman pulsa dan mendekodenya.
+// Hasil terakhir disimpan; read() hanya menyalin cache itu, jadi biaya CPU
+// per sampel beberapa mikrodetik. Baca yang gagal (checksum, bentuk pulsa,
+// tidak ada balasan) dihitung dan diulang di slot 2 detik berikutnya; nilai
+// lebih tua dari staleAfterMs dianggap tidak ada (NaN).
+//
+// Bentuk sinyal setelah jalur dilepas (level, mikrodetik):
+//   high 20-40 | low 80, high 80 (balasan) | 40 x (low 50, high 26 = 0 /
+//   high 70 = 1) | low 50, lalu idle high.
+// Data 5 byte: kelembaban x10, suhu x10 (bit 15 = negatif), checksum
+// = jumlah 4 byte pertama.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "device_platform.h"
+#include "tomato_logic.h"
+
+// Satu segmen level konstan dari rekaman RMT.
+struct DhtPulse {
+  uint8_t level;
+  uint16_t us;
+};
+
+enum DhtResult {
+  DHT_OK,
+  DHT_ERR_SHORT,     // kurang dari 40 bit
+  DHT_ERR_TIMING,    // lebar pulsa di luar protokol
+  DHT_ERR_CHECKSUM,
+  DHT_ERR_TIMEOUT,   // tidak ada rekaman sama sekali
+};
+
+inline const char* dhtResultName(int result) {
+  static const char* const kNames[] = {"ok", "short", "timing", "checksum", "timeout"};
+  return result >= 0 && result <= DHT_ERR_TIMEOUT ? kNames[result] : "?";
+}
+
+// Bit diambil dari 40 pulsa high terakhir: pulsa high sebelumnya (pelepasan
+// jalur dan balasan 80 us) lebarnya bervariasi, ekornya selalu data.
+inline int decodeDht22(const DhtPulse* pulses, size_t count, float* temperature,
+                       float* humidity) {
+  const uint16_t kOneAboveUs = 48;  // tengah 26 us dan 70 us
+  const uint16_t kMaxHighUs = 100;
+  const uint16_t kMinHighUs = 10;
+  int highs = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (pulses[i].level && pulses[i].us > 0) highs++;
+  }
+  if (highs < 40) return DHT_ERR_SHORT;
+
+  uint8_t data[5] = {0, 0, 0, 0, 0};
+  int skip = highs - 40;
+  int bit = 0;
+  for (size_t i = 0; i < count && bit < 40; i++) {
+    if (!pulses[i].level || pulses[i].us == 0) continue;
+    if (skip > 0) {
+      skip--;
+      continue;
+    }
+    uint16_t us = pulses[i].us;
+    if (us < kMinHighUs || us > kMaxHighUs) return DHT_ERR_TIMING;
+    data[bit / 8] = (uint8_t)((data[bit / 8] << 1) | (us > kOneAboveUs ? 1 : 0));
+    bit++;
+  }
+  if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) return DHT_ERR_CHECKSUM;
+
+  *humidity = ((data[0] << 8) | data[1]) / 10.0f;
+  int raw = ((data[2] & 0x7F) << 8) | data[3];
+  *temperature = (data[2] & 0x80 ? -raw : raw) / 10.0f;
+  return DHT_OK;
+}
+
+// Perangkat keras penangkap pulsa (RMT di ESP32, rekaman di host).
+class DhtBus {
+ public:
+  virtual ~DhtBus() {}
+  // Mulai sinyal start dan perekaman; kembali segera. false jika gagal.
+  virtual bool startRead() = 0;
+  // Rekaman selesai: jumlah pulsa (> 0) disalin ke out. 0 jika belum ada.
+  virtual int takePulses(DhtPulse* out, size_t capacity) = 0;
+  // Hentikan perekaman yang tidak kunjung selesai.
+  virtual void cancelRead() = 0;
+};
+
+struct Dht22Stats {
+  uint32_t reads;       // baca yang dimulai
+  uint32_t ok;
+  uint32_t checksumErrors;
+  uint32_t timingErrors;  // DHT_ERR_SHORT + DHT_ERR_TIMING
+  uint32_t timeouts;
+  uint32_t retries;     // baca yang dimulai karena baca sebelumnya gagal
+  uint32_t lastOkMs;    // millis() baca sukses terakhir
+  uint8_t lastResult;   // DhtResult
+};
+
+class Dht22Sensor {
+ public:
+  static const unsigned long kMinIntervalMs = 2000;  // batas DHT22
+  static const unsigned long kCaptureTimeoutMs = 30;  // start ~1 ms + data ~5 ms
+  static const size_t kMaxPulses = 96;
+
+  Dht22Sensor(DhtBus& bus, DevicePlatform& platform, unsigned long refreshMs = 5000,
+              unsigned long staleAfterMs = 15000)
+      : bus_(bus),
+        platform_(platform),
+        refreshMs_(refreshMs < kMinIntervalMs ? kMinIntervalMs : refreshMs),
+        staleAfterMs_(staleAfterMs),
+        capturing_(false),
+        failedLast_(false),
+        hasValue_(false),
+        startedAt_(0),
+        lastOkAt_(0),
+        temperature_(NAN),
+        humidity_(NAN),
+        stats_() {}
+
+  // Dipanggil di setup(): baca pertama langsung dimulai sehingga sampel
+  // pertama di loop() sudah punya nilai.
+  void begin() { start(platform_.millis()); }
+
+  // Setiap loop(): ambil rekaman yang selesai atau mulai baca berikutnya.
+  void service() {
+    unsigned long now = platform_.millis();
+    if (capturing_) {
+      DhtPulse pulses[kMaxPulses];
+      int count = bus_.takePulses(pulses, kMaxPulses);
+      if (count > 0) {
+        float t = NAN, h = NAN;
+        int result = decodeDht22(pulses, (size_t)count, &t, &h);
+        finish(result, now, t, h);
+      } else if (now - startedAt_ >= kCaptureTimeoutMs) {
+        bus_.cancelRead();
+        finish(DHT_ERR_TIMEOUT, now, NAN, NAN);
+      }
+      return;
+    }
+    unsigned long wait = failedLast_ ? kMinIntervalMs : refreshMs_;
+    if (now - startedAt_ >= wait) start(now);
+  }
+
+  // Nilai terakhir yang masih segar; false (dan NaN) jika belum ada atau basi.
+  bool read(float* temperature, float* humidity) const {
+    if (!hasValue_ || platform_.millis() - lastOkAt_ > staleAfterMs_) {
+      *temperature = NAN;
+      *humidity = NAN;
+      return false;
+    }
+    *temperature = temperature_;
+    *humidity = humidity_;
+    return true;
+  }
+
+  const Dht22Stats& stats() const { return stats_; }
+
+  void dump(DevicePlatform& out) const {
+    char line[128];
+    snprintf(line, sizeof(line),
+             "🌡️ DHT22: %lu baca, %lu ok, checksum %lu, pulsa %lu, timeout %lu, ulang %lu (%s)",
+             (unsigned long)stats_.reads, (unsigned long)stats_.ok,
+             (unsigned long)stats_.checksumErrors, (unsigned long)stats_.timingErrors,
+             (unsigned long)stats_.timeouts, (unsigned long)stats_.retries,
+             dhtResultName(stats_.lastResult));
+    out.log(line);
+  }
+
+  void writeJson(JsonWriter& json) const {
+    json.beginObject()
+        .key("reads").value((long long)stats_.reads)
+        .key("ok").value((long long)stats_.ok)
+        .key("checksum").value((long long)stats_.checksumErrors)
+        .key("timing").value((long long)stats_.timingErrors)
+        .key("timeout").value((long long)stats_.timeouts)
+        .key("retries").value((long long)stats_.retries)
+        .key("last").value(dhtResultName(stats_.lastResult))
+        .endObject();
+  }
+
+ private:
+  void start(unsigned long now) {
+    startedAt_ = now;
+    stats_.reads++;
+    if (failedLast_) stats_.retries++;
+    capturing_ = bus_.startRead();
+    if (!capturing_) finish(DHT_ERR_TIMEOUT, now, NAN, NAN);
+  }
+
+  void finish(int result, unsigned long now, float temperature, float humidity) {
+    capturing_ = false;
+    stats_.lastResult = (uint8_t)result;
+    failedLast_ = result != DHT_OK;
+    switch (result) {
+      case DHT_OK:
+        stats_.ok++;
+        stats_.lastOkMs = (uint32_t)now;
+        temperature_ = temperature;
+        humidity_ = humidity;
+        lastOkAt_ = now;
+        hasValue_ = true;
+        break;
+      case DHT_ERR_CHECKSUM:
+        stats_.checksumErrors++;
+        break;
+      case DHT_ERR_TIMEOUT:
+        stats_.timeouts++;
+        break;
+      default:
+        stats_.timingErrors++;
+        break;
+    }
+  }
+
+  DhtBus& bus_;
+  DevicePlatform& platform_;
+  unsigned long refreshMs_;
+  unsigned long staleAfterMs_;
+  bool capturing_;
+  bool failedLast_;
+  bool hasValue_;
+  unsigned long startedAt_;
+  unsigned long lastOkAt_;
+  float temperature_;
+  float humidity_;
+  Dht22Stats stats_;
+};
+
+#endif  // SMARTFARM_DHT22_SENSOR_H_
@@ -0,0 +1,552 @@
+#ifndef SMARTFARM_ED25519_H_
+#define SMARTFARM_ED25519_H_
+
+// SHA-512 dan tanda tangan Ed25519 (RFC 8032) untuk image OTA.
+//
+// Aritmetika mengikuti TweetNaCl (domain publik): elemen medan 16 limb
+// 16 bit di int64_t, tanpa tabel dan tanpa heap, sehingga kodenya kecil
+// dan sama persis di ESP32 dan di host. Lambat dibanding implementasi
+// berbasis tabel, jadi verifikasi dipecah: Ed25519Verifier::step() hanya
+// memproses beberapa bit skalar per panggilan agar loop() tidak tertahan
+// ratusan milidetik sekaligus.
+//
+// ed25519Sign() hanya dipakai alat host (linux/tools/ota_server); di
+// firmware fungsi inline itu tidak pernah ikut terkompilasi.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class Sha512 {
+ public:
+  static const size_t kDigestSize = 64;
+
+  Sha512() { reset(); }
+
+  void reset() {
+    static const uint64_t kInit[8] = {
+        0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL,
+        0xa54ff53a5f1d36f1ULL, 0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+        0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL};
+    memcpy(state_, kInit, sizeof(state_));
+    filled_ = 0;
+    total_ = 0;
+  }
+
+  void update(const uint8_t* data, size_t length) {
+    total_ += length;
+    while (length > 0) {
+      size_t n = sizeof(block_) - filled_;
+      if (n > length) n = length;
+      memcpy(block_ + filled_, data, n);
+      filled_ += n;
+      data += n;
+      length -= n;
+      if (filled_ == sizeof(block_)) {
+        compress(block_);
+        filled_ = 0;
+      }
+    }
+  }
+
+  void finish(uint8_t digest[kDigestSize]) {
+    uint64_t bits = total_ * 8;
+    block_[filled_++] = 0x80;
+    if (filled_ > sizeof(block_) - 16) {
+      memset(block_ + filled_, 0, sizeof(block_) - filled_);
+      compress(block_);
+      filled_ = 0;
+    }
+    memset(block_ + filled_, 0, sizeof(block_) - 8 - filled_);
+    for (int i = 0; i < 8; i++) block_[sizeof(block_) - 1 - i] = (uint8_t)(bits >> (8 * i));
+    compress(block_);
+    for (int i = 0; i < 8; i++) {
+      for (int b = 0; b < 8; b++) digest[8 * i + b] = (uint8_t)(state_[i] >> (56 - 8 * b));
+    }
+    reset();
+  }
+
+ private:
+  static uint64_t rotr(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+  void compress(const uint8_t* block) {
+    static const uint64_t kRound[80] = {
+      0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+      0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+      0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+      0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+      0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+      0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+      0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+      0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+      0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+      0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+      0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+      0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+      0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+      0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+      0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+      0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+      0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+      0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+      0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+      0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+      0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+      0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+      0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+      0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+      0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+      0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+      0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+    };
+    uint64_t w[16];
+    for (int i = 0; i < 16; i++) {
+      w[i] = 0;
+      for (int b = 0; b < 8; b++) w[i] = (w[i] << 8) | block[8 * i + b];
+    }
+    uint64_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    uint64_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+    for (int i = 0; i < 80; i++) {
+      if (i >= 16) {
+        uint64_t w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+        w[i & 15] += (rotr(w15, 1) ^ rotr(w15, 8) ^ (w15 >> 7)) + w[(i - 7) & 15] +
+                     (rotr(w2, 19) ^ rotr(w2, 61) ^ (w2 >> 6));
+      }
+      uint64_t t1 = h + (rotr(e, 14) ^ rotr(e, 18) ^ rotr(e, 41)) + ((e & f) ^ (~e & g)) +
+                    kRound[i] + w[i & 15];
+      uint64_t t2 = (rotr(a, 28) ^ rotr(a, 34) ^ rotr(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+  }
+
+  uint64_t state_[8];
+  uint8_t block_[128];
+  size_t filled_;
+  uint64_t total_;
+};
+
+// --- Medan GF(2^255 - 19) dan kurva Edwards ---
+
+typedef int64_t Fe25519[16];
+typedef Fe25519 Ge25519[4];  // koordinat X, Y, Z, T
+
+const size_t kEd25519KeySize = 32;
+const size_t kEd25519SignatureSize = 64;
+
+inline void fe25519Set(Fe25519 r, const Fe25519 a) { memcpy(r, a, sizeof(Fe25519)); }
+
+inline void fe25519Carry(Fe25519 o) {
+  for (int i = 0; i < 16; i++) {
+    o[i] += 1LL << 16;
+    int64_t c = o[i] >> 16;
+    o[(i + 1) * (i < 15)] += c - 1 + 37 * (c - 1) * (i == 15);
+    o[i] -= c * 65536;
+  }
+}
+
+// Tukar p dan q jika b == 1, tanpa cabang.
+inline void fe25519Select(Fe25519 p, Fe25519 q, int b) {
+  int64_t mask = ~(int64_t)(b - 1);
+  for (int i = 0; i < 16; i++) {
+    int64_t t = mask & (p[i] ^ q[i]);
+    p[i] ^= t;
+    q[i] ^= t;
+  }
+}
+
+inline void fe25519Pack(uint8_t out[32], const Fe25519 n) {
+  Fe25519 m, t;
+  fe25519Set(t, n);
+  fe25519Carry(t);
+  fe25519Carry(t);
+  fe25519Carry(t);
+  for (int j = 0; j < 2; j++) {
+    m[0] = t[0] - 0xffed;
+    for (int i = 1; i < 15; i++) {
+      m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+      m[i - 1] &= 0xffff;
+    }
+    m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+    int b = (int)((m[15] >> 16) & 1);
+    m[14] &= 0xffff;
+    fe25519Select(t, m, 1 - b);
+  }
+  for (int i = 0; i < 16; i++) {
+    out[2 * i] = (uint8_t)(t[i] & 0xff);
+    out[2 * i + 1] = (uint8_t)(t[i] >> 8);
+  }
+}
+
+inline void fe25519Unpack(Fe25519 o, const uint8_t in[32]) {
+  for (int i = 0; i < 16; i++) o[i] = in[2 * i] + ((int64_t)in[2 * i + 1] << 8);
+  o[15] &= 0x7fff;
+}
+
+inline bool fe25519Equal(const Fe25519 a, const Fe25519 b) {
+  uint8_t c[32], d[32];
+  fe25519Pack(c, a);
+  fe25519Pack(d, b);
+  return memcmp(c, d, 32) == 0;
+}
+
+inline int fe25519Parity(const Fe25519 a) {
+  uint8_t d[32];
+  fe25519Pack(d, a);
+  return d[0] & 1;
+}
+
+inline void fe25519Add(Fe25519 o, const Fe25519 a, const Fe25519 b) {
+  for (int i = 0; i < 16; i++) o[i] = a[i] + b[i];
+}
+
+inline void fe25519Sub(Fe25519 o, const Fe25519 a, const Fe25519 b) {
+  for (int i = 0; i < 16; i++) o[i] = a[i] - b[i];
+}
+
+inline void fe25519Mul(Fe25519 o, const Fe25519 a, const Fe25519 b) {
+  int64_t t[31];
+  memset(t, 0, sizeof(t));
+  for (int i = 0; i < 16; i++) {
+    for (int j = 0; j < 16; j++) t[i + j] += a[i] * b[j];
+  }
+  for (int i = 0; i < 15; i++) t[i] += 38 * t[i + 16];
+  for (int i = 0; i < 16; i++) o[i] = t[i];
+  fe25519Carry(o);
+  fe25519Carry(o);
+}
+
+inline void fe25519Invert(Fe25519 o, const Fe25519 in) {
+  Fe25519 c;
+  fe25519Set(c, in);
+  for (int a = 253; a >= 0; a--) {
+    fe25519Mul(c, c, c);
+    if (a != 2 && a != 4) fe25519Mul(c, c, in);
+  }
+  fe25519Set(o, c);
+}
+
+inline void fe25519Pow2523(Fe25519 o, const Fe25519 in) {
+  Fe25519 c;
+  fe25519Set(c, in);
+  for (int a = 250; a >= 0; a--) {
+    fe25519Mul(c, c, c);
+    if (a != 1) fe25519Mul(c, c, in);
+  }
+  fe25519Set(o, c);
+}
+
+struct Ed25519Constants {
+  Fe25519 zero, one, d, d2, x, y, sqrtm1;
+};
+
+inline const Ed25519Constants& ed25519Constants() {
+  static const Ed25519Constants kConstants = {
+      {0},
+      {1},
+      {0x78a3, 0x1359, 0x4dca, 0x75eb, 0xd8ab, 0x4141, 0x0a4d, 0x0070, 0xe898, 0x7779, 0x4079,
+       0x8cc7, 0xfe73, 0x2b6f, 0x6cee, 0x5203},
+      {0xf159, 0x26b2, 0x9b94, 0xebd6, 0xb156, 0x8283, 0x149a, 0x00e0, 0xd130, 0xeef3, 0x80f2,
+       0x198e, 0xfce7, 0x56df, 0xd9dc, 0x2406},
+      {0xd51a, 0x8f25, 0x2d60, 0xc956, 0xa7b2, 0x9525, 0xc760, 0x692c, 0xdc5c, 0xfdd6, 0xe231,
+       0xc0a4, 0x53fe, 0xcd6e, 0x36d3, 0x2169},
+      {0x6658, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666,
+       0x6666, 0x6666, 0x6666, 0x6666, 0x6666},
+      {0xa0b0, 0x4a0e, 0x1b27, 0xc4ee, 0xe478, 0xad2f, 0x1806, 0x2f43, 0xd7a7, 0x3dfb, 0x0099,
+       0x2b4d, 0xdf0b, 0x4fc1, 0x2480, 0x2b83}};
+  return kConstants;
+}
+
+// p += q
+inline void ge25519Add(Ge25519 p, Ge25519 q) {
+  const Ed25519Constants& k = ed25519Constants();
+  Fe25519 a, b, c, d, t, e, f, g, h;
+  fe25519Sub(a, p[1], p[0]);
+  fe25519Sub(t, q[1], q[0]);
+  fe25519Mul(a, a, t);
+  fe25519Add(b, p[0], p[1]);
+  fe25519Add(t, q[0], q[1]);
+  fe25519Mul(b, b, t);
+  fe25519Mul(c, p[3], q[3]);
+  fe25519Mul(c, c, k.d2);
+  fe25519Mul(d, p[2], q[2]);
+  fe25519Add(d, d, d);
+  fe25519Sub(e, b, a);
+  fe25519Sub(f, d, c);
+  fe25519Add(g, d, c);
+  fe25519Add(h, b, a);
+  fe25519Mul(p[0], e, f);
+  fe25519Mul(p[1], h, g);
+  fe25519Mul(p[2], g, f);
+  fe25519Mul(p[3], e, h);
+}
+
+inline void ge25519Swap(Ge25519 p, Ge25519 q, int b) {
+  for (int i = 0; i < 4; i++) fe25519Select(p[i], q[i], b);
+}
+
+inline void ge25519Pack(uint8_t out[32], Ge25519 p) {
+  Fe25519 tx, ty, zi;
+  fe25519Invert(zi, p[2]);
+  fe25519Mul(tx, p[0], zi);
+  fe25519Mul(ty, p[1], zi);
+  fe25519Pack(out, ty);
+  out[31] ^= (uint8_t)(fe25519Parity(tx) << 7);
+}
+
+inline void ge25519Identity(Ge25519 p) {
+  const Ed25519Constants& k = ed25519Constants();
+  fe25519Set(p[0], k.zero);
+  fe25519Set(p[1], k.one);
+  fe25519Set(p[2], k.one);
+  fe25519Set(p[3], k.zero);
+}
+
+inline void ge25519Base(Ge25519 q) {
+  const Ed25519Constants& k = ed25519Constants();
+  fe25519Set(q[0], k.x);
+  fe25519Set(q[1], k.y);
+  fe25519Set(q[2], k.one);
+  fe25519Mul(q[3], k.x, k.y);
+}
+
+// Satu langkah tangga Montgomery untuk bit skalar ke-bit (p = hasil, q =
+// titik yang dikalikan, ikut berubah).
+inline void ge25519LadderStep(Ge25519 p, Ge25519 q, const uint8_t* scalar, int bit) {
+  int b = (scalar[bit / 8] >> (bit & 7)) & 1;
+  ge25519Swap(p, q, b);
+  ge25519Add(q, p);
+  ge25519Add(p, p);
+  ge25519Swap(p, q, b);
+}
+
+inline void ge25519ScalarMult(Ge25519 p, Ge25519 q, const uint8_t scalar[32]) {
+  ge25519Identity(p);
+  for (int bit = 255; bit >= 0; bit--) ge25519LadderStep(p, q, scalar, bit);
+}
+
+// Titik -A dari kunci publik A; false jika bukan titik kurva.
+inline bool ge25519UnpackNegative(Ge25519 r, const uint8_t in[32]) {
+  const Ed25519Constants& k = ed25519Constants();
+  Fe25519 t, chk, num, den, den2, den4, den6;
+  fe25519Set(r[2], k.one);
+  fe25519Unpack(r[1], in);
+  fe25519Mul(num, r[1], r[1]);
+  fe25519Mul(den, num, k.d);
+  fe25519Sub(num, num, r[2]);
+  fe25519Add(den, r[2], den);
+  fe25519Mul(den2, den, den);
+  fe25519Mul(den4, den2, den2);
+  fe25519Mul(den6, den4, den2);
+  fe25519Mul(t, den6, num);
+  fe25519Mul(t, t, den);
+  fe25519Pow2523(t, t);
+  fe25519Mul(t, t, num);
+  fe25519Mul(t, t, den);
+  fe25519Mul(t, t, den);
+  fe25519Mul(r[0], t, den);
+  fe25519Mul(chk, r[0], r[0]);
+  fe25519Mul(chk, chk, den);
+  if (!fe25519Equal(chk, num)) fe25519Mul(r[0], r[0], k.sqrtm1);
+  fe25519Mul(chk, r[0], r[0]);
+  fe25519Mul(chk, chk, den);
+  if (!fe25519Equal(chk, num)) return false;
+  if (fe25519Parity(r[0]) == (in[31] >> 7)) fe25519Sub(r[0], k.zero, r[0]);
+  fe25519Mul(r[3], r[0], r[1]);
+  return true;
+}
+
+// --- Skalar modulo L = 2^252 + 27742317777372353535851937790883648493 ---
+
+inline const int64_t* ed25519Order() {
+  static const int64_t kL[32] = {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+                                 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+                                 0,    0,    0,    0,    0,    0,    0,    0,
+                                 0,    0,    0,    0,    0,    0,    0,    0x10};
+  return kL;
+}
+
+inline void ed25519ModL(uint8_t r[32], int64_t x[64]) {
+  const int64_t* order = ed25519Order();
+  int64_t carry;
+  for (int i = 63; i >= 32; i--) {
+    carry = 0;
+    int j;
+    for (j = i - 32; j < i - 12; j++) {
+      x[j] += carry - 16 * x[i] * order[j - (i - 32)];
+      carry = (x[j] + 128) >> 8;
+      x[j] -= carry * 256;
+    }
+    x[j] += carry;
+    x[i] = 0;
+  }
+  carry = 0;
+  for (int j = 0; j < 32; j++) {
+    x[j] += carry - (x[31] >> 4) * order[j];
+    carry = x[j] >> 8;
+    x[j] &= 255;
+  }
+  for (int j = 0; j < 32; j++) x[j] -= carry * order[j];
+  for (int i = 0; i < 32; i++) {
+    x[i + 1] += x[i] >> 8;
+    r[i] = (uint8_t)(x[i] & 255);
+  }
+}
+
+// Hash 64 byte -> skalar 32 byte.
+inline void ed25519Reduce(uint8_t r[32], const uint8_t hash[64]) {
+  int64_t x[64];
+  for (int i = 0; i < 64; i++) x[i] = hash[i];
+  ed25519ModL(r, x);
+}
+
+// S harus < L (RFC 8032 5.1.7), jika tidak tanda tangan bisa diubah-ubah.
+inline bool ed25519ScalarCanonical(const uint8_t s[32]) {
+  const int64_t* order = ed25519Order();
+  for (int i = 31; i >= 0; i--) {
+    if (s[i] != order[i]) return s[i] < order[i];
+  }
+  return false;
+}
+
+// --- Tanda tangan ---
+
+// Verifikasi bertahap: begin() lalu step() sampai true, lalu valid().
+// Kedua perkalian skalar ([h](-A) dan [S]B) berjalan bersamaan, satu bit
+// per langkah; total 256 langkah.
+class Ed25519Verifier {
+ public:
+  Ed25519Verifier() : bit_(-1), ready_(false) {}
+
+  // false jika kunci publik atau S tidak valid (tidak perlu step()).
+  bool begin(const uint8_t signature[kEd25519SignatureSize], const uint8_t* message,
+             size_t length, const uint8_t publicKey[kEd25519KeySize]) {
+    ready_ = false;
+    bit_ = -1;
+    Ge25519 negA;
+    if (!ed25519ScalarCanonical(signature + 32) || !ge25519UnpackNegative(negA, publicKey)) {
+      return false;
+    }
+    memcpy(r_, signature, 32);
+    memcpy(s_, signature + 32, 32);
+    uint8_t hash[Sha512::kDigestSize];
+    Sha512 sha;
+    sha.update(signature, 32);
+    sha.update(publicKey, kEd25519KeySize);
+    sha.update(message, length);
+    sha.finish(hash);
+    ed25519Reduce(h_, hash);
+
+    memcpy(q1_, negA, sizeof(Ge25519));
+    ge25519Identity(p1_);
+    ge25519Base(q2_);
+    ge25519Identity(p2_);
+    bit_ = 255;
+    ready_ = true;
+    return true;
+  }
+
+  // Proses sampai `bits` bit; true jika semua bit selesai.
+  bool step(int bits) {
+    while (bits-- > 0 && bit_ >= 0) {
+      ge25519LadderStep(p1_, q1_, h_, bit_);
+      ge25519LadderStep(p2_, q2_, s_, bit_);
+      bit_--;
+    }
+    return bit_ < 0;
+  }
+
+  // [S]B - [h]A == R
+  bool valid() {
+    if (!ready_ || bit_ >= 0) return false;
+    ge25519Add(p1_, p2_);
+    uint8_t packed[32];
+    ge25519Pack(packed, p1_);
+    ready_ = false;
+    return memcmp(packed, r_, 32) == 0;
+  }
+
+ private:
+  Ge25519 p1_, q1_, p2_, q2_;
+  uint8_t r_[32];
+  uint8_t s_[32];
+  uint8_t h_[32];
+  int bit_;
+  bool ready_;
+};
+
+inline bool ed25519Verify(const uint8_t signature[kEd25519SignatureSize], const uint8_t* message,
+                          size_t length, const uint8_t publicKey[kEd25519KeySize]) {
+  Ed25519Verifier verifier;
+  if (!verifier.begin(signature, message, length, publicKey)) return false;
+  verifier.step(256);
+  return verifier.valid();
+}
+
+// Kunci publik dari seed rahasia 32 byte.
+inline void ed25519PublicKey(uint8_t publicKey[kEd25519KeySize], const uint8_t seed[32]) {
+  uint8_t d[Sha512::kDigestSize];
+  Sha512 sha;
+  sha.update(seed, 32);
+  sha.finish(d);
+  d[0] &= 248;
+  d[31] &= 127;
+  d[31] |= 64;
+  Ge25519 p, base;
+  ge25519Base(base);
+  ge25519ScalarMult(p, base, d);
+  ge25519Pack(publicKey, p);
+}
+
+inline void ed25519Sign(uint8_t signature[kEd25519SignatureSize], const uint8_t* message,
+                        size_t length, const uint8_t seed[32]) {
+  uint8_t publicKey[kEd25519KeySize];
+  ed25519PublicKey(publicKey, seed);
+  uint8_t d[Sha512::kDigestSize], hash[Sha512::kDigestSize];
+  Sha512 sha;
+  sha.update(seed, 32);
+  sha.finish(d);
+  d[0] &= 248;
+  d[31] &= 127;
+  d[31] |= 64;
+
+  uint8_t r[32], h[32];
+  sha.update(d + 32, 32);
+  sha.update(message, length);
+  sha.finish(hash);
+  ed25519Reduce(r, hash);
+  Ge25519 p, base;
+  ge25519Base(base);
+  ge25519ScalarMult(p, base, r);
+  ge25519Pack(signature, p);
+
+  sha.update(signature, 32);
+  sha.update(publicKey, kEd25519KeySize);
+  sha.update(message, length);
+  sha.finish(hash);
+  ed25519Reduce(h, hash);
+
+  int64_t x[64];
+  memset(x, 0, sizeof(x));
+  for (int i = 0; i < 32; i++) x[i] = r[i];
+  for (int i = 0; i < 32; i++) {
+    for (int j = 0; j < 32; j++) x[i + j] += (int64_t)h[i] * d[j];
+  }
+  ed25519ModL(signature + 32, x);
+}
+
+#endif  // SMARTFARM_ED25519_H_
@@ -0,0 +1,400 @@
+#ifndef SMARTFARM_FIRMWARE_DELTA_H_
+#define SMARTFARM_FIRMWARE_DELTA_H_
+
+// Patch biner firmware ("SFDP"): image baru disusun dari potongan image yang
+// sedang berjalan plus byte baru, sehingga update biasa hanya mengunduh bagian
+// yang berubah. Dibuat di host oleh linux/tools/ota_server.cc.
+//
+// Header 32 byte, little-endian:
+//   "SFDP" | u16 versi (1) | u16 flags (0) | u32 ukuran sumber | u32 CRC32
+//   sumber | u32 ukuran target | u32 CRC32 target | u32 build asal | u32 build
+//   tujuan
+// Lalu operasi sampai END:
+//   0x01 COPY    zigzag varint (offset - akhir COPY sebelumnya), varint panjang
+//   0x02 INSERT  varint panjang, lalu byte sebanyak itu
+//   0x00 END
+// Offset COPY relatif terhadap akhir COPY sebelumnya karena kode yang hanya
+// bergeser menghasilkan offset 0 atau kecil (1 byte). Pembuat patch membatasi
+// satu COPY ke kDeltaMaxCopy agar satu feed() tidak menahan loop() lama.
+// Image utuh dikirim sebagai patch tanpa sumber (ukuran sumber 0, hanya
+// INSERT), jadi perangkat hanya punya satu jalur pemasangan.
+//
+// DeltaPatcher memproses patch sepotong demi sepotong dari stream HTTP dengan
+// buffer tetap; image target ditulis berurutan ke FirmwareSlots. CRC32 sumber
+// dicek sebelum unduh (OtaUpdater), CRC32 dan ukuran target dicek di END.
+//
+// CRC hanya menangkap kerusakan. Keaslian dijamin tanda tangan Ed25519
+// (ed25519.h) atas firmwareSignedMessage(): build, ukuran dan SHA-512 image
+// target, yang dihitung patcher sambil menulis. Karena yang ditandatangani
+// image target, image utuh dan semua delta ke build itu memakai satu tanda
+// tangan. Partisi baru hanya dipasang lewat install() setelah OtaUpdater
+// memverifikasinya.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ed25519.h"
+
+// Dua partisi app: yang berjalan (dibaca untuk COPY) dan yang tidak aktif
+// (ditulis). Implementasi ESP32 memakai esp_ota_* (arduino_platform.h).
+class FirmwareSlots {
+ public:
+  virtual ~FirmwareSlots() {}
+  // Baca image yang sedang berjalan; false di luar partisi.
+  virtual bool readRunning(uint32_t offset, uint8_t* out, size_t length) = 0;
+  // Ukuran partisi tidak aktif: batas image yang boleh dipasang.
+  virtual uint32_t updateCapacity() = 0;
+  // Siapkan partisi tidak aktif untuk image berukuran size.
+  virtual bool beginUpdate(uint32_t size) = 0;
+  // Tulis berurutan setelah beginUpdate().
+  virtual bool writeUpdate(const uint8_t* data, size_t length) = 0;
+  // Validasi image tertulis dan jadikan partisi boot berikutnya.
+  virtual bool finishUpdate() = 0;
+  virtual void abortUpdate() = 0;
+
+  // Rollback: image yang berjalan baru dipasang dan belum dikonfirmasi.
+  // Jika perangkat reboot sebelum markValid(), bootloader kembali ke image
+  // lama.
+  virtual bool pendingVerify() = 0;
+  virtual void markValid() = 0;
+  // Tandai image yang berjalan gagal lalu reboot ke image lama.
+  virtual void rollback() = 0;
+  virtual void restart() = 0;
+};
+
+// CRC-32 (IEEE, sama dengan zlib); tabel 4 bit supaya tidak memakan RAM.
+inline uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+  static const uint32_t kTable[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+      0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ kTable[crc & 15];
+    crc = (crc >> 4) ^ kTable[crc & 15];
+  }
+  return ~crc;
+}
+
+const uint8_t kDeltaMagic[4] = {'S', 'F', 'D', 'P'};
+const uint16_t kDeltaVersion = 1;
+const size_t kDeltaHeaderSize = 32;
+const uint32_t kDeltaMaxCopy = 64 * 1024;
+
+enum DeltaOp {
+  DELTA_OP_END = 0x00,
+  DELTA_OP_COPY = 0x01,
+  DELTA_OP_INSERT = 0x02,
+};
+
+struct DeltaHeader {
+  uint32_t sourceSize;  // 0 untuk image utuh
+  uint32_t sourceCrc;
+  uint32_t targetSize;
+  uint32_t targetCrc;
+  uint32_t fromBuild;   // 0 untuk image utuh
+  uint32_t toBuild;
+};
+
+inline void deltaPutU32(uint8_t* out, uint32_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+  out[2] = (uint8_t)(value >> 16);
+  out[3] = (uint8_t)(value >> 24);
+}
+
+inline uint32_t deltaGetU32(const uint8_t* in) {
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+         ((uint32_t)in[3] << 24);
+}
+
+inline void encodeDeltaHeader(const DeltaHeader& header, uint8_t out[kDeltaHeaderSize]) {
+  memcpy(out, kDeltaMagic, 4);
+  out[4] = (uint8_t)kDeltaVersion;
+  out[5] = (uint8_t)(kDeltaVersion >> 8);
+  out[6] = 0;
+  out[7] = 0;
+  deltaPutU32(out + 8, header.sourceSize);
+  deltaPutU32(out + 12, header.sourceCrc);
+  deltaPutU32(out + 16, header.targetSize);
+  deltaPutU32(out + 20, header.targetCrc);
+  deltaPutU32(out + 24, header.fromBuild);
+  deltaPutU32(out + 28, header.toBuild);
+}
+
+inline bool decodeDeltaHeader(const uint8_t in[kDeltaHeaderSize], DeltaHeader* header) {
+  if (memcmp(in, kDeltaMagic, 4) != 0 || (in[4] | (in[5] << 8)) != kDeltaVersion) return false;
+  header->sourceSize = deltaGetU32(in + 8);
+  header->sourceCrc = deltaGetU32(in + 12);
+  header->targetSize = deltaGetU32(in + 16);
+  header->targetCrc = deltaGetU32(in + 20);
+  header->fromBuild = deltaGetU32(in + 24);
+  header->toBuild = deltaGetU32(in + 28);
+  return header->targetSize > 0;
+}
+
+// Pesan yang ditandatangani untuk satu build:
+//   "SFFW" | u32 build | u32 ukuran image | SHA-512 image
+const size_t kFirmwareSignedMessageSize = 12 + Sha512::kDigestSize;
+
+inline void firmwareSignedMessage(uint32_t build, uint32_t size,
+                                  const uint8_t digest[Sha512::kDigestSize],
+                                  uint8_t out[kFirmwareSignedMessageSize]) {
+  memcpy(out, "SFFW", 4);
+  deltaPutU32(out + 4, build);
+  deltaPutU32(out + 8, size);
+  memcpy(out + 12, digest, Sha512::kDigestSize);
+}
+
+enum DeltaStatus {
+  DELTA_MORE,          // butuh byte patch berikutnya
+  DELTA_DONE,          // END diterima, target tertulis dan CRC cocok; belum
+                       // dipasang sampai install()
+  DELTA_ERR_HEADER,    // magic/versi salah atau tidak sesuai yang diharapkan
+  DELTA_ERR_CORRUPT,   // operasi tidak dikenal atau keluar batas
+  DELTA_ERR_FLASH,     // baca sumber / tulis target gagal
+  DELTA_ERR_VERIFY,    // ukuran atau CRC target salah, atau image ditolak
+};
+
+inline const char* deltaStatusName(int status) {
+  static const char* const kNames[] = {"more",    "done",  "bad_header",
+                                       "corrupt", "flash", "verify_failed"};
+  return status >= 0 && status <= DELTA_ERR_VERIFY ? kNames[status] : "?";
+}
+
+class DeltaPatcher {
+ public:
+  explicit DeltaPatcher(FirmwareSlots& slots) : slots_(slots) { reset(); }
+
+  // Patch baru. expected: header yang diumumkan manifest; header di patch
+  // harus sama persis.
+  void reset(const DeltaHeader* expected = nullptr) {
+    if (expected) {
+      expected_ = *expected;
+      hasExpected_ = true;
+    } else {
+      hasExpected_ = false;
+    }
+    state_ = READ_HEADER;
+    filled_ = 0;
+    outLength_ = 0;
+    written_ = 0;
+    crc_ = 0;
+    copyEnd_ = 0;
+    status_ = DELTA_MORE;
+    begun_ = false;
+    sha_.reset();
+  }
+
+  const DeltaHeader& header() const { return header_; }
+  // SHA-512 image target; berlaku setelah DELTA_DONE.
+  const uint8_t* targetDigest() const { return digest_; }
+  uint32_t written() const { return written_; }
+  DeltaStatus status() const { return status_; }
+
+  // Potongan patch berikutnya (ukuran bebas). Setelah status selain
+  // DELTA_MORE, byte berikutnya diabaikan.
+  DeltaStatus feed(const uint8_t* data, size_t length) {
+    size_t i = 0;
+    while (i < length && status_ == DELTA_MORE) {
+      switch (state_) {
+        case READ_HEADER: {
+          size_t n = kDeltaHeaderSize - filled_;
+          if (n > length - i) n = length - i;
+          memcpy(headerBytes_ + filled_, data + i, n);
+          filled_ += n;
+          i += n;
+          if (filled_ == kDeltaHeaderSize) startTarget();
+          break;
+        }
+        case READ_OP:
+          op_ = data[i++];
+          varint_ = 0;
+          shift_ = 0;
+          if (op_ == DELTA_OP_END) {
+            finish();
+          } else if (op_ == DELTA_OP_COPY) {
+            state_ = READ_COPY_OFFSET;
+          } else if (op_ == DELTA_OP_INSERT) {
+            state_ = READ_LENGTH;
+          } else {
+            fail(DELTA_ERR_CORRUPT);
+          }
+          break;
+        case READ_COPY_OFFSET:
+          if (readVarint(data[i++])) {
+            copyDelta_ = (int32_t)(varint_ >> 1) ^ -(int32_t)(varint_ & 1);
+            varint_ = 0;
+            shift_ = 0;
+            state_ = READ_LENGTH;
+          }
+          break;
+        case READ_LENGTH:
+          if (readVarint(data[i++])) {
+            if (op_ == DELTA_OP_COPY) {
+              copy(varint_);
+              state_ = READ_OP;
+            } else {
+              remaining_ = varint_;
+              state_ = remaining_ > 0 ? INSERT_DATA : READ_OP;
+            }
+          }
+          break;
+        case INSERT_DATA: {
+          size_t n = length - i < remaining_ ? length - i : remaining_;
+          emit(data + i, n);
+          i += n;
+          remaining_ -= (uint32_t)n;
+          if (remaining_ == 0 && status_ == DELTA_MORE) state_ = READ_OP;
+          break;
+        }
+      }
+    }
+    return status_;
+  }
+
+  // Setelah DELTA_DONE dan tanda tangan cocok: jadikan partisi baru partisi
+  // boot berikutnya. false (partisi dilepas) jika FirmwareSlots menolaknya.
+  bool install() {
+    if (!begun_ || status_ != DELTA_DONE) return false;
+    begun_ = false;  // finishUpdate melepas partisi, berhasil atau tidak
+    if (!slots_.finishUpdate()) {
+      status_ = DELTA_ERR_VERIFY;
+      return false;
+    }
+    return true;
+  }
+
+  // Hentikan patch yang belum dipasang (koneksi putus permanen, tanda
+  // tangan salah, dsb.).
+  void abort() {
+    if (begun_) slots_.abortUpdate();
+    begun_ = false;
+  }
+
+ private:
+  enum State { READ_HEADER, READ_OP, READ_COPY_OFFSET, READ_LENGTH, INSERT_DATA };
+
+  bool sameHeader(const DeltaHeader& a, const DeltaHeader& b) const {
+    return a.sourceSize == b.sourceSize && a.sourceCrc == b.sourceCrc &&
+           a.targetSize == b.targetSize && a.targetCrc == b.targetCrc &&
+           a.fromBuild == b.fromBuild && a.toBuild == b.toBuild;
+  }
+
+  void startTarget() {
+    if (!decodeDeltaHeader(headerBytes_, &header_) ||
+        (hasExpected_ && !sameHeader(header_, expected_))) {
+      fail(DELTA_ERR_HEADER);
+      return;
+    }
+    if (!slots_.beginUpdate(header_.targetSize)) {
+      fail(DELTA_ERR_FLASH);
+      return;
+    }
+    begun_ = true;
+    state_ = READ_OP;
+  }
+
+  // LEB128; true saat byte terakhir varint.
+  bool readVarint(uint8_t byte) {
+    if (shift_ > 28) {
+      fail(DELTA_ERR_CORRUPT);
+      return false;
+    }
+    varint_ |= (uint32_t)(byte & 0x7F) << shift_;
+    shift_ += 7;
+    return (byte & 0x80) == 0;
+  }
+
+  void copy(uint32_t length) {
+    int64_t offset = (int64_t)copyEnd_ + copyDelta_;
+    if (offset < 0 || offset + length > header_.sourceSize) {
+      fail(DELTA_ERR_CORRUPT);
+      return;
+    }
+    uint32_t at = (uint32_t)offset;
+    copyEnd_ = at + length;
+    uint8_t chunk[256];
+    while (length > 0 && status_ == DELTA_MORE) {
+      size_t n = length < sizeof(chunk) ? length : sizeof(chunk);
+      if (!slots_.readRunning(at, chunk, n)) {
+        fail(DELTA_ERR_FLASH);
+        return;
+      }
+      emit(chunk, n);
+      at += (uint32_t)n;
+      length -= (uint32_t)n;
+    }
+  }
+
+  // Byte target berikutnya, lewat buffer agar tulis flash per 1 KB.
+  void emit(const uint8_t* data, size_t length) {
+    if (written_ + outLength_ + length > header_.targetSize) {
+      fail(DELTA_ERR_CORRUPT);
+      return;
+    }
+    crc_ = crc32Update(crc_, data, length);
+    sha_.update(data, length);
+    while (length > 0) {
+      size_t n = sizeof(out_) - outLength_;
+      if (n > length) n = length;
+      memcpy(out_ + outLength_, data, n);
+      outLength_ += n;
+      data += n;
+      length -= n;
+      if (outLength_ == sizeof(out_) && !flush()) return;
+    }
+  }
+
+  bool flush() {
+    if (outLength_ == 0) return true;
+    if (!slots_.writeUpdate(out_, outLength_)) {
+      fail(DELTA_ERR_FLASH);
+      return false;
+    }
+    written_ += (uint32_t)outLength_;
+    outLength_ = 0;
+    return true;
+  }
+
+  void finish() {
+    if (!flush()) return;
+    if (written_ != header_.targetSize || crc_ != header_.targetCrc) {
+      fail(DELTA_ERR_VERIFY);
+      return;
+    }
+    sha_.finish(digest_);
+    status_ = DELTA_DONE;
+  }
+
+  void fail(DeltaStatus status) {
+    status_ = status;
+    abort();
+  }
+
+  FirmwareSlots& slots_;
+  DeltaHeader expected_;
+  DeltaHeader header_;
+  bool hasExpected_;
+  bool begun_;
+  State state_;
+  DeltaStatus status_;
+  uint8_t headerBytes_[kDeltaHeaderSize];
+  size_t filled_;
+  uint8_t op_;
+  uint32_t varint_;
+  int shift_;
+  int32_t copyDelta_;
+  uint32_t copyEnd_;
+  uint32_t remaining_;  // sisa byte INSERT
+  uint32_t written_;
+  uint32_t crc_;
+  Sha512 sha_;
+  uint8_t digest_[Sha512::kDigestSize];
+  uint8_t out_[1024];
+  size_t outLength_;
+};
+
+#endif  // SMARTFARM_FIRMWARE_DELTA_H_
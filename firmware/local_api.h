@@ -0,0 +1,184 @@
+#ifndef SMARTFARM_LOCAL_API_H_
+#define SMARTFARM_LOCAL_API_H_
+
+// Endpoint JSON untuk dashboard di LAN, dilayani LocalHttpServer:
+//
+//   GET  /api/snapshot                 data terbaru semua zona
+//   GET  /api/samples?since=<ms>       sampel dari ring buffer setelah since
+//        [&limit=N]                    (maks kMaxSamples per respons)
+//   GET  /api/stats                    latensi, heap, jaringan, pompa, server
+//   POST /api/pump?zone=1&action=on    nyalakan pompa ([&seconds=N])
+//   POST /api/pump?zone=1&action=off   matikan pompa
+//
+// POST wajib membawa header X-SmartFarm-Key yang sama dengan apiKey; tanpa
+// apiKey semua POST ditolak (403), jadi pompa tidak pernah terbuka tanpa
+// kunci. Hanya respons GET yang boleh dibaca halaman web dari origin lain
+// (lihat LocalHttpServer::startResponse()).
+// Data dibaca langsung dari TomatoDevice, jadi respons tidak menunggu
+// Firebase dan tetap jalan saat internet putus.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "local_http_server.h"
+#include "tomato_device.h"
+
+class LocalApi : public HttpHandler {
+ public:
+  static const int kMaxSamples = 60;
+
+  LocalApi(TomatoDevice& device, DevicePlatform& platform, const char* apiKey = "")
+      : device_(device), platform_(platform), apiKey_(apiKey), server_(nullptr) {}
+
+  // Untuk menampilkan statistik server di /api/stats.
+  void attach(const LocalHttpServer& server) { server_ = &server; }
+
+  int handle(const HttpRequest& request, JsonWriter& json) override {
+    bool get = strcmp(request.method, "GET") == 0;
+    bool post = strcmp(request.method, "POST") == 0;
+    if (strcmp(request.path, "/api/snapshot") == 0) {
+      if (!get) return methodNotAllowed(json);
+      writeSnapshot(json);
+      return 200;
+    }
+    if (strcmp(request.path, "/api/samples") == 0) {
+      if (!get) return methodNotAllowed(json);
+      return handleSamples(request, json);
+    }
+    if (strcmp(request.path, "/api/stats") == 0) {
+      if (!get) return methodNotAllowed(json);
+      writeStats(json);
+      return 200;
+    }
+    if (strcmp(request.path, "/api/pump") == 0) {
+      if (!post) return methodNotAllowed(json);
+      if (apiKey_[0] == '\0') return error(json, 403, "LOCAL_API_KEY belum diisi");
+      if (!keyMatches(request.apiKey)) return error(json, 401, "X-SmartFarm-Key salah");
+      return handlePump(request, json);
+    }
+    return error(json, 404, "endpoint tidak dikenal");
+  }
+
+ private:
+  void writeSnapshot(JsonWriter& json) {
+    const DeviceState& state = device_.state;
+    json.beginObject()
+        .key("device").value(device_.config().deviceId)
+        .key("uptime_ms").value((long long)platform_.millis())
+        .key("online").value(state.online)
+        .key("suhu").value(state.currentTemperature, 1)
+        .key("kelembaban_udara").value(state.currentHumidity, 1)
+        .key("status_kelembaban").value(state.currentAirHumStatus);
+    json.key("zones").beginArray();
+    for (int i = 0; i < device_.zoneCount(); i++) {
+      Zone& zone = device_.zone(i);
+      const ZoneState& zs = zone.state;
+      json.beginObject()
+          .key("zona").value(zone.config->id)
+          .key("kelembaban_tanah").value(zs.currentSoilPercent, 1)
+          .key("kecerahan").value(zs.currentBrightnessPercent, 1)
+          .key("kategori_tanah").value(zs.currentSoilCategory)
+          .key("status_pompa").value(zs.currentPompaStatus ? "ON" : "OFF")
+          .key("pompa_sisa_ms").value((long long)device_.pumps().remainingMs(i))
+          .key("mode_operasi").value(zs.currentOperatingMode)
+          .key("umur_tanaman").value(zs.plantAgeDays)
+          .key("tahapan_tanaman").value(getPlantStage(zs.plantAgeDays, device_.tuning().crop))
+          .key("threshold_tanah").value(device_.soilThreshold(zone))
+          .endObject();
+    }
+    json.endArray().endObject();
+  }
+
+  int handleSamples(const HttpRequest& request, JsonWriter& json) {
+    char value[24];
+    long long since = 0;
+    int limit = kMaxSamples;
+    if (httpQueryParam(request.query, "since", value, sizeof(value))) {
+      since = strtoll(value, nullptr, 10);
+    }
+    if (httpQueryParam(request.query, "limit", value, sizeof(value))) {
+      limit = atoi(value);
+      if (limit <= 0 || limit > kMaxSamples) limit = kMaxSamples;
+    }
+    device_.recentSamples().writeJson(json, since, limit);
+    return 200;
+  }
+
+  void writeStats(JsonWriter& json) {
+    json.beginObject();
+    json.key("latency");
+    device_.profiler().writeJson(json);
+    json.key("memory");
+    device_.memory().writeJson(json);
+    json.key("network");
+    device_.netStats().writeJson(json);
+    json.key("pump");
+    device_.pumps().writeJson(json);
+    if (server_) {
+      const LocalHttpStats& http = server_->stats();
+      json.key("local_http").beginObject()
+          .key("requests").value((long long)http.requests)
+          .key("errors").value((long long)http.errors)
+          .key("timeouts").value((long long)http.timeouts)
+          .key("max_poll_us").value((long long)http.maxPollUs)
+          .endObject();
+    }
+    json.key("config_version").value((long long)device_.tuning().version)
+        .key("uptime_ms").value((long long)platform_.millis())
+        .endObject();
+  }
+
+  int handlePump(const HttpRequest& request, JsonWriter& json) {
+    char value[16];
+    if (!httpQueryParam(request.query, "zone", value, sizeof(value))) {
+      return error(json, 400, "zone wajib");
+    }
+    int zone = atoi(value) - 1;
+    char action[8] = "";
+    httpQueryParam(request.query, "action", action, sizeof(action));
+    unsigned long seconds = 0;
+    if (httpQueryParam(request.query, "seconds", value, sizeof(value))) {
+      seconds = strtoul(value, nullptr, 10);
+    }
+
+    bool ok;
+    if (strcmp(action, "on") == 0) {
+      ok = device_.startPump(zone, seconds * 1000UL);
+    } else if (strcmp(action, "off") == 0) {
+      ok = device_.stopPump(zone);
+    } else {
+      return error(json, 400, "action harus on atau off");
+    }
+    if (!ok) return error(json, 409, "perintah pompa ditolak");
+
+    json.beginObject()
+        .key("zone").value(zone + 1)
+        .key("running").value(device_.pumps().running(zone))
+        .key("remaining_ms").value((long long)device_.pumps().remainingMs(zone))
+        .endObject();
+    return 200;
+  }
+
+  // Waktu perbandingan tidak bergantung pada posisi byte pertama yang beda.
+  bool keyMatches(const char* key) const {
+    size_t length = strlen(apiKey_);
+    if (strlen(key) != length) return false;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < length; i++) diff |= (unsigned char)(key[i] ^ apiKey_[i]);
+    return diff == 0;
+  }
+
+  int methodNotAllowed(JsonWriter& json) { return error(json, 405, "method tidak didukung"); }
+
+  int error(JsonWriter& json, int status, const char* message) {
+    json.beginObject().key("error").value(message).endObject();
+    return status;
+  }
+
+  TomatoDevice& device_;
+  DevicePlatform& platform_;
+  const char* apiKey_;
+  const LocalHttpServer* server_;
+};
+
+#endif  // SMARTFARM_LOCAL_API_H_
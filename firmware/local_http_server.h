@@ -0,0 +1,284 @@
+#ifndef SMARTFARM_LOCAL_HTTP_SERVER_H_
+#define SMARTFARM_LOCAL_HTTP_SERVER_H_
+
+// Server HTTP/1.0 kecil untuk klien di LAN. poll() dipanggil setiap iterasi
+// loop() dan tidak pernah menunggu: setiap panggilan hanya membaca byte yang
+// sudah tersedia atau menulis satu potongan respons, lalu kembali. Satu
+// koneksi dilayani sekaligus; koneksi lain menunggu di backlog socket.
+// Respons selalu JSON dengan "Connection: close". Hanya respons GET yang
+// membawa "Access-Control-Allow-Origin: *"; preflight OPTIONS tidak dijawab,
+// sehingga halaman web dari origin lain tidak bisa mengirim POST (pompa).
+//
+// Socket disembunyikan di balik LanListener/LanConnection sehingga server
+// yang sama berjalan di ESP32 (WiFiServer) dan di host (socket POSIX).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "device_platform.h"
+#include "tomato_logic.h"
+
+class LanConnection {
+ public:
+  virtual ~LanConnection() {}
+  // Byte yang bisa dibaca tanpa menunggu; < 0 jika koneksi sudah ditutup.
+  virtual int read(char* buffer, size_t capacity) = 0;
+  // Byte yang diterima socket (boleh kurang dari length); < 0 jika error.
+  virtual int write(const char* data, size_t length) = 0;
+  virtual void close() = 0;
+};
+
+class LanListener {
+ public:
+  virtual ~LanListener() {}
+  // Koneksi baru atau nullptr; pointer berlaku sampai close().
+  virtual LanConnection* accept() = 0;
+};
+
+struct HttpRequest {
+  char method[8];
+  const char* path;   // tanpa query
+  const char* query;  // setelah '?', "" jika tidak ada
+  const char* apiKey; // header X-SmartFarm-Key, "" jika tidak ada
+};
+
+// Nilai parameter query; false jika tidak ada.
+inline bool httpQueryParam(const char* query, const char* name, char* out, size_t capacity) {
+  size_t nameLength = strlen(name);
+  const char* p = query;
+  while (*p) {
+    const char* end = strchr(p, '&');
+    if (!end) end = p + strlen(p);
+    if ((size_t)(end - p) > nameLength && strncmp(p, name, nameLength) == 0 && p[nameLength] == '=') {
+      const char* value = p + nameLength + 1;
+      size_t n = (size_t)(end - value);
+      if (n >= capacity) n = capacity - 1;
+      memcpy(out, value, n);
+      out[n] = '\0';
+      return true;
+    }
+    p = *end ? end + 1 : end;
+  }
+  return false;
+}
+
+class HttpHandler {
+ public:
+  virtual ~HttpHandler() {}
+  // Menulis body JSON ke json; kembali kode status HTTP.
+  virtual int handle(const HttpRequest& request, JsonWriter& json) = 0;
+};
+
+struct LocalHttpStats {
+  uint32_t requests;
+  uint32_t errors;    // 4xx/5xx dari handler atau request rusak
+  uint32_t timeouts;  // koneksi ditutup karena diam terlalu lama
+  uint32_t maxPollUs; // poll() terlama
+};
+
+class LocalHttpServer {
+ public:
+  static const size_t kRequestSize = 768;
+  static const size_t kBodySize = 6144;
+  static const size_t kWriteChunk = 1024;  // byte per poll()
+  static const unsigned long kIdleTimeoutMs = 2000;
+
+  LocalHttpServer(LanListener& listener, DevicePlatform& platform, HttpHandler& handler)
+      : listener_(listener),
+        platform_(platform),
+        handler_(handler),
+        conn_(nullptr),
+        phase_(READING),
+        lastActivity_(0),
+        requestLength_(0),
+        headerLength_(0),
+        bodyLength_(0),
+        sent_(0) {
+    memset(&stats_, 0, sizeof(stats_));
+  }
+
+  const LocalHttpStats& stats() const { return stats_; }
+  bool busy() const { return conn_ != nullptr; }
+
+  void poll() {
+    unsigned long startUs = platform_.micros();
+    step();
+    unsigned long elapsed = platform_.micros() - startUs;
+    if (elapsed > stats_.maxPollUs) stats_.maxPollUs = (uint32_t)elapsed;
+  }
+
+ private:
+  enum Phase { READING, WRITING };
+
+  void step() {
+    unsigned long now = platform_.millis();
+    if (!conn_) {
+      conn_ = listener_.accept();
+      if (!conn_) return;
+      phase_ = READING;
+      requestLength_ = 0;
+      lastActivity_ = now;
+    }
+
+    if (phase_ == READING) {
+      int n = conn_->read(request_ + requestLength_, kRequestSize - 1 - requestLength_);
+      if (n < 0) {
+        closeConnection();
+        return;
+      }
+      if (n > 0) {
+        requestLength_ += (size_t)n;
+        request_[requestLength_] = '\0';
+        lastActivity_ = now;
+      }
+      if (strstr(request_, "\r\n\r\n") || strstr(request_, "\n\n")) {
+        dispatch();
+      } else if (requestLength_ >= kRequestSize - 1) {
+        respondError(431, "request terlalu besar");
+      } else if (now - lastActivity_ >= kIdleTimeoutMs) {
+        stats_.timeouts++;
+        closeConnection();
+        return;
+      }
+    }
+
+    if (phase_ == WRITING) {
+      size_t total = headerLength_ + bodyLength_;
+      size_t chunk = total - sent_ < kWriteChunk ? total - sent_ : kWriteChunk;
+      const char* data = sent_ < headerLength_ ? header_ + sent_ : body_ + (sent_ - headerLength_);
+      if (sent_ < headerLength_ && chunk > headerLength_ - sent_) chunk = headerLength_ - sent_;
+      int n = conn_->write(data, chunk);
+      if (n < 0) {
+        closeConnection();
+        return;
+      }
+      if (n > 0) {
+        sent_ += (size_t)n;
+        lastActivity_ = now;
+      }
+      if (sent_ >= total) {
+        closeConnection();
+      } else if (now - lastActivity_ >= kIdleTimeoutMs) {
+        stats_.timeouts++;
+        closeConnection();
+      }
+    }
+  }
+
+  void dispatch() {
+    stats_.requests++;
+    // "GET /api/x?y=1 HTTP/1.1"
+    char* lineEnd = strpbrk(request_, "\r\n");
+    if (lineEnd) *lineEnd = '\0';
+    char* space = strchr(request_, ' ');
+    if (!space || (size_t)(space - request_) >= sizeof(HttpRequest().method)) {
+      respondError(400, "request line rusak");
+      return;
+    }
+    HttpRequest request;
+    memcpy(request.method, request_, space - request_);
+    request.method[space - request_] = '\0';
+    char* target = space + 1;
+    char* version = strchr(target, ' ');
+    if (version) *version = '\0';
+    char* query = strchr(target, '?');
+    if (query) *query++ = '\0';
+    request.path = target;
+    request.query = query ? query : "";
+    request.apiKey = lineEnd ? findHeader(lineEnd + 1, "X-SmartFarm-Key") : "";
+
+    JsonWriter json(body_, sizeof(body_));
+    int status = handler_.handle(request, json);
+    if (!json.ok()) {
+      respondError(500, "respons terlalu besar");
+      return;
+    }
+    if (status >= 400) stats_.errors++;
+    bodyLength_ = json.length();
+    startResponse(status, strcmp(request.method, "GET") == 0);
+  }
+
+  // Nilai header (case-insensitive) di blok header; "" jika tidak ada.
+  // Mengubah request_ di tempat: akhir nilai diganti '\0'.
+  static const char* findHeader(char* headers, const char* name) {
+    size_t nameLength = strlen(name);
+    for (char* line = headers; *line;) {
+      while (*line == '\r' || *line == '\n') line++;
+      char* end = strpbrk(line, "\r\n");
+      if (strncasecmp(line, name, nameLength) == 0 && line[nameLength] == ':') {
+        char* value = line + nameLength + 1;
+        while (*value == ' ') value++;
+        if (end) *end = '\0';
+        return value;
+      }
+      if (!end) break;
+      line = end;
+    }
+    return "";
+  }
+
+  void respondError(int status, const char* message) {
+    stats_.errors++;
+    JsonWriter json(body_, sizeof(body_));
+    json.beginObject().key("error").value(message).endObject();
+    bodyLength_ = json.length();
+    startResponse(status);
+  }
+
+  // crossOrigin: data baca-saja boleh dibaca dashboard web dari origin lain.
+  void startResponse(int status, bool crossOrigin = false) {
+    int n = snprintf(header_, sizeof(header_),
+                     "HTTP/1.0 %d %s\r\n"
+                     "Content-Type: application/json\r\n"
+                     "Content-Length: %u\r\n"
+                     "%s"
+                     "Cache-Control: no-store\r\n"
+                     "Connection: close\r\n\r\n",
+                     status, statusText(status), (unsigned)bodyLength_,
+                     crossOrigin ? "Access-Control-Allow-Origin: *\r\n" : "");
+    headerLength_ = n > 0 && (size_t)n < sizeof(header_) ? (size_t)n : 0;
+    sent_ = 0;
+    phase_ = WRITING;
+  }
+
+  static const char* statusText(int status) {
+    switch (status) {
+      case 200: return "OK";
+      case 400: return "Bad Request";
+      case 401: return "Unauthorized";
+      case 403: return "Forbidden";
+      case 404: return "Not Found";
+      case 405: return "Method Not Allowed";
+      case 409: return "Conflict";
+      case 431: return "Request Header Fields Too Large";
+      default: return status < 400 ? "OK" : "Error";
+    }
+  }
+
+  void closeConnection() {
+    conn_->close();
+    conn_ = nullptr;
+  }
+
+  LanListener& listener_;
+  DevicePlatform& platform_;
+  HttpHandler& handler_;
+  LanConnection* conn_;
+  Phase phase_;
+  unsigned long lastActivity_;
+
+  char request_[kRequestSize];
+  size_t requestLength_;
+  char header_[320];
+  size_t headerLength_;
+  char body_[kBodySize];
+  size_t bodyLength_;
+  size_t sent_;
+  LocalHttpStats stats_;
+};
+
+#endif  // SMARTFARM_LOCAL_HTTP_SERVER_H_
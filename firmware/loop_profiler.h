@@ -0,0 +1,159 @@
+#ifndef SMARTFARM_LOOP_PROFILER_H_
+#define SMARTFARM_LOOP_PROFILER_H_
+
+// Histogram latensi per tahap loop(). Setiap tahap dibungkus StageTimer
+// (dua panggilan micros() + satu increment bucket), cukup ringan untuk tetap
+// aktif di produksi. Bucket berskala log2 dalam mikrodetik sehingga ukuran
+// state tetap dan p50/p99 bisa diperkirakan tanpa menyimpan sampel.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "device_platform.h"
+#include "tomato_logic.h"
+
+enum LoopStage {
+  STAGE_SENSOR_READ,      // DHT + ADC (SensorSource::read)
+  STAGE_CONTROL_GET,      // GET <zona>/control.json
+  STAGE_ALERT_RULES,      // evaluasi aturan notifikasi (termasuk PUT-nya)
+  STAGE_NOTIFY_PUT,       // PUT /notifications/<key>
+  STAGE_NOTIFY_GET,       // GET /notifications (cek dari aplikasi)
+  STAGE_JSON_BUILD,       // penyusunan batch di sendToFirebase
+  STAGE_DATA_PATCH,       // PATCH history_data + current_data
+  STAGE_DISPLAY,          // displaySensorData (LCD)
+  STAGE_CYCLE,            // satu putaran sampel penuh
+  STAGE_COUNT
+};
+
+inline const char* loopStageName(int stage) {
+  static const char* const kNames[STAGE_COUNT] = {
+    "sensor_read", "control_get", "alert_rules", "notify_put", "notify_get",
+    "json_build",  "data_patch",  "display",     "cycle",
+  };
+  return stage >= 0 && stage < STAGE_COUNT ? kNames[stage] : "?";
+}
+
+// Bucket i menampung durasi [2^(i-1), 2^i) us; bucket 0 untuk < 1 us.
+// 26 bucket menjangkau sampai ~33 detik.
+struct LatencyHistogram {
+  static const int kBuckets = 26;
+
+  uint32_t buckets[kBuckets];
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t totalUs;
+
+  static int bucketOf(uint32_t us) {
+    if (us == 0) return 0;
+    int bits = 32 - __builtin_clz(us);
+    return bits < kBuckets ? bits : kBuckets - 1;
+  }
+
+  // Batas atas bucket (us), dipakai sebagai perkiraan persentil.
+  static uint32_t bucketUpperUs(int bucket) {
+    return bucket == 0 ? 1 : (uint32_t)1 << bucket;
+  }
+
+  void reset() {
+    for (int i = 0; i < kBuckets; i++) buckets[i] = 0;
+    count = 0;
+    maxUs = 0;
+    totalUs = 0;
+  }
+
+  void record(uint32_t us) {
+    buckets[bucketOf(us)]++;
+    count++;
+    totalUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+
+  // fraction 0..1. Tidak melebihi max yang benar-benar terukur.
+  uint32_t percentileUs(float fraction) const {
+    if (count == 0) return 0;
+    uint32_t rank = (uint32_t)(fraction * (count - 1)) + 1;
+    uint32_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        uint32_t upper = bucketUpperUs(i);
+        return upper < maxUs ? upper : maxUs;
+      }
+    }
+    return maxUs;
+  }
+};
+
+class LoopProfiler {
+ public:
+  explicit LoopProfiler(DevicePlatform& platform) : platform_(platform) { reset(); }
+
+  void reset() {
+    for (int i = 0; i < STAGE_COUNT; i++) stages_[i].reset();
+  }
+
+  unsigned long now() { return platform_.micros(); }
+  void record(LoopStage stage, uint32_t us) { stages_[stage].record(us); }
+  const LatencyHistogram& stage(int stage) const { return stages_[stage]; }
+
+  // Satu baris per tahap yang pernah tercatat.
+  void dump(DevicePlatform& out) const {
+    char line[96];
+    out.log("⏱️ Latensi per tahap (us): count p50 p99 max");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+      const LatencyHistogram& h = stages_[i];
+      if (h.count == 0) continue;
+      snprintf(line, sizeof(line), "  %-12s %6lu %8lu %8lu %8lu", loopStageName(i),
+               (unsigned long)h.count, (unsigned long)h.percentileUs(0.50f),
+               (unsigned long)h.percentileUs(0.99f), (unsigned long)h.maxUs);
+      out.log(line);
+    }
+  }
+
+  // {"sensor_read":{"count":..,"p50_us":..,"p99_us":..,"max_us":..},...}
+  void writeJson(JsonWriter& json) const {
+    json.beginObject();
+    for (int i = 0; i < STAGE_COUNT; i++) {
+      const LatencyHistogram& h = stages_[i];
+      if (h.count == 0) continue;
+      json.key(loopStageName(i)).beginObject()
+          .key("count").value((long long)h.count)
+          .key("p50_us").value((long long)h.percentileUs(0.50f))
+          .key("p99_us").value((long long)h.percentileUs(0.99f))
+          .key("max_us").value((long long)h.maxUs)
+          .endObject();
+    }
+    json.endObject();
+  }
+
+ private:
+  DevicePlatform& platform_;
+  LatencyHistogram stages_[STAGE_COUNT];
+};
+
+// Mengukur satu blok: StageTimer t(profiler, STAGE_X);
+class StageTimer {
+ public:
+  StageTimer(LoopProfiler& profiler, LoopStage stage)
+      : profiler_(profiler), stage_(stage), start_(profiler.now()), running_(true) {}
+  ~StageTimer() { stop(); }
+
+  // Berhenti lebih awal, sebelum akhir blok.
+  void stop() {
+    if (!running_) return;
+    running_ = false;
+    profiler_.record(stage_, (uint32_t)(profiler_.now() - start_));
+  }
+
+ private:
+  StageTimer(const StageTimer&);
+  StageTimer& operator=(const StageTimer&);
+
+  LoopProfiler& profiler_;
+  LoopStage stage_;
+  unsigned long start_;
+  bool running_;
+};
+
+#endif  // SMARTFARM_LOOP_PROFILER_H_
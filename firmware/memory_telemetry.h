@@ -0,0 +1,148 @@
+#ifndef SMARTFARM_MEMORY_TELEMETRY_H_
+#define SMARTFARM_MEMORY_TELEMETRY_H_
+
+// Telemetri heap: free heap, blok bebas terbesar (fragmentasi), free heap
+// minimum sejak boot, dan jumlah alokasi per iterasi loop(). Setiap jendela
+// diagnostik menyimpan satu titik tren sehingga kebocoran lambat (node yang
+// melambat setelah berhari-hari) terlihat sebagai kemiringan byte/jam.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "device_platform.h"
+#include "tomato_logic.h"
+
+class MemoryTelemetry {
+ public:
+  static const int kTrendPoints = 24;  // 24 jendela (4 jam dengan jendela 10 menit)
+
+  MemoryTelemetry() { reset(); }
+
+  void reset() {
+    hasHeap_ = false;
+    memset(&last_, 0, sizeof(last_));
+    loopStartAllocs_ = 0;
+    trendCount_ = 0;
+    trendHead_ = 0;
+    resetWindow();
+  }
+
+  // Dipanggil di awal dan akhir loop(). Murah: hanya membaca penghitung.
+  void beginLoop(DevicePlatform& platform) { loopStartAllocs_ = platform.allocationCount(); }
+
+  void endLoop(DevicePlatform& platform) {
+    uint32_t allocs = platform.allocationCount() - loopStartAllocs_;
+    windowLoops_++;
+    windowAllocs_ += allocs;
+    if (allocs > windowMaxAllocsPerLoop_) windowMaxAllocsPerLoop_ = allocs;
+  }
+
+  // Baca heap lengkap; sekali per putaran sampel karena mencari blok
+  // terbesar perlu menelusuri heap.
+  void sample(DevicePlatform& platform) {
+    HeapStats stats;
+    if (!platform.heapStats(&stats)) return;
+    last_ = stats;
+    hasHeap_ = true;
+    if (windowMinFree_ == 0 || stats.freeBytes < windowMinFree_) windowMinFree_ = stats.freeBytes;
+  }
+
+  // Menutup jendela diagnostik: simpan titik tren dari sampel terakhir.
+  void pushTrend(unsigned long nowMs) {
+    if (!hasHeap_) return;
+    trendMs_[trendHead_] = nowMs;
+    trendFree_[trendHead_] = last_.freeBytes;
+    trendHead_ = (trendHead_ + 1) % kTrendPoints;
+    if (trendCount_ < kTrendPoints) trendCount_++;
+  }
+
+  void resetWindow() {
+    windowLoops_ = 0;
+    windowAllocs_ = 0;
+    windowMaxAllocsPerLoop_ = 0;
+    windowMinFree_ = 0;
+  }
+
+  bool hasHeap() const { return hasHeap_; }
+  const HeapStats& last() const { return last_; }
+
+  // 0 = satu blok utuh, 100 = sangat terfragmentasi.
+  int fragmentationPercent() const {
+    if (!hasHeap_ || last_.freeBytes == 0) return 0;
+    return 100 - (int)((uint64_t)last_.largestFreeBlock * 100 / last_.freeBytes);
+  }
+
+  float allocsPerLoop() const {
+    return windowLoops_ ? (float)windowAllocs_ / (float)windowLoops_ : 0.0f;
+  }
+
+  // Kemiringan least-squares free heap terhadap waktu (byte/jam); negatif
+  // berarti heap menyusut. 0 jika titik tren belum cukup.
+  float trendBytesPerHour() const {
+    if (trendCount_ < 3) return 0.0f;
+    int first = (trendHead_ - trendCount_ + kTrendPoints) % kTrendPoints;
+    unsigned long t0 = trendMs_[first];
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    for (int i = 0; i < trendCount_; i++) {
+      int idx = (first + i) % kTrendPoints;
+      double x = (double)(trendMs_[idx] - t0) / 3600000.0;
+      double y = (double)trendFree_[idx];
+      sumX += x;
+      sumY += y;
+      sumXX += x * x;
+      sumXY += x * y;
+    }
+    double n = trendCount_;
+    double denom = n * sumXX - sumX * sumX;
+    if (denom <= 0) return 0.0f;
+    return (float)((n * sumXY - sumX * sumY) / denom);
+  }
+
+  void dump(DevicePlatform& out) const {
+    char line[112];
+    if (hasHeap_) {
+      snprintf(line, sizeof(line), "🧠 Heap: free %lu, blok terbesar %lu (frag %d%%), min %lu",
+               (unsigned long)last_.freeBytes, (unsigned long)last_.largestFreeBlock,
+               fragmentationPercent(), (unsigned long)last_.minFreeBytes);
+      out.log(line);
+    }
+    snprintf(line, sizeof(line), "🧠 Alokasi/loop: rata2 %.2f, maks %lu; tren %.0f B/jam",
+             allocsPerLoop(), (unsigned long)windowMaxAllocsPerLoop_, trendBytesPerHour());
+    out.log(line);
+  }
+
+  void writeJson(JsonWriter& json) const {
+    json.beginObject();
+    if (hasHeap_) {
+      json.key("free").value((long long)last_.freeBytes)
+          .key("largest_block").value((long long)last_.largestFreeBlock)
+          .key("min_free").value((long long)last_.minFreeBytes)
+          .key("window_min_free").value((long long)windowMinFree_)
+          .key("frag_pct").value(fragmentationPercent())
+          .key("live_blocks").value((long long)last_.liveBlocks);
+    }
+    json.key("allocs_per_loop").value(allocsPerLoop(), 3)
+        .key("allocs_per_loop_max").value((long long)windowMaxAllocsPerLoop_)
+        .key("trend_bytes_per_h").value(trendBytesPerHour(), 1)
+        .endObject();
+  }
+
+ private:
+  bool hasHeap_;
+  HeapStats last_;
+  uint32_t loopStartAllocs_;
+
+  uint32_t windowLoops_;
+  uint32_t windowAllocs_;
+  uint32_t windowMaxAllocsPerLoop_;
+  uint32_t windowMinFree_;
+
+  unsigned long trendMs_[kTrendPoints];
+  uint32_t trendFree_[kTrendPoints];
+  int trendCount_;
+  int trendHead_;
+};
+
+#endif  // SMARTFARM_MEMORY_TELEMETRY_H_
@@ -0,0 +1,224 @@
+#ifndef SMARTFARM_NET_STATS_H_
+#define SMARTFARM_NET_STATS_H_
+
+// Akuntansi jaringan per endpoint logis. MeteredRtdbTransport membungkus
+// transport asli sehingga setiap GET/PUT/PATCH tercatat tanpa mengubah
+// pemanggil: jumlah request, byte kirim/terima, sebaran kode status, error,
+// timeout dan reconnect WiFi. Angka kumulatif sejak boot (pemakaian kuota).
+//
+// Byte yang dihitung adalah path + body; header HTTP dan overhead TLS tidak
+// ikut, jadi pemakaian kuota sebenarnya sedikit lebih besar.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "device_platform.h"
+#include "tomato_logic.h"
+
+// Kode error HTTPClient ESP32 untuk timeout baca.
+const int kHttpReadTimeout = -11;
+
+enum NetEndpoint {
+  NET_DATA,           // PATCH batch history_data + current_data
+  NET_CONTROL,        // GET <zona>/control.json
+  NET_NOTIFICATIONS,  // PUT /notifications/<key>
+  NET_NOTIFY_POLL,    // GET /notifications (cek dari aplikasi)
+  NET_READ_ACK,       // PUT /notifications/<key>/isRead
+  NET_DIAGNOSTICS,    // PATCH /diagnostics/<device>
+  NET_CONFIG,         // GET /config/<device>
+  NET_COMMAND_ACK,    // PUT <zona>/control_ack (pump_command.h)
+  NET_OTHER,
+  NET_ENDPOINT_COUNT
+};
+
+inline const char* netEndpointName(int endpoint) {
+  static const char* const kNames[NET_ENDPOINT_COUNT] = {
+    "data",        "control", "notifications", "notify_poll", "read_ack",
+    "diagnostics", "config",  "command_ack",   "other",
+  };
+  return endpoint >= 0 && endpoint < NET_ENDPOINT_COUNT ? kNames[endpoint] : "?";
+}
+
+// Klasifikasi dari path REST (sudah termasuk ".json" dan query).
+inline NetEndpoint classifyRtdbPath(const char* path) {
+  if (strstr(path, "/control.json")) return NET_CONTROL;
+  if (strstr(path, "/control_ack.json")) return NET_COMMAND_ACK;
+  if (strncmp(path, "/diagnostics/", 13) == 0) return NET_DIAGNOSTICS;
+  if (strncmp(path, "/config/", 8) == 0) return NET_CONFIG;
+  if (strncmp(path, "/notifications.json", 19) == 0) return NET_NOTIFY_POLL;
+  if (strncmp(path, "/notifications/", 15) == 0) {
+    return strstr(path, "/isRead") ? NET_READ_ACK : NET_NOTIFICATIONS;
+  }
+  if (strcmp(path, "/.json") == 0 || strstr(path, "current_data") || strstr(path, "history_data")) {
+    return NET_DATA;
+  }
+  return NET_OTHER;
+}
+
+struct EndpointStats {
+  uint32_t requests;
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+  uint32_t status2xx;
+  uint32_t status3xx;
+  uint32_t status4xx;
+  uint32_t status5xx;
+  uint32_t errors;    // kode <= 0 (koneksi gagal, timeout, dst.)
+  uint32_t timeouts;  // bagian dari errors
+
+  void record(int code, size_t sent, size_t received) {
+    requests++;
+    bytesSent += (uint32_t)sent;
+    bytesReceived += (uint32_t)received;
+    if (code <= 0) {
+      errors++;
+      if (code == kHttpReadTimeout) timeouts++;
+    } else if (code < 300) {
+      status2xx++;
+    } else if (code < 400) {
+      status3xx++;
+    } else if (code < 500) {
+      status4xx++;
+    } else {
+      status5xx++;
+    }
+  }
+
+  uint32_t failures() const { return errors + status4xx + status5xx; }
+};
+
+struct NetStats {
+  EndpointStats endpoints[NET_ENDPOINT_COUNT];
+  uint32_t reconnects;    // WiFi kembali terhubung setelah putus
+  uint32_t offlineSkips;  // tugas jaringan dilewati karena WiFi putus
+
+  uint32_t totalSent() const {
+    uint32_t total = 0;
+    for (int i = 0; i < NET_ENDPOINT_COUNT; i++) total += endpoints[i].bytesSent;
+    return total;
+  }
+
+  uint32_t totalReceived() const {
+    uint32_t total = 0;
+    for (int i = 0; i < NET_ENDPOINT_COUNT; i++) total += endpoints[i].bytesReceived;
+    return total;
+  }
+
+  void dump(DevicePlatform& out) const {
+    char line[112];
+    out.log("🌐 Jaringan per endpoint: req tx rx 2xx 4xx 5xx err timeout");
+    for (int i = 0; i < NET_ENDPOINT_COUNT; i++) {
+      const EndpointStats& e = endpoints[i];
+      if (e.requests == 0) continue;
+      snprintf(line, sizeof(line), "  %-13s %6lu %8lu %8lu %5lu %4lu %4lu %4lu %4lu",
+               netEndpointName(i), (unsigned long)e.requests, (unsigned long)e.bytesSent,
+               (unsigned long)e.bytesReceived, (unsigned long)e.status2xx,
+               (unsigned long)e.status4xx, (unsigned long)e.status5xx, (unsigned long)e.errors,
+               (unsigned long)e.timeouts);
+      out.log(line);
+    }
+    snprintf(line, sizeof(line), "  total tx %lu B, rx %lu B, reconnect %lu, skip offline %lu",
+             (unsigned long)totalSent(), (unsigned long)totalReceived(),
+             (unsigned long)reconnects, (unsigned long)offlineSkips);
+    out.log(line);
+  }
+
+  void writeJson(JsonWriter& json) const {
+    json.beginObject();
+    for (int i = 0; i < NET_ENDPOINT_COUNT; i++) {
+      const EndpointStats& e = endpoints[i];
+      if (e.requests == 0) continue;
+      json.key(netEndpointName(i)).beginObject()
+          .key("req").value((long long)e.requests)
+          .key("tx").value((long long)e.bytesSent)
+          .key("rx").value((long long)e.bytesReceived)
+          .key("s2xx").value((long long)e.status2xx)
+          .key("s3xx").value((long long)e.status3xx)
+          .key("s4xx").value((long long)e.status4xx)
+          .key("s5xx").value((long long)e.status5xx)
+          .key("err").value((long long)e.errors)
+          .key("timeout").value((long long)e.timeouts)
+          .endObject();
+    }
+    json.key("reconnects").value((long long)reconnects)
+        .key("offline_skips").value((long long)offlineSkips)
+        .endObject();
+  }
+};
+
+// Statistik handshake TLS dari transport (lihat ArduinoRtdbTransport).
+inline void dumpTlsStats(const TlsStats& tls, DevicePlatform& out) {
+  char line[136];
+  snprintf(line, sizeof(line),
+           "🔒 TLS: handshake %lu (lanjut sesi %lu, gagal %lu), pakai ulang %lu, terakhir %lu ms, "
+           "maks %lu ms, rata2 %lu ms",
+           (unsigned long)tls.handshakes, (unsigned long)tls.resumedHandshakes,
+           (unsigned long)tls.handshakeFailures,
+           (unsigned long)tls.reusedRequests, (unsigned long)tls.lastHandshakeMs,
+           (unsigned long)tls.maxHandshakeMs,
+           (unsigned long)(tls.handshakes ? tls.totalHandshakeMs / tls.handshakes : 0));
+  out.log(line);
+}
+
+inline void writeTlsJson(const TlsStats& tls, JsonWriter& json) {
+  json.beginObject()
+      .key("handshakes").value((long long)tls.handshakes)
+      .key("resumed").value((long long)tls.resumedHandshakes)
+      .key("failures").value((long long)tls.handshakeFailures)
+      .key("reused").value((long long)tls.reusedRequests)
+      .key("last_ms").value((long long)tls.lastHandshakeMs)
+      .key("max_ms").value((long long)tls.maxHandshakeMs)
+      .key("total_ms").value((long long)tls.totalHandshakeMs)
+      .endObject();
+}
+
+class MeteredRtdbTransport : public RtdbTransport {
+ public:
+  explicit MeteredRtdbTransport(RtdbTransport& inner)
+      : inner_(inner), wasConnected_(false), everConnected_(false) {
+    memset(&stats_, 0, sizeof(stats_));
+  }
+
+  bool connected() override {
+    bool now = inner_.connected();
+    if (now && !wasConnected_ && everConnected_) stats_.reconnects++;
+    if (now) everConnected_ = true;
+    wasConnected_ = now;
+    return now;
+  }
+
+  // Dipanggil pemanggil yang benar-benar melewatkan request karena
+  // connected() false; connected() sendiri juga dipakai sekadar memeriksa.
+  void countOfflineSkip() { stats_.offlineSkips++; }
+
+  int get(const char* path, char* body, size_t capacity, size_t* length) override {
+    int code = inner_.get(path, body, capacity, length);
+    stats_.endpoints[classifyRtdbPath(path)].record(code, strlen(path), *length);
+    return code;
+  }
+
+  int put(const char* path, const char* body, size_t length) override {
+    int code = inner_.put(path, body, length);
+    stats_.endpoints[classifyRtdbPath(path)].record(code, strlen(path) + length, 0);
+    return code;
+  }
+
+  int patch(const char* path, const char* body, size_t length) override {
+    int code = inner_.patch(path, body, length);
+    stats_.endpoints[classifyRtdbPath(path)].record(code, strlen(path) + length, 0);
+    return code;
+  }
+
+  const TlsStats* tlsStats() const override { return inner_.tlsStats(); }
+
+  const NetStats& stats() const { return stats_; }
+
+ private:
+  RtdbTransport& inner_;
+  NetStats stats_;
+  bool wasConnected_;
+  bool everConnected_;
+};
+
+#endif  // SMARTFARM_NET_STATS_H_
@@ -0,0 +1,566 @@
+#ifndef SMARTFARM_OTA_UPDATE_H_
+#define SMARTFARM_OTA_UPDATE_H_
+
+// Update firmware lewat jaringan dengan patch delta (firmware_delta.h).
+//
+// Server update (host Firebase Hosting, atau linux/tools/ota_server di LAN)
+// menyediakan manifest:
+//   {"build": 13, "size": <byte image>, "crc": <CRC32 image>,
+//    "sig": "<tanda tangan Ed25519, 128 hex>",
+//    "image":  {"path": "/firmware/13.sfdp", "bytes": N},
+//    "deltas": {"12": {"path": "/firmware/12-13.sfdp", "bytes": M,
+//                      "source_size": S, "source_crc": C}, ...}}
+// Perangkat dengan build 12 mengunduh patch 12→13 (biasanya sebagian kecil
+// image), build lain atau sumber yang CRC-nya tidak cocok mengunduh image
+// utuh. Semuanya berjalan di service() yang dipanggil setiap loop(): setiap
+// panggilan hanya membaca/menulis beberapa KB, jadi sampel, pompa dan API
+// lokal tetap jalan selama unduh. Koneksi yang putus dilanjutkan dengan
+// header Range dari byte terakhir.
+//
+// Setelah image terpasang, perangkat menunggu semua pompa mati lalu reboot.
+// Image baru harus sehat (satu upload data berhasil) dalam confirmTimeoutMs;
+// jika tidak, ia menandai dirinya gagal dan kembali ke image lama. Crash
+// sebelum konfirmasi ditangani bootloader (rollback ESP-IDF). Build yang
+// gagal dicatat di NVS dan tidak diunduh lagi.
+//
+// Progres ditulis ke /ota/<device_id> saat fase berganti dan setiap 10%.
+//
+// Server update tidak dipercaya: manifest dan patch boleh lewat HTTP polos.
+// CRC32 hanya menangkap kerusakan; image target baru dipasang jika "sig"
+// adalah tanda tangan Ed25519 yang sah atas firmwareSignedMessage()
+// (firmware_delta.h) dengan kunci publik di OtaConfig. Kunci privatnya hanya
+// ada di mesin rilis (ota_server --keygen / --publish --key). Verifikasi
+// berjalan bertahap di service() (~256 langkah tangga, beberapa per loop()).
+// Karena itu angka di manifest dicek lebih dulu (bilangan bulat uint32, image
+// muat di partisi tujuan) sebelum apa pun diunduh.
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "device_log.h"
+#include "device_platform.h"
+#include "firmware_delta.h"
+#include "rtdb_json.h"
+#include "tomato_device.h"
+
+// HTTP ke server update.
+class UpdateTransport {
+ public:
+  virtual ~UpdateTransport() {}
+  // Request kecil (manifest). Kode HTTP, <= 0 error koneksi.
+  virtual int get(const char* path, char* body, size_t capacity, size_t* length) = 0;
+  // Mulai unduh dari byte offset (Range jika > 0). Kode HTTP (200/206);
+  // *length = byte yang akan dikirim.
+  virtual int openStream(const char* path, uint32_t offset, uint32_t* length) = 0;
+  // Byte yang sudah tersedia; 0 jika belum ada, < 0 jika koneksi putus.
+  virtual int read(uint8_t* buffer, size_t capacity) = 0;
+  virtual void closeStream() = 0;
+};
+
+struct OtaConfig {
+  uint32_t build;                  // build image yang sedang berjalan
+  const char* manifestPath;
+  unsigned long checkIntervalMs;
+  unsigned long firstCheckDelayMs; // setelah begin()
+  unsigned long confirmTimeoutMs;  // batas image baru untuk sehat
+  unsigned long stallTimeoutMs;    // tanpa byte selama ini = koneksi putus
+  uint8_t maxReconnects;           // per unduhan
+  const char* publicKeyHex;        // kunci publik Ed25519, 64 hex
+};
+
+inline OtaConfig defaultOtaConfig(uint32_t build, const char* publicKeyHex) {
+  OtaConfig config;
+  config.build = build;
+  config.publicKeyHex = publicKeyHex;
+  config.manifestPath = "/firmware/manifest.json";
+  config.checkIntervalMs = 6UL * 60 * 60 * 1000;
+  config.firstCheckDelayMs = 60UL * 1000;
+  config.confirmTimeoutMs = 5UL * 60 * 1000;
+  config.stallTimeoutMs = 15UL * 1000;
+  config.maxReconnects = 5;
+  return config;
+}
+
+// Angka manifest yang disimpan sebagai uint32_t: bilangan bulat
+// 0..4294967295. Manifest belum tepercaya sampai tanda tangannya dicek, jadi
+// NaN, inf, negatif dan pecahan ditolak sebelum cast.
+inline bool readManifestUint32(JsonSpan object, const char* key, uint32_t* out) {
+  JsonSpan field;
+  double number;
+  if (!jsonFindMember(object, key, &field) || !jsonToDouble(field, &number) ||
+      !(number >= 0 && number <= 4294967295.0)) {
+    return false;
+  }
+  uint32_t value = (uint32_t)number;
+  if ((double)value != number) return false;
+  *out = value;
+  return true;
+}
+
+enum OtaPhase {
+  OTA_IDLE,
+  OTA_VERIFY_SOURCE,  // CRC32 image berjalan vs manifest delta
+  OTA_DOWNLOAD,
+  OTA_VERIFY_SIGNATURE,  // image tertulis, tanda tangan dicek sebelum dipasang
+  OTA_INSTALLED,      // menunggu pompa mati untuk reboot
+  OTA_CONFIRMING,     // image baru, menunggu sehat
+};
+
+struct OtaProgress {
+  OtaPhase phase;
+  uint32_t targetBuild;
+  bool delta;
+  uint32_t received;  // byte patch diterima
+  uint32_t total;     // ukuran patch
+  uint8_t reconnects;
+  char error[24];     // "" jika tidak ada
+
+  int percent() const { return total > 0 ? (int)((uint64_t)received * 100 / total) : 0; }
+};
+
+class OtaUpdater {
+ public:
+  static const size_t kManifestSize = 1024;
+  static const size_t kPathSize = 64;
+  static const uint32_t kVerifyBytesPerService = 16 * 1024;
+  static const int kChunksPerService = 8;
+  static const int kSignatureBitsPerService = 8;
+
+  OtaUpdater(TomatoDevice& device, DevicePlatform& platform, UpdateTransport& transport,
+             FirmwareSlots& slots, const OtaConfig& config)
+      : device_(device),
+        platform_(platform),
+        transport_(transport),
+        slots_(slots),
+        config_(config),
+        patcher_(slots),
+        checkRequested_(false),
+        streamOpen_(false),
+        fullOnlyBuild_(0),
+        lastCheck_(0),
+        bootMs_(0),
+        lastByteMs_(0),
+        reportedPercent_(-1),
+        unsentState_(nullptr) {
+    memset(&progress_, 0, sizeof(progress_));
+    memset(&record_, 0, sizeof(record_));
+    memset(&expected_, 0, sizeof(expected_));
+    memset(signature_, 0, sizeof(signature_));
+    path_[0] = '\0';
+    keyValid_ = parseHex(config.publicKeyHex, publicKey_, sizeof(publicKey_));
+  }
+
+  const OtaProgress& progress() const { return progress_; }
+  bool active() const { return progress_.phase != OTA_IDLE; }
+
+  // Dipanggil di setup() setelah device.begin(): selesaikan catatan update
+  // dari boot sebelumnya.
+  void begin() {
+    if (!platform_.loadBlob(kRecordKey, &record_, sizeof(record_)) ||
+        record_.magic != kRecordMagic) {
+      memset(&record_, 0, sizeof(record_));
+      record_.magic = kRecordMagic;
+    }
+    bootMs_ = platform_.millis();
+    lastCheck_ = bootMs_ - config_.checkIntervalMs + config_.firstCheckDelayMs;
+    if (record_.installedBuild == 0) return;
+
+    progress_.targetBuild = record_.installedBuild;
+    if (record_.installedBuild != config_.build) {
+      // Bootloader kembali ke image lama: image baru crash sebelum konfirmasi.
+      record_.badBuild = record_.installedBuild;
+      setError("boot_failed");
+      report("rolled_back");
+    } else if (slots_.pendingVerify()) {
+      progress_.phase = OTA_CONFIRMING;
+      report("confirming");
+    } else {
+      report("confirmed");
+    }
+    record_.installedBuild = 0;
+    saveRecord();
+  }
+
+  // Perintah serial "ota": cek manifest di service() berikutnya.
+  void requestCheck() { checkRequested_ = true; }
+
+  void service() {
+    if (unsentState_ && device_.state.online) report(unsentState_);
+    switch (progress_.phase) {
+      case OTA_IDLE:
+        if (checkRequested_ || platform_.millis() - lastCheck_ >= config_.checkIntervalMs) {
+          checkRequested_ = false;
+          lastCheck_ = platform_.millis();
+          checkManifest();
+        }
+        break;
+      case OTA_VERIFY_SOURCE:
+        verifySource();
+        break;
+      case OTA_DOWNLOAD:
+        download();
+        break;
+      case OTA_VERIFY_SIGNATURE:
+        verifySignature();
+        break;
+      case OTA_INSTALLED:
+        if (!pumpRunning()) {
+          report("rebooting");
+          slots_.restart();
+        }
+        break;
+      case OTA_CONFIRMING:
+        confirm();
+        break;
+    }
+  }
+
+ private:
+  static constexpr const char* kRecordKey = "ota";
+  static const uint32_t kRecordMagic = 0x4F544131;  // "OTA1"
+
+  // Disimpan di NVS, bertahan saat reboot dan rollback.
+  struct OtaRecord {
+    uint32_t magic;
+    uint32_t installedBuild;  // dipasang, belum pernah di-boot
+    uint32_t badBuild;        // gagal di-boot; tidak diunduh lagi
+  };
+
+  void checkManifest() {
+    if (!device_.state.online) return;
+    if (!keyValid_) {
+      SF_LOGE("❌ OTA: kunci publik tidak valid, update dimatikan");
+      return;
+    }
+    size_t length = 0;
+    int code = transport_.get(config_.manifestPath, manifest_, sizeof(manifest_), &length);
+    if (code != 200) {
+      SF_LOGW("⚠️ OTA: manifest tidak bisa diambil (%d)", code);
+      return;
+    }
+    JsonSpan root = jsonSpanOf(manifest_, length);
+    JsonSpan field;
+    uint32_t target = 0, size = 0, crc = 0;
+    if (!readManifestUint32(root, "build", &target) || !readManifestUint32(root, "size", &size) ||
+        !readManifestUint32(root, "crc", &crc)) {
+      SF_LOGW("⚠️ OTA: manifest tidak valid");
+      return;
+    }
+    if (target <= config_.build || target == record_.badBuild) return;
+    if (size == 0 || size > slots_.updateCapacity()) {
+      SF_LOGW("⚠️ OTA: image build %lu (%lu byte) tidak muat di partisi %lu byte",
+              (unsigned long)target, (unsigned long)size, (unsigned long)slots_.updateCapacity());
+      return;
+    }
+    char sig[2 * kEd25519SignatureSize + 1];
+    if (!jsonFindMember(root, "sig", &field) || jsonCopyString(field, sig, sizeof(sig)) == 0 ||
+        !parseHex(sig, signature_, sizeof(signature_))) {
+      SF_LOGW("⚠️ OTA: manifest build %lu tanpa tanda tangan, diabaikan", (unsigned long)target);
+      return;
+    }
+
+    memset(&progress_, 0, sizeof(progress_));
+    progress_.targetBuild = target;
+    memset(&expected_, 0, sizeof(expected_));
+    expected_.targetSize = size;
+    expected_.targetCrc = crc;
+    expected_.toBuild = target;
+
+    char from[12];
+    snprintf(from, sizeof(from), "%lu", (unsigned long)config_.build);
+    JsonSpan deltas, delta;
+    if (fullOnlyBuild_ != target && jsonFindMember(root, "deltas", &deltas) &&
+        jsonFindMember(deltas, from, &delta) && readEntry(delta) &&
+        readManifestUint32(delta, "source_size", &expected_.sourceSize) &&
+        readManifestUint32(delta, "source_crc", &expected_.sourceCrc)) {
+      progress_.delta = true;
+      expected_.fromBuild = config_.build;
+      verifyOffset_ = 0;
+      verifyCrc_ = 0;
+      progress_.phase = OTA_VERIFY_SOURCE;
+      report("verifying");
+      return;
+    }
+    JsonSpan image;
+    if (!jsonFindMember(root, "image", &image) || !readEntry(image)) {
+      SF_LOGW("⚠️ OTA: manifest tanpa image untuk build %lu", (unsigned long)config_.build);
+      return;
+    }
+    startDownload();
+  }
+
+  // path dan bytes satu entri image/delta.
+  bool readEntry(JsonSpan entry) {
+    JsonSpan field;
+    uint32_t bytes = 0;
+    if (!jsonFindMember(entry, "path", &field) ||
+        jsonCopyString(field, path_, sizeof(path_)) == 0 ||
+        !readManifestUint32(entry, "bytes", &bytes) || bytes == 0) {
+      return false;
+    }
+    progress_.total = bytes;
+    return true;
+  }
+
+  // Patch delta hanya berlaku untuk image yang persis sama dengan sumbernya.
+  void verifySource() {
+    uint32_t end = verifyOffset_ + kVerifyBytesPerService;
+    if (end > expected_.sourceSize) end = expected_.sourceSize;
+    while (verifyOffset_ < end) {
+      size_t n = end - verifyOffset_ < sizeof(chunk_) ? end - verifyOffset_ : sizeof(chunk_);
+      if (!slots_.readRunning(verifyOffset_, chunk_, n)) {
+        fail("flash");
+        return;
+      }
+      verifyCrc_ = crc32Update(verifyCrc_, chunk_, n);
+      verifyOffset_ += (uint32_t)n;
+    }
+    if (verifyOffset_ < expected_.sourceSize) return;
+    if (verifyCrc_ == expected_.sourceCrc) {
+      startDownload();
+      return;
+    }
+    // Image berjalan bukan sumber patch (mis. di-flash manual): pakai image
+    // utuh untuk build ini.
+    SF_LOGW("⚠️ OTA: CRC image berjalan tidak cocok dengan patch, unduh image utuh");
+    fullOnlyBuild_ = progress_.targetBuild;
+    progress_.phase = OTA_IDLE;
+    checkRequested_ = true;
+  }
+
+  void startDownload() {
+    if (!progress_.delta) {
+      expected_.sourceSize = 0;
+      expected_.sourceCrc = 0;
+      expected_.fromBuild = 0;
+    }
+    patcher_.reset(&expected_);
+    progress_.received = 0;
+    progress_.reconnects = 0;
+    progress_.phase = OTA_DOWNLOAD;
+    streamOpen_ = false;
+    reportedPercent_ = 0;
+    report("downloading");
+  }
+
+  void download() {
+    if (!streamOpen_ && !openStream()) return;
+    for (int i = 0; i < kChunksPerService; i++) {
+      int n = transport_.read(chunk_, sizeof(chunk_));
+      if (n == 0) {
+        if (platform_.millis() - lastByteMs_ >= config_.stallTimeoutMs) dropStream();
+        return;
+      }
+      if (n < 0) {
+        dropStream();
+        return;
+      }
+      lastByteMs_ = platform_.millis();
+      progress_.received += (uint32_t)n;
+      DeltaStatus status = patcher_.feed(chunk_, (size_t)n);
+      if (status == DELTA_DONE) {
+        transport_.closeStream();
+        streamOpen_ = false;
+        uint8_t message[kFirmwareSignedMessageSize];
+        firmwareSignedMessage(progress_.targetBuild, patcher_.header().targetSize,
+                              patcher_.targetDigest(), message);
+        if (!verifier_.begin(signature_, message, sizeof(message), publicKey_)) {
+          fail("signature");
+          return;
+        }
+        progress_.phase = OTA_VERIFY_SIGNATURE;
+        report("checking_signature");
+        return;
+      }
+      if (status != DELTA_MORE) {
+        fail(deltaStatusName(status));
+        return;
+      }
+    }
+    int percent = progress_.percent();
+    if (percent / 10 != reportedPercent_ / 10) {
+      reportedPercent_ = percent;
+      report("downloading");
+    }
+  }
+
+  bool openStream() {
+    uint32_t length = 0;
+    int code = transport_.openStream(path_, progress_.received, &length);
+    if (code == 200 && progress_.received > 0) {
+      // Server tidak mendukung Range: mulai lagi dari awal.
+      patcher_.abort();
+      patcher_.reset(&expected_);
+      progress_.received = 0;
+    } else if (code != 200 && code != 206) {
+      dropStream();
+      return false;
+    }
+    if (progress_.received + length != progress_.total) {
+      transport_.closeStream();
+      fail("size");
+      return false;
+    }
+    streamOpen_ = true;
+    lastByteMs_ = platform_.millis();
+    return true;
+  }
+
+  // Beberapa bit per panggilan; partisi baru hanya dipasang jika cocok.
+  void verifySignature() {
+    if (!verifier_.step(kSignatureBitsPerService)) return;
+    if (!verifier_.valid()) {
+      SF_LOGE("❌ OTA: tanda tangan build %lu tidak sah, image dibuang",
+              (unsigned long)progress_.targetBuild);
+      fail("signature");
+      return;
+    }
+    if (!patcher_.install()) {
+      fail("verify_failed");
+      return;
+    }
+    record_.installedBuild = progress_.targetBuild;
+    saveRecord();
+    progress_.phase = OTA_INSTALLED;
+    report("installed");
+  }
+
+  static bool parseHex(const char* text, uint8_t* out, size_t length) {
+    if (text == nullptr || strlen(text) != 2 * length) return false;
+    for (size_t i = 0; i < 2 * length; i++) {
+      char c = text[i];
+      int nibble = c >= '0' && c <= '9'   ? c - '0'
+                   : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                   : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                          : -1;
+      if (nibble < 0) return false;
+      out[i / 2] = (uint8_t)(i % 2 == 0 ? nibble << 4 : (out[i / 2] | nibble));
+    }
+    return true;
+  }
+
+  void dropStream() {
+    transport_.closeStream();
+    streamOpen_ = false;
+    if (++progress_.reconnects > config_.maxReconnects) {
+      fail("download");
+      return;
+    }
+    SF_LOGW("⚠️ OTA: koneksi putus di %lu/%lu byte, lanjut", (unsigned long)progress_.received,
+            (unsigned long)progress_.total);
+  }
+
+  void confirm() {
+    if (device_.dataUploads() > 0) {
+      slots_.markValid();
+      progress_.phase = OTA_IDLE;
+      report("confirmed");
+    } else if (platform_.millis() - bootMs_ >= config_.confirmTimeoutMs) {
+      record_.badBuild = config_.build;
+      saveRecord();
+      setError("unhealthy");
+      report("rolling_back");
+      slots_.rollback();
+    }
+  }
+
+  void fail(const char* error) {
+    patcher_.abort();
+    if (streamOpen_) transport_.closeStream();
+    streamOpen_ = false;
+    progress_.phase = OTA_IDLE;
+    setError(error);
+    report("failed");
+  }
+
+  bool pumpRunning() {
+    for (int i = 0; i < device_.zoneCount(); i++) {
+      if (device_.pumps().running(i)) return true;
+    }
+    return false;
+  }
+
+  void setError(const char* error) { snprintf(progress_.error, sizeof(progress_.error), "%s", error); }
+
+  void saveRecord() {
+    if (!platform_.saveBlob(kRecordKey, &record_, sizeof(record_))) {
+      SF_LOGW("⚠️ OTA: catatan update tidak tersimpan di NVS");
+    }
+  }
+
+  // Log + PATCH /ota/<device_id>.
+  void report(const char* state) {
+    SF_LOGI("📦 OTA %s: build %lu → %lu (%s) %lu/%lu byte%s%s", state,
+            (unsigned long)config_.build, (unsigned long)progress_.targetBuild,
+            progress_.delta ? "delta" : "image", (unsigned long)progress_.received,
+            (unsigned long)progress_.total, progress_.error[0] ? ", error: " : "",
+            progress_.error);
+    unsentState_ = nullptr;
+    if (!device_.state.online) {
+      unsentState_ = state;  // dikirim begitu online, mis. hasil boot
+      return;
+    }
+    char body[320];
+    JsonWriter json(body, sizeof(body));
+    json.beginObject()
+        .key("state").value(state)
+        .key("build").value((long long)config_.build)
+        .key("target").value((long long)progress_.targetBuild)
+        .key("mode").value(progress_.delta ? "delta" : "image")
+        .key("bytes").value((long long)progress_.received)
+        .key("total").value((long long)progress_.total)
+        .key("percent").value(progress_.percent())
+        .key("reconnects").value((int)progress_.reconnects)
+        .key("error").value(progress_.error)
+        .key("updated_at").value(device_.clock().nowMs())
+        .endObject();
+    if (!json.ok()) return;
+    char path[64];
+    snprintf(path, sizeof(path), "/ota/%s.json", device_.config().deviceId);
+    device_.rtdb().patch(path, json.c_str(), json.length());
+  }
+
+#if defined(__GNUC__)
+  __attribute__((format(printf, 2, 3)))
+#endif
+  void logf(const char* format, ...) {
+    if (!platform_.logEnabled()) return;
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    platform_.log(line);
+  }
+
+  TomatoDevice& device_;
+  DevicePlatform& platform_;
+  UpdateTransport& transport_;
+  FirmwareSlots& slots_;
+  OtaConfig config_;
+  DeltaPatcher patcher_;
+  Ed25519Verifier verifier_;
+  uint8_t publicKey_[kEd25519KeySize];
+  uint8_t signature_[kEd25519SignatureSize];
+  bool keyValid_;
+  OtaProgress progress_;
+  OtaRecord record_;
+  DeltaHeader expected_;
+  char path_[kPathSize];
+  bool checkRequested_;
+  bool streamOpen_;
+  uint32_t fullOnlyBuild_;  // build yang delta-nya ditolak (sumber beda)
+  uint32_t verifyOffset_;
+  uint32_t verifyCrc_;
+  unsigned long lastCheck_;
+  unsigned long bootMs_;
+  unsigned long lastByteMs_;
+  int reportedPercent_;
+  const char* unsentState_;  // literal state terakhir yang belum terkirim
+  char manifest_[kManifestSize];
+  uint8_t chunk_[1024];
+};
+
+#endif  // SMARTFARM_OTA_UPDATE_H_
@@ -0,0 +1,197 @@
+#ifndef SMARTFARM_PUMP_COMMAND_H_
+#define SMARTFARM_PUMP_COMMAND_H_
+
+// Pelacakan perintah pompa dari aplikasi. Setiap kali petani menekan tombol
+// pompa, aplikasi menulis node control zona sekaligus:
+//   pompa_status  "ON"/"OFF" (yang dijalankan perangkat, seperti sebelumnya)
+//   pompa_cmd     {"id": push key, "on": bool, "issued_at": waktu server ms}
+// Perangkat mengenali id baru saat GET control (waktu terima), memutuskan
+// di checkPompaControl (waktu aktuasi), lalu menulis satu kali per id:
+//   <zona>/control_ack = {"id","on","issued_at","received_at","actuated_at",
+//                         "result"}
+// Latensi terbit→aktuasi dan terima→aktuasi dikumpulkan di histogram log2
+// (milidetik, LatencyHistogram dari loop_profiler.h) dan ikut diagnostik,
+// bersama jumlah perintah yang melewati SLO.
+//
+// issued_at memakai jam server Firebase dan actuated_at jam NTP perangkat,
+// jadi terbit→aktuasi ikut memuat selisih kedua jam; nilai negatif dihitung
+// sebagai clock_skew dan tidak masuk histogram. Terima→aktuasi murni
+// millis() perangkat.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "device_platform.h"
+#include "loop_profiler.h"
+#include "rtdb_json.h"
+#include "tomato_logic.h"
+
+enum CommandResult {
+  COMMAND_APPLIED,  // relay sekarang sesuai perintah
+  COMMAND_AUTO,     // zona di mode AUTO, perintah tidak dijalankan
+  COMMAND_BLOCKED,  // safety cutoff atau run dari API perintah lokal
+};
+
+inline const char* commandResultName(int result) {
+  static const char* const kNames[] = {"applied", "auto", "blocked"};
+  return result >= 0 && result <= COMMAND_BLOCKED ? kNames[result] : "?";
+}
+
+struct PumpCommandStats {
+  uint32_t received;
+  uint32_t results[COMMAND_BLOCKED + 1];
+  uint32_t stale;      // diterima lebih dari kStaleMs setelah terbit (mis. saat boot)
+  uint32_t clockSkew;  // actuated_at < issued_at
+  uint32_t overSlo;    // terbit→aktuasi > SLO
+};
+
+class PumpCommandTracker {
+ public:
+  static const size_t kIdSize = 32;  // push key Firebase 20 karakter
+  // Perintah setua ini saat diterima tidak diukur: biasanya sisa perintah
+  // lama yang terbaca lagi setelah perangkat menyala.
+  static const long long kStaleMs = 10LL * 60 * 1000;
+
+  explicit PumpCommandTracker(unsigned long sloMs) : sloMs_(sloMs) {
+    memset(zones_, 0, sizeof(zones_));
+    resetWindow();
+  }
+
+  // pompa_cmd dari node control zona. true jika id-nya belum pernah dilihat
+  // zona ini; perintah itu lalu menunggu complete().
+  bool receive(int zone, JsonSpan command, long long nowEpochMs, unsigned long nowMs) {
+    if (zone < 0 || zone >= TOMATO_MAX_ZONES) return false;
+    ZoneCommand& zc = zones_[zone];
+    JsonSpan field;
+    char id[kIdSize];
+    if (!jsonFindMember(command, "id", &field) || jsonCopyString(field, id, sizeof(id)) == 0 ||
+        strcmp(id, zc.id) == 0) {
+      return false;
+    }
+    snprintf(zc.id, sizeof(zc.id), "%s", id);
+    double issuedAt = 0;
+    if (jsonFindMember(command, "issued_at", &field)) jsonToDouble(field, &issuedAt);
+    zc.issuedAt = (long long)issuedAt;
+    zc.receivedAt = nowEpochMs;
+    zc.receivedMs = nowMs;
+    zc.pending = true;
+    stats_.received++;
+    return true;
+  }
+
+  bool pending(int zone) const {
+    return zone >= 0 && zone < TOMATO_MAX_ZONES && zones_[zone].pending;
+  }
+
+  // Keputusan untuk perintah yang menunggu: catat latensinya dan tulis body
+  // control_ack ke ack. relayOn = keadaan relay setelah keputusan.
+  void complete(int zone, CommandResult result, bool relayOn, long long nowEpochMs,
+                unsigned long nowMs, JsonWriter& ack) {
+    ZoneCommand& zc = zones_[zone];
+    zc.pending = false;
+    stats_.results[result]++;
+    long long issueToActuation = nowEpochMs - zc.issuedAt;
+    bool stale = zc.issuedAt <= 0 || zc.receivedAt - zc.issuedAt > kStaleMs;
+    if (stale) {
+      stats_.stale++;
+    } else if (result == COMMAND_APPLIED) {
+      receiveToActuation_.record((uint32_t)(nowMs - zc.receivedMs));
+      if (issueToActuation < 0) {
+        stats_.clockSkew++;
+      } else {
+        issueToActuation_.record((uint32_t)issueToActuation);
+        if ((unsigned long long)issueToActuation > sloMs_) stats_.overSlo++;
+      }
+    }
+
+    ack.beginObject()
+        .key("id").value(zc.id)
+        .key("on").value(relayOn)
+        .key("issued_at").value(zc.issuedAt)
+        .key("received_at").value(zc.receivedAt);
+    if (result == COMMAND_APPLIED) ack.key("actuated_at").value(nowEpochMs);
+    ack.key("result").value(commandResultName(result))
+        .endObject();
+  }
+
+  const PumpCommandStats& stats() const { return stats_; }
+  const LatencyHistogram& issueToActuation() const { return issueToActuation_; }
+  const LatencyHistogram& receiveToActuation() const { return receiveToActuation_; }
+
+  // Jendela diagnostik baru (setelah upload berhasil).
+  void resetWindow() {
+    memset(&stats_, 0, sizeof(stats_));
+    issueToActuation_.reset();
+    receiveToActuation_.reset();
+  }
+
+  void dump(DevicePlatform& out) const {
+    char line[160];
+    snprintf(line, sizeof(line),
+             "🎛️ Perintah pompa: %lu diterima (jalan %lu, auto %lu, diblok %lu, basi %lu)",
+             (unsigned long)stats_.received, (unsigned long)stats_.results[COMMAND_APPLIED],
+             (unsigned long)stats_.results[COMMAND_AUTO],
+             (unsigned long)stats_.results[COMMAND_BLOCKED], (unsigned long)stats_.stale);
+    out.log(line);
+    dumpHistogram(out, "terbit→aktuasi", issueToActuation_);
+    dumpHistogram(out, "terima→aktuasi", receiveToActuation_);
+    snprintf(line, sizeof(line), "  SLO %lu ms: %lu lewat, clock skew %lu",
+             (unsigned long)sloMs_, (unsigned long)stats_.overSlo,
+             (unsigned long)stats_.clockSkew);
+    out.log(line);
+  }
+
+  void writeJson(JsonWriter& json) const {
+    json.beginObject()
+        .key("received").value((long long)stats_.received)
+        .key("applied").value((long long)stats_.results[COMMAND_APPLIED])
+        .key("auto").value((long long)stats_.results[COMMAND_AUTO])
+        .key("blocked").value((long long)stats_.results[COMMAND_BLOCKED])
+        .key("stale").value((long long)stats_.stale)
+        .key("clock_skew").value((long long)stats_.clockSkew)
+        .key("slo_ms").value((long long)sloMs_)
+        .key("over_slo").value((long long)stats_.overSlo);
+    json.key("issue_to_actuation");
+    writeHistogram(json, issueToActuation_);
+    json.key("receive_to_actuation");
+    writeHistogram(json, receiveToActuation_);
+    json.endObject();
+  }
+
+ private:
+  struct ZoneCommand {
+    char id[kIdSize];  // id terakhir yang dilihat; kosong setelah boot
+    bool pending;
+    long long issuedAt;
+    long long receivedAt;
+    unsigned long receivedMs;
+  };
+
+  // Nilai histogram di sini milidetik, bukan mikrodetik.
+  static void writeHistogram(JsonWriter& json, const LatencyHistogram& h) {
+    json.beginObject()
+        .key("count").value((long long)h.count)
+        .key("p50_ms").value((long long)h.percentileUs(0.50f))
+        .key("p99_ms").value((long long)h.percentileUs(0.99f))
+        .key("max_ms").value((long long)h.maxUs)
+        .endObject();
+  }
+
+  static void dumpHistogram(DevicePlatform& out, const char* name, const LatencyHistogram& h) {
+    if (h.count == 0) return;
+    char line[112];
+    snprintf(line, sizeof(line), "  %s: n %lu, p50 %lu ms, p99 %lu ms, maks %lu ms", name,
+             (unsigned long)h.count, (unsigned long)h.percentileUs(0.50f),
+             (unsigned long)h.percentileUs(0.99f), (unsigned long)h.maxUs);
+    out.log(line);
+  }
+
+  unsigned long sloMs_;
+  ZoneCommand zones_[TOMATO_MAX_ZONES];
+  PumpCommandStats stats_;
+  LatencyHistogram issueToActuation_;
+  LatencyHistogram receiveToActuation_;
+};
+
+#endif  // SMARTFARM_PUMP_COMMAND_H_
@@ -0,0 +1,228 @@
+#ifndef SMARTFARM_PUMP_SERVICE_H_
+#define SMARTFARM_PUMP_SERVICE_H_
+
+// Layanan aktuasi pompa: setiap penyiraman adalah satu "run" berdurasi tetap.
+// Saat run dimulai, timer satu kali di aktuator (esp_timer di ESP32) dipasang
+// untuk mematikan pompa, jadi pompa mati tepat waktu walaupun loop() sedang
+// tertahan request HTTP. Tanpa timer perangkat keras, batas waktu dicek di
+// service() setiap iterasi loop().
+//
+// Setiap run dicatat: durasi diminta vs durasi nyata, sumber perintah dan
+// cara berakhirnya. Selisihnya (overshoot) menunjukkan seberapa telat pompa
+// dimatikan.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "device_platform.h"
+#include "tomato_logic.h"
+
+enum PumpSource {
+  PUMP_SOURCE_AUTO,     // penyiraman otomatis (juga saat offline)
+  PUMP_SOURCE_APP,      // pompa_status dari aplikasi (mode MANUAL)
+  PUMP_SOURCE_COMMAND,  // API perintah (serial, server lokal)
+};
+
+enum PumpEnd {
+  PUMP_END_TIMER,     // dimatikan timer perangkat keras
+  PUMP_END_DEADLINE,  // dimatikan service() saat batas waktu lewat
+  PUMP_END_STOP,      // dihentikan lewat stop()
+};
+
+inline const char* pumpSourceName(int source) {
+  static const char* const kNames[] = {"auto", "app", "command"};
+  return source >= 0 && source <= PUMP_SOURCE_COMMAND ? kNames[source] : "?";
+}
+
+inline const char* pumpEndName(int end) {
+  static const char* const kNames[] = {"timer", "deadline", "stop"};
+  return end >= 0 && end <= PUMP_END_STOP ? kNames[end] : "?";
+}
+
+struct PumpRun {
+  uint8_t zone;
+  uint8_t source;  // PumpSource
+  uint8_t end;     // PumpEnd
+  uint32_t requestedMs;
+  uint32_t actualMs;
+
+  long overshootMs() const { return (long)actualMs - (long)requestedMs; }
+};
+
+struct PumpStats {
+  uint32_t runs;
+  uint32_t timerCutoffs;     // berakhir oleh timer perangkat keras
+  uint32_t deadlineCutoffs;  // berakhir oleh service()
+  uint32_t maxOvershootMs;
+};
+
+class PumpService {
+ public:
+  static const int kHistory = 8;  // run terakhir yang disimpan
+  // Jika timer perangkat keras terpasang tetapi belum memadamkan pompa
+  // sampai selewat ini, service() mematikannya sendiri.
+  static const unsigned long kTimerGraceMs = 1000;
+
+  PumpService(PumpActuator& pump, DevicePlatform& platform) : pump_(pump), platform_(platform) {
+    memset(active_, 0, sizeof(active_));
+    memset(history_, 0, sizeof(history_));
+    memset(&stats_, 0, sizeof(stats_));
+    historyCount_ = 0;
+    historyHead_ = 0;
+  }
+
+  // Menyalakan pompa zona selama durationMs. Run yang sedang berjalan di zona
+  // yang sama diperpanjang dari sekarang. false jika zona/durasi tidak valid.
+  bool start(int zone, unsigned long durationMs, PumpSource source) {
+    if (zone < 0 || zone >= TOMATO_MAX_ZONES || durationMs == 0) return false;
+    ActiveRun& run = active_[zone];
+    if (run.running) {
+      pump_.cancelCutoff(zone);
+      // Timer mungkin sudah memadamkan pompa sebelum service() sempat
+      // mencatatnya: tutup run itu dulu, lalu mulai run baru.
+      unsigned long offAt;
+      if (run.hardwareTimer && pump_.takeCutoff(zone, &offAt)) finish(zone, offAt, PUMP_END_TIMER);
+    }
+    unsigned long now = platform_.millis();
+    if (!run.running) run.startedAt = now;
+    // Selalu dinyalakan ulang, juga saat memperpanjang: callback timer di
+    // core lain bisa memadamkan relay di antara cancelCutoff() dan di sini.
+    pump_.setPump(zone, true);
+    run.running = true;
+    run.source = (uint8_t)source;
+    run.requestedMs = (now - run.startedAt) + durationMs;
+    run.hardwareTimer = pump_.armCutoff(zone, durationMs);
+    return true;
+  }
+
+  // Mematikan pompa sekarang. false jika zona tidak sedang menyiram.
+  bool stop(int zone) {
+    if (zone < 0 || zone >= TOMATO_MAX_ZONES || !active_[zone].running) return false;
+    pump_.cancelCutoff(zone);
+    pump_.setPump(zone, false);
+    finish(zone, platform_.millis(), PUMP_END_STOP);
+    return true;
+  }
+
+  bool running(int zone) const {
+    return zone >= 0 && zone < TOMATO_MAX_ZONES && active_[zone].running;
+  }
+
+  unsigned long elapsedMs(int zone) const {
+    return running(zone) ? platform_.millis() - active_[zone].startedAt : 0;
+  }
+
+  unsigned long remainingMs(int zone) const {
+    if (!running(zone)) return 0;
+    unsigned long elapsed = elapsedMs(zone);
+    return elapsed < active_[zone].requestedMs ? active_[zone].requestedMs - elapsed : 0;
+  }
+
+  // Dipanggil setiap iterasi loop(): menutup run yang sudah dimatikan timer
+  // dan menegakkan batas waktu bila timer tidak ada (atau tidak berjalan).
+  void service() {
+    unsigned long now = platform_.millis();
+    for (int zone = 0; zone < TOMATO_MAX_ZONES; zone++) {
+      ActiveRun& run = active_[zone];
+      if (!run.running) continue;
+      unsigned long offAt;
+      if (run.hardwareTimer && pump_.takeCutoff(zone, &offAt)) {
+        finish(zone, offAt, PUMP_END_TIMER);
+        continue;
+      }
+      unsigned long limit = run.requestedMs + (run.hardwareTimer ? kTimerGraceMs : 0);
+      if (now - run.startedAt >= limit) {
+        pump_.cancelCutoff(zone);
+        pump_.setPump(zone, false);
+        finish(zone, now, PUMP_END_DEADLINE);
+      }
+    }
+  }
+
+  // Run terakhir yang selesai di zona ini (nullptr jika belum ada).
+  const PumpRun* lastRun(int zone) const {
+    for (int i = 0; i < historyCount_; i++) {
+      const PumpRun& run = history_[(historyHead_ - 1 - i + kHistory) % kHistory];
+      if (run.zone == zone) return &run;
+    }
+    return nullptr;
+  }
+
+  const PumpStats& stats() const { return stats_; }
+
+  void dump(DevicePlatform& out) const {
+    char line[112];
+    snprintf(line, sizeof(line), "🚿 Pompa: %lu run (timer %lu, batas waktu %lu), overshoot maks %lu ms",
+             (unsigned long)stats_.runs, (unsigned long)stats_.timerCutoffs,
+             (unsigned long)stats_.deadlineCutoffs, (unsigned long)stats_.maxOvershootMs);
+    out.log(line);
+    for (int i = 0; i < historyCount_; i++) {
+      const PumpRun& run = history_[(historyHead_ - historyCount_ + i + kHistory) % kHistory];
+      snprintf(line, sizeof(line), "  zona %u %-7s minta %lu ms, nyata %lu ms (%s)",
+               (unsigned)run.zone, pumpSourceName(run.source), (unsigned long)run.requestedMs,
+               (unsigned long)run.actualMs, pumpEndName(run.end));
+      out.log(line);
+    }
+  }
+
+  void writeJson(JsonWriter& json) const {
+    json.beginObject()
+        .key("runs").value((long long)stats_.runs)
+        .key("timer").value((long long)stats_.timerCutoffs)
+        .key("deadline").value((long long)stats_.deadlineCutoffs)
+        .key("max_overshoot_ms").value((long long)stats_.maxOvershootMs);
+    json.key("recent").beginArray();
+    for (int i = 0; i < historyCount_; i++) {
+      const PumpRun& run = history_[(historyHead_ - historyCount_ + i + kHistory) % kHistory];
+      json.beginObject()
+          .key("zone").value((int)run.zone)
+          .key("source").value(pumpSourceName(run.source))
+          .key("end").value(pumpEndName(run.end))
+          .key("requested_ms").value((long long)run.requestedMs)
+          .key("actual_ms").value((long long)run.actualMs)
+          .endObject();
+    }
+    json.endArray();
+    json.endObject();
+  }
+
+ private:
+  struct ActiveRun {
+    bool running;
+    bool hardwareTimer;
+    uint8_t source;
+    unsigned long startedAt;
+    unsigned long requestedMs;
+  };
+
+  void finish(int zone, unsigned long offAt, PumpEnd end) {
+    ActiveRun& run = active_[zone];
+    PumpRun& record = history_[historyHead_];
+    record.zone = (uint8_t)zone;
+    record.source = run.source;
+    record.end = (uint8_t)end;
+    record.requestedMs = (uint32_t)run.requestedMs;
+    record.actualMs = (uint32_t)(offAt - run.startedAt);
+    historyHead_ = (historyHead_ + 1) % kHistory;
+    if (historyCount_ < kHistory) historyCount_++;
+
+    stats_.runs++;
+    if (end == PUMP_END_TIMER) stats_.timerCutoffs++;
+    if (end == PUMP_END_DEADLINE) stats_.deadlineCutoffs++;
+    if (end != PUMP_END_STOP && record.overshootMs() > (long)stats_.maxOvershootMs) {
+      stats_.maxOvershootMs = (uint32_t)record.overshootMs();
+    }
+    run.running = false;
+  }
+
+  PumpActuator& pump_;
+  DevicePlatform& platform_;
+  ActiveRun active_[TOMATO_MAX_ZONES];
+  PumpRun history_[kHistory];
+  int historyCount_;
+  int historyHead_;
+  PumpStats stats_;
+};
+
+#endif  // SMARTFARM_PUMP_SERVICE_H_
@@ -0,0 +1,228 @@
+#ifndef SMARTFARM_REMOTE_CONFIG_H_
+#define SMARTFARM_REMOTE_CONFIG_H_
+
+// Konfigurasi jarak jauh: satu dokumen /config/<device> berisi jeda sampel,
+// durasi siram, profil budidaya (batas tahap, threshold tanah, jam siram) dan
+// batas alert. Dokumen diambil sekali saat boot dan disimpan di NVS; setelah
+// itu hanya diambil ulang jika "config_version" di node control (yang memang
+// dibaca setiap sampel) berbeda dari versi yang berlaku, jadi keadaan tunak
+// tidak menambah request.
+//
+// Dokumen diurai ke salinan sementara lalu divalidasi utuh; satu nilai yang
+// salah membuat seluruh dokumen ditolak sehingga konfigurasi tidak pernah
+// berlaku setengah. Kunci yang tidak ada memakai nilai bawaan firmware.
+//
+//   {"version": 3, "interval_ms": 5000, "notification_interval_ms": 10000,
+//    "watering_duration_ms": 15000, "stage_last_day": [14, 35, 50],
+//    "soil_threshold": [30, 40, 50, 60],
+//    "watering_hours": [6, 7, 8, 9, 10, 16, 17, 18],
+//    "alerts": {"temp_high": 33, "humidity_high": 85}}
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "alert_rules.h"
+#include "rtdb_json.h"
+#include "tomato_logic.h"
+
+struct RemoteConfig {
+  uint32_t version;  // 0 = bawaan firmware, belum pernah menerima dokumen
+  unsigned long interval;
+  unsigned long notificationInterval;
+  unsigned long wateringDuration;
+  CropProfile crop;
+  float alertThreshold[kAlertRuleCount];  // urutan kAlertRules
+};
+
+// Blob NVS. Magic berubah bila susunan RemoteConfig berubah sehingga cache
+// lama dari firmware sebelumnya diabaikan.
+const char kRemoteConfigKey[] = "remote_cfg";
+const uint32_t kRemoteConfigMagic = 0x53464301u;  // "SFC" v1
+
+struct StoredRemoteConfig {
+  uint32_t magic;
+  RemoteConfig config;
+};
+
+inline RemoteConfig remoteConfigDefaults(unsigned long interval, unsigned long notificationInterval,
+                                         unsigned long wateringDuration) {
+  RemoteConfig config;
+  memset(&config, 0, sizeof(config));
+  config.interval = interval;
+  config.notificationInterval = notificationInterval;
+  config.wateringDuration = wateringDuration;
+  config.crop = defaultCropProfile();
+  for (int r = 0; r < kAlertRuleCount; r++) config.alertThreshold[r] = kAlertRules[r].threshold;
+  return config;
+}
+
+// Rentang yang masuk akal; dipakai juga untuk cache NVS.
+inline bool validateRemoteConfig(const RemoteConfig& config, const char** error) {
+  if (config.interval < 1000 || config.interval > 3600000UL) {
+    *error = "interval_ms di luar 1000..3600000";
+    return false;
+  }
+  if (config.notificationInterval < 1000 || config.notificationInterval > 3600000UL) {
+    *error = "notification_interval_ms di luar 1000..3600000";
+    return false;
+  }
+  if (config.wateringDuration < 1000 || config.wateringDuration > 10UL * 60 * 1000) {
+    *error = "watering_duration_ms di luar 1000..600000";
+    return false;
+  }
+  int previous = 0;
+  for (int i = 0; i < 3; i++) {
+    if (config.crop.stageLastDay[i] <= previous || config.crop.stageLastDay[i] > 365) {
+      *error = "stage_last_day harus naik, 1..365";
+      return false;
+    }
+    previous = config.crop.stageLastDay[i];
+  }
+  for (int i = 0; i < 4; i++) {
+    if (config.crop.soilThreshold[i] < 0 || config.crop.soilThreshold[i] > 100) {
+      *error = "soil_threshold di luar 0..100";
+      return false;
+    }
+  }
+  if (config.crop.wateringHours >> 24) {
+    *error = "watering_hours di luar 0..23";
+    return false;
+  }
+  for (int r = 0; r < kAlertRuleCount; r++) {
+    float value = config.alertThreshold[r];
+    if (!(value >= -100.0f && value <= 200.0f)) {
+      *error = "batas alert di luar -100..200";
+      return false;
+    }
+  }
+  return true;
+}
+
+// Angka opsional; nilai di *out tetap jika kunci tidak ada. false jika ada
+// tetapi bukan angka atau di luar [low, high].
+inline bool readConfigNumber(JsonSpan doc, const char* key, double low, double high, double* out) {
+  JsonSpan field;
+  if (!jsonFindMember(doc, key, &field)) return true;
+  double number;
+  if (!jsonToDouble(field, &number) || !(number >= low && number <= high)) return false;
+  *out = number;
+  return true;
+}
+
+inline bool readConfigMillis(JsonSpan doc, const char* key, unsigned long* out) {
+  double number = (double)*out;
+  if (!readConfigNumber(doc, key, 0, 86400000.0, &number)) return false;
+  *out = (unsigned long)number;
+  return true;
+}
+
+// Array bilangan bulat dengan panjang tepat `count`. Rentang dicek sebelum
+// cast ke int (cast double di luar rentang int tidak terdefinisi).
+inline bool readConfigIntArray(JsonSpan doc, const char* key, int* out, int count) {
+  JsonSpan field;
+  if (!jsonFindMember(doc, key, &field)) return true;
+  int staged[4];
+  int n = 0;
+  JsonArrayIterator it(field);
+  JsonSpan item;
+  while (it.next(&item)) {
+    double number;
+    if (n >= count || !jsonToDouble(item, &number) || !(number >= INT_MIN && number <= INT_MAX) ||
+        number != (double)(int)number) {
+      return false;
+    }
+    staged[n++] = (int)number;
+  }
+  if (!it.valid() || n != count) return false;
+  memcpy(out, staged, count * sizeof(int));
+  return true;
+}
+
+// Nomor versi /config dan config_version: bilangan bulat 1..4294967295.
+// NaN, inf, negatif dan pecahan ditolak sebelum dicast ke uint32_t.
+inline bool configVersionFromDouble(double number, uint32_t* out) {
+  if (!(number >= 1 && number <= 4294967295.0)) return false;
+  uint32_t version = (uint32_t)number;
+  if ((double)version != number) return false;
+  *out = version;
+  return true;
+}
+
+// Mengurai dokumen ke *out, berangkat dari `defaults`. *out hanya diubah jika
+// seluruh dokumen valid; jika tidak, *error berisi alasannya.
+inline bool parseRemoteConfig(JsonSpan doc, const RemoteConfig& defaults, RemoteConfig* out,
+                              const char** error) {
+  if (!JsonObjectIterator(doc).valid()) {
+    *error = "dokumen bukan objek";
+    return false;
+  }
+  RemoteConfig staged = defaults;
+
+  double version = 0;
+  if (!readConfigNumber(doc, "version", 1, 4294967295.0, &version) ||
+      !configVersionFromDouble(version, &staged.version)) {
+    *error = "version wajib, bilangan bulat >= 1";
+    return false;
+  }
+
+  if (!readConfigMillis(doc, "interval_ms", &staged.interval) ||
+      !readConfigMillis(doc, "notification_interval_ms", &staged.notificationInterval) ||
+      !readConfigMillis(doc, "watering_duration_ms", &staged.wateringDuration)) {
+    *error = "jeda/durasi bukan angka milidetik";
+    return false;
+  }
+  if (!readConfigIntArray(doc, "stage_last_day", staged.crop.stageLastDay, 3)) {
+    *error = "stage_last_day harus 3 bilangan bulat";
+    return false;
+  }
+  if (!readConfigIntArray(doc, "soil_threshold", staged.crop.soilThreshold, 4)) {
+    *error = "soil_threshold harus 4 bilangan bulat";
+    return false;
+  }
+
+  JsonSpan field;
+  if (jsonFindMember(doc, "watering_hours", &field)) {
+    uint32_t hours = 0;
+    JsonArrayIterator it(field);
+    JsonSpan item;
+    while (it.next(&item)) {
+      double hour;
+      if (!jsonToDouble(item, &hour) || hour < 0 || hour > 23 || hour != (double)(int)hour) {
+        *error = "watering_hours harus jam 0..23";
+        return false;
+      }
+      hours |= 1UL << (int)hour;
+    }
+    if (!it.valid()) {
+      *error = "watering_hours harus array";
+      return false;
+    }
+    staged.crop.wateringHours = hours;
+  }
+
+  if (jsonFindMember(doc, "alerts", &field)) {
+    JsonObjectIterator it(field);
+    JsonSpan key, value;
+    while (it.next(&key, &value)) {
+      int rule = findAlertRule(key.begin, key.size());
+      double number;
+      if (rule < 0 || !jsonToDouble(value, &number)) {
+        *error = "alerts berisi id tidak dikenal atau bukan angka";
+        return false;
+      }
+      staged.alertThreshold[rule] = (float)number;
+    }
+    if (!it.valid()) {
+      *error = "alerts harus objek";
+      return false;
+    }
+  }
+
+  if (!validateRemoteConfig(staged, error)) return false;
+  *out = staged;
+  return true;
+}
+
+#endif  // SMARTFARM_REMOTE_CONFIG_H_
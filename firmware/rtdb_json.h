@@ -0,0 +1,208 @@
+#ifndef SMARTFARM_RTDB_JSON_H_
+#define SMARTFARM_RTDB_JSON_H_
+
+// Pembaca JSON kecil untuk respons Firebase RTDB (daftar notifikasi, node
+// kontrol). Bekerja langsung di atas buffer respons tanpa alokasi; cukup untuk
+// objek bersarang dangkal yang dipakai firmware.
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct JsonSpan {
+  const char* begin;
+  const char* end;
+
+  size_t size() const { return (size_t)(end - begin); }
+  bool equals(const char* text) const {
+    size_t n = strlen(text);
+    return size() == n && memcmp(begin, text, n) == 0;
+  }
+};
+
+inline const char* jsonSkipWs(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+  return p;
+}
+
+// Melewati satu string JSON (p menunjuk ke tanda kutip pembuka).
+inline const char* jsonSkipString(const char* p, const char* end) {
+  for (p++; p < end; p++) {
+    if (*p == '\\') p++;
+    else if (*p == '"') return p + 1;
+  }
+  return nullptr;
+}
+
+// Melewati satu nilai JSON apa pun; nullptr jika format rusak.
+inline const char* jsonSkipValue(const char* p, const char* end) {
+  p = jsonSkipWs(p, end);
+  if (p >= end) return nullptr;
+  if (*p == '"') return jsonSkipString(p, end);
+  if (*p == '{' || *p == '[') {
+    int depth = 0;
+    while (p < end) {
+      if (*p == '"') {
+        p = jsonSkipString(p, end);
+        if (!p) return nullptr;
+        continue;
+      }
+      if (*p == '{' || *p == '[') depth++;
+      else if (*p == '}' || *p == ']') {
+        if (--depth == 0) return p + 1;
+      }
+      p++;
+    }
+    return nullptr;
+  }
+  while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n') p++;
+  return p;
+}
+
+// Iterasi anggota objek JSON: key tanpa tanda kutip, value berupa span mentah.
+class JsonObjectIterator {
+ public:
+  explicit JsonObjectIterator(JsonSpan object) : p_(object.begin), end_(object.end), valid_(false) {
+    p_ = jsonSkipWs(p_, end_);
+    if (p_ < end_ && *p_ == '{') {
+      p_++;
+      valid_ = true;
+    }
+  }
+
+  bool valid() const { return valid_; }
+
+  bool next(JsonSpan* key, JsonSpan* value) {
+    if (!valid_) return false;
+    p_ = jsonSkipWs(p_, end_);
+    if (p_ < end_ && *p_ == ',') p_ = jsonSkipWs(p_ + 1, end_);
+    if (p_ >= end_ || *p_ != '"') return false;
+
+    const char* keyEnd = jsonSkipString(p_, end_);
+    if (!keyEnd) return fail();
+    key->begin = p_ + 1;
+    key->end = keyEnd - 1;
+
+    p_ = jsonSkipWs(keyEnd, end_);
+    if (p_ >= end_ || *p_ != ':') return fail();
+    p_ = jsonSkipWs(p_ + 1, end_);
+
+    const char* valueEnd = jsonSkipValue(p_, end_);
+    if (!valueEnd) return fail();
+    value->begin = p_;
+    value->end = valueEnd;
+    p_ = valueEnd;
+    return true;
+  }
+
+ private:
+  bool fail() {
+    valid_ = false;
+    return false;
+  }
+
+  const char* p_;
+  const char* end_;
+  bool valid_;
+};
+
+// Iterasi elemen array JSON.
+class JsonArrayIterator {
+ public:
+  explicit JsonArrayIterator(JsonSpan array) : p_(array.begin), end_(array.end), valid_(false) {
+    p_ = jsonSkipWs(p_, end_);
+    if (p_ < end_ && *p_ == '[') {
+      p_++;
+      valid_ = true;
+    }
+  }
+
+  bool valid() const { return valid_; }
+
+  bool next(JsonSpan* value) {
+    if (!valid_) return false;
+    p_ = jsonSkipWs(p_, end_);
+    if (p_ < end_ && *p_ == ',') p_ = jsonSkipWs(p_ + 1, end_);
+    if (p_ >= end_ || *p_ == ']') return false;
+
+    const char* valueEnd = jsonSkipValue(p_, end_);
+    if (!valueEnd) {
+      valid_ = false;
+      return false;
+    }
+    value->begin = p_;
+    value->end = valueEnd;
+    p_ = valueEnd;
+    return true;
+  }
+
+ private:
+  const char* p_;
+  const char* end_;
+  bool valid_;
+};
+
+inline bool jsonFindMember(JsonSpan object, const char* name, JsonSpan* value) {
+  JsonObjectIterator it(object);
+  JsonSpan key;
+  while (it.next(&key, value)) {
+    if (key.equals(name)) return true;
+  }
+  return false;
+}
+
+// Menyalin string JSON ke buffer (escape sederhana di-decode). Jika value
+// bukan string, teks mentahnya yang disalin, seperti readFirebaseString dulu.
+inline size_t jsonCopyString(JsonSpan value, char* out, size_t capacity) {
+  if (capacity == 0) return 0;
+  const char* p = value.begin;
+  const char* end = value.end;
+  if (p < end && *p == '"') {
+    p++;
+    if (end > p && end[-1] == '"') end--;
+  }
+  size_t n = 0;
+  while (p < end && n + 1 < capacity) {
+    char c = *p++;
+    if (c == '\\' && p < end) {
+      c = *p++;
+      if (c == 'n') c = '\n';
+      else if (c == 't') c = '\t';
+    }
+    out[n++] = c;
+  }
+  out[n] = '\0';
+  return n;
+}
+
+inline bool jsonIsTrue(JsonSpan value) {
+  return value.equals("true");
+}
+
+// Angka JSON (juga string berisi angka, seperti yang kadang ditulis
+// konsol Firebase). false jika bukan angka.
+inline bool jsonToDouble(JsonSpan value, double* out) {
+  const char* p = value.begin;
+  const char* end = value.end;
+  if (p < end && *p == '"') {
+    p++;
+    if (end > p && end[-1] == '"') end--;
+  }
+  char text[32];
+  size_t n = (size_t)(end - p);
+  if (n == 0 || n >= sizeof(text)) return false;
+  memcpy(text, p, n);
+  text[n] = '\0';
+  char* parsed = nullptr;
+  double number = strtod(text, &parsed);
+  if (parsed != text + n) return false;
+  *out = number;
+  return true;
+}
+
+inline JsonSpan jsonSpanOf(const char* text, size_t length) {
+  JsonSpan span = {text, text + length};
+  return span;
+}
+
+#endif  // SMARTFARM_RTDB_JSON_H_
@@ -0,0 +1,310 @@
+#ifndef SMARTFARM_RTDB_RESILIENCE_H_
+#define SMARTFARM_RTDB_RESILIENCE_H_
+
+// Lapisan ketahanan untuk REST Firebase: circuit breaker per endpoint
+// (lihat net_stats.h) dengan backoff eksponensial ber-jitter, dan buffer
+// tulis lokal. Saat Firebase tidak terjangkau tetapi WiFi hidup, setiap
+// request dulu menunggu timeout HTTPClient penuh; sekarang setelah beberapa
+// kegagalan beruntun circuit terbuka dan panggilan langsung gagal tanpa
+// memblokir loop() (penting agar pompa tetap dimatikan tepat waktu).
+//
+// Percobaan ulang tidak dilakukan dengan menunggu di dalam panggilan:
+// circuit yang terbuka mengizinkan satu request percobaan setelah jeda
+// backoff habis, dan tulisan yang tertahan dikirim ulang satu per iterasi
+// loop() lewat service().
+
+#include <stdint.h>
+#include <string.h>
+
+#include "device_platform.h"
+#include "net_stats.h"
+#include "tomato_logic.h"
+
+// Kode kembali sintetis, tidak bentrok dengan kode error HTTPClient (-1..-11)
+// maupun kode HTTP (100-599). kRtdbBuffered tetap > 0 karena bagi pemanggil
+// tulisan sudah diterima, tetapi bukan 2xx: Firebase belum menerimanya.
+const int kRtdbCircuitOpen = -20;  // GET ditolak cepat, circuit terbuka
+const int kRtdbBuffered = 1000;    // tulisan diterima ke buffer lokal
+
+struct ResilienceConfig {
+  int failureThreshold;        // kegagalan beruntun sebelum circuit terbuka
+  unsigned long backoffBaseMs; // jeda buka pertama
+  unsigned long backoffMaxMs;  // batas jeda
+};
+
+inline ResilienceConfig defaultResilienceConfig() {
+  ResilienceConfig config;
+  config.failureThreshold = 3;
+  config.backoffBaseMs = 5000;
+  config.backoffMaxMs = 5UL * 60 * 1000;
+  return config;
+}
+
+struct CircuitBreaker {
+  enum State { CLOSED, OPEN };
+
+  State state;
+  uint8_t failures;  // kegagalan beruntun saat CLOSED
+  uint8_t opens;     // berapa kali terbuka beruntun (pangkat backoff)
+  unsigned long openedAt;
+  unsigned long openFor;
+
+  // true jika request boleh dikirim. Circuit OPEN yang jedanya habis
+  // mengizinkan satu request percobaan (half-open).
+  bool allow(unsigned long now) const {
+    return state == CLOSED || now - openedAt >= openFor;
+  }
+
+  bool isOpen(unsigned long now) const { return !allow(now); }
+
+  void onSuccess() {
+    state = CLOSED;
+    failures = 0;
+    opens = 0;
+  }
+
+  // jitter01: bilangan acak 0..1023 dari platform.
+  // true jika kegagalan ini membuka circuit.
+  bool onFailure(const ResilienceConfig& config, unsigned long now, long jitter01) {
+    if (state == CLOSED && ++failures < config.failureThreshold) return false;
+    if (opens < 16) opens++;
+    unsigned long backoff = config.backoffBaseMs;
+    for (int i = 1; i < opens && backoff < config.backoffMaxMs; i++) backoff *= 2;
+    if (backoff > config.backoffMaxMs) backoff = config.backoffMaxMs;
+    // Equal jitter: separuh tetap, separuh acak, agar node satu armada tidak
+    // mencoba ulang bersamaan.
+    openFor = backoff / 2 + (unsigned long)((backoff / 2) * (unsigned long)jitter01 / 1024);
+    openedAt = now;
+    state = OPEN;
+    failures = 0;
+    return true;
+  }
+};
+
+// Antrean tulisan (PUT/PATCH) di arena byte tetap. Entri tertua dibuang bila
+// penuh. Urutan dijaga agar current_data lama tidak menimpa yang baru.
+class WriteBuffer {
+ public:
+  static const size_t kArenaSize = 8192;
+
+  WriteBuffer() : used_(0), count_(0) {}
+
+  size_t count() const { return count_; }
+  size_t bytes() const { return used_; }
+
+  // false jika entri lebih besar dari seluruh arena. dropped bertambah untuk
+  // setiap entri lama yang dibuang demi tempat.
+  bool push(bool patch, int endpoint, const char* path, const char* body, size_t bodyLength,
+            uint32_t* dropped) {
+    size_t pathLength = strlen(path);
+    size_t need = kHeaderSize + pathLength + 1 + bodyLength;
+    if (need > kArenaSize || pathLength > 0xFFFF || bodyLength > 0xFFFF) return false;
+    while (kArenaSize - used_ < need && count_ > 0) {
+      pop();
+      (*dropped)++;
+    }
+    uint8_t* p = arena_ + used_;
+    p[0] = patch ? 1 : 0;
+    p[1] = (uint8_t)endpoint;
+    p[2] = (uint8_t)(pathLength & 0xFF);
+    p[3] = (uint8_t)(pathLength >> 8);
+    p[4] = (uint8_t)(bodyLength & 0xFF);
+    p[5] = (uint8_t)(bodyLength >> 8);
+    memcpy(p + kHeaderSize, path, pathLength + 1);
+    memcpy(p + kHeaderSize + pathLength + 1, body, bodyLength);
+    used_ += need;
+    count_++;
+    return true;
+  }
+
+  bool hasEndpoint(int endpoint) const {
+    for (size_t offset = 0; offset < used_; offset += entrySize(offset)) {
+      if (arena_[offset + 1] == endpoint) return true;
+    }
+    return false;
+  }
+
+  // Entri tertua. Pointer berlaku sampai pop()/push() berikutnya.
+  bool front(bool* patch, int* endpoint, const char** path, const char** body,
+             size_t* bodyLength) const {
+    if (count_ == 0) return false;
+    size_t pathLength = arena_[2] | (arena_[3] << 8);
+    *patch = arena_[0] != 0;
+    *endpoint = arena_[1];
+    *path = (const char*)arena_ + kHeaderSize;
+    *body = (const char*)arena_ + kHeaderSize + pathLength + 1;
+    *bodyLength = arena_[4] | (arena_[5] << 8);
+    return true;
+  }
+
+  void pop() {
+    if (count_ == 0) return;
+    size_t size = entrySize(0);
+    memmove(arena_, arena_ + size, used_ - size);
+    used_ -= size;
+    count_--;
+  }
+
+ private:
+  static const size_t kHeaderSize = 6;
+
+  size_t entrySize(size_t offset) const {
+    size_t pathLength = arena_[offset + 2] | (arena_[offset + 3] << 8);
+    size_t bodyLength = arena_[offset + 4] | (arena_[offset + 5] << 8);
+    return kHeaderSize + pathLength + 1 + bodyLength;
+  }
+
+  uint8_t arena_[kArenaSize];
+  size_t used_;
+  size_t count_;
+};
+
+struct ResilienceStats {
+  uint32_t opens;          // circuit terbuka
+  uint32_t fastFails;      // GET ditolak tanpa request
+  uint32_t buffered;       // tulisan masuk buffer
+  uint32_t replayed;       // tulisan buffer yang berhasil dikirim
+  uint32_t droppedWrites;  // tulisan dibuang (buffer penuh / terlalu besar)
+  // Tulisan yang dijawab 2xx oleh Firebase, langsung atau saat kirim ulang.
+  uint32_t delivered[NET_ENDPOINT_COUNT];
+};
+
+class ResilientRtdbTransport : public RtdbTransport {
+ public:
+  ResilientRtdbTransport(RtdbTransport& inner, DevicePlatform& platform,
+                         const ResilienceConfig& config = defaultResilienceConfig())
+      : inner_(inner), platform_(platform), config_(config) {
+    memset(breakers_, 0, sizeof(breakers_));
+    memset(&stats_, 0, sizeof(stats_));
+  }
+
+  bool connected() override { return inner_.connected(); }
+
+  int get(const char* path, char* body, size_t capacity, size_t* length) override {
+    int endpoint = classifyRtdbPath(path);
+    unsigned long now = platform_.millis();
+    if (!breakers_[endpoint].allow(now)) {
+      stats_.fastFails++;
+      *length = 0;
+      if (capacity > 0) body[0] = '\0';
+      return kRtdbCircuitOpen;
+    }
+    int code = inner_.get(path, body, capacity, length);
+    recordResult(endpoint, code, now);
+    return code;
+  }
+
+  int put(const char* path, const char* body, size_t length) override {
+    return write(false, path, body, length);
+  }
+
+  int patch(const char* path, const char* body, size_t length) override {
+    return write(true, path, body, length);
+  }
+
+  // Dipanggil sekali per iterasi loop(): kirim ulang satu tulisan tertahan
+  // bila circuit endpoint-nya mengizinkan.
+  void service() {
+    bool patch;
+    int endpoint;
+    const char* path;
+    const char* body;
+    size_t length;
+    if (!buffer_.front(&patch, &endpoint, &path, &body, &length)) return;
+    unsigned long now = platform_.millis();
+    if (!breakers_[endpoint].allow(now) || !inner_.connected()) return;
+
+    int code = patch ? inner_.patch(path, body, length) : inner_.put(path, body, length);
+    recordResult(endpoint, code, now);
+    if (!isRetryable(code)) {
+      // Berhasil, atau ditolak server (4xx) sehingga percuma diulang.
+      if (isDelivered(code)) {
+        stats_.replayed++;
+        stats_.delivered[endpoint]++;
+      } else {
+        stats_.droppedWrites++;
+      }
+      buffer_.pop();
+    }
+  }
+
+  const TlsStats* tlsStats() const override { return inner_.tlsStats(); }
+
+  bool isOpen(int endpoint) const { return breakers_[endpoint].isOpen(platform_.millis()); }
+  const ResilienceStats& stats() const { return stats_; }
+  const WriteBuffer& buffer() const { return buffer_; }
+
+  void writeJson(JsonWriter& json) const {
+    json.beginObject();
+    json.key("open");
+    json.beginObject();
+    for (int i = 0; i < NET_ENDPOINT_COUNT; i++) {
+      if (isOpen(i)) json.key(netEndpointName(i)).value(true);
+    }
+    json.endObject();
+    json.key("opens").value((long long)stats_.opens)
+        .key("fast_fails").value((long long)stats_.fastFails)
+        .key("buffered").value((long long)stats_.buffered)
+        .key("replayed").value((long long)stats_.replayed)
+        .key("dropped").value((long long)stats_.droppedWrites)
+        .key("pending").value((long long)buffer_.count())
+        .endObject();
+  }
+
+  void dump(DevicePlatform& out) const {
+    char line[160];
+    snprintf(line, sizeof(line),
+             "🛡️ Circuit: buka %lu, fast-fail %lu, buffer %lu (antre %lu, %lu B), kirim ulang %lu, "
+             "buang %lu",
+             (unsigned long)stats_.opens, (unsigned long)stats_.fastFails,
+             (unsigned long)stats_.buffered, (unsigned long)buffer_.count(),
+             (unsigned long)buffer_.bytes(), (unsigned long)stats_.replayed,
+             (unsigned long)stats_.droppedWrites);
+    out.log(line);
+    for (int i = 0; i < NET_ENDPOINT_COUNT; i++) {
+      if (!isOpen(i)) continue;
+      snprintf(line, sizeof(line), "  %s: TERBUKA", netEndpointName(i));
+      out.log(line);
+    }
+  }
+
+ private:
+  // Error koneksi/timeout dan 5xx layak diulang; 4xx tidak.
+  static bool isRetryable(int code) { return code <= 0 || code >= 500; }
+  static bool isDelivered(int code) { return code >= 200 && code < 300; }
+
+  void recordResult(int endpoint, int code, unsigned long now) {
+    if (isRetryable(code)) {
+      if (breakers_[endpoint].onFailure(config_, now, platform_.random(0, 1024))) stats_.opens++;
+    } else {
+      breakers_[endpoint].onSuccess();
+    }
+  }
+
+  int write(bool patch, const char* path, const char* body, size_t length) {
+    int endpoint = classifyRtdbPath(path);
+    unsigned long now = platform_.millis();
+    // Tulisan baru mengantre di belakang yang tertahan agar urutan terjaga.
+    if (breakers_[endpoint].allow(now) && !buffer_.hasEndpoint(endpoint)) {
+      int code = patch ? inner_.patch(path, body, length) : inner_.put(path, body, length);
+      recordResult(endpoint, code, now);
+      if (isDelivered(code)) stats_.delivered[endpoint]++;
+      if (!isRetryable(code)) return code;
+    }
+    if (!buffer_.push(patch, endpoint, path, body, length, &stats_.droppedWrites)) {
+      stats_.droppedWrites++;
+      return kRtdbCircuitOpen;
+    }
+    stats_.buffered++;
+    return kRtdbBuffered;
+  }
+
+  RtdbTransport& inner_;
+  DevicePlatform& platform_;
+  ResilienceConfig config_;
+  CircuitBreaker breakers_[NET_ENDPOINT_COUNT];
+  ResilienceStats stats_;
+  WriteBuffer buffer_;
+};
+
+#endif  // SMARTFARM_RTDB_RESILIENCE_H_
@@ -0,0 +1,103 @@
+#ifndef SMARTFARM_SAMPLE_RING_H_
+#define SMARTFARM_SAMPLE_RING_H_
+
+// Ring buffer sampel terbaru di RAM untuk klien LAN (local_api.h). Diisi
+// setiap putaran sampel, online maupun offline, sehingga dashboard di WiFi
+// yang sama tetap punya riwayat pendek tanpa Firebase. Nilai disimpan dalam
+// persepuluhan (sensorTenths()) agar satu entri hanya 24 byte; bacaan yang
+// tidak ada disimpan sebagai kNoReadingTenths dan ditulis null di JSON.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "tomato_logic.h"
+
+struct RingSample {
+  long long timestamp;  // ms epoch, sama dengan yang dikirim ke Firebase
+  uint8_t zone;
+  uint8_t pumpOn;
+  int16_t temperature;  // persepuluhan, kNoReadingTenths jika tidak ada
+  int16_t humidity;
+  int16_t soil;
+  int16_t brightness;
+};
+
+class SampleRing {
+ public:
+  // 240 entri = 20 menit satu zona, atau 5 menit empat zona, dengan jeda 5 detik.
+  static const int kCapacity = 240;
+
+  SampleRing() : head_(0), count_(0) { memset(samples_, 0, sizeof(samples_)); }
+
+  void push(long long timestamp, int zone, float temperature, float humidity, float soil,
+            float brightness, bool pumpOn) {
+    RingSample& sample = samples_[head_];
+    sample.timestamp = timestamp;
+    sample.zone = (uint8_t)zone;
+    sample.pumpOn = pumpOn ? 1 : 0;
+    sample.temperature = sensorTenths(temperature);
+    sample.humidity = sensorTenths(humidity);
+    sample.soil = sensorTenths(soil);
+    sample.brightness = sensorTenths(brightness);
+    head_ = (head_ + 1) % kCapacity;
+    if (count_ < kCapacity) count_++;
+  }
+
+  int count() const { return count_; }
+
+  // Urut dari yang tertua; index 0..count()-1.
+  const RingSample& at(int index) const {
+    return samples_[(head_ - count_ + index + kCapacity) % kCapacity];
+  }
+
+  // Indeks sampel pertama dengan timestamp > since (count() jika tidak ada).
+  // Timestamp naik sepanjang ring, jadi cukup pencarian biner.
+  int firstAfter(long long since) const {
+    int low = 0;
+    int high = count_;
+    while (low < high) {
+      int mid = (low + high) / 2;
+      if (at(mid).timestamp <= since) low = mid + 1;
+      else high = mid;
+    }
+    return low;
+  }
+
+  // Menulis {"samples":[...],"next":<ts>,"more":bool} mulai dari sampel
+  // setelah `since`, paling banyak `limit` entri. Klien meneruskan "next"
+  // sebagai since berikutnya.
+  void writeJson(JsonWriter& json, long long since, int limit) const {
+    int first = firstAfter(since);
+    int end = first + limit < count_ ? first + limit : count_;
+    // Jangan memotong di tengah satu putaran (semua zona bertimestamp sama).
+    while (end > first && end < count_ && at(end).timestamp == at(end - 1).timestamp) end--;
+    if (end == first && first < count_) end = first + 1;
+
+    long long next = since;
+    json.beginObject().key("samples").beginArray();
+    for (int i = first; i < end; i++) {
+      const RingSample& s = at(i);
+      json.beginObject()
+          .key("t").value(s.timestamp)
+          .key("zone").value((int)s.zone)
+          .key("temp").value(tenthsToFloat(s.temperature), 1)
+          .key("hum").value(tenthsToFloat(s.humidity), 1)
+          .key("soil").value(tenthsToFloat(s.soil), 1)
+          .key("light").value(tenthsToFloat(s.brightness), 1)
+          .key("pump").value(s.pumpOn != 0)
+          .endObject();
+      next = s.timestamp;
+    }
+    json.endArray()
+        .key("next").value(next)
+        .key("more").value(end < count_)
+        .endObject();
+  }
+
+ private:
+  RingSample samples_[kCapacity];
+  int head_;
+  int count_;
+};
+
+#endif  // SMARTFARM_SAMPLE_RING_H_
@@ -0,0 +1,194 @@
+#ifndef SMARTFARM_TELEMETRY_FRAME_H_
+#define SMARTFARM_TELEMETRY_FRAME_H_
+
+// Format frame telemetri UDP untuk penerima di LAN (runner Linux, lihat
+// linux/runner/lan_telemetry_plugin.cc). Satu datagram per putaran sampel,
+// dikirim ke grup multicast kTelemetryGroup:kTelemetryPort.
+//
+// Layout little-endian, 36 byte + 8 byte per zona:
+//   0  'S' 'F'            magic
+//   2  u8  versi          kTelemetryVersion
+//   3  u8  jumlah zona
+//   4  u32 seq            naik 1 per frame, mulai 0 setiap boot
+//   8  i64 timestamp      ms epoch, sama dengan yang dikirim ke Firebase
+//   16 char[12] device id (dipotong, diisi '\0')
+//   28 u16 boot id        acak per boot; seq direset bila berubah
+//   30 i16 suhu           persepuluhan °C
+//   32 i16 kelembaban     persepuluhan %
+//                         (semua nilai persepuluhan: -32768 = tidak ada
+//                         bacaan, lihat sensorTenths() di tomato_logic.h)
+//   34 u8  flags          bit0 online
+//   35 u8  cadangan
+//   36 per zona: i16 tanah, i16 cahaya (persepuluhan %), u8 flags
+//      (bit0 pompa, bit1 MANUAL), u8 cadangan, u16 sisa siram (detik)
+//
+// Bagian penerima (telemetryTrack) juga di sini supaya kedua sisi protokol
+// berubah bersama.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "device_platform.h"
+#include "tomato_logic.h"
+
+const char kTelemetryGroup[] = "239.255.77.70";  // administratif lokal (239/8)
+const uint16_t kTelemetryPort = 47700;
+const uint8_t kTelemetryVersion = 1;
+const size_t kTelemetryHeaderSize = 36;
+const size_t kTelemetryZoneSize = 8;
+const size_t kTelemetryMaxFrame = kTelemetryHeaderSize + TOMATO_MAX_ZONES * kTelemetryZoneSize;
+const size_t kTelemetryIdSize = 12;
+
+struct TelemetryZone {
+  int16_t soil;        // persepuluhan %
+  int16_t brightness;  // persepuluhan %
+  bool pumpOn;
+  bool manual;
+  uint16_t pumpRemainingS;
+};
+
+struct TelemetryFrame {
+  uint32_t seq;
+  long long timestamp;
+  char deviceId[kTelemetryIdSize + 1];
+  uint16_t bootId;
+  int16_t temperature;  // persepuluhan
+  int16_t humidity;
+  bool online;
+  int zoneCount;
+  TelemetryZone zones[TOMATO_MAX_ZONES];
+};
+
+inline void telemetryPut16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+inline void telemetryPut32(uint8_t* p, uint32_t v) {
+  telemetryPut16(p, (uint16_t)v);
+  telemetryPut16(p + 2, (uint16_t)(v >> 16));
+}
+
+inline uint16_t telemetryGet16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+inline uint32_t telemetryGet32(const uint8_t* p) {
+  return telemetryGet16(p) | ((uint32_t)telemetryGet16(p + 2) << 16);
+}
+
+// Menulis frame ke out; kembali jumlah byte, 0 jika kapasitas kurang.
+inline size_t encodeTelemetryFrame(const TelemetryFrame& frame, uint8_t* out, size_t capacity) {
+  int zones = frame.zoneCount < TOMATO_MAX_ZONES ? frame.zoneCount : TOMATO_MAX_ZONES;
+  size_t size = kTelemetryHeaderSize + (size_t)zones * kTelemetryZoneSize;
+  if (zones < 0 || capacity < size) return 0;
+  memset(out, 0, size);
+  out[0] = 'S';
+  out[1] = 'F';
+  out[2] = kTelemetryVersion;
+  out[3] = (uint8_t)zones;
+  telemetryPut32(out + 4, frame.seq);
+  telemetryPut32(out + 8, (uint32_t)(uint64_t)frame.timestamp);
+  telemetryPut32(out + 12, (uint32_t)((uint64_t)frame.timestamp >> 32));
+  size_t idLength = strlen(frame.deviceId);
+  memcpy(out + 16, frame.deviceId, idLength < kTelemetryIdSize ? idLength : kTelemetryIdSize);
+  telemetryPut16(out + 28, frame.bootId);
+  telemetryPut16(out + 30, (uint16_t)frame.temperature);
+  telemetryPut16(out + 32, (uint16_t)frame.humidity);
+  out[34] = frame.online ? 1 : 0;
+  for (int i = 0; i < zones; i++) {
+    uint8_t* z = out + kTelemetryHeaderSize + i * kTelemetryZoneSize;
+    const TelemetryZone& zone = frame.zones[i];
+    telemetryPut16(z, (uint16_t)zone.soil);
+    telemetryPut16(z + 2, (uint16_t)zone.brightness);
+    z[4] = (uint8_t)((zone.pumpOn ? 1 : 0) | (zone.manual ? 2 : 0));
+    telemetryPut16(z + 6, zone.pumpRemainingS);
+  }
+  return size;
+}
+
+// false jika datagram bukan frame telemetri yang dikenal.
+inline bool decodeTelemetryFrame(const uint8_t* data, size_t length, TelemetryFrame* frame) {
+  if (length < kTelemetryHeaderSize || data[0] != 'S' || data[1] != 'F' ||
+      data[2] != kTelemetryVersion || data[3] > TOMATO_MAX_ZONES ||
+      length < kTelemetryHeaderSize + data[3] * kTelemetryZoneSize) {
+    return false;
+  }
+  frame->zoneCount = data[3];
+  frame->seq = telemetryGet32(data + 4);
+  frame->timestamp =
+      (long long)(telemetryGet32(data + 8) | ((uint64_t)telemetryGet32(data + 12) << 32));
+  memcpy(frame->deviceId, data + 16, kTelemetryIdSize);
+  frame->deviceId[kTelemetryIdSize] = '\0';
+  frame->bootId = telemetryGet16(data + 28);
+  frame->temperature = (int16_t)telemetryGet16(data + 30);
+  frame->humidity = (int16_t)telemetryGet16(data + 32);
+  frame->online = (data[34] & 1) != 0;
+  for (int i = 0; i < frame->zoneCount; i++) {
+    const uint8_t* z = data + kTelemetryHeaderSize + i * kTelemetryZoneSize;
+    TelemetryZone& zone = frame->zones[i];
+    zone.soil = (int16_t)telemetryGet16(z);
+    zone.brightness = (int16_t)telemetryGet16(z + 2);
+    zone.pumpOn = (z[4] & 1) != 0;
+    zone.manual = (z[4] & 2) != 0;
+    zone.pumpRemainingS = telemetryGet16(z + 6);
+  }
+  return true;
+}
+
+// --- Sisi penerima: urutan & kehilangan per perangkat ---
+
+enum TelemetryVerdict {
+  TELEMETRY_NEXT,       // frame baru (mungkin setelah celah = hilang)
+  TELEMETRY_LATE,       // datang terlambat; sudah dihitung hilang, kini dikoreksi
+  TELEMETRY_DUPLICATE,  // seq sudah pernah diterima
+  TELEMETRY_RESTART,    // boot id berubah: perangkat reboot, hitungan seq mulai lagi
+};
+
+// Satu per perangkat (device id); mulai dari nol.
+struct TelemetryPeer {
+  bool seen;
+  uint16_t bootId;
+  uint32_t lastSeq;  // seq tertinggi yang diterima
+  uint32_t window;   // bit i = seq (lastSeq - i) sudah diterima
+  uint32_t received;
+  uint32_t lost;     // celah seq yang belum terisi
+  uint32_t late;
+  uint32_t duplicates;
+  uint32_t restarts;
+};
+
+// Mencatat satu frame. Frame LATE/DUPLICATE sebaiknya tidak ditampilkan
+// karena data yang lebih baru sudah sampai. Frame yang lebih tua dari 32
+// seq di belakang diperlakukan sebagai duplikat.
+inline TelemetryVerdict telemetryTrack(TelemetryPeer& peer, uint16_t bootId, uint32_t seq) {
+  if (!peer.seen || bootId != peer.bootId) {
+    bool restart = peer.seen;
+    peer.seen = true;
+    peer.bootId = bootId;
+    peer.lastSeq = seq;
+    peer.window = 1;
+    peer.received++;
+    if (restart) peer.restarts++;
+    return restart ? TELEMETRY_RESTART : TELEMETRY_NEXT;
+  }
+  if (seq > peer.lastSeq) {
+    uint32_t gap = seq - peer.lastSeq;
+    peer.lost += gap - 1;
+    peer.window = gap < 32 ? (peer.window << gap) | 1 : 1;
+    peer.lastSeq = seq;
+    peer.received++;
+    return TELEMETRY_NEXT;
+  }
+  uint32_t age = peer.lastSeq - seq;
+  if (age >= 32 || (peer.window & (1u << age))) {
+    peer.duplicates++;
+    return TELEMETRY_DUPLICATE;
+  }
+  peer.window |= 1u << age;
+  peer.received++;
+  peer.late++;
+  if (peer.lost > 0) peer.lost--;
+  return TELEMETRY_LATE;
+}
+
+#endif  // SMARTFARM_TELEMETRY_FRAME_H_
@@ -0,0 +1,286 @@
+#ifndef SMARTFARM_TLS_SESSION_CLIENT_H_
+#define SMARTFARM_TLS_SESSION_CLIENT_H_
+
+// Klien TLS untuk ArduinoRtdbTransport yang melanjutkan sesi TLS 1.2
+// (session ticket / session ID) antar koneksi, juga setelah deep sleep atau
+// restart: sesi terakhir diserialisasi ke RTC memory dan dipasang dengan
+// mbedtls_ssl_set_session() sebelum handshake berikutnya. Handshake singkat
+// tidak memverifikasi ulang sertifikat dan tidak melakukan ECDHE, jadi jauh
+// lebih cepat dan hemat daya daripada handshake penuh.
+//
+// WiFiClientSecure tidak bisa dipakai: konteks mbedtls-nya privat dan
+// handshake langsung dijalankan di connect(). Kelas ini memakai mbedtls yang
+// sama (Arduino-ESP32 2.x, mbedtls 2.28) di atas WiFiClient biasa, dengan
+// verifikasi server tetap wajib (MBEDTLS_SSL_VERIFY_REQUIRED). Hanya
+// di-include oleh arduino_platform.h.
+//
+// Blob sesi berisi master secret. RTC slow memory tidak keluar dari chip dan
+// hilang saat listrik putus; sesi yang ditolak server atau gagal di-load
+// dibuang dan koneksi berikutnya memakai handshake penuh.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+#include <string.h>
+
+// mbedtls 3.x menyembunyikan field struct di balik MBEDTLS_PRIVATE().
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
+class TlsSessionClient : public WiFiClient {
+ public:
+  // Sesi TLS 1.2 terserialisasi: ~150 byte + sertifikat server (bila mbedtls
+  // menyimpannya) + ticket.
+  static const size_t kSessionCapacity = 2048;
+
+  TlsSessionClient()
+      : caCert_(nullptr),
+        handshakeTimeoutMs_(5000),
+        ready_(false),
+        open_(false),
+        resumed_(false),
+        lastError_(0),
+        peeked_(-1) {
+    mbedtls_ssl_init(&ssl_);
+    mbedtls_ssl_config_init(&conf_);
+    mbedtls_x509_crt_init(&ca_);
+  }
+
+  ~TlsSessionClient() {
+    stop();
+    mbedtls_ssl_free(&ssl_);
+    mbedtls_ssl_config_free(&conf_);
+    mbedtls_x509_crt_free(&ca_);
+  }
+
+  // Dipanggil sebelum connect() pertama; pem harus tetap hidup.
+  void setCACert(const char* pem) { caCert_ = pem; }
+  void setHandshakeTimeout(unsigned long seconds) { handshakeTimeoutMs_ = seconds * 1000; }
+
+  // true jika handshake terakhir melanjutkan sesi tersimpan.
+  bool resumed() const { return resumed_; }
+  // Kode error mbedtls handshake terakhir yang gagal (0 jika belum ada).
+  int lastError() const { return lastError_; }
+
+  int connect(IPAddress ip, uint16_t port) override {
+    return connect(ip.toString().c_str(), port, (int32_t)handshakeTimeoutMs_);
+  }
+  int connect(IPAddress ip, uint16_t port, int32_t timeoutMs) override {
+    return connect(ip.toString().c_str(), port, timeoutMs);
+  }
+  int connect(const char* host, uint16_t port) override {
+    return connect(host, port, (int32_t)handshakeTimeoutMs_);
+  }
+
+  int connect(const char* host, uint16_t port, int32_t timeoutMs) override {
+    stop();
+    resumed_ = false;
+    if (!setup() || !tcp_.connect(host, port, timeoutMs)) return 0;
+    if (mbedtls_ssl_session_reset(&ssl_) != 0 || mbedtls_ssl_set_hostname(&ssl_, host) != 0) {
+      tcp_.stop();
+      return 0;
+    }
+    mbedtls_ssl_set_bio(&ssl_, this, sendTcp, recvTcp, nullptr);
+    bool offered = offerSession();
+
+    unsigned long start = ::millis();
+    int ret;
+    while ((ret = mbedtls_ssl_handshake(&ssl_)) != 0) {
+      if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+          ::millis() - start > handshakeTimeoutMs_) {
+        // Sesi yang ikut gagal tidak ditawarkan lagi.
+        if (offered) storedSession().magic = 0;
+        lastError_ = ret;
+        tcp_.stop();
+        return 0;
+      }
+      delay(1);
+    }
+    // Master secret hanya sama jika server menerima sesi yang ditawarkan.
+    resumed_ = offered && memcmp(ssl_.MBEDTLS_PRIVATE(session)->MBEDTLS_PRIVATE(master),
+                                 offeredMaster_, sizeof(offeredMaster_)) == 0;
+    saveSession();
+    open_ = true;
+    return 1;
+  }
+
+  size_t write(uint8_t data) override { return write(&data, 1); }
+
+  size_t write(const uint8_t* data, size_t length) override {
+    if (!open_) return 0;
+    size_t written = 0;
+    unsigned long start = ::millis();
+    while (written < length) {
+      int ret = mbedtls_ssl_write(&ssl_, data + written, length - written);
+      if (ret > 0) {
+        written += (size_t)ret;
+      } else if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+                 ::millis() - start > handshakeTimeoutMs_) {
+        stop();
+        break;
+      }
+    }
+    return written;
+  }
+
+  int available() override {
+    if (!open_) return 0;
+    int pending = peeked_ >= 0 ? 1 : 0;
+    // Baca 0 byte agar record yang sudah tiba didekripsi.
+    int ret = mbedtls_ssl_read(&ssl_, nullptr, 0);
+    size_t avail = mbedtls_ssl_get_bytes_avail(&ssl_);
+    if (avail == 0 && ret != 0 && ret != MBEDTLS_ERR_SSL_WANT_READ &&
+        ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      stop();
+      return pending;
+    }
+    return pending + (int)avail;
+  }
+
+  int read() override {
+    uint8_t data;
+    return read(&data, 1) == 1 ? data : -1;
+  }
+
+  int read(uint8_t* buffer, size_t size) override {
+    if (size == 0) return 0;
+    int n = 0;
+    if (peeked_ >= 0) {
+      buffer[n++] = (uint8_t)peeked_;
+      peeked_ = -1;
+      if (size == 1) return n;
+    }
+    if (!open_) return n > 0 ? n : -1;
+    int ret = mbedtls_ssl_read(&ssl_, buffer + n, size - n);
+    if (ret > 0) return n + ret;
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) stop();
+    return n > 0 ? n : -1;
+  }
+
+  int peek() override {
+    if (peeked_ < 0) {
+      uint8_t data;
+      if (open_ && mbedtls_ssl_read(&ssl_, &data, 1) == 1) peeked_ = data;
+    }
+    return peeked_;
+  }
+
+  void flush() override {}
+
+  void stop() override {
+    if (open_) mbedtls_ssl_close_notify(&ssl_);
+    open_ = false;
+    peeked_ = -1;
+    tcp_.stop();
+  }
+
+  uint8_t connected() override {
+    if (open_ && !tcp_.connected() && peeked_ < 0 && mbedtls_ssl_get_bytes_avail(&ssl_) == 0) {
+      stop();
+    }
+    return open_ || peeked_ >= 0;
+  }
+
+  int setTimeout(uint32_t seconds) override { return tcp_.setTimeout(seconds); }
+
+  operator bool() override { return connected(); }
+
+ private:
+  static const uint32_t kSessionMagic = 0x544C5331;  // "TLS1"
+
+  struct StoredSession {
+    uint32_t magic;
+    uint32_t length;
+    uint8_t data[kSessionCapacity];
+  };
+
+  static StoredSession& storedSession() {
+    static RTC_DATA_ATTR StoredSession session;
+    return session;
+  }
+
+  static int randomBytes(void*, unsigned char* out, size_t length) {
+    esp_fill_random(out, length);  // RNG hardware; WiFi aktif
+    return 0;
+  }
+
+  static int sendTcp(void* context, const unsigned char* data, size_t length) {
+    WiFiClient& tcp = static_cast<TlsSessionClient*>(context)->tcp_;
+    if (!tcp.connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+    size_t n = tcp.write(data, length);
+    return n > 0 ? (int)n : MBEDTLS_ERR_SSL_WANT_WRITE;
+  }
+
+  static int recvTcp(void* context, unsigned char* buffer, size_t length) {
+    WiFiClient& tcp = static_cast<TlsSessionClient*>(context)->tcp_;
+    if (tcp.available() <= 0) {
+      return tcp.connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    int n = tcp.read(buffer, length);
+    return n > 0 ? n : MBEDTLS_ERR_SSL_WANT_READ;
+  }
+
+  // Konfigurasi mbedtls sekali per boot.
+  bool setup() {
+    if (ready_) return true;
+    if (caCert_ == nullptr ||
+        mbedtls_x509_crt_parse(&ca_, (const unsigned char*)caCert_, strlen(caCert_) + 1) != 0 ||
+        mbedtls_ssl_config_defaults(&conf_, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+      return false;
+    }
+    mbedtls_ssl_conf_authmode(&conf_, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&conf_, &ca_, nullptr);
+    mbedtls_ssl_conf_rng(&conf_, randomBytes, nullptr);
+    mbedtls_ssl_conf_session_tickets(&conf_, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+    ready_ = mbedtls_ssl_setup(&ssl_, &conf_) == 0;
+    return ready_;
+  }
+
+  // Pasang sesi dari RTC memory sebelum handshake; false jika tidak ada.
+  bool offerSession() {
+    StoredSession& stored = storedSession();
+    if (stored.magic != kSessionMagic || stored.length > sizeof(stored.data)) return false;
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    bool ok = mbedtls_ssl_session_load(&session, stored.data, stored.length) == 0 &&
+              mbedtls_ssl_set_session(&ssl_, &session) == 0;
+    if (ok) memcpy(offeredMaster_, session.MBEDTLS_PRIVATE(master), sizeof(offeredMaster_));
+    mbedtls_ssl_session_free(&session);
+    if (!ok) stored.magic = 0;
+    return ok;
+  }
+
+  // Simpan sesi (termasuk ticket baru) untuk handshake berikutnya.
+  void saveSession() {
+    StoredSession& stored = storedSession();
+    stored.magic = 0;
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    size_t length = 0;
+    if (mbedtls_ssl_get_session(&ssl_, &session) == 0 &&
+        mbedtls_ssl_session_save(&session, stored.data, sizeof(stored.data), &length) == 0) {
+      stored.length = (uint32_t)length;
+      stored.magic = kSessionMagic;
+    }
+    mbedtls_ssl_session_free(&session);
+  }
+
+  WiFiClient tcp_;
+  mbedtls_ssl_context ssl_;
+  mbedtls_ssl_config conf_;
+  mbedtls_x509_crt ca_;
+  const char* caCert_;
+  unsigned long handshakeTimeoutMs_;
+  bool ready_;
+  bool open_;
+  bool resumed_;
+  int lastError_;
+  int peeked_;
+  unsigned char offeredMaster_[48];
+};
+
+#endif  // SMARTFARM_TLS_SESSION_CLIENT_H_
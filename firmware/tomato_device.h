@@ -0,0 +1,985 @@
+#ifndef SMARTFARM_TOMATO_DEVICE_H_
+#define SMARTFARM_TOMATO_DEVICE_H_
+
+// Seluruh state dan logika satu node SmartFarm Tomato. Dulu berupa variabel
+// global di sketch; sekarang dibungkus agar host bisa menjalankan banyak
+// perangkat virtual sekaligus (lihat linux/tools/fleet_sim.cc). Sketch ESP32
+// cukup membuat satu instance dengan platform Arduino.
+//
+// Satu papan bisa melayani beberapa zona (bedengan). Tiap zona punya probe
+// tanah/LDR, pompa, umur tanaman, threshold dan state penyiraman sendiri;
+// DHT (suhu & kelembaban udara) dipakai bersama.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "alert_rules.h"
+#include "device_clock.h"
+#include "device_log.h"
+#include "device_platform.h"
+#include "dht22_sensor.h"
+#include "loop_profiler.h"
+#include "memory_telemetry.h"
+#include "net_stats.h"
+#include "pump_command.h"
+#include "pump_service.h"
+#include "remote_config.h"
+#include "rtdb_json.h"
+#include "rtdb_resilience.h"
+#include "sample_ring.h"
+#include "tomato_logic.h"
+
+struct DeviceConfig {
+  const char* deviceId;
+  // Tiga nilai berikut hanya bawaan; /config/<device> bisa menggantinya
+  // (lihat remote_config.h dan TomatoDevice::tuning()).
+  unsigned long interval;              // jeda antar sampel
+  unsigned long notificationInterval;  // cek notifikasi Firebase
+  unsigned long wateringDuration;      // durasi satu kali siram
+  unsigned long dayDuration;           // 1 hari umur tanaman
+  int notificationBurst;               // token bucket: notifikasi beruntun maks
+  unsigned long notificationRefillMs;  // token bucket: 1 token per jeda ini
+  bool notificationDigest;             // lipat alert berulang jadi ringkasan
+  unsigned long diagnosticsInterval;   // upload /diagnostics/<id>; 0 = mati
+  unsigned long commandSloMs;          // SLO perintah pompa terbit→aktuasi
+  ResilienceConfig resilience;         // circuit breaker & backoff REST
+};
+
+inline DeviceConfig defaultDeviceConfig() {
+  DeviceConfig config;
+  config.deviceId = "tomato_01";
+  config.interval = 5000;               // 5 detik
+  config.notificationInterval = 10000;  // Cek notifikasi setiap 10 detik
+  config.wateringDuration = 15000;      // 15 DETIK
+  config.dayDuration = 24UL * 60 * 60 * 1000;
+  config.notificationBurst = 6;
+  config.notificationRefillMs = 5UL * 60 * 1000;  // ~12 notifikasi/jam setelah burst
+  config.notificationDigest = true;
+  config.diagnosticsInterval = 10UL * 60 * 1000;  // 10 menit
+  config.commandSloMs = 10000;  // dua kali jeda sampel bawaan
+  config.resilience = defaultResilienceConfig();
+  return config;
+}
+
+// --- Konfigurasi Zona ---
+// basePath "" memakai node lama (/current_data, /history_data, /control) agar
+// aplikasi tetap jalan; zona lain misalnya "/zones/bed2".
+struct ZoneConfig {
+  const char* id;
+  const char* basePath;
+  int soilPin;
+  int ldrPin;
+  int relayPin;
+  int servoPin;          // -1 jika tanpa servo
+  int initialAgeDays;    // umur tanaman saat papan menyala
+  int soilThresholds[4]; // per tahap (BIBIT..PEMBUAHAN); 0 = bawaan
+};
+
+// State satu zona (dulu variabel global di sketch).
+struct ZoneState {
+  // --- Penyiraman ---
+  unsigned long lastWateringTime;
+  bool wateringInProgress;
+  unsigned long wateringStartTime;
+  uint8_t pumpSource;  // PumpSource run yang sedang/terakhir berjalan
+  // Run MANUAL dipotong safety timer; tidak dinyalakan lagi sampai aplikasi
+  // mengirim OFF.
+  bool manualCutoff;
+
+  // --- Umur Tanaman ---
+  int plantAgeDays;
+  unsigned long lastAgeUpdate;
+
+  // --- Data terbaru ---
+  float currentSoilPercent;
+  float currentBrightnessPercent;
+  bool isDay;
+  const char* currentSoilCategory;
+  const char* currentBrightnessCategory;
+  const char* currentTempStatus;
+  const char* currentTime;
+  bool currentPompaStatus;
+  char currentOperatingMode[12];
+
+  // --- Notifikasi & manajemen data ---
+  AlertRuleState alerts[kAlertRuleCount];  // aturan ALERT_SCOPE_ZONE
+  uint64_t lastDataHash;
+  bool hasDataHash;
+};
+
+// State bersama satu papan.
+struct DeviceState {
+  unsigned long previousMillis;
+  unsigned long lastNotificationCheck;
+  unsigned long lastDiagnosticsUpload;
+  float currentTemperature;
+  float currentHumidity;
+  const char* currentAirHumStatus;
+  AlertRuleState alerts[kAlertRuleCount];  // aturan ALERT_SCOPE_DEVICE
+  TokenBucket notifyBucket;
+  unsigned long notificationsSent;
+  unsigned long notificationsFolded;   // masuk digest
+  unsigned long notificationsDropped;  // kena batas laju / digest mati
+  char lastFirebaseNotification[192];
+  bool timeInitialized;
+  bool online;  // WiFi terhubung saat sampel terakhir
+};
+
+struct Zone {
+  const ZoneConfig* config;
+  ZoneState state;
+};
+
+class TomatoDevice;
+
+// Dipanggil setiap putaran sampel setelah nilai sensor dihitung, sebelum
+// request Firebase apa pun (mis. UdpTelemetry di udp_telemetry.h).
+class SampleListener {
+ public:
+  virtual ~SampleListener() {}
+  virtual void onSample(TomatoDevice& device, long long timestamp) = 0;
+};
+
+class TomatoDevice {
+ public:
+  static const size_t kBodySize = 2048;
+  static const size_t kJsonSize = 768;
+  static const size_t kBatchSize = TOMATO_MAX_ZONES * (2 * kJsonSize + 160);
+  static const size_t kMessageSize = 192;
+  static const unsigned long kMaxPumpCommandMs = 10UL * 60 * 1000;
+
+  TomatoDevice(DevicePlatform& platform, RtdbTransport& rtdb, PumpActuator& pump,
+               const ZoneConfig* zones, int zoneCount,
+               const DeviceConfig& config = defaultDeviceConfig())
+      : platform_(platform),
+        clock_(platform),
+        net_(rtdb),
+        rtdb_(net_, platform, config.resilience),
+        pumps_(pump, platform),
+        commands_(config.commandSloMs),
+        dht_(nullptr),
+        config_(config),
+        profiler_(platform),
+        tuning_(remoteConfigDefaults(config.interval, config.notificationInterval,
+                                     config.wateringDuration)),
+        configVersionSeen_(0),
+        configPending_(true),
+        sampleListener_(nullptr) {
+    memset(&state, 0, sizeof(state));
+    state.currentAirHumStatus = "";
+    tokenBucketInit(state.notifyBucket, config_.notificationBurst, config_.notificationRefillMs, 0);
+    memset(pompaCommand_, 0, sizeof(pompaCommand_));
+
+    zoneCount_ = zoneCount < TOMATO_MAX_ZONES ? zoneCount : TOMATO_MAX_ZONES;
+    for (int i = 0; i < zoneCount_; i++) {
+      Zone& zone = zones_[i];
+      zone.config = &zones[i];
+      memset(&zone.state, 0, sizeof(zone.state));
+      zone.state.plantAgeDays = zones[i].initialAgeDays > 0 ? zones[i].initialAgeDays : 1;
+      zone.state.currentSoilCategory = "";
+      zone.state.currentBrightnessCategory = "";
+      zone.state.currentTempStatus = "";
+      zone.state.currentTime = "";
+      strcpy(zone.state.currentOperatingMode, "AUTO");
+    }
+  }
+
+  const DeviceConfig& config() const { return config_; }
+  int zoneCount() const { return zoneCount_; }
+  Zone& zone(int index) { return zones_[index]; }
+  int zoneIndex(const Zone& zone) const { return (int)(&zone - zones_); }
+  DeviceClock& clock() { return clock_; }
+  LoopProfiler& profiler() { return profiler_; }
+  MemoryTelemetry& memory() { return memory_; }
+  const NetStats& netStats() const { return net_.stats(); }
+  const ResilientRtdbTransport& resilience() const { return rtdb_; }
+  // Untuk modul lain yang menulis ke RTDB (mis. status OTA): lewat circuit
+  // breaker dan tercatat di statistik jaringan.
+  RtdbTransport& rtdb() { return rtdb_; }
+  // PATCH data yang benar-benar diterima Firebase sejak boot (cek sehat OTA);
+  // tulisan yang hanya masuk buffer lokal baru dihitung saat terkirim ulang.
+  unsigned long dataUploads() const { return rtdb_.stats().delivered[NET_DATA]; }
+  // Konfigurasi yang sedang berlaku (bawaan, cache NVS, atau /config terbaru).
+  const RemoteConfig& tuning() const { return tuning_; }
+  const PumpService& pumps() const { return pumps_; }
+  const PumpCommandTracker& commands() const { return commands_; }
+
+  // Statistik DHT22 ikut dumpDiagnostics() dan /diagnostics bila dipasang.
+  void attachDht(const Dht22Sensor& dht) { dht_ = &dht; }
+  const SampleRing& recentSamples() const { return recent_; }
+  void setSampleListener(SampleListener* listener) { sampleListener_ = listener; }
+
+  // Perintah serial "diag".
+  void dumpDiagnostics() {
+    profiler_.dump(platform_);
+    memory_.dump(platform_);
+    net_.stats().dump(platform_);
+    rtdb_.dump(platform_);
+    pumps_.dump(platform_);
+    commands_.dump(platform_);
+    if (dht_) dht_->dump(platform_);
+    if (rtdb_.tlsStats()) dumpTlsStats(*rtdb_.tlsStats(), platform_);
+  }
+
+  // Dipanggil di akhir setup(): muat konfigurasi dari NVS, mulai hitung umur
+  // tanaman dan jadwal sampel. /config diambil di sampel pertama.
+  void begin() {
+    loadCachedConfig();
+    unsigned long now = platform_.millis();
+    for (int i = 0; i < zoneCount_; i++) {
+      zones_[i].state.lastAgeUpdate = now;
+    }
+    state.previousMillis = now - tuning_.interval;
+    state.lastNotificationCheck = now;
+    state.lastDiagnosticsUpload = now;
+    tokenBucketInit(state.notifyBucket, config_.notificationBurst, config_.notificationRefillMs, now);
+  }
+
+  // Satu iterasi loop(). true jika sampel baru diproses (LCD perlu update).
+  bool loop(SensorSource& sensors) {
+    unsigned long currentMillis = platform_.millis();
+    bool sampled = false;
+    memory_.beginLoop(platform_);
+
+    pumps_.service();
+    // Tutup run yang dimatikan timer sebelum perintah apa pun di putaran ini
+    // membaca status pompa; jika tidak, OFF dari aplikasi di putaran yang sama
+    // menelan notifikasi Safety Timer dan lastWateringTime.
+    for (int i = 0; i < zoneCount_; i++) {
+      if (zones_[i].state.wateringInProgress && !pumps_.running(i)) {
+        finishWatering(zones_[i]);
+      }
+    }
+    rtdb_.service();
+    serviceClock();
+    updatePlantAge();
+
+    if (currentMillis - state.lastNotificationCheck >= tuning_.notificationInterval) {
+      checkFirebaseNotifications();
+      state.lastNotificationCheck = currentMillis;
+    }
+
+    if (currentMillis - state.previousMillis >= tuning_.interval) {
+      state.previousMillis = currentMillis;
+      if (configPending_) refreshRemoteConfig();
+      StageTimer cycle(profiler_, STAGE_CYCLE);
+      RawSample sample;
+      memset(&sample, 0, sizeof(sample));
+      {
+        StageTimer t(profiler_, STAGE_SENSOR_READ);
+        sensors.read(&sample, zoneCount_);
+      }
+      processSample(sample);
+      memory_.sample(platform_);
+      sampled = true;
+    }
+
+    if (config_.diagnosticsInterval > 0 &&
+        currentMillis - state.lastDiagnosticsUpload >= config_.diagnosticsInterval) {
+      state.lastDiagnosticsUpload = currentMillis;
+      uploadDiagnostics();
+    }
+
+    memory_.endLoop(platform_);
+    return sampled;
+  }
+
+  // Semua zona diproses dalam satu putaran lalu di-upload dalam satu request.
+  void processSample(const RawSample& raw) {
+    state.currentTemperature = raw.temperature;
+    state.currentHumidity = raw.humidity;
+    state.currentAirHumStatus = getAirHumStatus(raw.humidity);
+
+    for (int i = 0; i < zoneCount_; i++) {
+      ZoneState& zs = zones_[i].state;
+      zs.currentSoilPercent = soilRawToPercent(raw.soilRaw[i]);
+      zs.currentBrightnessPercent = ldrRawToPercent(raw.ldrRaw[i]);
+      zs.isDay = (zs.currentBrightnessPercent > 25.0);
+      zs.currentSoilCategory = getSoilCategory(zs.currentSoilPercent);
+      zs.currentBrightnessCategory = getBrightnessCategory(zs.currentBrightnessPercent);
+      zs.currentTempStatus = getTempStatus(raw.temperature, zs.isDay);
+      zs.currentTime = zs.isDay ? "Siang" : "Malam";
+    }
+
+    if (SMARTFARM_LOG_LEVEL >= SMARTFARM_LOG_DEBUG && platform_.logEnabled()) logSample();
+
+    long long timestamp = getTimestampForFirebase();
+    if (sampleListener_) sampleListener_->onSample(*this, timestamp);
+
+    readControl();
+    for (int i = 0; i < zoneCount_; i++) {
+      checkPompaControl(zones_[i]);
+    }
+    checkAndGenerateNotifications();
+
+    for (int i = 0; i < zoneCount_; i++) {
+      const ZoneState& zs = zones_[i].state;
+      recent_.push(timestamp, i, raw.temperature, raw.humidity, zs.currentSoilPercent,
+                   zs.currentBrightnessPercent, zs.currentPompaStatus);
+    }
+    sendToFirebase(timestamp);
+  }
+
+  // --- Fungsi Waktu ---
+  // Timestamp milidetik untuk Firebase, O(1) dari DeviceClock. Sebelum jam
+  // tersinkron: uptime + 1.7e12 seperti dulu.
+  long long getTimestampForFirebase() { return clock_.nowMs(); }
+
+  // Jangkar jam diambil setelah sketch menandai waktu siap (NTP atau waktu
+  // manual), lalu setiap jam.
+  void serviceClock() {
+    if (!state.timeInitialized || !clock_.needsSync()) return;
+    bool first = !clock_.synced();
+    if (clock_.sync() && first) SF_LOGI("🕒 Jam tersinkron: %s", clock_.dateTime());
+  }
+
+  // --- Fungsi Umur Tanaman ---
+  void updatePlantAge() {
+    unsigned long currentMillis = platform_.millis();
+    for (int i = 0; i < zoneCount_; i++) {
+      ZoneState& zs = zones_[i].state;
+      if (currentMillis - zs.lastAgeUpdate >= config_.dayDuration) {
+        zs.plantAgeDays++;
+        zs.lastAgeUpdate = currentMillis;
+        SF_LOGI("🎉 [%s] HARI KE-%d: %s", zones_[i].config->id, zs.plantAgeDays,
+                getPlantStage(zs.plantAgeDays, tuning_.crop));
+      }
+    }
+  }
+
+  int soilThreshold(const Zone& zone) const {
+    int stage = getPlantStageIndex(zone.state.plantAgeDays, tuning_.crop);
+    int custom = zone.config->soilThresholds[stage];
+    return custom > 0 ? custom : tuning_.crop.soilThreshold[stage];
+  }
+
+  bool isWateringTime() {
+    struct tm timeinfo;
+    if (!clock_.localTime(&timeinfo)) {
+      return false;
+    }
+    return isWateringHour(timeinfo.tm_hour, tuning_.crop.wateringHours);
+  }
+
+  // --- Fungsi Notifikasi ---
+  bool sendNotificationToFirebase(const char* title, const char* message, const char* type = "info",
+                                  const Zone* zone = nullptr) {
+    if (!onlineOrSkip()) {
+      SF_LOGE("❌ WiFi tidak terhubung");
+      return false;
+    }
+    if (!tokenBucketTake(state.notifyBucket, platform_.millis())) {
+      state.notificationsDropped++;
+      SF_LOGW("⏳ Batas notifikasi tercapai, \"%s\" dilewati", title);
+      return false;
+    }
+
+    long long timestamp = getTimestampForFirebase();
+    const char* createdAt = clock_.dateTime();
+
+    char notificationKey[48];
+    snprintf(notificationKey, sizeof(notificationKey), "notif_%lld_%ld",
+             timestamp, platform_.random(1000, 9999));
+
+    // Dengan lebih dari satu zona, judul diberi nama zona agar bisa dibedakan.
+    char zonedTitle[128];
+    if (zone && zoneCount_ > 1) {
+      snprintf(zonedTitle, sizeof(zonedTitle), "[%s] %s", zone->config->id, title);
+      title = zonedTitle;
+    }
+
+    JsonWriter json(json_, sizeof(json_));
+    json.beginObject()
+        .key("title").value(title)
+        .key("message").value(message)
+        .key("type").value(type)
+        .key("timestamp").value(timestamp)
+        .key("isRead").value(false)
+        .key("createdAt").value(createdAt);
+    if (zone) json.key("zona").value(zone->config->id);
+    json.endObject();
+    if (!json.ok()) {
+      SF_LOGE("❌ Notifikasi terlalu panjang, dilewati");
+      return false;
+    }
+
+    char path[96];
+    snprintf(path, sizeof(path), "/notifications/%s.json", notificationKey);
+
+    SF_LOGD("📤 Mengirim notifikasi...");
+    SF_LOGD("🗂️ Key: %s", notificationKey);
+    SF_LOGD("🕒 Waktu: %s", createdAt);
+    SF_LOGD("📅 Timestamp: %lld", timestamp);
+
+    int httpResponseCode;
+    {
+      StageTimer t(profiler_, STAGE_NOTIFY_PUT);
+      httpResponseCode = rtdb_.put(path, json.c_str(), json.length());
+    }
+    if (httpResponseCode > 0) {
+      SF_LOGI("✅ Notifikasi berhasil! Response: %d", httpResponseCode);
+      state.notificationsSent++;
+      return true;
+    }
+    SF_LOGE("❌ Gagal mengirim notifikasi! Error: %d", httpResponseCode);
+    return false;
+  }
+
+  // Evaluasi semua aturan di alert_rules.h: aturan papan sekali, aturan zona
+  // untuk setiap zona.
+  void checkAndGenerateNotifications() {
+    StageTimer t(profiler_, STAGE_ALERT_RULES);
+    unsigned long now = platform_.millis();
+    AlertInputs in;
+    memset(&in, 0, sizeof(in));
+    in.temperature = state.currentTemperature;
+    in.humidity = state.currentHumidity;
+
+    for (int r = 0; r < kAlertRuleCount; r++) {
+      if (kAlertRules[r].scope == ALERT_SCOPE_DEVICE) {
+        evaluateAlert(r, state.alerts[r], in, now, nullptr);
+      }
+    }
+
+    for (int i = 0; i < zoneCount_; i++) {
+      Zone& zone = zones_[i];
+      ZoneState& zs = zone.state;
+      in.soilPercent = zs.currentSoilPercent;
+      in.soilThreshold = soilThreshold(zone);
+      in.brightnessPercent = zs.currentBrightnessPercent;
+      in.isDay = zs.isDay;
+      in.manualPumpOn = zs.wateringInProgress && zs.pumpSource != PUMP_SOURCE_AUTO;
+      in.plantAgeDays = zs.plantAgeDays;
+      in.plantStage = getPlantStageIndex(zs.plantAgeDays, tuning_.crop);
+      in.stageStartDay = isStageStartDay(zs.plantAgeDays, tuning_.crop);
+      for (int r = 0; r < kAlertRuleCount; r++) {
+        if (kAlertRules[r].scope == ALERT_SCOPE_ZONE) {
+          evaluateAlert(r, zs.alerts[r], in, now, &zone);
+        }
+      }
+    }
+  }
+
+  void checkFirebaseNotifications() {
+    if (!onlineOrSkip()) return;
+
+    size_t length = 0;
+    int httpCode;
+    {
+      StageTimer t(profiler_, STAGE_NOTIFY_GET);
+      httpCode = rtdb_.get("/notifications.json?orderBy=\"timestamp\"&limitToLast=5", body_,
+                           sizeof(body_), &length);
+    }
+    if (httpCode <= 0 || strcmp(body_, "null") == 0) return;
+
+    JsonObjectIterator it(jsonSpanOf(body_, length));
+    JsonSpan key, value;
+    while (it.next(&key, &value)) {
+      char title[96] = "Notifikasi";
+      char message[kMessageSize] = "";
+      bool isRead = false;
+      JsonSpan field;
+      if (jsonFindMember(value, "title", &field)) jsonCopyString(field, title, sizeof(title));
+      if (jsonFindMember(value, "message", &field)) jsonCopyString(field, message, sizeof(message));
+      if (jsonFindMember(value, "isRead", &field)) isRead = jsonIsTrue(field);
+
+      if (!isRead && message[0] != '\0' && strcmp(message, state.lastFirebaseNotification) != 0) {
+        SF_LOGI("📢 NOTIFIKASI FIREBASE: %s - %s", title, message);
+        snprintf(state.lastFirebaseNotification, sizeof(state.lastFirebaseNotification), "%s", message);
+
+        // Mark as read
+        char readPath[96];
+        snprintf(readPath, sizeof(readPath), "/notifications/%.*s/isRead.json",
+                 (int)key.size(), key.begin);
+        rtdb_.put(readPath, "true", 4);
+
+        SF_LOGI("✅ Notifikasi Firebase dibaca: %s", title);
+      }
+    }
+  }
+
+  // --- API perintah pompa (serial, server lokal) ---
+  // durationMs 0 = durasi siram yang berlaku. Di mode MANUAL, perintah ini
+  // tidak dibatalkan oleh pompa_status aplikasi; safety timer tetap berlaku.
+  bool startPump(int zoneIndex, unsigned long durationMs = 0) {
+    if (zoneIndex < 0 || zoneIndex >= zoneCount_) return false;
+    if (durationMs == 0) durationMs = tuning_.wateringDuration;
+    if (durationMs > kMaxPumpCommandMs) return false;
+    startWatering(zones_[zoneIndex], PUMP_SOURCE_COMMAND, durationMs);
+    SF_LOGI("🔧 [%s] Pompa ON %lu ms (perintah)", zones_[zoneIndex].config->id, durationMs);
+    return true;
+  }
+
+  bool stopPump(int zoneIndex) {
+    if (zoneIndex < 0 || zoneIndex >= zoneCount_ || !zones_[zoneIndex].state.wateringInProgress) {
+      return false;
+    }
+    stopWatering(zones_[zoneIndex]);
+    SF_LOGI("🔧 [%s] Pompa OFF (perintah)", zones_[zoneIndex].config->id);
+    return true;
+  }
+
+  // --- Fungsi Penyiraman Cerdas ---
+  // Setiap penyiraman adalah satu run di PumpService; pompa dimatikan timer
+  // saat durasinya habis, finishWatering() lalu mencatat dan memberi tahu.
+  void startWatering(Zone& zone, PumpSource source = PUMP_SOURCE_AUTO,
+                     unsigned long durationMs = 0) {
+    pumps_.start(zoneIndex(zone), durationMs ? durationMs : tuning_.wateringDuration, source);
+    zone.state.wateringInProgress = true;
+    zone.state.wateringStartTime = platform_.millis();
+    zone.state.currentPompaStatus = true;
+    zone.state.pumpSource = (uint8_t)source;
+  }
+
+  void stopWatering(Zone& zone) {
+    pumps_.stop(zoneIndex(zone));
+    zone.state.wateringInProgress = false;
+    zone.state.currentPompaStatus = false;
+  }
+
+  // Run yang berakhir sendiri (timer atau batas waktu).
+  void finishWatering(Zone& zone) {
+    ZoneState& zs = zone.state;
+    zs.wateringInProgress = false;
+    zs.currentPompaStatus = false;
+    zs.lastWateringTime = platform_.millis();
+
+    const PumpRun* run = pumps_.lastRun(zoneIndex(zone));
+    unsigned long actualMs = run ? run->actualMs : tuning_.wateringDuration;
+    char message[kMessageSize];
+    if (zs.pumpSource == PUMP_SOURCE_APP) {
+      zs.manualCutoff = true;
+      snprintf(message, sizeof(message), "Pompa auto-off setelah %.1f detik\nMode: MANUAL Safety",
+               actualMs / 1000.0f);
+      sendNotificationToFirebase("⏰ Safety Timer", message, "info", &zone);
+    } else {
+      snprintf(message, sizeof(message),
+               "Durasi %.1f detik selesai\nKelembaban tanah: %.1f%%\nTahap: %s",
+               actualMs / 1000.0f, zs.currentSoilPercent,
+               getPlantStage(zs.plantAgeDays, tuning_.crop));
+      sendNotificationToFirebase("✅ Penyiraman Selesai", message, "success", &zone);
+    }
+  }
+
+  // Keputusan siram otomatis (mode AUTO, juga saat offline).
+  void smartTomatoWatering(Zone& zone) {
+    ZoneState& zs = zone.state;
+    if (zs.wateringInProgress) return;
+    int threshold = soilThreshold(zone);
+    if (zs.currentSoilPercent < threshold && isWateringTime()) {
+      startWatering(zone);
+      char message[kMessageSize];
+      snprintf(message, sizeof(message), "Tanah kering: %.0f%%\nThreshold: %d%%\nTahap: %s",
+               zs.currentSoilPercent, threshold, getPlantStage(zs.plantAgeDays, tuning_.crop));
+      sendNotificationToFirebase("🚰 Penyiraman Dimulai", message, "info", &zone);
+    }
+  }
+
+  // --- Kontrol dari aplikasi ---
+  // Satu GET per zona untuk node control (mode + status pompa sekaligus).
+  void readControl() {
+    state.online = onlineOrSkip();
+    if (!state.online) return;
+    for (int i = 0; i < zoneCount_; i++) {
+      ZoneState& zs = zones_[i].state;
+      char path[96];
+      snprintf(path, sizeof(path), "%s/control.json", zones_[i].config->basePath);
+
+      size_t length = 0;
+      strcpy(zs.currentOperatingMode, "AUTO");
+      pompaCommand_[i] = false;
+      int httpCode;
+      {
+        StageTimer t(profiler_, STAGE_CONTROL_GET);
+        httpCode = rtdb_.get(path, body_, sizeof(body_), &length);
+      }
+      if (httpCode <= 0) continue;
+
+      JsonSpan control = jsonSpanOf(body_, length);
+      JsonSpan field;
+      if (jsonFindMember(control, "operating_mode", &field)) {
+        char mode[sizeof(zs.currentOperatingMode)];
+        jsonCopyString(field, mode, sizeof(mode));
+        if (mode[0] != '\0' && strcmp(mode, "null") != 0) strcpy(zs.currentOperatingMode, mode);
+      }
+      if (jsonFindMember(control, "pompa_status", &field)) {
+        pompaCommand_[i] = field.equals("\"ON\"");
+      }
+      if (jsonFindMember(control, "pompa_cmd", &field)) {
+        commands_.receive(i, field, getTimestampForFirebase(), platform_.millis());
+      }
+      // Aplikasi menaikkan config_version di node control zona pertama setiap
+      // kali /config/<device> diubah; dokumennya diambil di sampel berikutnya.
+      // Nilai yang bukan nomor versi sah diabaikan.
+      double number;
+      uint32_t version;
+      if (i == 0 && jsonFindMember(control, "config_version", &field) &&
+          jsonToDouble(field, &number) && configVersionFromDouble(number, &version) &&
+          version != configVersionSeen_) {
+        configVersionSeen_ = version;
+        configPending_ = true;
+      }
+    }
+  }
+
+  void checkPompaControl(Zone& zone) {
+    ZoneState& zs = zone.state;
+    // Offline: siram otomatis dengan run berdurasi tetap, bukan menyalakan/
+    // mematikan relay di setiap sampel.
+    if (!rtdb_.connected() || strcmp(zs.currentOperatingMode, "AUTO") == 0) {
+      smartTomatoWatering(zone);
+      acknowledgeCommand(zone, COMMAND_AUTO);
+      return;
+    }
+
+    // Ack ditulis tepat setelah relay berubah, sebelum notifikasi, supaya
+    // actuated_at tidak ikut menunggu PUT notifikasi.
+    bool pompaOn = pompaCommand_[zoneIndex(zone)];
+    if (!pompaOn) zs.manualCutoff = false;
+    if (pompaOn && !zs.currentPompaStatus && !zs.manualCutoff) {
+      startWatering(zone, PUMP_SOURCE_APP);
+      acknowledgeCommand(zone, COMMAND_APPLIED);
+      sendNotificationToFirebase("🔧 Pompa Manual", "Pompa diaktifkan via Firebase\nMode: MANUAL", "info", &zone);
+    } else if (!pompaOn && zs.currentPompaStatus && zs.pumpSource != PUMP_SOURCE_COMMAND) {
+      stopWatering(zone);
+      acknowledgeCommand(zone, COMMAND_APPLIED);
+      sendNotificationToFirebase("🔧 Pompa Manual", "Pompa dimatikan via Firebase\nMode: MANUAL", "info", &zone);
+    } else {
+      // Relay sudah sesuai, atau ditahan safety cutoff / run API perintah.
+      acknowledgeCommand(zone, pompaOn == zs.currentPompaStatus ? COMMAND_APPLIED : COMMAND_BLOCKED);
+    }
+  }
+
+  // PUT <zona>/control_ack untuk pompa_cmd yang baru diterima, satu kali per
+  // id (lihat pump_command.h).
+  void acknowledgeCommand(Zone& zone, CommandResult result) {
+    int index = zoneIndex(zone);
+    if (!commands_.pending(index)) return;
+    JsonWriter ack(json_, sizeof(json_));
+    commands_.complete(index, result, zone.state.currentPompaStatus,
+                       getTimestampForFirebase(), platform_.millis(), ack);
+    char path[96];
+    snprintf(path, sizeof(path), "%s/control_ack.json", zone.config->basePath);
+    int httpCode = rtdb_.put(path, ack.c_str(), ack.length());
+    SF_LOGI("🎛️ [%s] Perintah pompa %s, ack: %d", zone.config->id, commandResultName(result),
+            httpCode);
+  }
+
+  // --- Kirim data semua zona dalam satu request ---
+  // Multi-location PATCH ke root: history_data/<key> dan current_data tiap
+  // zona yang datanya berubah. Data lama tidak perlu disalin lagi ke history
+  // karena setiap sampel sudah tersimpan di history saat dikirim.
+  void sendToFirebase(long long timestamp) {
+    if (!onlineOrSkip()) return;
+
+    const char* currentDateTime = clock_.dateTime();
+    const char* date = clock_.date();
+    const char* time = clock_.time();
+
+    StageTimer build(profiler_, STAGE_JSON_BUILD);
+    JsonWriter batch(batch_, sizeof(batch_));
+    batch.beginObject();
+    int changedZones = 0;
+
+    for (int i = 0; i < zoneCount_; i++) {
+      Zone& zone = zones_[i];
+      ZoneState& zs = zone.state;
+
+      // Cek apakah data berubah
+      uint64_t currentHash = createDataHash(state.currentTemperature, state.currentHumidity,
+                                            zs.currentSoilPercent, zs.currentBrightnessPercent,
+                                            zs.currentPompaStatus);
+      if (zs.hasDataHash && currentHash == zs.lastDataHash) continue;
+      zs.lastDataHash = currentHash;
+      zs.hasDataHash = true;
+
+      JsonWriter json(json_, sizeof(json_));
+      json.beginObject()
+          .key("suhu").value(state.currentTemperature, 1)
+          .key("kelembaban_udara").value(state.currentHumidity, 1)
+          .key("kelembaban_tanah").value(zs.currentSoilPercent, 1)
+          .key("kecerahan").value(zs.currentBrightnessPercent, 1)
+          .key("kategori_tanah").value(zs.currentSoilCategory)
+          .key("status_kelembaban").value(state.currentAirHumStatus)
+          .key("kategori_cahaya").value(zs.currentBrightnessCategory)
+          .key("status_suhu").value(zs.currentTempStatus)
+          .key("waktu").value(zs.currentTime)
+          .key("status_pompa").value(zs.currentPompaStatus ? "ON" : "OFF")
+          .key("mode_operasi").value(zs.currentOperatingMode)
+          .key("umur_tanaman").value(zs.plantAgeDays)
+          .key("tahapan_tanaman").value(getPlantStage(zs.plantAgeDays, tuning_.crop))
+          .key("zona").value(zone.config->id)
+          .key("tanggal").value(date)
+          .key("jam").value(time)
+          .key("datetime").value(currentDateTime)
+          .key("timestamp").value(timestamp)
+          .endObject();
+
+      // Path relatif terhadap root, tanpa "/" di depan.
+      const char* base = zone.config->basePath;
+      if (base[0] == '/') base++;
+      const char* sep = base[0] ? "/" : "";
+      char path[96];
+      snprintf(path, sizeof(path), "%s%shistory_data/data_%lld_%ld", base, sep, timestamp,
+               platform_.random(1000, 9999));
+      batch.key(path).rawValue(json.c_str());
+      snprintf(path, sizeof(path), "%s%scurrent_data", base, sep);
+      batch.key(path).rawValue(json.c_str());
+      changedZones++;
+    }
+    batch.endObject();
+    build.stop();
+
+    if (changedZones == 0) {
+      SF_LOGD("ℹ️ Data tidak berubah, skip update");
+      return;
+    }
+    if (!batch.ok()) {
+      SF_LOGE("❌ Batch data terlalu besar, dilewati");
+      return;
+    }
+
+    int httpCode;
+    {
+      StageTimer t(profiler_, STAGE_DATA_PATCH);
+      httpCode = rtdb_.patch("/.json", batch.c_str(), batch.length());
+    }
+    if (httpCode > 0) {
+      SF_LOGD("✅ Data %d zona dikirim (history_data + current_data): %d", changedZones, httpCode);
+    } else {
+      SF_LOGE("❌ Gagal mengirim data zona: %d", httpCode);
+    }
+
+    SF_LOGD("📊 Data dikirim - %s", currentDateTime);
+    SF_LOGD("🆔 Timestamp: %lld", timestamp);
+  }
+
+  // --- Diagnostik ---
+  // PATCH /diagnostics/<deviceId>: histogram latensi sejak upload terakhir,
+  // telemetri heap, statistik jaringan per endpoint dan handshake TLS.
+  // Histogram direset setelah upload berhasil sehingga tiap upload adalah
+  // satu jendela waktu; titik tren heap diambil setiap jendela, terkirim
+  // atau tidak.
+  void uploadDiagnostics() {
+    memory_.pushTrend(platform_.millis());
+    if (!onlineOrSkip()) {
+      memory_.resetWindow();
+      return;
+    }
+
+    JsonWriter json(batch_, sizeof(batch_));
+    json.beginObject();
+    json.key("latency");
+    profiler_.writeJson(json);
+    json.key("memory");
+    memory_.writeJson(json);
+    memory_.resetWindow();
+    json.key("network");
+    net_.stats().writeJson(json);
+    json.key("resilience");
+    rtdb_.writeJson(json);
+    if (rtdb_.tlsStats()) {
+      json.key("tls");
+      writeTlsJson(*rtdb_.tlsStats(), json);
+    }
+    json.key("pump");
+    pumps_.writeJson(json);
+    json.key("commands");
+    commands_.writeJson(json);
+    if (dht_) {
+      json.key("dht");
+      dht_->writeJson(json);
+    }
+    json.key("config_version").value((long long)tuning_.version)
+        .key("uptime_ms").value((long long)platform_.millis())
+        .key("log_dropped").value((long long)platform_.droppedLogLines())
+        .key("timestamp").value(getTimestampForFirebase())
+        .endObject();
+    if (!json.ok()) {
+      SF_LOGE("❌ Diagnostik terlalu besar, dilewati");
+      return;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/diagnostics/%s.json", config_.deviceId);
+    int httpCode = rtdb_.patch(path, json.c_str(), json.length());
+    if (httpCode > 0) {
+      SF_LOGI("🩺 Diagnostik dikirim: %d", httpCode);
+      profiler_.reset();
+      commands_.resetWindow();
+    } else {
+      SF_LOGE("❌ Gagal mengirim diagnostik: %d", httpCode);
+    }
+  }
+
+  // --- Konfigurasi jarak jauh ---
+  // GET /config/<deviceId> saat boot dan setiap config_version berubah.
+  // Dokumen yang valid langsung berlaku seluruhnya dan disimpan ke NVS.
+  void refreshRemoteConfig() {
+    if (!onlineOrSkip()) return;
+    char path[64];
+    snprintf(path, sizeof(path), "/config/%s.json", config_.deviceId);
+    size_t length = 0;
+    int httpCode = rtdb_.get(path, body_, sizeof(body_), &length);
+    if (httpCode <= 0) return;  // coba lagi di sampel berikutnya
+    configPending_ = false;
+    if (httpCode != 200 || strcmp(body_, "null") == 0) return;
+
+    RemoteConfig next;
+    const char* error = "";
+    if (!parseRemoteConfig(jsonSpanOf(body_, length),
+                           remoteConfigDefaults(config_.interval, config_.notificationInterval,
+                                                config_.wateringDuration),
+                           &next, &error)) {
+      SF_LOGE("❌ /config ditolak: %s", error);
+      return;
+    }
+    configVersionSeen_ = next.version;
+    if (next.version == tuning_.version) return;
+
+    tuning_ = next;
+    StoredRemoteConfig stored;
+    memset(&stored, 0, sizeof(stored));
+    stored.magic = kRemoteConfigMagic;
+    stored.config = next;
+    bool saved = platform_.saveBlob(kRemoteConfigKey, &stored, sizeof(stored));
+    SF_LOGI("⚙️ Konfigurasi v%lu berlaku%s", (unsigned long)next.version,
+            saved ? " dan disimpan" : " (tidak tersimpan di NVS)");
+  }
+
+  DeviceState state;
+
+ private:
+  void loadCachedConfig() {
+    StoredRemoteConfig stored;
+    const char* error = "";
+    if (!platform_.loadBlob(kRemoteConfigKey, &stored, sizeof(stored)) ||
+        stored.magic != kRemoteConfigMagic) {
+      return;
+    }
+    if (!validateRemoteConfig(stored.config, &error)) {
+      SF_LOGW("⚠️ Cache konfigurasi NVS tidak valid: %s", error);
+      return;
+    }
+    tuning_ = stored.config;
+    configVersionSeen_ = tuning_.version;
+    SF_LOGI("⚙️ Konfigurasi v%lu dimuat dari NVS", (unsigned long)tuning_.version);
+  }
+
+  // Aturan yang terpicu di dalam jeda (cooldown) atau saat token habis
+  // dilipat ke digest; digest dikirim sebagai satu notifikasi setelah jeda.
+  void evaluateAlert(int ruleIndex, AlertRuleState& st, const AlertInputs& in, unsigned long now,
+                     const Zone* zone) {
+    const AlertRule& rule = kAlertRules[ruleIndex];
+    if (alertEvaluate(rule, tuning_.alertThreshold[ruleIndex], st, in, now)) {
+      // Digest yang masih tertunda menampung kejadian ini juga, agar urutan
+      // tetap: ringkasan dulu, baru notifikasi biasa di jeda berikutnya.
+      if (alertInCooldown(rule, st, now) || st.digestCount > 0 ||
+          !tokenBucketAvailable(state.notifyBucket, now)) {
+        if (config_.notificationDigest) {
+          alertFold(st, alertDisplayValue(rule.channel, in), now);
+          state.notificationsFolded++;
+        } else {
+          alertDrop(st);
+          state.notificationsDropped++;
+        }
+      } else {
+        char message[kMessageSize];
+        rule.format(message, sizeof(message), in);
+        if (sendNotificationToFirebase(rule.title, message, alertSeverityName(rule.severity), zone)) {
+          alertMarkSent(st, now);
+          logNotification(rule.title, message, zone);
+        }
+      }
+    }
+
+    if (alertDigestDue(rule, st, now) && tokenBucketAvailable(state.notifyBucket, now)) {
+      char title[96];
+      char message[kMessageSize];
+      snprintf(title, sizeof(title), "%s (%u×)", rule.title, (unsigned)st.digestCount);
+      formatAlertDigest(message, sizeof(message), rule, st, now);
+      if (sendNotificationToFirebase(title, message, alertSeverityName(rule.severity), zone)) {
+        alertDigestSent(st, now);
+        logNotification(title, message, zone);
+      }
+    }
+  }
+
+  void logNotification(const char* title, const char* message, const Zone* zone) {
+    if (zone) {
+      SF_LOGI("📢 NOTIFIKASI [%s]: %s - %s", zone->config->id, title, message);
+    } else {
+      SF_LOGI("📢 NOTIFIKASI: %s - %s", title, message);
+    }
+  }
+
+  void logSample() {
+    SF_LOGD("%s", "");
+    SF_LOGD("=== DATA BUDIDAYA TOMAT ===");
+    SF_LOGD("Waktu: %s", clock_.dateTime());
+    SF_LOGD("Suhu: %.1f°C", state.currentTemperature);
+    SF_LOGD("Kelembaban Udara: %.1f%% - %s", state.currentHumidity, state.currentAirHumStatus);
+    for (int i = 0; i < zoneCount_; i++) {
+      const ZoneState& zs = zones_[i].state;
+      SF_LOGD("--- Zona %s ---", zones_[i].config->id);
+      SF_LOGD("Tahapan: %s (Hari ke-%d)", getPlantStage(zs.plantAgeDays, tuning_.crop),
+              zs.plantAgeDays);
+      SF_LOGD("Status Suhu: %s", zs.currentTempStatus);
+      SF_LOGD("Kelembaban Tanah: %.1f%% - %s", zs.currentSoilPercent, zs.currentSoilCategory);
+      SF_LOGD("Kecerahan Cahaya: %.1f%% - %s", zs.currentBrightnessPercent,
+              getBrightnessStatus(zs.currentBrightnessPercent));
+    }
+    SF_LOGD("================================");
+  }
+
+#if defined(__GNUC__)
+  __attribute__((format(printf, 2, 3)))
+#endif
+  void logf(const char* format, ...) {
+    if (!platform_.logEnabled()) return;
+    char line[320];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    platform_.log(line);
+  }
+
+  // Pemeriksaan sebelum request yang dilewati saat offline; yang dilewati
+  // dihitung di NetStats.offlineSkips.
+  bool onlineOrSkip() {
+    if (rtdb_.connected()) return true;
+    net_.countOfflineSkip();
+    return false;
+  }
+
+  DevicePlatform& platform_;
+  DeviceClock clock_;
+  // Semua REST lewat rtdb_: circuit breaker + buffer tulis, lalu net_ yang
+  // mencatat request yang benar-benar keluar.
+  MeteredRtdbTransport net_;
+  ResilientRtdbTransport rtdb_;
+  PumpService pumps_;
+  PumpCommandTracker commands_;
+  const Dht22Sensor* dht_;
+  DeviceConfig config_;
+  LoopProfiler profiler_;
+  MemoryTelemetry memory_;
+  SampleRing recent_;  // untuk klien LAN (local_api.h)
+  RemoteConfig tuning_;
+  uint32_t configVersionSeen_;  // config_version terakhir dari node control
+  bool configPending_;          // /config perlu diambil
+  SampleListener* sampleListener_;
+
+  Zone zones_[TOMATO_MAX_ZONES];
+  int zoneCount_;
+  bool pompaCommand_[TOMATO_MAX_ZONES];
+
+  char body_[kBodySize];
+  char json_[kJsonSize];
+  char batch_[kBatchSize];
+};
+
+#endif  // SMARTFARM_TOMATO_DEVICE_H_
@@ -0,0 +1,274 @@
+#ifndef SMARTFARM_TOMATO_LOGIC_H_
+#define SMARTFARM_TOMATO_LOGIC_H_
+
+// Logika murni budidaya tomat: klasifikasi sensor, threshold per tahap,
+// hash data dan penyusun JSON. Tidak bergantung pada Arduino sehingga bisa
+// dikompilasi di ESP32 maupun di host (linux/tools).
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// --- Profil Budidaya ---
+// Batas tahap, threshold tanah per tahap dan jendela jam penyiraman. Nilai
+// bawaan di bawah; bisa diganti lewat /config/<device> (remote_config.h).
+struct CropProfile {
+  int stageLastDay[3];     // hari terakhir BIBIT, VEGETATIF, BERBUNGA
+  int soilThreshold[4];    // % per tahap
+  uint32_t wateringHours;  // bit n = jam n termasuk jendela siram
+};
+
+// 06:00-10:59 dan 16:00-18:59.
+const uint32_t kDefaultWateringHours = 0x7C0UL | 0x70000UL;
+
+inline const CropProfile& defaultCropProfile() {
+  static const CropProfile kProfile = {
+    {14, 35, 50},
+    {
+      30,  // Bibit
+      40,  // Vegetatif
+      50,  // Berbunga
+      60,  // Pembuahan
+    },
+    kDefaultWateringHours,
+  };
+  return kProfile;
+}
+
+// --- Fungsi Umur Tanaman ---
+// 0 = BIBIT, 1 = VEGETATIF, 2 = BERBUNGA, 3 = PEMBUAHAN
+inline int getPlantStageIndex(int plantAgeDays, const CropProfile& crop = defaultCropProfile()) {
+  if (plantAgeDays <= crop.stageLastDay[0]) return 0;
+  else if (plantAgeDays <= crop.stageLastDay[1]) return 1;
+  else if (plantAgeDays <= crop.stageLastDay[2]) return 2;
+  else return 3;
+}
+
+inline const char* plantStageName(int stageIndex) {
+  static const char* const kStages[] = {"BIBIT", "VEGETATIF", "BERBUNGA", "PEMBUAHAN"};
+  return kStages[stageIndex];
+}
+
+inline const char* getPlantStage(int plantAgeDays, const CropProfile& crop = defaultCropProfile()) {
+  return plantStageName(getPlantStageIndex(plantAgeDays, crop));
+}
+
+inline int getSoilThreshold(int plantAgeDays, const CropProfile& crop = defaultCropProfile()) {
+  return crop.soilThreshold[getPlantStageIndex(plantAgeDays, crop)];
+}
+
+// Hari pertama tahap baru (VEGETATIF, BERBUNGA, PEMBUAHAN).
+inline bool isStageStartDay(int plantAgeDays, const CropProfile& crop = defaultCropProfile()) {
+  for (int i = 0; i < 3; i++) {
+    if (plantAgeDays == crop.stageLastDay[i] + 1) return true;
+  }
+  return false;
+}
+
+// --- Kategori Sensor ---
+// Status untuk bacaan NaN (DHT22 gagal/basi) agar tidak tampil sebagai
+// "RH Rendah" atau "Suhu Malam Tidak Ideal".
+const char kSensorErrorStatus[] = "Sensor Error";
+
+inline const char* getSoilCategory(float soilPercent) {
+  if (!isfinite(soilPercent)) return kSensorErrorStatus;
+  if (soilPercent < 30.0) return "SANGAT KERING";
+  else if (soilPercent < 50.0) return "KERING";
+  else if (soilPercent <= 70.0) return "LEMBAB";
+  else return "BASAH";
+}
+
+inline const char* getBrightnessCategory(float brightnessPercent) {
+  if (brightnessPercent < 20.0) return "GELAP";
+  else if (brightnessPercent < 50.0) return "REMANG";
+  else if (brightnessPercent < 80.0) return "TERANG";
+  else return "SANGAT TERANG";
+}
+
+inline const char* getBrightnessStatus(float brightnessPercent) {
+  if (brightnessPercent < 20.0) return "CAHAYA RENDAH";
+  else if (brightnessPercent < 50.0) return "CAHAYA SEDANG";
+  else if (brightnessPercent < 80.0) return "CAHAYA BAIK";
+  else return "CAHAYA TINGGI";
+}
+
+inline const char* getAirHumStatus(float humidity) {
+  if (!isfinite(humidity)) return kSensorErrorStatus;
+  if (humidity < 50.0) return "RH Rendah";
+  else if (humidity <= 70.0) return "RH Ideal";
+  else if (humidity < 80.0) return "RH Tinggi";
+  else return "Risiko Jamur";
+}
+
+inline const char* getTempStatus(float temperature, bool isDay) {
+  if (!isfinite(temperature)) return kSensorErrorStatus;
+  if (temperature > 32.0) return "Suhu > max toleransi (panas)";
+  if (temperature < 10.0) return "Suhu < min toleransi (dingin)";
+  if (isDay) {
+    return (temperature >= 20.0 && temperature <= 28.0) ? "Suhu Siang Ideal" : "Suhu Siang Tidak Ideal";
+  }
+  return (temperature >= 18.0 && temperature <= 22.0) ? "Suhu Malam Ideal" : "Suhu Malam Tidak Ideal";
+}
+
+// --- Fungsi Waktu Penyiraman ---
+inline bool isWateringHour(int hour, uint32_t wateringHours = kDefaultWateringHours) {
+  return hour >= 0 && hour < 24 && (wateringHours >> hour) & 1;
+}
+
+// --- Konversi ADC ---
+// Sama dengan constrain(map(raw, 0, 4095, 100, 0), 0, 100) di sketch lama.
+inline float soilRawToPercent(int raw) {
+  long value = (long)(raw - 0) * (0 - 100) / (4095 - 0) + 100;
+  if (value < 0) value = 0;
+  if (value > 100) value = 100;
+  return (float)value;
+}
+
+inline float ldrRawToPercent(int raw) {
+  float value = (raw / 4095.0f) * 100.0f;
+  if (value < 0) value = 0;
+  if (value > 100) value = 100;
+  return value;
+}
+
+// --- Persepuluhan ---
+// Satu konversi float -> int16 persepuluhan untuk hash data, ring sampel
+// (sample_ring.h) dan frame UDP (telemetry_frame.h). NaN/inf ("tidak ada
+// bacaan") menjadi kNoReadingTenths, bukan hasil cast yang tidak terdefinisi;
+// nilai lain dijepit ke +-3276.7 sehingga tidak pernah sama dengan sentinel.
+const int16_t kNoReadingTenths = INT16_MIN;
+
+inline int16_t sensorTenths(float value) {
+  if (!isfinite(value)) return kNoReadingTenths;
+  float tenths = value * 10.0f + (value >= 0 ? 0.5f : -0.5f);
+  if (tenths > 32767.0f) return 32767;
+  if (tenths < -32767.0f) return -32767;
+  return (int16_t)tenths;
+}
+
+// Kebalikan sensorTenths(); NaN untuk kNoReadingTenths.
+inline float tenthsToFloat(int16_t tenths) {
+  return tenths == kNoReadingTenths ? NAN : tenths / 10.0f;
+}
+
+// --- Hash Data ---
+// Dulu berupa String "25.1_60.2_..."; sekarang nilai persepuluhan dipak ke
+// 64 bit sehingga perbandingannya tetap eksak tanpa alokasi heap. Tiap nilai
+// mendapat 15 bit: bit 14 saja (0x4000) berarti tidak ada bacaan, nilai
+// lain dijepit ke +-1638.3 sehingga tidak bertabrakan dengannya.
+inline uint64_t packTenths(float value) {
+  int tenths = sensorTenths(value);
+  if (tenths == kNoReadingTenths) return 0x4000;
+  if (tenths > 16383) tenths = 16383;
+  if (tenths < -16383) tenths = -16383;
+  return (uint64_t)(tenths & 0x7FFF);
+}
+
+inline uint64_t createDataHash(float temp, float hum, float soil, float bright, bool pumpOn) {
+  return (packTenths(temp) << 46) | (packTenths(hum) << 31) |
+         (packTenths(soil) << 16) | (packTenths(bright) << 1) |
+         (pumpOn ? 1u : 0u);
+}
+
+// --- Penyusun JSON ---
+// Menulis langsung ke buffer milik pemanggil. Jika buffer penuh, ok() bernilai
+// false dan isi buffer tidak boleh dikirim.
+class JsonWriter {
+ public:
+  JsonWriter(char* buffer, size_t capacity)
+      : buffer_(buffer), capacity_(capacity), length_(0), first_(true), ok_(capacity > 0) {
+    if (capacity_ > 0) buffer_[0] = '\0';
+  }
+
+  JsonWriter& beginObject() { comma(); raw("{"); first_ = true; return *this; }
+  JsonWriter& endObject() { raw("}"); first_ = false; return *this; }
+  JsonWriter& beginArray() { comma(); raw("["); first_ = true; return *this; }
+  JsonWriter& endArray() { raw("]"); first_ = false; return *this; }
+
+  JsonWriter& key(const char* name) {
+    comma();
+    string(name);
+    raw(":");
+    first_ = true;  // nilai setelah key tidak diawali koma
+    return *this;
+  }
+
+  JsonWriter& value(const char* text) { comma(); string(text); return *this; }
+  JsonWriter& value(bool flag) { comma(); raw(flag ? "true" : "false"); return *this; }
+  JsonWriter& value(int number) { comma(); appendf("%d", number); return *this; }
+  JsonWriter& value(long long number) { comma(); appendf("%lld", number); return *this; }
+  // NaN/inf (misal DHT22 belum terbaca) tidak punya bentuk JSON: ditulis null.
+  JsonWriter& value(float number, int decimals) {
+    comma();
+    if (isfinite(number)) {
+      appendf("%.*f", decimals, (double)number);
+    } else {
+      raw("null");
+    }
+    return *this;
+  }
+
+  // Menyisipkan JSON yang sudah jadi (misal objek hasil builder lain).
+  JsonWriter& rawValue(const char* json) { comma(); raw(json); return *this; }
+
+  bool ok() const { return ok_; }
+  size_t length() const { return length_; }
+  const char* c_str() const { return buffer_; }
+
+ private:
+  void comma() {
+    if (!first_) raw(",");
+    first_ = false;
+  }
+
+  void raw(const char* text) {
+    size_t n = strlen(text);
+    if (!ok_ || length_ + n >= capacity_) { ok_ = false; return; }
+    memcpy(buffer_ + length_, text, n + 1);
+    length_ += n;
+  }
+
+  void put(char c) {
+    if (!ok_ || length_ + 1 >= capacity_) { ok_ = false; return; }
+    buffer_[length_++] = c;
+    buffer_[length_] = '\0';
+  }
+
+  void string(const char* text) {
+    put('"');
+    for (const char* p = text; *p; ++p) {
+      char c = *p;
+      if (c == '"' || c == '\\') { put('\\'); put(c); }
+      else if (c == '\n') { put('\\'); put('n'); }
+      else if ((unsigned char)c < 0x20) { appendf("\\u%04x", (unsigned)c); }
+      else put(c);
+    }
+    put('"');
+  }
+
+  template <typename T>
+  void appendf(const char* format, int decimals, T number) {
+    if (!ok_) return;
+    int n = snprintf(buffer_ + length_, capacity_ - length_, format, decimals, number);
+    if (n < 0 || length_ + n >= capacity_) { ok_ = false; return; }
+    length_ += n;
+  }
+
+  template <typename T>
+  void appendf(const char* format, T number) {
+    if (!ok_) return;
+    int n = snprintf(buffer_ + length_, capacity_ - length_, format, number);
+    if (n < 0 || length_ + n >= capacity_) { ok_ = false; return; }
+    length_ += n;
+  }
+
+  char* buffer_;
+  size_t capacity_;
+  size_t length_;
+  bool first_;
+  bool ok_;
+};
+
+#endif  // SMARTFARM_TOMATO_LOGIC_H_
@@ -0,0 +1,82 @@
+#ifndef SMARTFARM_UDP_TELEMETRY_H_
+#define SMARTFARM_UDP_TELEMETRY_H_
+
+// Pengirim frame telemetri UDP (format di telemetry_frame.h). Dipasang
+// sebagai SampleListener sehingga frame keluar begitu nilai sensor dihitung,
+// sebelum request Firebase apa pun; PC di LAN menerimanya dalam hitungan
+// milidetik walaupun uplink lambat atau putus.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "telemetry_frame.h"
+#include "tomato_device.h"
+
+class DatagramSink {
+ public:
+  virtual ~DatagramSink() {}
+  // Mengirim satu datagram tanpa menunggu balasan; false jika gagal.
+  virtual bool send(const uint8_t* data, size_t length) = 0;
+};
+
+struct UdpTelemetryStats {
+  uint32_t sent;
+  uint32_t failed;
+};
+
+class UdpTelemetry : public SampleListener {
+ public:
+  UdpTelemetry(DatagramSink& sink, DevicePlatform& platform)
+      : sink_(sink), platform_(platform), seq_(0), bootId_(0) {
+    memset(&stats_, 0, sizeof(stats_));
+  }
+
+  // Dipanggil sekali di setup(), setelah WiFi terhubung.
+  void begin(TomatoDevice& device) {
+    bootId_ = (uint16_t)platform_.random(1, 65536);
+    device.setSampleListener(this);
+  }
+
+  const UdpTelemetryStats& stats() const { return stats_; }
+
+  void onSample(TomatoDevice& device, long long timestamp) override {
+    TelemetryFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.seq = seq_++;
+    frame.timestamp = timestamp;
+    strncpy(frame.deviceId, device.config().deviceId, kTelemetryIdSize);
+    frame.bootId = bootId_;
+    frame.temperature = sensorTenths(device.state.currentTemperature);
+    frame.humidity = sensorTenths(device.state.currentHumidity);
+    frame.online = device.state.online;
+    frame.zoneCount = device.zoneCount();
+    for (int i = 0; i < frame.zoneCount; i++) {
+      const ZoneState& zs = device.zone(i).state;
+      TelemetryZone& zone = frame.zones[i];
+      zone.soil = sensorTenths(zs.currentSoilPercent);
+      zone.brightness = sensorTenths(zs.currentBrightnessPercent);
+      zone.pumpOn = device.pumps().running(i);
+      zone.manual = strcmp(zs.currentOperatingMode, "MANUAL") == 0;
+      unsigned long remaining = (device.pumps().remainingMs(i) + 999) / 1000;
+      zone.pumpRemainingS = (uint16_t)(remaining < 65535 ? remaining : 65535);
+    }
+
+    uint8_t buffer[kTelemetryMaxFrame];
+    size_t length = encodeTelemetryFrame(frame, buffer, sizeof(buffer));
+    if (length > 0 && sink_.send(buffer, length)) {
+      stats_.sent++;
+    } else {
+      stats_.failed++;
+    }
+  }
+
+ private:
+  DatagramSink& sink_;
+  DevicePlatform& platform_;
+  uint32_t seq_;
+  uint16_t bootId_;
+  UdpTelemetryStats stats_;
+};
+
+#endif  // SMARTFARM_UDP_TELEMETRY_H_
@@ -1,9 +1,11 @@
 import 'dart:async'; 
+import 'dart:typed_data';
 import 'package:flutter/material.dart';
 import 'package:firebase_database/firebase_database.dart';
 import 'package:intl/intl.dart';
 import 'package:provider/provider.dart';
 import 'package:smartfarmtomato/providers/theme_provider.dart';
+import 'package:smartfarmtomato/services/fleet_stats.dart';
 import 'admin_notifications.dart';
 
 class AdminDashboardScreen extends StatefulWidget {
@@ -479,17 +481,20 @@ class _AdminDashboardScreenState extends State<AdminDashboardScreen> {
       }
     });
 
-    // Sort by timestamp descending (terbaru di atas)
-    firebaseAlerts.sort((a, b) => (b['timestamp'] as int).compareTo(a['timestamp'] as int));
+    // 10 alert terbaru (terbaru di atas) tanpa mengurutkan seluruh alert seminggu
+    final timestamps = Int64List.fromList([
+      for (final alert in firebaseAlerts) alert['timestamp'] as int,
+    ]);
+    final newest = FleetStats.topRecent(timestamps, 10);
 
     setState(() {
       // Hapus Firebase alerts yang lama
       _criticalAlertsList.removeWhere((alert) => alert['source'] == 'firebase_alerts');
       
       // Tambahkan Firebase alerts baru
-      _criticalAlertsList.addAll(firebaseAlerts.take(10));
+      _criticalAlertsList.addAll(newest.map((i) => firebaseAlerts[i]));
       
-      // Sort ulang seluruh alerts (Firebase + realtime)
+      // Sort ulang seluruh alerts (Firebase + realtime, paling banyak 30)
       _criticalAlertsList.sort((a, b) => (b['timestamp'] as int).compareTo(a['timestamp'] as int));
       
       // Update total critical alerts
@@ -571,17 +576,14 @@ class _AdminDashboardScreenState extends State<AdminDashboardScreen> {
       
       final data = event.snapshot.value as Map<dynamic, dynamic>?;
       if (data != null) {
-        double totalYield = 0;
-        int harvestCount = 0;
-        
-        data.forEach((key, value) {
-          totalYield += (value['yield'] ?? 0).toDouble();
-          harvestCount++;
-        });
+        final yields = Float32List.fromList([
+          for (final value in data.values) (value['yield'] ?? 0).toDouble(),
+        ]);
+        final summary = FleetStats.summarize(yields);
         
         setState(() {
-          _totalHarvests = harvestCount;
-          _averageYield = harvestCount > 0 ? totalYield / harvestCount : 0.0;
+          _totalHarvests = yields.length;
+          _averageYield = summary.mean;
         });
       }
     });
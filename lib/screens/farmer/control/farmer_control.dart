@@ -1,4 +1,5 @@
 // ignore_for_file: undefined_class
+import 'dart:async';
 import 'package:flutter/material.dart';
 import 'package:firebase_database/firebase_database.dart';
 import 'package:provider/provider.dart';
@@ -20,6 +21,15 @@ class _ControlScreenState extends State<ControlScreen> {
   bool isPumpActive = false;
   bool isLampActive = false;
 
+  // Perintah pompa yang menunggu control_ack dari perangkat
+  String? _pendingCommandId;
+  DateTime? _pendingCommandSentAt;
+  Timer? _ackTimeout;
+  StreamSubscription? _ackStream;
+
+  // Batas tunggu ack; perangkat membaca control sekali per sampel (5 detik)
+  static const Duration _ackTimeoutDuration = Duration(seconds: 30);
+
   // System status
   Map<String, String> systemStatus = {
     'iot': 'aktif',
@@ -47,6 +57,32 @@ class _ControlScreenState extends State<ControlScreen> {
         });
       }
     });
+
+    // Konfirmasi perangkat untuk perintah pompa (firmware/pump_command.h)
+    _ackStream = _databaseRef.child('control_ack').onValue.listen((event) {
+      final ack = event.snapshot.value as Map<dynamic, dynamic>?;
+      if (ack == null || _pendingCommandId == null || ack['id'] != _pendingCommandId || !mounted) {
+        return;
+      }
+      final elapsed = DateTime.now().difference(_pendingCommandSentAt!);
+      final seconds = (elapsed.inMilliseconds / 1000).toStringAsFixed(1);
+      _ackTimeout?.cancel();
+      _pendingCommandId = null;
+
+      switch (ack['result']) {
+        case 'applied':
+          _showSnackbar(
+            'Perangkat mengonfirmasi pompa ${ack['on'] == true ? 'ON' : 'OFF'} ($seconds dtk)',
+            Colors.green,
+          );
+          break;
+        case 'auto':
+          _showSnackbar('Perintah diabaikan: perangkat masih mode otomatis', Colors.orange);
+          break;
+        default:
+          _showSnackbar('Perintah ditahan perangkat (safety timer)', Colors.orange);
+      }
+    });
   }
 
   @override
@@ -500,6 +536,9 @@ class _ControlScreenState extends State<ControlScreen> {
     _databaseRef.child('control/autoMode').set(newAutoMode);
     _databaseRef.child('control/pump').set(newPumpActive);
     _databaseRef.child('control/light').set(newLampActive);
+    // Field yang dibaca firmware (readControl)
+    _databaseRef.child('control/operating_mode').set(newAutoMode ? 'AUTO' : 'MANUAL');
+    _databaseRef.child('control/pompa_status').set(newPumpActive ? 'ON' : 'OFF');
 
     // UPDATE PENTING: Sync ke current_data agar history bisa membaca status terkini
     final timestamp = DateTime.now().millisecondsSinceEpoch;
@@ -535,9 +574,21 @@ class _ControlScreenState extends State<ControlScreen> {
       systemStatus['actuator'] = 'manual';
     });
 
-    // Update to Firebase control
-    _databaseRef.child('control/pump').set(newPumpActive);
-    _databaseRef.child('control/autoMode').set(false); // Set autoMode ke false
+    // Update to Firebase control: satu update supaya perangkat tidak membaca
+    // pompa_status baru dengan pompa_cmd lama. issued_at memakai jam server.
+    final commandId = _databaseRef.child('control').push().key;
+    _databaseRef.child('control').update({
+      'pump': newPumpActive,
+      'autoMode': false, // Set autoMode ke false
+      'operating_mode': 'MANUAL',
+      'pompa_status': newPumpActive ? 'ON' : 'OFF',
+      'pompa_cmd': {
+        'id': commandId,
+        'on': newPumpActive,
+        'issued_at': ServerValue.timestamp,
+      },
+    });
+    _awaitCommandAck(commandId);
 
     // UPDATE PENTING: Sync ke current_data agar history bisa membaca status terkini
     final timestamp = DateTime.now().millisecondsSinceEpoch;
@@ -586,6 +637,18 @@ class _ControlScreenState extends State<ControlScreen> {
     );
   }
 
+  // Tunggu control_ack dengan id ini; beri tahu petani bila tidak datang.
+  void _awaitCommandAck(String? commandId) {
+    _pendingCommandId = commandId;
+    _pendingCommandSentAt = DateTime.now();
+    _ackTimeout?.cancel();
+    _ackTimeout = Timer(_ackTimeoutDuration, () {
+      if (_pendingCommandId != commandId) return;
+      _pendingCommandId = null;
+      _showSnackbar('Perangkat belum mengonfirmasi perintah pompa', Colors.red);
+    });
+  }
+
   void _logAction(String action) {
     final timestamp = DateTime.now().millisecondsSinceEpoch;
     _databaseRef.child('logs').push().set({
@@ -609,6 +672,8 @@ class _ControlScreenState extends State<ControlScreen> {
 
   @override
   void dispose() {
+    _ackStream?.cancel();
+    _ackTimeout?.cancel();
     super.dispose();
   }
 }
\ No newline at end of file
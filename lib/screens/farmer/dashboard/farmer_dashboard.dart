@@ -9,6 +9,7 @@ import '../control/farmer_control.dart';
 import '../history/farmer_history.dart';
 import '../settings/farmer_settings.dart';
 import '../../../providers/theme_provider.dart';
+import '../../../services/history_cache.dart';
 
 class FarmerDashboardScreen extends StatefulWidget {
   const FarmerDashboardScreen({super.key});
@@ -23,6 +24,8 @@ class _FarmerDashboardScreenState extends State<FarmerDashboardScreen> {
   bool _isLoading = true;
   bool _isLoadingLand = true;
   bool _isLoadingHistory = true;
+  // Desktop Linux: chart memuat 24 jam dari cache lokal lalu diringkas (LTTB).
+  bool _historyFromCache = false;
   int _unreadNotifications = 0;
   bool _notificationsEnabled = true;
 
@@ -156,6 +159,32 @@ class _FarmerDashboardScreenState extends State<FarmerDashboardScreen> {
   // Method untuk memuat data history untuk chart
   Future<void> _loadHistoryData() async {
     try {
+      // Desktop Linux: tampilkan cache lokal dulu, lalu ambil child baru saja.
+      // Cache membuat 24 jam penuh murah, jadi chart meringkasnya alih-alih
+      // hanya menampilkan 20 titik terakhir.
+      // Jika perangkat sudah lebih dari sehari tidak mengirim, pakai 50 baris
+      // terakhir seperti dari jaringan.
+      Future<Map<String, Map<String, dynamic>>?> lastDay() async {
+        final day = await HistoryCacheService.cached(
+          'history_data',
+          limit: 0,
+          from: DateTime.now().subtract(const Duration(hours: 24)).millisecondsSinceEpoch,
+        );
+        if (day == null || day.isNotEmpty) return day;
+        return HistoryCacheService.cached('history_data', limit: 50);
+      }
+      final cached = await lastDay();
+      if (cached != null) {
+        _historyFromCache = true;
+        if (cached.isNotEmpty) _showHistoryData(cached);
+        await HistoryCacheService.sync(_databaseRef, 'history_data');
+        final synced = await lastDay();
+        if (synced != null) {
+          _showHistoryData(synced);
+          return;
+        }
+      }
+
       final historySnapshot = await _databaseRef
           .child('history_data')
           .orderByKey()
@@ -163,64 +192,8 @@ class _FarmerDashboardScreenState extends State<FarmerDashboardScreen> {
           .get();
 
       if (historySnapshot.exists) {
-        final List<Map<String, dynamic>> tempData = [];
-        final List<Map<String, dynamic>> humData = [];
-        final List<Map<String, dynamic>> soilData = [];
-        final List<Map<String, dynamic>> lightData = [];
-
-        for (final entry in historySnapshot.children) {
-          final data = entry.value as Map<dynamic, dynamic>?;
-          if (data != null) {
-            final timestamp = _parseTimestamp(data, entry.key.toString());
-            if (timestamp > 0) {
-              final date = DateTime.fromMillisecondsSinceEpoch(timestamp);
-              final timeString = date.toIso8601String();
-              
-              final temperature = _toDouble(data['suhu']);
-              final humidity = _toDouble(data['kelembaban_udara']);
-              final soilMoisture = _toDouble(data['kelembaban_tanah']);
-              final brightness = _toDouble(data['kecerahan']);
-
-              if (temperature != null) {
-                tempData.add({
-                  'time': timeString,
-                  'temperature': temperature,
-                });
-              }
-              if (humidity != null) {
-                humData.add({
-                  'time': timeString,
-                  'humidity': humidity,
-                });
-              }
-              if (soilMoisture != null) {
-                soilData.add({
-                  'time': timeString,
-                  'soilMoisture': soilMoisture,
-                });
-              }
-              if (brightness != null) {
-                lightData.add({
-                  'time': timeString,
-                  'brightness': brightness,
-                });
-              }
-            }
-          }
-        }
-
-        // Sort data dari terlama ke terbaru untuk chart
-        tempData.sort((a, b) => a['time'].compareTo(b['time']));
-        humData.sort((a, b) => a['time'].compareTo(b['time']));
-        soilData.sort((a, b) => a['time'].compareTo(b['time']));
-        lightData.sort((a, b) => a['time'].compareTo(b['time']));
-
-        setState(() {
-          temperatureHistoryData = tempData;
-          humidityHistoryData = humData;
-          soilMoistureHistoryData = soilData;
-          brightnessHistoryData = lightData;
-          _isLoadingHistory = false;
+        _showHistoryData({
+          for (final entry in historySnapshot.children) entry.key.toString(): entry.value,
         });
       } else {
         setState(() {
@@ -235,6 +208,70 @@ class _FarmerDashboardScreenState extends State<FarmerDashboardScreen> {
     }
   }
 
+  // children: key history_data -> isi child, dari jaringan atau cache lokal.
+  void _showHistoryData(Map<String, dynamic> children) {
+    if (!mounted) return;
+    final List<Map<String, dynamic>> tempData = [];
+    final List<Map<String, dynamic>> humData = [];
+    final List<Map<String, dynamic>> soilData = [];
+    final List<Map<String, dynamic>> lightData = [];
+
+    children.forEach((key, value) {
+      final data = value as Map<dynamic, dynamic>?;
+      if (data != null) {
+        final timestamp = _parseTimestamp(data, key);
+        if (timestamp > 0) {
+          final date = DateTime.fromMillisecondsSinceEpoch(timestamp);
+          final timeString = date.toIso8601String();
+          
+          final temperature = _toDouble(data['suhu']);
+          final humidity = _toDouble(data['kelembaban_udara']);
+          final soilMoisture = _toDouble(data['kelembaban_tanah']);
+          final brightness = _toDouble(data['kecerahan']);
+
+          if (temperature != null) {
+            tempData.add({
+              'time': timeString,
+              'temperature': temperature,
+            });
+          }
+          if (humidity != null) {
+            humData.add({
+              'time': timeString,
+              'humidity': humidity,
+            });
+          }
+          if (soilMoisture != null) {
+            soilData.add({
+              'time': timeString,
+              'soilMoisture': soilMoisture,
+            });
+          }
+          if (brightness != null) {
+            lightData.add({
+              'time': timeString,
+              'brightness': brightness,
+            });
+          }
+        }
+      }
+    });
+
+    // Sort data dari terlama ke terbaru untuk chart
+    tempData.sort((a, b) => a['time'].compareTo(b['time']));
+    humData.sort((a, b) => a['time'].compareTo(b['time']));
+    soilData.sort((a, b) => a['time'].compareTo(b['time']));
+    lightData.sort((a, b) => a['time'].compareTo(b['time']));
+
+    setState(() {
+      temperatureHistoryData = tempData;
+      humidityHistoryData = humData;
+      soilMoistureHistoryData = soilData;
+      brightnessHistoryData = lightData;
+      _isLoadingHistory = false;
+    });
+  }
+
   int _parseTimestamp(Map<dynamic, dynamic> data, String key) {
     // 1. Coba dari timestamp field langsung (dalam milliseconds)
     if (data['timestamp'] != null) {
@@ -1573,7 +1610,8 @@ class _FarmerDashboardScreenState extends State<FarmerDashboardScreen> {
                     title: 'Suhu (°C)',
                     color: const Color(0xFF006B5D),
                     dataType: 'temperature',
-                    maxDataPoints: 20,
+                    maxDataPoints: _historyFromCache ? 120 : 20,
+                    downsample: _historyFromCache,
                   ),
                 
                 if (temperatureHistoryData.isNotEmpty) const SizedBox(height: 16),
@@ -1584,7 +1622,8 @@ class _FarmerDashboardScreenState extends State<FarmerDashboardScreen> {
                     title: 'Kelembaban Udara (%)',
                     color: const Color(0xFFB8860B),
                     dataType: 'humidity',
-                    maxDataPoints: 20,
+                    maxDataPoints: _historyFromCache ? 120 : 20,
+                    downsample: _historyFromCache,
                   ),
                 
                 if (humidityHistoryData.isNotEmpty) const SizedBox(height: 16),
@@ -1595,7 +1634,8 @@ class _FarmerDashboardScreenState extends State<FarmerDashboardScreen> {
                     title: 'Kelembaban Tanah (%)',
                     color: const Color(0xFF558B2F),
                     dataType: 'soilMoisture',
-                    maxDataPoints: 20,
+                    maxDataPoints: _historyFromCache ? 120 : 20,
+                    downsample: _historyFromCache,
                   ),
                 
                 if (soilMoistureHistoryData.isNotEmpty) const SizedBox(height: 16),
@@ -1606,7 +1646,8 @@ class _FarmerDashboardScreenState extends State<FarmerDashboardScreen> {
                     title: 'Kecerahan',
                     color: const Color(0xFFB71C1C),
                     dataType: 'brightness',
-                    maxDataPoints: 20,
+                    maxDataPoints: _historyFromCache ? 120 : 20,
+                    downsample: _historyFromCache,
                   ),
               ],
             )
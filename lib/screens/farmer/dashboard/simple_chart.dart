@@ -1,6 +1,8 @@
+import 'dart:typed_data';
 import 'package:flutter/material.dart';
 import 'package:fl_chart/fl_chart.dart';
 import 'package:intl/intl.dart';
+import '../../../services/chart_downsample.dart';
 
 class SensorHistoryChart extends StatelessWidget {
   final List<Map<String, dynamic>> historyData; // Data dari history
@@ -8,6 +10,9 @@ class SensorHistoryChart extends StatelessWidget {
   final Color color;
   final String dataType; // 'temperature', 'humidity', 'soilMoisture', 'brightness'
   final int maxDataPoints; // Jumlah maksimal data yang ditampilkan
+  // true: seluruh data diringkas (LTTB) menjadi maxDataPoints titik;
+  // false: hanya maxDataPoints data terbaru yang ditampilkan.
+  final bool downsample;
 
   const SensorHistoryChart({
     super.key,
@@ -16,6 +21,7 @@ class SensorHistoryChart extends StatelessWidget {
     required this.color,
     required this.dataType,
     this.maxDataPoints = 20,
+    this.downsample = false,
   });
 
   @override
@@ -276,19 +282,22 @@ class SensorHistoryChart extends StatelessWidget {
       return value != null && time != null && value > 0;
     }).toList();
 
-    // Sort berdasarkan waktu (terlama ke terbaru)
-    validData.sort((a, b) {
-      try {
-        final timeA = DateTime.parse(a['time'] ?? '');
-        final timeB = DateTime.parse(b['time'] ?? '');
-        return timeA.compareTo(timeB);
-      } catch (e) {
-        return 0;
-      }
-    });
+    // Sort berdasarkan waktu (terlama ke terbaru). Waktu di-parse sekali per
+    // titik, bukan di setiap perbandingan.
+    final times = <Map<String, dynamic>, int>{
+      for (final data in validData)
+        data: DateTime.tryParse(data['time'] ?? '')?.millisecondsSinceEpoch ?? 0,
+    };
+    validData.sort((a, b) => times[a]!.compareTo(times[b]!));
 
-    // Ambil data terbaru sesuai maxDataPoints
     if (validData.length > maxDataPoints) {
+      if (downsample) {
+        final x = Int64List.fromList([for (final data in validData) times[data]!]);
+        final y = Float32List.fromList([for (final data in validData) _getValue(data)]);
+        final indices = ChartDownsampler.lttb(x, y, maxDataPoints);
+        return [for (final i in indices) validData[i]];
+      }
+      // Ambil data terbaru sesuai maxDataPoints
       return validData.sublist(validData.length - maxDataPoints);
     }
 
@@ -502,7 +511,8 @@ class SensorHistoryChart extends StatelessWidget {
     if (data.length <= 10) return 1;
     if (data.length <= 20) return 2;
     if (data.length <= 30) return 3;
-    return 5;
+    if (data.length <= 50) return 5;
+    return (data.length / 6).ceilToDouble(); // hasil LTTB: sekitar 6 label
   }
 
   Widget _buildEmptyState(BuildContext context) {
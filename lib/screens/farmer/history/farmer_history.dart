@@ -1,10 +1,12 @@
 // ignore_for_file: undefined_class
 import 'dart:async';
 import 'package:flutter/material.dart';
+import 'package:flutter/services.dart';
 import 'package:firebase_database/firebase_database.dart';
 import 'package:intl/intl.dart';
 import 'package:provider/provider.dart';
 import '../../../providers/theme_provider.dart';
+import '../../../services/history_cache.dart';
 
 class HistoryScreen extends StatefulWidget {
   const HistoryScreen({super.key});
@@ -15,13 +17,14 @@ class HistoryScreen extends StatefulWidget {
 
 class _HistoryScreenState extends State<HistoryScreen> {
   final DatabaseReference _databaseRef = FirebaseDatabase.instance.ref();
-  late StreamSubscription<DatabaseEvent> _historyStream;
+  StreamSubscription<DatabaseEvent>? _historyStream;
   late StreamSubscription<DatabaseEvent> _realtimeStream;
 
   List<LogEntry> _logs = [];
   LogEntry? _realtimeData;
   bool _isLoading = true;
   bool _hasError = false;
+  bool _usingCache = false; // desktop Linux dengan cache lokal
 
   // Warna sesuai design untuk light mode
   final Color _darkGreen = const Color(0xFF2D5016);
@@ -50,7 +53,7 @@ class _HistoryScreenState extends State<HistoryScreen> {
 
   @override
   void dispose() {
-    _historyStream.cancel();
+    _historyStream?.cancel();
     _realtimeStream.cancel();
     super.dispose();
   }
@@ -61,6 +64,11 @@ class _HistoryScreenState extends State<HistoryScreen> {
       _handleRealtimeData(event.snapshot.value);
     });
 
+    if (HistoryCacheService.isSupported) {
+      _listenWithCache();
+      return;
+    }
+
     // Listen untuk history_data (update otomatis)
     _historyStream = _databaseRef.child('history_data')
       .orderByKey()
@@ -70,6 +78,48 @@ class _HistoryScreenState extends State<HistoryScreen> {
     });
   }
 
+  // Desktop Linux: tampilkan cache lokal seketika, ambil hanya child yang
+  // lebih baru, lalu setiap child baru memicu sinkronisasi kecil yang sama.
+  Future<void> _listenWithCache() async {
+    final cached = await HistoryCacheService.cached('history_data', limit: 100);
+    if (!mounted) return;
+    if (cached == null) {
+      // Cache dipakai instance lain; kembali ke listener jaringan biasa.
+      _historyStream = _databaseRef.child('history_data')
+        .orderByKey()
+        .limitToLast(100)
+        .onValue.listen((DatabaseEvent event) {
+        _handleHistoryData(event.snapshot.value);
+      });
+      return;
+    }
+    _usingCache = true;
+    if (cached.isNotEmpty) _handleHistoryData(cached);
+
+    // limitToLast(1) juga mengirim child terakhir saat mulai, jadi sync
+    // pertama terjadi di sini.
+    _historyStream = _databaseRef.child('history_data')
+      .orderByKey()
+      .limitToLast(1)
+      .onChildAdded.listen((DatabaseEvent event) => _syncCache());
+  }
+
+  Future<void> _syncCache() async {
+    try {
+      await HistoryCacheService.sync(_databaseRef, 'history_data');
+      final cached = await HistoryCacheService.cached('history_data', limit: 100);
+      if (mounted && cached != null) _handleHistoryData(cached);
+    } catch (e) {
+      print('❌ Error syncing history cache: $e');
+      if (mounted && _isLoading) {
+        setState(() {
+          _isLoading = false;
+          _hasError = _logs.isEmpty;
+        });
+      }
+    }
+  }
+
   void _handleRealtimeData(dynamic data) {
     if (data != null && data is Map) {
       setState(() {
@@ -118,6 +168,10 @@ class _HistoryScreenState extends State<HistoryScreen> {
     setState(() {
       _isLoading = true;
     });
+    if (_usingCache) {
+      _syncCache();
+      return;
+    }
     // Memuat ulang data dengan mengambil snapshot terbaru
     _databaseRef.child('history_data')
       .orderByKey()
@@ -135,6 +189,15 @@ class _HistoryScreenState extends State<HistoryScreen> {
       });
   }
 
+  // Desktop Linux: ekspor seluruh cache riwayat ke berkas di folder Unduhan.
+  void _showExportDialog() {
+    showDialog(
+      context: context,
+      barrierDismissible: false,
+      builder: (context) => const _HistoryExportDialog(path: 'history_data'),
+    );
+  }
+
   bool _isValidTimestamp(int timestamp) {
     final date = DateTime.fromMillisecondsSinceEpoch(timestamp);
     final now = DateTime.now();
@@ -316,11 +379,24 @@ class _HistoryScreenState extends State<HistoryScreen> {
                       ),
                     ],
                   ),
-                  IconButton(
-                    onPressed: _refreshData,
-                    icon: Icon(Icons.refresh, 
-                      color: isDarkMode ? _darkModePrimary : _darkGreen, 
-                      size: 24),
+                  Row(
+                    mainAxisSize: MainAxisSize.min,
+                    children: [
+                      if (_usingCache)
+                        IconButton(
+                          onPressed: _showExportDialog,
+                          tooltip: 'Ekspor riwayat',
+                          icon: Icon(Icons.download,
+                            color: isDarkMode ? _darkModePrimary : _darkGreen,
+                            size: 24),
+                        ),
+                      IconButton(
+                        onPressed: _refreshData,
+                        icon: Icon(Icons.refresh, 
+                          color: isDarkMode ? _darkModePrimary : _darkGreen, 
+                          size: 24),
+                      ),
+                    ],
                   ),
                 ],
               ),
@@ -762,4 +838,117 @@ class LogEntry {
     this.datetime,
     this.formattedDate, 
   });
-}
\ No newline at end of file
+}
+/// Memilih format, lalu menampilkan kemajuan ekspor cache riwayat.
+class _HistoryExportDialog extends StatefulWidget {
+  final String path;
+
+  const _HistoryExportDialog({required this.path});
+
+  @override
+  State<_HistoryExportDialog> createState() => _HistoryExportDialogState();
+}
+
+class _HistoryExportDialogState extends State<_HistoryExportDialog> {
+  String _format = 'csv';
+  StreamSubscription<HistoryExportProgress>? _export;
+  HistoryExportProgress? _progress;
+  String? _error;
+
+  bool get _running => _export != null && !(_progress?.done ?? false) && _error == null;
+
+  @override
+  void dispose() {
+    // Menutup dialog tidak menghentikan ekspor; tombol Batal yang menghentikannya.
+    _export?.cancel();
+    super.dispose();
+  }
+
+  void _start() {
+    setState(() {
+      _progress = null;
+      _error = null;
+    });
+    _export = HistoryCacheService.export(widget.path, format: _format).listen(
+      (progress) => setState(() {
+        _progress = progress;
+        if (progress.error != null) _error = progress.error;
+      }),
+      onError: (Object e) => setState(() {
+        _error = e is PlatformException ? e.message : e.toString();
+      }),
+    );
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    final progress = _progress;
+    final number = NumberFormat.decimalPattern();
+    final Widget content;
+    if (_export == null) {
+      content = Column(
+        mainAxisSize: MainAxisSize.min,
+        children: [
+          RadioListTile<String>(
+            value: 'csv',
+            groupValue: _format,
+            onChanged: (value) => setState(() => _format = value!),
+            title: const Text('CSV'),
+            subtitle: const Text('Untuk spreadsheet'),
+          ),
+          RadioListTile<String>(
+            value: 'columnar',
+            groupValue: _format,
+            onChanged: (value) => setState(() => _format = value!),
+            title: const Text('Kolom biner (.sfhx)'),
+            subtitle: const Text('Lebih kecil, untuk analisis (numpy)'),
+          ),
+        ],
+      );
+    } else {
+      content = Column(
+        mainAxisSize: MainAxisSize.min,
+        crossAxisAlignment: CrossAxisAlignment.start,
+        children: [
+          LinearProgressIndicator(value: progress?.fraction),
+          const SizedBox(height: 12),
+          if (progress != null)
+            Text('${number.format(progress.rows)} / ${number.format(progress.total)} baris · '
+                '${number.format(progress.rowsPerSecond.round())} baris/detik'),
+          if (progress != null && progress.done && _error == null)
+            Padding(
+              padding: const EdgeInsets.only(top: 8),
+              child: Text('Tersimpan di ${progress.file}'),
+            ),
+          if (_error != null)
+            Padding(
+              padding: const EdgeInsets.only(top: 8),
+              child: Text(
+                _error == 'cancelled' ? 'Ekspor dibatalkan' : 'Ekspor gagal: $_error',
+                style: const TextStyle(color: Colors.red),
+              ),
+            ),
+        ],
+      );
+    }
+
+    return AlertDialog(
+      title: const Text('Ekspor Riwayat'),
+      content: content,
+      actions: [
+        if (_running)
+          TextButton(
+            onPressed: HistoryCacheService.cancelExport,
+            child: const Text('Batal'),
+          )
+        else
+          TextButton(
+            onPressed: () => Navigator.of(context).pop(),
+            child: const Text('Tutup'),
+          ),
+        if (_export == null)
+          ElevatedButton(onPressed: _start, child: const Text('Ekspor')),
+      ],
+    );
+  }
+}
@@ -0,0 +1,112 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+
+// dart:ffi tidak ada di web, jadi binding native hanya diimpor di platform
+// yang mendukungnya; stub membuat ChartDownsampler selalu memakai jalur Dart.
+import 'chart_downsample_stub.dart'
+    if (dart.library.ffi) 'chart_downsample_native.dart';
+
+/// Mengecilkan deret sensor menjadi kira-kira satu titik per piksel sebelum
+/// digambar. Di desktop Linux memakai libsmartfarm_chart.so
+/// (linux/native/downsample.h) lewat FFI; di platform lain memakai
+/// implementasi Dart yang sama (dihitung dengan double, jadi pilihan titik
+/// bisa sedikit berbeda saat seri), hanya lebih lambat.
+///
+/// Keduanya mengembalikan indeks ke data masukan (urut naik), jadi pemanggil
+/// tetap memegang timestamp dan nilainya sendiri.
+class ChartDownsampler {
+  static NativeChart? _native;
+  static bool _loaded = false;
+
+  /// True jika pustaka native berhasil dimuat.
+  static bool get isNative => _load() != null;
+
+  /// Largest-Triangle-Three-Buckets: [threshold] titik yang menjaga bentuk
+  /// garis. [x] dalam ms epoch dan harus urut naik.
+  static Uint32List lttb(Int64List x, Float32List y, int threshold) {
+    assert(x.length == y.length);
+    final n = x.length;
+    if (threshold < 3 || threshold >= n) return _all(n);
+    final native = _load();
+    if (native != null) return native.lttb(x, y, threshold);
+    return _lttbDart(x, y, threshold);
+  }
+
+  /// Nilai terendah dan tertinggi tiap bucket (paling banyak 2 x [buckets]
+  /// titik), agar lonjakan singkat tetap terlihat.
+  static Uint32List minMax(Float32List y, int buckets) {
+    final n = y.length;
+    if (buckets <= 0 || 2 * buckets >= n) return _all(n);
+    final native = _load();
+    if (native != null) return native.minMax(y, buckets);
+    return _minMaxDart(y, buckets);
+  }
+
+  static NativeChart? _load() {
+    if (_loaded) return _native;
+    _loaded = true;
+    _native = loadNativeChart();
+    return _native;
+  }
+
+  static Uint32List _all(int n) => Uint32List.fromList(List<int>.generate(n, (i) => i));
+
+  static Uint32List _lttbDart(Int64List x, Float32List y, int threshold) {
+    final n = x.length;
+    final out = Uint32List(threshold);
+    final every = (n - 2) / (threshold - 2);
+    int count = 0;
+    int a = 0;
+    out[count++] = 0;
+    for (int bucket = 0; bucket < threshold - 2; bucket++) {
+      final last = bucket == threshold - 3;
+      final begin = 1 + (bucket * every).floor();
+      final end = last ? n - 1 : 1 + ((bucket + 1) * every).floor();
+      final nextEnd = last ? n : math.min(1 + ((bucket + 2) * every).floor(), n - 1);
+
+      double cx = 0, cy = 0;
+      for (int i = end; i < nextEnd; i++) {
+        cx += x[i] - x[0];
+        cy += y[i];
+      }
+      cx /= nextEnd - end;
+      cy /= nextEnd - end;
+
+      final ax = (x[a] - x[0]).toDouble(), ay = y[a];
+      double best = -1;
+      int bestIndex = begin;
+      for (int i = begin; i < end; i++) {
+        final area = ((ax - cx) * (y[i] - ay) - (ax - (x[i] - x[0])) * (cy - ay)).abs();
+        if (area > best) {
+          best = area;
+          bestIndex = i;
+        }
+      }
+      out[count++] = bestIndex;
+      a = bestIndex;
+    }
+    out[count++] = n - 1;
+    return out;
+  }
+
+  static Uint32List _minMaxDart(Float32List y, int buckets) {
+    final n = y.length;
+    final out = <int>[];
+    for (int bucket = 0; bucket < buckets; bucket++) {
+      final begin = bucket * n ~/ buckets;
+      final end = (bucket + 1) * n ~/ buckets;
+      int lo = begin, hi = begin;
+      for (int i = begin; i < end; i++) {
+        if (y[i] < y[lo]) lo = i;
+        if (y[i] > y[hi]) hi = i;
+      }
+      if (lo == hi) {
+        out.add(lo);
+      } else {
+        out.add(lo < hi ? lo : hi);
+        out.add(lo < hi ? hi : lo);
+      }
+    }
+    return Uint32List.fromList(out);
+  }
+}
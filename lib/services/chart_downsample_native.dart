@@ -0,0 +1,66 @@
+import 'dart:ffi';
+import 'dart:typed_data';
+
+import 'native_library.dart';
+
+typedef _AllocNative = Pointer<Void> Function(IntPtr bytes);
+typedef _Alloc = Pointer<Void> Function(int bytes);
+typedef _FreeNative = Void Function(Pointer<Void> buffer);
+typedef _Free = void Function(Pointer<Void> buffer);
+typedef _LttbNative = IntPtr Function(
+    Pointer<Int64> x, Pointer<Float> y, IntPtr n, IntPtr threshold, Pointer<Uint32> out);
+typedef _Lttb = int Function(
+    Pointer<Int64> x, Pointer<Float> y, int n, int threshold, Pointer<Uint32> out);
+typedef _MinMaxNative = IntPtr Function(
+    Pointer<Float> y, IntPtr n, IntPtr buckets, Pointer<Uint32> out);
+typedef _MinMax = int Function(Pointer<Float> y, int n, int buckets, Pointer<Uint32> out);
+
+/// Memuat libsmartfarm_chart.so; null jika tidak ada (bukan desktop Linux).
+NativeChart? loadNativeChart() {
+  final lib = openBundledLibrary('libsmartfarm_chart.so');
+  return lib == null ? null : NativeChart(lib);
+}
+
+class NativeChart {
+  final _Alloc _alloc;
+  final _Free _free;
+  final _Lttb _lttb;
+  final _MinMax _minMax;
+
+  NativeChart(DynamicLibrary lib)
+      : _alloc = lib.lookupFunction<_AllocNative, _Alloc>('smartfarm_chart_alloc'),
+        _free = lib.lookupFunction<_FreeNative, _Free>('smartfarm_chart_free'),
+        _lttb = lib.lookupFunction<_LttbNative, _Lttb>('smartfarm_lttb'),
+        _minMax = lib.lookupFunction<_MinMaxNative, _MinMax>('smartfarm_minmax');
+
+  Uint32List lttb(Int64List x, Float32List y, int threshold) {
+    final n = x.length;
+    final px = _alloc(n * 8).cast<Int64>();
+    final py = _alloc(n * 4).cast<Float>();
+    final pout = _alloc(threshold * 4).cast<Uint32>();
+    try {
+      px.asTypedList(n).setAll(0, x);
+      py.asTypedList(n).setAll(0, y);
+      final count = _lttb(px, py, n, threshold, pout);
+      return Uint32List.fromList(pout.asTypedList(count));
+    } finally {
+      _free(px.cast());
+      _free(py.cast());
+      _free(pout.cast());
+    }
+  }
+
+  Uint32List minMax(Float32List y, int buckets) {
+    final n = y.length;
+    final py = _alloc(n * 4).cast<Float>();
+    final pout = _alloc(2 * buckets * 4).cast<Uint32>();
+    try {
+      py.asTypedList(n).setAll(0, y);
+      final count = _minMax(py, n, buckets, pout);
+      return Uint32List.fromList(pout.asTypedList(count));
+    } finally {
+      _free(py.cast());
+      _free(pout.cast());
+    }
+  }
+}
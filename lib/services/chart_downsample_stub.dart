@@ -0,0 +1,10 @@
+import 'dart:typed_data';
+
+/// Pengganti chart_downsample_native.dart untuk platform tanpa dart:ffi
+/// (web). Tidak pernah dibuat, jadi ChartDownsampler memakai jalur Dart.
+abstract class NativeChart {
+  Uint32List lttb(Int64List x, Float32List y, int threshold);
+  Uint32List minMax(Float32List y, int buckets);
+}
+
+NativeChart? loadNativeChart() => null;
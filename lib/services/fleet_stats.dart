@@ -0,0 +1,157 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+
+// Seperti chart_downsample.dart: binding FFI hanya diimpor bila dart:ffi
+// tersedia; di web stub tidak memberi pustaka native.
+import 'fleet_stats_stub.dart'
+    if (dart.library.ffi) 'fleet_stats_native.dart';
+
+/// Ringkasan satu deret sensor; sampel NaN (gagal baca) tidak dihitung.
+class SeriesSummary {
+  final int count;
+  final double mean;
+  final double min;
+  final double max;
+  final double p50;
+  final double p90;
+  final double p99;
+
+  const SeriesSummary({
+    required this.count,
+    required this.mean,
+    required this.min,
+    required this.max,
+    required this.p50,
+    required this.p90,
+    required this.p99,
+  });
+
+  static const empty = SeriesSummary(count: 0, mean: 0, min: 0, max: 0, p50: 0, p90: 0, p99: 0);
+}
+
+/// Lama dan berapa kali nilai keluar dari rentang [low, high].
+class Exceedance {
+  final Duration above;
+  final Duration below;
+  final int aboveRuns;
+  final int belowRuns;
+
+  const Exceedance({
+    required this.above,
+    required this.below,
+    required this.aboveRuns,
+    required this.belowRuns,
+  });
+}
+
+/// Agregat dashboard admin atas kolom sampel (bukan Map per baris). Di
+/// desktop Linux memakai libsmartfarm_stats.so (linux/native/fleet_stats.h)
+/// lewat FFI; di platform lain, atau untuk data kecil yang ongkos salinnya
+/// lebih mahal dari hitungannya, memakai implementasi Dart dengan aturan
+/// yang sama (rata-rata bisa berbeda di digit terakhir karena urutan
+/// penjumlahan).
+class FleetStats {
+  static NativeStats? _native;
+  static bool _loaded = false;
+
+  /// Di bawah jumlah baris ini Dart lebih cepat daripada menyalin ke native.
+  static const int _nativeMinRows = 4096;
+
+  /// True jika pustaka native berhasil dimuat.
+  static bool get isNative => _load() != null;
+
+  static SeriesSummary summarize(Float32List y) =>
+      summarizeGroups(y, [0, y.length]).first;
+
+  /// Ringkasan per perangkat lalu seluruh armada (elemen terakhir).
+  /// Perangkat g memiliki baris [offsets[g], offsets[g + 1]) dari [y].
+  static List<SeriesSummary> summarizeGroups(Float32List y, List<int> offsets) {
+    assert(offsets.isNotEmpty && offsets.last <= y.length);
+    final native = y.length >= _nativeMinRows ? _load() : null;
+    if (native != null) return native.summarizeGroups(y, offsets);
+    final groups = offsets.length - 1;
+    return [
+      for (int g = 0; g < groups; g++) _summarizeDart(y, offsets[g], offsets[g + 1]),
+      _summarizeDart(y, offsets.first, offsets.last),
+    ];
+  }
+
+  /// Sampel i berlaku sampai sampel berikutnya, paling lama [maxGap]; jeda
+  /// lebih panjang berarti perangkat offline. [t] dalam ms epoch, urut naik.
+  static Exceedance exceedance(Int64List t, Float32List y,
+      {required double low, required double high, Duration maxGap = const Duration(minutes: 10)}) {
+    assert(t.length == y.length);
+    final native = t.length >= _nativeMinRows ? _load() : null;
+    if (native != null) return native.exceedance(t, y, low, high, maxGap.inMilliseconds);
+    return _exceedanceDart(t, y, low, high, maxGap.inMilliseconds);
+  }
+
+  /// Indeks [k] timestamp terbesar, terbaru dulu; timestamp sama tetap dalam
+  /// urutan masukan. Tidak mengurutkan sisa data.
+  static Uint32List topRecent(Int64List t, int k) {
+    k = math.min(k, t.length);
+    if (k <= 0) return Uint32List(0);
+    final native = t.length >= _nativeMinRows ? _load() : null;
+    if (native != null) return native.topRecent(t, k);
+    final order = List<int>.generate(t.length, (i) => i)
+      ..sort((a, b) => t[a] != t[b] ? t[b].compareTo(t[a]) : a.compareTo(b));
+    return Uint32List.fromList(order.sublist(0, k));
+  }
+
+  static NativeStats? _load() {
+    if (_loaded) return _native;
+    _loaded = true;
+    _native = loadNativeStats();
+    return _native;
+  }
+
+  // Persentil nearest-rank, sama dengan fleet_stats.cc.
+  static SeriesSummary _summarizeDart(Float32List y, int begin, int end) {
+    final values = <double>[
+      for (int i = begin; i < end; i++)
+        if (!y[i].isNaN) y[i]
+    ];
+    if (values.isEmpty) return SeriesSummary.empty;
+    values.sort();
+    double sum = 0;
+    for (final v in values) {
+      sum += v;
+    }
+    double at(int perMille) {
+      final rank = (values.length * perMille + 999) ~/ 1000;
+      return values[math.max(rank - 1, 0)];
+    }
+
+    return SeriesSummary(
+      count: values.length,
+      mean: sum / values.length,
+      min: values.first,
+      max: values.last,
+      p50: at(500),
+      p90: at(900),
+      p99: at(990),
+    );
+  }
+
+  static Exceedance _exceedanceDart(
+      Int64List t, Float32List y, double low, double high, int maxGapMs) {
+    int aboveMs = 0, belowMs = 0, aboveRuns = 0, belowRuns = 0;
+    bool wasAbove = false, wasBelow = false;
+    for (int i = 0; i < t.length; i++) {
+      final dt = i + 1 < t.length ? math.min(math.max(t[i + 1] - t[i], 0), maxGapMs) : 0;
+      final above = y[i] > high, below = y[i] < low;
+      if (above) aboveMs += dt;
+      if (below) belowMs += dt;
+      if (above && !wasAbove) aboveRuns++;
+      if (below && !wasBelow) belowRuns++;
+      wasAbove = above;
+      wasBelow = below;
+    }
+    return Exceedance(
+      above: Duration(milliseconds: aboveMs),
+      below: Duration(milliseconds: belowMs),
+      aboveRuns: aboveRuns,
+      belowRuns: belowRuns,
+    );
+  }
+}
@@ -0,0 +1,142 @@
+import 'dart:ffi';
+import 'dart:typed_data';
+
+import 'fleet_stats.dart';
+import 'native_library.dart';
+
+typedef _AllocNative = Pointer<Void> Function(IntPtr bytes);
+typedef _Alloc = Pointer<Void> Function(int bytes);
+typedef _FreeNative = Void Function(Pointer<Void> buffer);
+typedef _Free = void Function(Pointer<Void> buffer);
+typedef _SummarizeGroupsNative = Void Function(
+    Pointer<Float> y, Pointer<Uint64> offsets, IntPtr groups, Pointer<_Summary> out);
+typedef _SummarizeGroups = void Function(
+    Pointer<Float> y, Pointer<Uint64> offsets, int groups, Pointer<_Summary> out);
+typedef _ExceedanceNative = Void Function(Pointer<Int64> t, Pointer<Float> y, IntPtr n,
+    Float low, Float high, Int64 maxGapMs, Pointer<_Exceedance> out);
+typedef _ExceedanceFn = void Function(Pointer<Int64> t, Pointer<Float> y, int n, double low,
+    double high, int maxGapMs, Pointer<_Exceedance> out);
+typedef _TopRecentNative = IntPtr Function(
+    Pointer<Int64> t, IntPtr n, IntPtr k, Pointer<Uint32> out);
+typedef _TopRecent = int Function(Pointer<Int64> t, int n, int k, Pointer<Uint32> out);
+
+/// Memuat libsmartfarm_stats.so; null jika tidak ada (bukan desktop Linux).
+NativeStats? loadNativeStats() {
+  final lib = openBundledLibrary('libsmartfarm_stats.so');
+  return lib == null ? null : NativeStats(lib);
+}
+
+// Sama dengan SmartfarmSummary di fleet_stats.h; urutan field harus sama.
+final class _Summary extends Struct {
+  @Uint64()
+  external int count;
+  @Double()
+  external double mean;
+  @Float()
+  external double min;
+  @Float()
+  external double max;
+  @Float()
+  external double p50;
+  @Float()
+  external double p90;
+  @Float()
+  external double p99;
+  @Float()
+  external double reserved;
+}
+
+// Sama dengan SmartfarmExceedance di fleet_stats.h.
+final class _Exceedance extends Struct {
+  @Int64()
+  external int aboveMs;
+  @Int64()
+  external int belowMs;
+  @Uint32()
+  external int aboveRuns;
+  @Uint32()
+  external int belowRuns;
+}
+
+class NativeStats {
+  final _Alloc _alloc;
+  final _Free _free;
+  final _SummarizeGroups _summarizeGroups;
+  final _ExceedanceFn _exceedance;
+  final _TopRecent _topRecent;
+
+  NativeStats(DynamicLibrary lib)
+      : _alloc = lib.lookupFunction<_AllocNative, _Alloc>('smartfarm_stats_alloc'),
+        _free = lib.lookupFunction<_FreeNative, _Free>('smartfarm_stats_free'),
+        _summarizeGroups = lib.lookupFunction<_SummarizeGroupsNative, _SummarizeGroups>(
+            'smartfarm_summarize_groups'),
+        _exceedance =
+            lib.lookupFunction<_ExceedanceNative, _ExceedanceFn>('smartfarm_exceedance'),
+        _topRecent = lib.lookupFunction<_TopRecentNative, _TopRecent>('smartfarm_top_recent');
+
+  List<SeriesSummary> summarizeGroups(Float32List y, List<int> offsets) {
+    final n = y.length;
+    final groups = offsets.length - 1;
+    final py = _alloc(n * 4).cast<Float>();
+    final poffsets = _alloc(offsets.length * 8).cast<Uint64>();
+    final pout = _alloc((groups + 1) * sizeOf<_Summary>()).cast<_Summary>();
+    try {
+      py.asTypedList(n).setAll(0, y);
+      poffsets.asTypedList(offsets.length).setAll(0, offsets);
+      _summarizeGroups(py, poffsets, groups, pout);
+      return [
+        for (int g = 0; g <= groups; g++)
+          SeriesSummary(
+            count: pout[g].count,
+            mean: pout[g].mean,
+            min: pout[g].min,
+            max: pout[g].max,
+            p50: pout[g].p50,
+            p90: pout[g].p90,
+            p99: pout[g].p99,
+          ),
+      ];
+    } finally {
+      _free(py.cast());
+      _free(poffsets.cast());
+      _free(pout.cast());
+    }
+  }
+
+  Exceedance exceedance(Int64List t, Float32List y, double low, double high, int maxGapMs) {
+    final n = t.length;
+    final pt = _alloc(n * 8).cast<Int64>();
+    final py = _alloc(n * 4).cast<Float>();
+    final pout = _alloc(sizeOf<_Exceedance>()).cast<_Exceedance>();
+    try {
+      pt.asTypedList(n).setAll(0, t);
+      py.asTypedList(n).setAll(0, y);
+      _exceedance(pt, py, n, low, high, maxGapMs, pout);
+      final out = pout.ref;
+      return Exceedance(
+        above: Duration(milliseconds: out.aboveMs),
+        below: Duration(milliseconds: out.belowMs),
+        aboveRuns: out.aboveRuns,
+        belowRuns: out.belowRuns,
+      );
+    } finally {
+      _free(pt.cast());
+      _free(py.cast());
+      _free(pout.cast());
+    }
+  }
+
+  Uint32List topRecent(Int64List t, int k) {
+    final n = t.length;
+    final pt = _alloc(n * 8).cast<Int64>();
+    final pout = _alloc(k * 4).cast<Uint32>();
+    try {
+      pt.asTypedList(n).setAll(0, t);
+      final count = _topRecent(pt, n, k, pout);
+      return Uint32List.fromList(pout.asTypedList(count));
+    } finally {
+      _free(pt.cast());
+      _free(pout.cast());
+    }
+  }
+}
@@ -0,0 +1,13 @@
+import 'dart:typed_data';
+
+import 'fleet_stats.dart';
+
+/// Pengganti fleet_stats_native.dart untuk platform tanpa dart:ffi (web).
+/// Tidak pernah dibuat, jadi FleetStats memakai persentil dan agregat Dart.
+abstract class NativeStats {
+  List<SeriesSummary> summarizeGroups(Float32List y, List<int> offsets);
+  Exceedance exceedance(Int64List t, Float32List y, double low, double high, int maxGapMs);
+  Uint32List topRecent(Int64List t, int k);
+}
+
+NativeStats? loadNativeStats() => null;
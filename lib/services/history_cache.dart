@@ -0,0 +1,289 @@
+import 'dart:async';
+import 'dart:typed_data';
+
+import 'package:firebase_database/firebase_database.dart';
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+/// Salinan lokal history_data di desktop Linux
+/// (linux/runner/history_cache_plugin.cc). Layar riwayat dan dashboard
+/// membaca dari cache ini lebih dulu, lalu hanya mengambil child yang lebih
+/// baru dari key terakhir di cache. Di platform lain semua method
+/// mengembalikan null sehingga layar tetap memakai jaringan seperti biasa.
+class HistoryCacheService {
+  static const MethodChannel _channel = MethodChannel('smartfarm/history_cache');
+  static const EventChannel _exportChannel = EventChannel('smartfarm/history_cache/export');
+
+  // Sama dengan HistoryFlags di linux/native/history_cache.h.
+  static const int _pumpOn = 1;
+  static const int _manual = 2;
+  static const int _day = 4;
+  static const int _stageShift = 3;
+  static const List<String> _stages = ['BIBIT', 'VEGETATIF', 'BERBUNGA', 'PEMBUAHAN'];
+
+  static bool get isSupported =>
+      !kIsWeb && defaultTargetPlatform == TargetPlatform.linux;
+
+  /// [limit] baris terbaru (0 = semua) dalam rentang [from]..[to] (ms
+  /// epoch), dalam bentuk yang sama dengan snapshot history_data (key -> map
+  /// field).
+  /// Null jika cache tidak tersedia, misalnya dipakai instance aplikasi lain.
+  static Future<Map<String, Map<String, dynamic>>?> cached(
+    String path, {
+    int limit = 100,
+    int? from,
+    int? to,
+  }) async {
+    if (!isSupported) return null;
+    try {
+      final result = await _channel.invokeMapMethod<String, dynamic>('query', {
+        'path': path,
+        'limit': limit,
+        if (from != null) 'from': from,
+        if (to != null) 'to': to,
+      });
+      if (result == null) return null;
+      return _toChildren(result);
+    } on PlatformException catch (e) {
+      print('⚠️ Cache riwayat tidak tersedia: ${e.message}');
+      return null;
+    }
+  }
+
+  /// Mengambil child [path] yang lebih baru dari key terakhir di cache,
+  /// per halaman [pageSize], lalu menyimpannya. Cache kosong diisi dengan
+  /// [initialLimit] child terbaru. Mengembalikan jumlah baris baru, atau null
+  /// jika cache tidak tersedia.
+  static Future<int?> sync(
+    DatabaseReference root,
+    String path, {
+    int initialLimit = 500,
+    int pageSize = 500,
+  }) async {
+    if (!isSupported) return null;
+    try {
+      String lastKey = await _channel.invokeMethod<String>('lastKey', {'path': path}) ?? '';
+      int total = 0;
+      while (true) {
+        final Query query = lastKey.isEmpty
+            ? root.child(path).orderByKey().limitToLast(initialLimit)
+            : root.child(path).orderByKey().startAfter(lastKey).limitToFirst(pageSize);
+        final snapshot = await query.get();
+        final children = snapshot.children.toList();
+        if (children.isEmpty) break;
+        total += await append(path, children, afterKey: lastKey);
+        lastKey = children.last.key ?? lastKey;
+        if (children.length < pageSize) break;
+      }
+      return total;
+    } on PlatformException catch (e) {
+      print('⚠️ Sinkronisasi cache riwayat gagal: ${e.message}');
+      return null;
+    }
+  }
+
+  /// Menyimpan child history_data yang sudah terurut menurut key. Child tanpa
+  /// timestamp dilewati, tetapi key-nya tetap dicatat agar tidak diambil
+  /// ulang. Dengan [afterKey], tidak ada yang disimpan jika key terakhir cache
+  /// sudah berubah (layar lain baru saja sinkron).
+  static Future<int> append(String path, List<DataSnapshot> children, {String? afterKey}) async {
+    if (!isSupported || children.isEmpty) return 0;
+    final rows = <Map<dynamic, dynamic>>[];
+    for (final child in children) {
+      final value = child.value;
+      if (value is Map && _timestampOf(value) > 0) rows.add(value);
+    }
+
+    final n = rows.length;
+    final timestamp = Int64List(n);
+    final suhu = Float32List(n);
+    final kelembabanUdara = Float32List(n);
+    final kelembabanTanah = Float32List(n);
+    final kecerahan = Float32List(n);
+    final umurTanaman = Int32List(n);
+    final flags = Uint8List(n);
+    for (int i = 0; i < n; i++) {
+      final row = rows[i];
+      timestamp[i] = _timestampOf(row);
+      suhu[i] = _toDouble(row['suhu']);
+      kelembabanUdara[i] = _toDouble(row['kelembaban_udara']);
+      kelembabanTanah[i] = _toDouble(row['kelembaban_tanah']);
+      kecerahan[i] = _toDouble(row['kecerahan']);
+      umurTanaman[i] = int.tryParse(row['umur_tanaman']?.toString() ?? '') ?? 0;
+      flags[i] = _flagsOf(row);
+    }
+
+    final appended = await _channel.invokeMethod<int>('append', {
+      'path': path,
+      'lastKey': children.last.key ?? '',
+      if (afterKey != null) 'afterKey': afterKey,
+      'timestamp': timestamp,
+      'suhu': suhu,
+      'kelembaban_udara': kelembabanUdara,
+      'kelembaban_tanah': kelembabanTanah,
+      'kecerahan': kecerahan,
+      'umur_tanaman': umurTanaman,
+      'flags': flags,
+    });
+    return appended ?? 0;
+  }
+
+  /// Mengekspor rentang [from]..[to] (ms epoch, default semua) dari cache
+  /// ke CSV ([format] 'csv') atau berkas kolom biner ('columnar', .sfhx).
+  /// Tanpa [file], berkas ditulis ke folder Unduhan. Stream mengirim
+  /// kemajuan paling sering tiap 100 ms dan selesai setelah event dengan
+  /// [HistoryExportProgress.done]; gagal dengan PlatformException bila ekspor
+  /// tidak bisa dimulai (BUSY jika ekspor lain masih berjalan).
+  static Stream<HistoryExportProgress> export(
+    String path, {
+    String format = 'csv',
+    String? file,
+    int? from,
+    int? to,
+  }) {
+    if (!isSupported) {
+      return Stream.error(UnsupportedError('Ekspor riwayat hanya ada di desktop Linux'));
+    }
+    StreamSubscription<dynamic>? events;
+    late final StreamController<HistoryExportProgress> controller;
+    controller = StreamController<HistoryExportProgress>(
+      onListen: () async {
+        // Dengarkan dulu agar event selesai dari ekspor kecil tidak terlewat.
+        // Hanya satu ekspor berjalan sekaligus, jadi semua event milik ekspor ini.
+        events = _exportChannel.receiveBroadcastStream().listen((event) {
+          final progress = HistoryExportProgress._fromMap(event as Map);
+          controller.add(progress);
+          if (progress.done) {
+            events?.cancel();
+            controller.close();
+          }
+        }, onError: controller.addError);
+        try {
+          await _channel.invokeMapMethod<String, dynamic>('export', {
+            'path': path,
+            'format': format,
+            if (file != null) 'file': file,
+            if (from != null) 'from': from,
+            if (to != null) 'to': to,
+          });
+        } on PlatformException catch (e) {
+          await events?.cancel();
+          controller.addError(e);
+          await controller.close();
+        }
+      },
+      onCancel: () => events?.cancel(),
+    );
+    return controller.stream;
+  }
+
+  /// Membatalkan ekspor yang berjalan dan menghapus berkas setengah jadinya.
+  static Future<void> cancelExport() async {
+    if (!isSupported) return;
+    await _channel.invokeMethod<bool>('cancelExport');
+  }
+
+  static int _timestampOf(Map value) {
+    final ts = value['timestamp'];
+    if (ts is int) return ts;
+    if (ts is String) return int.tryParse(ts) ?? 0;
+    return 0;
+  }
+
+  // Nilai yang tidak ada (firmware menulis null saat DHT22 gagal) disimpan
+  // sebagai NaN, bukan 0, agar tidak tampil sebagai bacaan 0 °C / 0 %.
+  static double _toDouble(dynamic value) {
+    if (value is num) return value.toDouble();
+    if (value is String) return double.tryParse(value) ?? double.nan;
+    return double.nan;
+  }
+
+  static int _flagsOf(Map value) {
+    int flags = 0;
+    if (value['status_pompa']?.toString() == 'ON') flags |= _pumpOn;
+    if (value['mode_operasi']?.toString() == 'MANUAL') flags |= _manual;
+    if (value['waktu']?.toString() == 'Siang') flags |= _day;
+    final stage = _stages.indexOf(value['tahapan_tanaman']?.toString() ?? '');
+    if (stage > 0) flags |= stage << _stageShift;
+    return flags;
+  }
+
+  // Sama dengan getSoilCategory() di firmware/tomato_logic.h.
+  static String _soilCategory(double soil) {
+    if (soil.isNaN) return 'Sensor Error';
+    if (soil < 30.0) return 'SANGAT KERING';
+    if (soil < 50.0) return 'KERING';
+    if (soil <= 70.0) return 'LEMBAB';
+    return 'BASAH';
+  }
+
+  static Map<String, Map<String, dynamic>> _toChildren(Map<String, dynamic> columns) {
+    final timestamp = columns['timestamp'] as Int64List;
+    final suhu = columns['suhu'] as Float32List;
+    final kelembabanUdara = columns['kelembaban_udara'] as Float32List;
+    final kelembabanTanah = columns['kelembaban_tanah'] as Float32List;
+    final kecerahan = columns['kecerahan'] as Float32List;
+    final umurTanaman = columns['umur_tanaman'] as Int32List;
+    final flags = columns['flags'] as Uint8List;
+
+    final children = <String, Map<String, dynamic>>{};
+    for (int i = 0; i < timestamp.length; i++) {
+      final flag = flags[i];
+      // Float32 -> double menambah ekor desimal (27.1 -> 27.100000381).
+      // NaN kembali menjadi null, sama seperti data dari Firebase.
+      double? round(double v) => v.isNaN ? null : (v * 10).roundToDouble() / 10;
+      children['data_${timestamp[i]}_$i'] = {
+        'timestamp': timestamp[i],
+        'suhu': round(suhu[i]),
+        'kelembaban_udara': round(kelembabanUdara[i]),
+        'kelembaban_tanah': round(kelembabanTanah[i]),
+        'kecerahan': round(kecerahan[i]),
+        'kategori_tanah': _soilCategory(kelembabanTanah[i]),
+        'umur_tanaman': umurTanaman[i],
+        'tahapan_tanaman': _stages[(flag >> _stageShift) & 3],
+        'status_pompa': (flag & _pumpOn) != 0 ? 'ON' : 'OFF',
+        'mode_operasi': (flag & _manual) != 0 ? 'MANUAL' : 'AUTO',
+        'waktu': (flag & _day) != 0 ? 'Siang' : 'Malam',
+      };
+    }
+    return children;
+  }
+}
+
+/// Kemajuan satu ekspor riwayat (lihat [HistoryCacheService.export]).
+class HistoryExportProgress {
+  final String file;
+  final int rows;
+  final int total;
+  final int bytes;
+  final Duration elapsed;
+  final double rowsPerSecond;
+  final bool done;
+
+  /// Pesan galat bila ekspor gagal atau dibatalkan ('cancelled').
+  final String? error;
+
+  const HistoryExportProgress({
+    required this.file,
+    required this.rows,
+    required this.total,
+    required this.bytes,
+    required this.elapsed,
+    required this.rowsPerSecond,
+    required this.done,
+    this.error,
+  });
+
+  double get fraction => total == 0 ? 1 : rows / total;
+
+  factory HistoryExportProgress._fromMap(Map event) => HistoryExportProgress(
+        file: event['file'] as String,
+        rows: event['rows'] as int,
+        total: event['total'] as int,
+        bytes: event['bytes'] as int,
+        elapsed: Duration(milliseconds: event['elapsed_ms'] as int),
+        rowsPerSecond: (event['rows_per_s'] as num).toDouble(),
+        done: event['done'] as bool,
+        error: event['error'] as String?,
+      );
+}
@@ -0,0 +1,108 @@
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+/// Pembacaan langsung dari ESP32 di LAN lewat UDP multicast, tanpa Firebase.
+/// Hanya tersedia di build Linux (linux/runner/lan_telemetry_plugin.cc);
+/// platform lain mendapat stream kosong.
+class LanTelemetryService {
+  static const EventChannel _channel = EventChannel('smartfarm/lan_telemetry');
+
+  static bool get isSupported =>
+      !kIsWeb && defaultTargetPlatform == TargetPlatform.linux;
+
+  static Stream<LanTelemetryFrame> frames({int? port}) {
+    if (!isSupported) return const Stream.empty();
+    return _channel
+        .receiveBroadcastStream(port == null ? null : {'port': port})
+        .map((event) => LanTelemetryFrame.fromMap(event as Map));
+  }
+}
+
+class LanZoneReading {
+  final int zona;
+  final double kelembabanTanah;
+  final double kecerahan;
+  final bool pompa;
+  final bool manual;
+  final int pompaSisaDetik;
+
+  LanZoneReading({
+    required this.zona,
+    required this.kelembabanTanah,
+    required this.kecerahan,
+    required this.pompa,
+    required this.manual,
+    required this.pompaSisaDetik,
+  });
+
+  factory LanZoneReading.fromMap(Map value) {
+    return LanZoneReading(
+      zona: value['zona'] ?? 0,
+      kelembabanTanah: (value['kelembaban_tanah'] ?? double.nan).toDouble(),
+      kecerahan: (value['kecerahan'] ?? double.nan).toDouble(),
+      pompa: value['pompa'] == true,
+      manual: value['manual'] == true,
+      pompaSisaDetik: value['pompa_sisa_s'] ?? 0,
+    );
+  }
+}
+
+class LanTelemetryFrame {
+  final String device;
+  final int seq;
+  final bool restart;
+  final int timestamp;
+  final int receivedAt;
+  final bool online;
+  final double suhu;  // NaN jika DHT22 tidak terbaca
+  final double kelembabanUdara;
+  final List<LanZoneReading> zones;
+
+  // Hitungan per perangkat sejak mulai mendengarkan.
+  final int received;
+  final int lost;
+  final int late;
+
+  LanTelemetryFrame({
+    required this.device,
+    required this.seq,
+    required this.restart,
+    required this.timestamp,
+    required this.receivedAt,
+    required this.online,
+    required this.suhu,
+    required this.kelembabanUdara,
+    required this.zones,
+    required this.received,
+    required this.lost,
+    required this.late,
+  });
+
+  /// Bagian frame yang hilang di jalan, 0..1.
+  double get lossRatio =>
+      received + lost == 0 ? 0 : lost / (received + lost);
+
+  /// Umur data saat diterima; hanya bermakna jika jam ESP32 (NTP) dan PC
+  /// sinkron.
+  int get latencyMs => receivedAt - timestamp;
+
+  factory LanTelemetryFrame.fromMap(Map value) {
+    final stats = (value['stats'] as Map?) ?? const {};
+    return LanTelemetryFrame(
+      device: value['device']?.toString() ?? '',
+      seq: value['seq'] ?? 0,
+      restart: value['restart'] == true,
+      timestamp: value['timestamp'] ?? 0,
+      receivedAt: value['received_at'] ?? 0,
+      online: value['online'] == true,
+      suhu: (value['suhu'] ?? double.nan).toDouble(),
+      kelembabanUdara: (value['kelembaban_udara'] ?? double.nan).toDouble(),
+      zones: ((value['zones'] as List?) ?? const [])
+          .map((zone) => LanZoneReading.fromMap(zone as Map))
+          .toList(),
+      received: stats['received'] ?? 0,
+      lost: stats['lost'] ?? 0,
+      late: stats['late'] ?? 0,
+    );
+  }
+}
@@ -0,0 +1,20 @@
+import 'dart:ffi';
+import 'dart:io';
+
+import 'package:flutter/foundation.dart';
+
+/// Membuka pustaka native dari linux/native yang dipasang di lib/ di samping
+/// executable (linux/CMakeLists.txt). Null di luar desktop Linux atau bila
+/// pustaka tidak bisa dimuat; pemanggil lalu memakai implementasi Dart.
+/// Hanya boleh diimpor dari berkas *_native.dart di balik impor kondisional,
+/// karena dart:ffi dan dart:io tidak tersedia di web.
+DynamicLibrary? openBundledLibrary(String name) {
+  if (kIsWeb || defaultTargetPlatform != TargetPlatform.linux) return null;
+  try {
+    final dir = File(Platform.resolvedExecutable).parent.path;
+    return DynamicLibrary.open('$dir/lib/$name');
+  } catch (e) {
+    print('⚠️ $name tidak dimuat, memakai Dart: $e');
+    return null;
+  }
+}
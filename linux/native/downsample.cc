@@ -0,0 +1,238 @@
+#include "downsample.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "simd.h"
+
+namespace smartfarm {
+
+namespace {
+
+using simd::Abs;
+using simd::Float4;
+using simd::Int4;
+using simd::Load4;
+using simd::Select;
+using simd::Splat;
+
+// Both kernels below keep four partial results and combine them the same
+// way, so the scalar kernel reproduces the vector one bit for bit; only the
+// speed differs.
+
+// Sums of xs and y over [begin, end).
+void SumRange(const float* xs, const float* y, size_t begin, size_t end, DownsampleKernel kernel,
+              float* sum_x, float* sum_y) {
+  float lanes_x[4] = {0, 0, 0, 0};
+  float lanes_y[4] = {0, 0, 0, 0};
+  size_t i = begin;
+  if (kernel == DownsampleKernel::kVector) {
+    Float4 acc_x = Splat(0.0f), acc_y = Splat(0.0f);
+    for (; i + 4 <= end; i += 4) {
+      acc_x += Load4(xs + i);
+      acc_y += Load4(y + i);
+    }
+    memcpy(lanes_x, &acc_x, sizeof(lanes_x));
+    memcpy(lanes_y, &acc_y, sizeof(lanes_y));
+  } else {
+    for (; i + 4 <= end; i += 4) {
+      for (int lane = 0; lane < 4; lane++) {
+        lanes_x[lane] += xs[i + lane];
+        lanes_y[lane] += y[i + lane];
+      }
+    }
+  }
+  float sx = (lanes_x[0] + lanes_x[1]) + (lanes_x[2] + lanes_x[3]);
+  float sy = (lanes_y[0] + lanes_y[1]) + (lanes_y[2] + lanes_y[3]);
+  for (; i < end; i++) {
+    sx += xs[i];
+    sy += y[i];
+  }
+  *sum_x = sx;
+  *sum_y = sy;
+}
+
+// Index in [begin, end) maximising |p * y + q * x + r|, the doubled area of
+// the triangle (a, point, c) written as a linear function of the point.
+// Ties go to the lowest index.
+size_t MaxArea(const float* xs, const float* y, size_t begin, size_t end, float p, float q,
+               float r, DownsampleKernel kernel) {
+  float best[4] = {-1, -1, -1, -1};
+  int32_t best_index[4] = {0, 0, 0, 0};
+  size_t i = begin;
+  if (kernel == DownsampleKernel::kVector) {
+    const Float4 vp = Splat(p), vq = Splat(q), vr = Splat(r);
+    Float4 vbest = Splat(-1.0f);
+    Int4 vindex = Int4{0, 1, 2, 3} + (int32_t)begin;
+    Int4 vbest_index = vindex;
+    const Int4 step = Int4{4, 4, 4, 4};
+    for (; i + 4 <= end; i += 4) {
+      Float4 area = Abs(vp * Load4(y + i) + vq * Load4(xs + i) + vr);
+      Int4 better = area > vbest;
+      vbest = Select(better, area, vbest);
+      vbest_index = Select(better, vindex, vbest_index);
+      vindex += step;
+    }
+    memcpy(best, &vbest, sizeof(best));
+    memcpy(best_index, &vbest_index, sizeof(best_index));
+  } else {
+    for (; i + 4 <= end; i += 4) {
+      for (int lane = 0; lane < 4; lane++) {
+        float area = p * y[i + lane] + q * xs[i + lane] + r;
+        area = area < 0 ? -area : area;
+        if (area > best[lane]) {
+          best[lane] = area;
+          best_index[lane] = (int32_t)(i + lane);
+        }
+      }
+    }
+  }
+
+  float top = best[0];
+  size_t top_index = i > begin ? (size_t)best_index[0] : begin;
+  for (int lane = 1; lane < 4 && i > begin; lane++) {
+    if (best[lane] > top || (best[lane] == top && (size_t)best_index[lane] < top_index)) {
+      top = best[lane];
+      top_index = (size_t)best_index[lane];
+    }
+  }
+  for (; i < end; i++) {
+    float area = p * y[i] + q * xs[i] + r;
+    area = area < 0 ? -area : area;
+    if (area > top) {
+      top = area;
+      top_index = i;
+    }
+  }
+  return top_index;
+}
+
+// Lowest and highest sample in [begin, end); ties go to the lowest index.
+void MinMaxRange(const float* y, size_t begin, size_t end, DownsampleKernel kernel,
+                 size_t* min_index, size_t* max_index) {
+  size_t lo = begin, hi = begin;
+  size_t i = begin;
+  if (kernel == DownsampleKernel::kVector && end - begin >= 4) {
+    Float4 vmin = Load4(y + begin), vmax = vmin;
+    Int4 vindex = Int4{0, 1, 2, 3} + (int32_t)begin;
+    Int4 vmin_index = vindex, vmax_index = vindex;
+    const Int4 step = Int4{4, 4, 4, 4};
+    for (i = begin + 4; i + 4 <= end; i += 4) {
+      Float4 v = Load4(y + i);
+      vindex += step;
+      Int4 lower = v < vmin;
+      Int4 higher = v > vmax;
+      vmin = Select(lower, v, vmin);
+      vmin_index = Select(lower, vindex, vmin_index);
+      vmax = Select(higher, v, vmax);
+      vmax_index = Select(higher, vindex, vmax_index);
+    }
+    float mins[4], maxs[4];
+    int32_t min_indices[4], max_indices[4];
+    memcpy(mins, &vmin, sizeof(mins));
+    memcpy(maxs, &vmax, sizeof(maxs));
+    memcpy(min_indices, &vmin_index, sizeof(min_indices));
+    memcpy(max_indices, &vmax_index, sizeof(max_indices));
+    lo = (size_t)min_indices[0];
+    hi = (size_t)max_indices[0];
+    for (int lane = 1; lane < 4; lane++) {
+      size_t at = (size_t)min_indices[lane];
+      if (mins[lane] < y[lo] || (mins[lane] == y[lo] && at < lo)) lo = at;
+      at = (size_t)max_indices[lane];
+      if (maxs[lane] > y[hi] || (maxs[lane] == y[hi] && at < hi)) hi = at;
+    }
+  }
+  for (; i < end; i++) {
+    if (y[i] < y[lo]) lo = i;
+    if (y[i] > y[hi]) hi = i;
+  }
+  *min_index = lo;
+  *max_index = hi;
+}
+
+size_t AllIndices(size_t n, uint32_t* out) {
+  for (size_t i = 0; i < n; i++) out[i] = (uint32_t)i;
+  return n;
+}
+
+}  // namespace
+
+size_t Lttb(const int64_t* x, const float* y, size_t n, size_t threshold, uint32_t* out,
+            DownsampleKernel kernel) {
+  if (threshold < 3 || threshold >= n) return AllIndices(n, out);
+
+  // Time relative to the first sample. As float this keeps ~1 s resolution
+  // over a year, far finer than one pixel.
+  std::vector<float> xs(n);
+  for (size_t i = 0; i < n; i++) xs[i] = (float)(x[i] - x[0]);
+
+  const double every = (double)(n - 2) / (double)(threshold - 2);
+  size_t count = 0;
+  size_t a = 0;
+  out[count++] = 0;
+  for (size_t bucket = 0; bucket < threshold - 2; bucket++) {
+    size_t begin = 1 + (size_t)(bucket * every);
+    bool last = bucket == threshold - 3;
+    size_t end = last ? n - 1 : 1 + (size_t)((bucket + 1) * every);
+    size_t next_end = last ? n : 1 + (size_t)((bucket + 2) * every);
+    if (next_end > n - 1 && !last) next_end = n - 1;
+
+    // Third corner: the average of the next bucket, which for the final
+    // bucket is just the last sample.
+    float sum_x, sum_y;
+    SumRange(xs.data(), y, end, next_end, kernel, &sum_x, &sum_y);
+    const float cx = sum_x / (float)(next_end - end);
+    const float cy = sum_y / (float)(next_end - end);
+
+    // 2 * area(a, b, c) = |(ax - cx) * (by - ay) - (ax - bx) * (cy - ay)|
+    //                   = |p * by + q * bx + r|
+    const float ax = xs[a], ay = y[a];
+    const float p = ax - cx;
+    const float q = cy - ay;
+    const float r = -p * ay - ax * q;
+    a = MaxArea(xs.data(), y, begin, end, p, q, r, kernel);
+    out[count++] = (uint32_t)a;
+  }
+  out[count++] = (uint32_t)(n - 1);
+  return count;
+}
+
+size_t MinMax(const float* y, size_t n, size_t buckets, uint32_t* out, DownsampleKernel kernel) {
+  if (buckets == 0 || 2 * buckets >= n) return AllIndices(n, out);
+
+  size_t count = 0;
+  for (size_t bucket = 0; bucket < buckets; bucket++) {
+    size_t begin = (size_t)((uint64_t)bucket * n / buckets);
+    size_t end = (size_t)((uint64_t)(bucket + 1) * n / buckets);
+    size_t lo, hi;
+    MinMaxRange(y, begin, end, kernel, &lo, &hi);
+    if (lo == hi) {
+      out[count++] = (uint32_t)lo;
+    } else {
+      out[count++] = (uint32_t)(lo < hi ? lo : hi);
+      out[count++] = (uint32_t)(lo < hi ? hi : lo);
+    }
+  }
+  return count;
+}
+
+}  // namespace smartfarm
+
+extern "C" {
+
+void* smartfarm_chart_alloc(size_t bytes) { return malloc(bytes); }
+
+void smartfarm_chart_free(void* buffer) { free(buffer); }
+
+size_t smartfarm_lttb(const int64_t* x, const float* y, size_t n, size_t threshold,
+                      uint32_t* out) {
+  return smartfarm::Lttb(x, y, n, threshold, out);
+}
+
+size_t smartfarm_minmax(const float* y, size_t n, size_t buckets, uint32_t* out) {
+  return smartfarm::MinMax(y, n, buckets, out);
+}
+
+}  // extern "C"
@@ -0,0 +1,66 @@
+#ifndef SMARTFARM_NATIVE_DOWNSAMPLE_H_
+#define SMARTFARM_NATIVE_DOWNSAMPLE_H_
+
+// Reduces a sensor series to roughly one point per on-screen pixel before it
+// reaches the chart. At the firmware's 5 s interval six months of one sensor
+// is ~3M samples; fl_chart draws a few thousand comfortably.
+//
+// Two reducers, both returning indices into the input (ascending), so the
+// caller keeps its own timestamps and values:
+//   LTTB   Largest-Triangle-Three-Buckets: one point per bucket, chosen to
+//          keep the visual shape of the line. Good default for line charts.
+//   MinMax the lowest and highest sample of each bucket, so spikes (a pump
+//          run, a sensor glitch) survive at any zoom level.
+// Buckets split the samples by index, as in the LTTB paper, so irregular
+// sampling shifts the buckets but never drops the first or last sample.
+// Lane indices are int32, so a series holds fewer than 2^31 samples.
+//
+// The hot loops run four lanes at a time with GCC/Clang vector extensions,
+// which lower to SSE2 on x86-64 and NEON on arm64 without any -m flags.
+//
+// The C functions at the bottom are the FFI surface for Dart
+// (lib/services/chart_downsample.dart); the library is built as
+// libsmartfarm_chart.so and bundled next to the runner.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+namespace smartfarm {
+
+enum class DownsampleKernel {
+  kVector,  // default
+  kScalar,  // same arithmetic one lane at a time; for tests and benchmarks
+};
+
+// x: timestamps (ms), y: values, n samples with x ascending. Writes at most
+// `threshold` indices to out and returns how many. threshold < 3 or >= n
+// returns every index.
+size_t Lttb(const int64_t* x, const float* y, size_t n, size_t threshold, uint32_t* out,
+            DownsampleKernel kernel = DownsampleKernel::kVector);
+
+// Writes at most 2 * buckets indices (min and max of each bucket, in index
+// order, once if they coincide) and returns how many. buckets == 0 or
+// 2 * buckets >= n returns every index.
+size_t MinMax(const float* y, size_t n, size_t buckets, uint32_t* out,
+              DownsampleKernel kernel = DownsampleKernel::kVector);
+
+}  // namespace smartfarm
+
+extern "C" {
+#endif
+
+// Native buffers for Dart to fill through Pointer.asTypedList, so a series
+// is copied into native memory once rather than per call.
+void* smartfarm_chart_alloc(size_t bytes);
+void smartfarm_chart_free(void* buffer);
+
+size_t smartfarm_lttb(const int64_t* x, const float* y, size_t n, size_t threshold,
+                      uint32_t* out);
+size_t smartfarm_minmax(const float* y, size_t n, size_t buckets, uint32_t* out);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // SMARTFARM_NATIVE_DOWNSAMPLE_H_
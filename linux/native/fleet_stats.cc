@@ -0,0 +1,357 @@
+#include "fleet_stats.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "simd.h"
+
+namespace smartfarm {
+
+namespace {
+
+using simd::Float4;
+using simd::Int4;
+using simd::Int64x2;
+using simd::Load2;
+using simd::Load4;
+using simd::Select;
+using simd::Splat;
+using simd::Splat2;
+using simd::UInt4;
+using simd::WidenHigh;
+using simd::WidenLow;
+
+// Lanes sum in float within a block and blocks sum in double, so a year of
+// samples keeps its mean to well under the sensors' resolution. A multiple of
+// four, so only the last block of a range has a scalar tail.
+constexpr size_t kBlock = 4096;
+
+struct Moments {
+  uint64_t count = 0;
+  double sum = 0;
+  float min = INFINITY;
+  float max = -INFINITY;
+};
+
+// Count, sum and extrema of the non-NaN samples in [begin, end). As in
+// downsample.cc, the scalar kernel keeps four lanes and combines them the
+// same way, so both kernels agree bit for bit.
+Moments Accumulate(const float* y, size_t begin, size_t end, StatsKernel kernel) {
+  Moments m;
+  for (size_t block = begin; block < end; block += kBlock) {
+    const size_t block_end = std::min(block + kBlock, end);
+    float sums[4] = {0, 0, 0, 0};
+    float mins[4] = {INFINITY, INFINITY, INFINITY, INFINITY};
+    float maxs[4] = {-INFINITY, -INFINITY, -INFINITY, -INFINITY};
+    int32_t counts[4] = {0, 0, 0, 0};
+    size_t i = block;
+    if (kernel == StatsKernel::kVector) {
+      Float4 vsum = Splat(0.0f), vmin = Splat(INFINITY), vmax = Splat(-INFINITY);
+      Int4 vcount = Int4{0, 0, 0, 0};
+      for (; i + 4 <= block_end; i += 4) {
+        Float4 v = Load4(y + i);
+        Int4 valid = v == v;  // false for NaN
+        vsum += Select(valid, v, Splat(0.0f));
+        vcount -= valid;
+        vmin = Select(v < vmin, v, vmin);
+        vmax = Select(v > vmax, v, vmax);
+      }
+      memcpy(sums, &vsum, sizeof(sums));
+      memcpy(mins, &vmin, sizeof(mins));
+      memcpy(maxs, &vmax, sizeof(maxs));
+      memcpy(counts, &vcount, sizeof(counts));
+    } else {
+      for (; i + 4 <= block_end; i += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+          float v = y[i + lane];
+          if (isnan(v)) continue;
+          sums[lane] += v;
+          counts[lane]++;
+          if (v < mins[lane]) mins[lane] = v;
+          if (v > maxs[lane]) maxs[lane] = v;
+        }
+      }
+    }
+
+    float sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    uint64_t count = (uint64_t)counts[0] + counts[1] + counts[2] + counts[3];
+    for (int lane = 0; lane < 4; lane++) {
+      m.min = std::min(m.min, mins[lane]);
+      m.max = std::max(m.max, maxs[lane]);
+    }
+    for (; i < block_end; i++) {
+      if (isnan(y[i])) continue;
+      sum += y[i];
+      count++;
+      m.min = std::min(m.min, y[i]);
+      m.max = std::max(m.max, y[i]);
+    }
+    m.sum += sum;
+    m.count += count;
+  }
+  return m;
+}
+
+// Nearest rank: the smallest sample with at least `per_mille` of the samples
+// at or below it.
+size_t Rank(size_t count, size_t per_mille) {
+  size_t rank = (count * per_mille + 999) / 1000;
+  return rank > 0 ? rank - 1 : 0;
+}
+
+// Percentiles by radix select: a histogram of the top 16 bits of each
+// sample's order-preserving key finds the bucket holding each rank, and only
+// that bucket (about 0.1 degC wide for greenhouse readings) is copied and
+// partitioned. Two streaming passes instead of nth_element over a copy of
+// the whole series, and the fleet histogram is the sum of the devices'.
+constexpr size_t kRadixBuckets = 1 << 16;
+
+struct Scratch {
+  std::vector<uint32_t> histogram;
+  std::vector<float> bucket[3];  // values in the p50 / p90 / p99 bucket
+};
+
+// Maps a float's bits to an unsigned key with the same order.
+inline uint32_t Key(float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+void FillHistogram(const float* y, size_t begin, size_t end, std::vector<uint32_t>* histogram) {
+  histogram->assign(kRadixBuckets, 0);
+  uint32_t* counts = histogram->data();
+  for (size_t i = begin; i < end; i++) {
+    if (!isnan(y[i])) counts[Key(y[i]) >> 16]++;
+  }
+}
+
+// Expects `histogram` to hold the samples of [begin, end).
+SmartfarmSummary Finish(const Moments& m, const float* y, size_t begin, size_t end,
+                        const std::vector<uint32_t>& histogram, StatsKernel kernel,
+                        Scratch* scratch) {
+  SmartfarmSummary summary;
+  memset(&summary, 0, sizeof(summary));
+  if (m.count == 0) return summary;
+  summary.count = m.count;
+  summary.mean = m.sum / (double)m.count;
+  summary.min = m.min;
+  summary.max = m.max;
+
+  // Locate the bucket of each rank, then copy those (at most three) buckets
+  // in one more pass.
+  const size_t ranks[3] = {Rank(m.count, 500), Rank(m.count, 900), Rank(m.count, 990)};
+  uint32_t buckets[3];
+  size_t offsets[3];  // rank within the bucket
+  size_t below = 0, bucket = 0;
+  for (int p = 0; p < 3; p++) {
+    while (below + histogram[bucket] <= ranks[p]) below += histogram[bucket++];
+    buckets[p] = (uint32_t)bucket;
+    offsets[p] = ranks[p] - below;
+  }
+  for (int p = 0; p < 3; p++) scratch->bucket[p].clear();
+  auto gather = [&](size_t i) {
+    if (isnan(y[i])) return;
+    const uint32_t b = Key(y[i]) >> 16;
+    for (int p = 0; p < 3; p++) {
+      if (b == buckets[p]) {
+        scratch->bucket[p].push_back(y[i]);
+        return;  // equal buckets share the first copy
+      }
+    }
+  };
+  size_t i = begin;
+  if (kernel == StatsKernel::kVector) {
+    // Most blocks hold none of the three buckets and are skipped whole.
+    const UInt4 sign = UInt4{0x80000000u, 0x80000000u, 0x80000000u, 0x80000000u};
+    for (; i + 4 <= end; i += 4) {
+      UInt4 bits = (UInt4)Load4(y + i);
+      UInt4 top = (bits ^ ((UInt4)((Int4)bits >> 31) | sign)) >> 16;
+      Int4 hit = (top == buckets[0]) | (top == buckets[1]) | (top == buckets[2]);
+      if ((hit[0] | hit[1] | hit[2] | hit[3]) == 0) continue;
+      for (int lane = 0; lane < 4; lane++) gather(i + lane);
+    }
+  }
+  for (; i < end; i++) gather(i);
+
+  float* values[3] = {&summary.p50, &summary.p90, &summary.p99};
+  for (int p = 0; p < 3; p++) {
+    int owner = p;
+    while (owner > 0 && buckets[owner - 1] == buckets[p]) owner--;
+    std::vector<float>& in = scratch->bucket[owner];
+    std::nth_element(in.begin(), in.begin() + offsets[p], in.end());
+    *values[p] = in[offsets[p]];
+  }
+  return summary;
+}
+
+struct Recent {
+  int64_t t;
+  uint32_t index;
+};
+
+// Heap order: "less" is newer, so the heap front is the oldest row kept.
+bool Newer(const Recent& a, const Recent& b) {
+  return a.t > b.t || (a.t == b.t && a.index < b.index);
+}
+
+}  // namespace
+
+SmartfarmSummary Summarize(const float* y, size_t n, StatsKernel kernel) {
+  Scratch scratch;
+  FillHistogram(y, 0, n, &scratch.histogram);
+  return Finish(Accumulate(y, 0, n, kernel), y, 0, n, scratch.histogram, kernel,
+                &scratch);
+}
+
+void SummarizeGroups(const float* y, const uint64_t* offsets, size_t groups,
+                     SmartfarmSummary* out, StatsKernel kernel) {
+  const size_t begin = groups > 0 ? (size_t)offsets[0] : 0;
+  const size_t end = groups > 0 ? (size_t)offsets[groups] : 0;
+  Scratch scratch;
+  std::vector<uint32_t> fleet_histogram(kRadixBuckets, 0);
+  Moments fleet;
+  for (size_t g = 0; g < groups; g++) {
+    const size_t first = (size_t)offsets[g], last = (size_t)offsets[g + 1];
+    Moments m = Accumulate(y, first, last, kernel);
+    FillHistogram(y, first, last, &scratch.histogram);
+    out[g] = Finish(m, y, first, last, scratch.histogram, kernel, &scratch);
+    for (size_t b = 0; b < kRadixBuckets; b++) fleet_histogram[b] += scratch.histogram[b];
+    fleet.count += m.count;
+    fleet.sum += m.sum;
+    fleet.min = std::min(fleet.min, m.min);
+    fleet.max = std::max(fleet.max, m.max);
+  }
+  out[groups] = Finish(fleet, y, begin, end, fleet_histogram, kernel, &scratch);
+}
+
+SmartfarmExceedance Exceedance(const int64_t* t, const float* y, size_t n, float low, float high,
+                               int64_t max_gap_ms, StatsKernel kernel) {
+  SmartfarmExceedance result;
+  memset(&result, 0, sizeof(result));
+  if (n == 0) return result;
+
+  // Row i: how long it lasts and which runs it starts. Integer arithmetic,
+  // so the lane order cannot change the totals.
+  auto row = [&](size_t i) {
+    int64_t dt = i + 1 < n ? t[i + 1] - t[i] : 0;
+    dt = std::max<int64_t>(0, std::min(dt, max_gap_ms));
+    const bool above = y[i] > high, below = y[i] < low;
+    if (above) {
+      result.above_ms += dt;
+      if (i == 0 || !(y[i - 1] > high)) result.above_runs++;
+    }
+    if (below) {
+      result.below_ms += dt;
+      if (i == 0 || !(y[i - 1] < low)) result.below_runs++;
+    }
+  };
+
+  row(0);
+  size_t i = 1;
+  if (kernel == StatsKernel::kVector) {
+    const Float4 vhigh = Splat(high), vlow = Splat(low);
+    const Int64x2 gap = Splat2(max_gap_ms), zero = Splat2(0);
+    Int64x2 above_ms = zero, below_ms = zero;
+    Int4 above_runs = Int4{0, 0, 0, 0}, below_runs = above_runs;
+    auto clamp = [&](Int64x2 dt) {
+      dt = Select(dt > gap, gap, dt);
+      return Select(dt < zero, zero, dt);
+    };
+    // t[i + 4] must exist for the last lane's duration.
+    for (; i + 4 < n; i += 4) {
+      Float4 v = Load4(y + i), prev = Load4(y + i - 1);
+      Int4 above = v > vhigh, below = v < vlow;
+      above_runs -= above & ~(prev > vhigh);
+      below_runs -= below & ~(prev < vlow);
+      Int64x2 dt_low = clamp(Load2(t + i + 1) - Load2(t + i));
+      Int64x2 dt_high = clamp(Load2(t + i + 3) - Load2(t + i + 2));
+      above_ms += (dt_low & WidenLow(above)) + (dt_high & WidenHigh(above));
+      below_ms += (dt_low & WidenLow(below)) + (dt_high & WidenHigh(below));
+    }
+    result.above_ms += above_ms[0] + above_ms[1];
+    result.below_ms += below_ms[0] + below_ms[1];
+    for (int lane = 0; lane < 4; lane++) {
+      result.above_runs += (uint32_t)above_runs[lane];
+      result.below_runs += (uint32_t)below_runs[lane];
+    }
+  }
+  for (; i < n; i++) row(i);
+  return result;
+}
+
+size_t TopRecent(const int64_t* t, size_t n, size_t k, uint32_t* out, StatsKernel kernel) {
+  k = std::min(k, n);
+  if (k == 0) return 0;
+
+  // Scan newest-index first: RTDB push keys, and so most snapshots, arrive
+  // in time order, which makes the first k rows the answer and lets the
+  // prefilter skip nearly every block after them. Walking backwards, a row
+  // with the same timestamp as the oldest kept one has a lower index and so
+  // ranks above it, hence >= rather than >.
+  std::vector<Recent> heap;
+  heap.reserve(k);
+  size_t i = n;
+  while (heap.size() < k) {
+    i--;
+    heap.push_back(Recent{t[i], (uint32_t)i});
+  }
+  std::make_heap(heap.begin(), heap.end(), Newer);
+  int64_t oldest = heap.front().t;
+
+  auto offer = [&](size_t at) {
+    if (t[at] < oldest) return;
+    std::pop_heap(heap.begin(), heap.end(), Newer);
+    heap.back() = Recent{t[at], (uint32_t)at};
+    std::push_heap(heap.begin(), heap.end(), Newer);
+    oldest = heap.front().t;
+  };
+
+  if (kernel == StatsKernel::kVector) {
+    while (i >= 4) {
+      const Int64x2 limit = Splat2(oldest);
+      Int64x2 newer = (Load2(t + i - 4) >= limit) | (Load2(t + i - 2) >= limit);
+      if ((newer[0] | newer[1]) != 0) {
+        for (size_t at = i; at-- > i - 4;) offer(at);
+      }
+      i -= 4;
+    }
+  }
+  while (i > 0) offer(--i);
+
+  std::sort_heap(heap.begin(), heap.end(), Newer);
+  for (size_t r = 0; r < k; r++) out[r] = heap[r].index;
+  return k;
+}
+
+}  // namespace smartfarm
+
+extern "C" {
+
+void* smartfarm_stats_alloc(size_t bytes) { return malloc(bytes); }
+
+void smartfarm_stats_free(void* buffer) { free(buffer); }
+
+void smartfarm_summarize(const float* y, size_t n, SmartfarmSummary* out) {
+  *out = smartfarm::Summarize(y, n);
+}
+
+void smartfarm_summarize_groups(const float* y, const uint64_t* offsets, size_t groups,
+                                SmartfarmSummary* out) {
+  smartfarm::SummarizeGroups(y, offsets, groups, out);
+}
+
+void smartfarm_exceedance(const int64_t* t, const float* y, size_t n, float low, float high,
+                          int64_t max_gap_ms, SmartfarmExceedance* out) {
+  *out = smartfarm::Exceedance(t, y, n, low, high, max_gap_ms);
+}
+
+size_t smartfarm_top_recent(const int64_t* t, size_t n, size_t k, uint32_t* out) {
+  return smartfarm::TopRecent(t, n, k, out);
+}
+
+}  // extern "C"
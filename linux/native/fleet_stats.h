@@ -0,0 +1,103 @@
+#ifndef SMARTFARM_NATIVE_FLEET_STATS_H_
+#define SMARTFARM_NATIVE_FLEET_STATS_H_
+
+// Aggregates for the admin dashboard over columnar sample arrays, so a fleet
+// of devices with months of history is summarised without building a Dart
+// map per row:
+//   Summarize        count / mean / min / max / p50 / p90 / p99 of one series
+//   SummarizeGroups  the same per device plus fleet-wide, with the devices
+//                    laid out back to back (CSR offsets)
+//   Exceedance       time spent above / below a band and how often it left
+//   TopRecent        indices of the k newest rows, newest first, without
+//                    sorting the rest (the alert list keeps ten of a week)
+// NaN samples (a failed sensor read) are skipped by every aggregate.
+//
+// Sums, extrema, exceedance and the top-k prefilter run four lanes at a time
+// (simd.h). Percentiles are a radix select: a 16-bit histogram of each
+// sample's order-preserving key finds the bucket holding each rank, then
+// nth_element runs only on the samples copied out of those (at most three)
+// buckets. Two streaming passes, no copy of the whole series, and the
+// fleet-wide histogram is the sum of the devices'. As in downsample.h, a
+// scalar kernel with the same arithmetic is kept for tests and benchmarks.
+//
+// The C functions at the bottom are the FFI surface for Dart
+// (lib/services/fleet_stats.dart); the library is built as
+// libsmartfarm_stats.so and bundled next to the runner.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Mirrored by _Summary in fleet_stats.dart; keep the field order.
+typedef struct {
+  uint64_t count;  // samples that are not NaN; every other field is 0 when 0
+  double mean;
+  float min;
+  float max;
+  float p50;  // nearest-rank percentiles
+  float p90;
+  float p99;
+  float reserved;
+} SmartfarmSummary;
+
+// Mirrored by _Exceedance in fleet_stats.dart.
+typedef struct {
+  int64_t above_ms;  // time with the value above `high`
+  int64_t below_ms;  // time with the value below `low`
+  uint32_t above_runs;  // times it went above `high`
+  uint32_t below_runs;
+} SmartfarmExceedance;
+
+#ifdef __cplusplus
+}  // extern "C"
+
+namespace smartfarm {
+
+enum class StatsKernel {
+  kVector,  // default
+  kScalar,  // same arithmetic one lane at a time; for tests and benchmarks
+};
+
+SmartfarmSummary Summarize(const float* y, size_t n, StatsKernel kernel = StatsKernel::kVector);
+
+// Device g owns rows [offsets[g], offsets[g + 1]). Writes groups + 1
+// summaries: one per device, then the whole fleet.
+void SummarizeGroups(const float* y, const uint64_t* offsets, size_t groups,
+                     SmartfarmSummary* out, StatsKernel kernel = StatsKernel::kVector);
+
+// t: timestamps (ms, ascending), y: values. Sample i holds its state until
+// sample i + 1, but for at most max_gap_ms: a longer gap means the device was
+// offline and is not counted in full. A run is entered when a sample is out
+// of the band and the previous one was not.
+SmartfarmExceedance Exceedance(const int64_t* t, const float* y, size_t n, float low, float high,
+                               int64_t max_gap_ms, StatsKernel kernel = StatsKernel::kVector);
+
+// Writes the indices of the min(k, n) largest timestamps to out, newest
+// first; equal timestamps keep input order. Returns how many.
+size_t TopRecent(const int64_t* t, size_t n, size_t k, uint32_t* out,
+                 StatsKernel kernel = StatsKernel::kVector);
+
+}  // namespace smartfarm
+
+extern "C" {
+#endif
+
+// Native buffers for Dart to fill through Pointer.asTypedList.
+void* smartfarm_stats_alloc(size_t bytes);
+void smartfarm_stats_free(void* buffer);
+
+void smartfarm_summarize(const float* y, size_t n, SmartfarmSummary* out);
+void smartfarm_summarize_groups(const float* y, const uint64_t* offsets, size_t groups,
+                                SmartfarmSummary* out);
+void smartfarm_exceedance(const int64_t* t, const float* y, size_t n, float low, float high,
+                          int64_t max_gap_ms, SmartfarmExceedance* out);
+size_t smartfarm_top_recent(const int64_t* t, size_t n, size_t k, uint32_t* out);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // SMARTFARM_NATIVE_FLEET_STATS_H_
@@ -0,0 +1,289 @@
+#include "history_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace smartfarm {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'F', 'H', 'I', 'S', 'T', '1', '\0'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderBytes = 4096;
+constexpr size_t kRowBytes = sizeof(int64_t) + 4 * sizeof(float) + sizeof(uint16_t) + 1;
+// 4096 rows * 27 bytes is a whole number of pages.
+constexpr size_t kSegmentBytes = HistoryCache::kSegmentRows * kRowBytes;
+
+// Column offsets inside a segment.
+constexpr size_t kTimestampOffset = 0;
+constexpr size_t kTemperatureOffset = kTimestampOffset + HistoryCache::kSegmentRows * 8;
+constexpr size_t kHumidityOffset = kTemperatureOffset + HistoryCache::kSegmentRows * 4;
+constexpr size_t kSoilOffset = kHumidityOffset + HistoryCache::kSegmentRows * 4;
+constexpr size_t kBrightnessOffset = kSoilOffset + HistoryCache::kSegmentRows * 4;
+constexpr size_t kPlantAgeOffset = kBrightnessOffset + HistoryCache::kSegmentRows * 4;
+constexpr size_t kFlagsOffset = kPlantAgeOffset + HistoryCache::kSegmentRows * 2;
+
+template <typename T>
+T* Column(uint8_t* segment, size_t offset) {
+  return reinterpret_cast<T*>(segment + offset);
+}
+
+// Copies rows [first, first + count) of one column out of a segment.
+template <typename T>
+void CopyColumn(uint8_t* segment, size_t offset, uint32_t first, uint32_t count, T* out) {
+  memcpy(out, Column<T>(segment, offset) + first, count * sizeof(T));
+}
+
+}  // namespace
+
+struct HistoryCache::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t segment_rows;
+  uint64_t rows;
+  uint64_t capacity;  // rows the file has room for
+  int64_t first_timestamp;
+  int64_t last_timestamp;
+  uint32_t last_key_length;
+  char last_key[kMaxKeyLength + 1];
+};
+
+constexpr uint32_t HistoryCache::kSegmentRows;
+constexpr size_t HistoryCache::kMaxKeyLength;
+
+void HistoryColumns::Resize(size_t rows) {
+  timestamp.resize(rows);
+  temperature.resize(rows);
+  humidity.resize(rows);
+  soil.resize(rows);
+  brightness.resize(rows);
+  plant_age.resize(rows);
+  flags.resize(rows);
+}
+
+HistoryCache::~HistoryCache() { Close(); }
+
+bool HistoryCache::Open(const std::string& path, std::string* error) {
+  Close();
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    *error = "open " + path + ": " + strerror(errno);
+    return false;
+  }
+  if (flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+    *error = path + " is in use by another instance";
+    Close();
+    return false;
+  }
+
+  struct stat info;
+  fstat(fd_, &info);
+  bool fresh = info.st_size == 0;
+  if (fresh && ftruncate(fd_, kHeaderBytes) != 0) {
+    *error = std::string("ftruncate: ") + strerror(errno);
+    Close();
+    return false;
+  }
+  size_t bytes = fresh ? kHeaderBytes : (size_t)info.st_size;
+  if (!Map(bytes, error)) {
+    Close();
+    return false;
+  }
+
+  Header* h = header();
+  if (fresh) {
+    memcpy(h->magic, kMagic, sizeof(kMagic));
+    h->version = kVersion;
+    h->segment_rows = kSegmentRows;
+  } else if (memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion ||
+             h->segment_rows != kSegmentRows ||
+             kHeaderBytes + (h->capacity / kSegmentRows) * kSegmentBytes > bytes ||
+             h->rows > h->capacity) {
+    // Not ours or from another layout: start over rather than misread it.
+    munmap(base_, mapped_bytes_);
+    base_ = nullptr;
+    if (ftruncate(fd_, 0) != 0 || ftruncate(fd_, kHeaderBytes) != 0 ||
+        !Map(kHeaderBytes, error)) {
+      Close();
+      return false;
+    }
+    h = header();
+    memcpy(h->magic, kMagic, sizeof(kMagic));
+    h->version = kVersion;
+    h->segment_rows = kSegmentRows;
+  }
+  return true;
+}
+
+void HistoryCache::Close() {
+  if (base_ != nullptr) {
+    msync(base_, mapped_bytes_, MS_ASYNC);
+    munmap(base_, mapped_bytes_);
+    base_ = nullptr;
+    mapped_bytes_ = 0;
+  }
+  if (fd_ >= 0) {
+    close(fd_);  // also releases the flock
+    fd_ = -1;
+  }
+}
+
+bool HistoryCache::Map(size_t bytes, std::string* error) {
+  void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (base == MAP_FAILED) {
+    *error = std::string("mmap: ") + strerror(errno);
+    return false;
+  }
+  base_ = static_cast<uint8_t*>(base);
+  mapped_bytes_ = bytes;
+  return true;
+}
+
+std::string HistoryCache::LastKey() const {
+  if (!is_open()) return std::string();
+  const Header* h = header();
+  return std::string(h->last_key, std::min<size_t>(h->last_key_length, kMaxKeyLength));
+}
+
+uint8_t* HistoryCache::Segment(uint64_t index) const {
+  return base_ + kHeaderBytes + index * kSegmentBytes;
+}
+
+int64_t HistoryCache::TimestampAt(uint64_t row) const {
+  return Column<int64_t>(Segment(row / kSegmentRows), kTimestampOffset)[row % kSegmentRows];
+}
+
+uint64_t HistoryCache::LowerBound(int64_t timestamp) const {
+  uint64_t low = 0;
+  uint64_t high = header()->rows;
+  while (low < high) {
+    uint64_t mid = low + (high - low) / 2;
+    if (TimestampAt(mid) < timestamp) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+// Grows the file by whole segments. mremap keeps the mapping's address when
+// it can, so growing a large cache does not copy it.
+bool HistoryCache::Reserve(uint64_t rows) {
+  Header* h = header();
+  if (rows <= h->capacity) return true;
+  uint64_t segments = (rows + kSegmentRows - 1) / kSegmentRows;
+  size_t bytes = kHeaderBytes + segments * kSegmentBytes;
+  if (ftruncate(fd_, (off_t)bytes) != 0) return false;
+  void* base = mremap(base_, mapped_bytes_, bytes, MREMAP_MAYMOVE);
+  if (base == MAP_FAILED) return false;
+  base_ = static_cast<uint8_t*>(base);
+  mapped_bytes_ = bytes;
+  header()->capacity = segments * kSegmentRows;
+  return true;
+}
+
+long HistoryCache::Append(const HistoryRow* rows, size_t count, const std::string& last_key) {
+  if (!is_open()) return -1;
+  uint64_t start = header()->rows;
+  if (!Reserve(start + count)) return -1;
+
+  Header* h = header();
+  uint64_t row = start;
+  int64_t newest = start > 0 ? h->last_timestamp : INT64_MIN;
+  for (size_t i = 0; i < count; i++) {
+    const HistoryRow& in = rows[i];
+    if (in.timestamp < newest) continue;  // out of order; the column must stay sorted
+    newest = in.timestamp;
+    uint8_t* segment = Segment(row / kSegmentRows);
+    uint32_t at = (uint32_t)(row % kSegmentRows);
+    Column<int64_t>(segment, kTimestampOffset)[at] = in.timestamp;
+    Column<float>(segment, kTemperatureOffset)[at] = in.temperature;
+    Column<float>(segment, kHumidityOffset)[at] = in.humidity;
+    Column<float>(segment, kSoilOffset)[at] = in.soil;
+    Column<float>(segment, kBrightnessOffset)[at] = in.brightness;
+    Column<uint16_t>(segment, kPlantAgeOffset)[at] = in.plant_age;
+    Column<uint8_t>(segment, kFlagsOffset)[at] = in.flags;
+    row++;
+  }
+
+  // Publish the batch: rows first, then the count and sync key.
+  if (row > start) {
+    if (start == 0) h->first_timestamp = rows[0].timestamp;
+    h->last_timestamp = newest;
+  }
+  h->rows = row;
+  if (!last_key.empty()) {
+    size_t length = std::min(last_key.size(), kMaxKeyLength);
+    memcpy(h->last_key, last_key.data(), length);
+    h->last_key[length] = '\0';
+    h->last_key_length = (uint32_t)length;
+  }
+  return (long)(row - start);
+}
+
+size_t HistoryCache::Query(int64_t from, int64_t to, size_t limit, HistoryColumns* out) const {
+  HistoryCursor cursor = Seek(from, to);
+  if (limit > 0 && cursor.remaining() > limit) cursor.next = cursor.end - limit;
+  CopyRows(cursor.next, cursor.end, out);
+  return out->size();
+}
+
+HistoryCursor HistoryCache::Seek(int64_t from, int64_t to) const {
+  HistoryCursor cursor;
+  if (!is_open() || to < from) return cursor;
+  cursor.next = LowerBound(from);
+  cursor.end = to == INT64_MAX ? header()->rows : LowerBound(to + 1);
+  if (cursor.end < cursor.next) cursor.end = cursor.next;
+  return cursor;
+}
+
+size_t HistoryCache::Read(HistoryCursor* cursor, size_t max_rows, HistoryColumns* out) const {
+  uint64_t end = cursor->next + std::min<uint64_t>(max_rows, cursor->remaining());
+  CopyRows(cursor->next, end, out);
+  cursor->next = end;
+  return out->size();
+}
+
+void HistoryCache::CopyRows(uint64_t first, uint64_t end, HistoryColumns* out) const {
+  out->Resize(0);
+  if (!is_open() || end <= first) return;
+  out->Resize((size_t)(end - first));
+  size_t written = 0;
+  for (uint64_t row = first; row < end;) {
+    uint8_t* segment = Segment(row / kSegmentRows);
+    uint32_t at = (uint32_t)(row % kSegmentRows);
+    uint32_t run = (uint32_t)std::min<uint64_t>(kSegmentRows - at, end - row);
+    CopyColumn(segment, kTimestampOffset, at, run, out->timestamp.data() + written);
+    CopyColumn(segment, kTemperatureOffset, at, run, out->temperature.data() + written);
+    CopyColumn(segment, kHumidityOffset, at, run, out->humidity.data() + written);
+    CopyColumn(segment, kSoilOffset, at, run, out->soil.data() + written);
+    CopyColumn(segment, kBrightnessOffset, at, run, out->brightness.data() + written);
+    CopyColumn(segment, kPlantAgeOffset, at, run, out->plant_age.data() + written);
+    CopyColumn(segment, kFlagsOffset, at, run, out->flags.data() + written);
+    written += run;
+    row += run;
+  }
+}
+
+HistoryCacheStats HistoryCache::Stats() const {
+  HistoryCacheStats stats = {};
+  if (!is_open()) return stats;
+  const Header* h = header();
+  stats.rows = h->rows;
+  stats.file_bytes = mapped_bytes_;
+  if (h->rows > 0) {
+    stats.first_timestamp = h->first_timestamp;
+    stats.last_timestamp = h->last_timestamp;
+  }
+  return stats;
+}
+
+}  // namespace smartfarm
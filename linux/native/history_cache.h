@@ -0,0 +1,135 @@
+#ifndef SMARTFARM_NATIVE_HISTORY_CACHE_H_
+#define SMARTFARM_NATIVE_HISTORY_CACHE_H_
+
+// Local cache of one history_data collection (one device or zone) for the
+// desktop app. Rows live in an append-only, memory-mapped file laid out by
+// column in fixed-size segments, so a range query is a binary search over
+// the timestamp column plus straight copies of the columns it needs.
+//
+// File layout:
+//   [4 KiB header][segment 0][segment 1]...
+// Each segment holds kSegmentRows rows as contiguous column arrays:
+//   int64 timestamp[N] | float temperature[N] | float humidity[N] |
+//   float soil[N] | float brightness[N] | uint16 plant_age[N] | uint8 flags[N]
+// The header's row count and last key are written after the row data, so a
+// crash mid-append loses at most that batch, and the next sync fetches it
+// again.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace smartfarm {
+
+// The history_data strings the app shows, packed into one byte. Soil
+// category and the time-of-day label are not stored; they follow from
+// kelembaban_tanah and the day bit.
+enum HistoryFlags : uint8_t {
+  kHistoryPumpOn = 1,          // status_pompa == "ON"
+  kHistoryManual = 2,          // mode_operasi == "MANUAL"
+  kHistoryDay = 4,             // waktu == "Siang"
+  kHistoryStageShift = 3,      // tahapan_tanaman index (BIBIT..PEMBUAHAN)
+  kHistoryStageMask = 3 << 3,  // in bits 3-4
+};
+
+// One history_data child, minus the strings the app derives from numbers.
+struct HistoryRow {
+  int64_t timestamp;  // ms epoch
+  float temperature;  // suhu
+  float humidity;     // kelembaban_udara
+  float soil;         // kelembaban_tanah
+  float brightness;   // kecerahan
+  uint16_t plant_age; // umur_tanaman
+  uint8_t flags;      // HistoryFlags
+};
+
+// Query result, one vector per column, oldest row first.
+struct HistoryColumns {
+  std::vector<int64_t> timestamp;
+  std::vector<float> temperature;
+  std::vector<float> humidity;
+  std::vector<float> soil;
+  std::vector<float> brightness;
+  std::vector<uint16_t> plant_age;
+  std::vector<uint8_t> flags;
+
+  size_t size() const { return timestamp.size(); }
+  void Resize(size_t rows);
+};
+
+// Forward scan over a timestamp range; see HistoryCache::Seek.
+struct HistoryCursor {
+  uint64_t next = 0;  // row index
+  uint64_t end = 0;   // one past the last row of the range
+
+  uint64_t remaining() const { return end - next; }
+};
+
+struct HistoryCacheStats {
+  uint64_t rows;
+  uint64_t file_bytes;
+  int64_t first_timestamp;  // 0 when empty
+  int64_t last_timestamp;
+};
+
+class HistoryCache {
+ public:
+  static constexpr uint32_t kSegmentRows = 4096;
+  static constexpr size_t kMaxKeyLength = 127;
+
+  HistoryCache() = default;
+  ~HistoryCache();
+  HistoryCache(const HistoryCache&) = delete;
+  HistoryCache& operator=(const HistoryCache&) = delete;
+
+  // Opens or creates the cache file and takes an exclusive lock on it, so a
+  // second app instance falls back to the network instead of corrupting it.
+  bool Open(const std::string& path, std::string* error);
+  void Close();
+  bool is_open() const { return base_ != nullptr; }
+
+  // RTDB key of the newest cached row ("" when empty). Incremental sync
+  // asks the backend for keys after this one.
+  std::string LastKey() const;
+
+  // Appends rows that follow LastKey() in key order and records last_key.
+  // Rows older than the newest cached timestamp are skipped. Returns the
+  // number of rows appended, or -1 if the file could not grow.
+  long Append(const HistoryRow* rows, size_t count, const std::string& last_key);
+
+  // Rows with from <= timestamp <= to, keeping only the newest `limit`
+  // (0 = all). Returns the number of rows written to out.
+  size_t Query(int64_t from, int64_t to, size_t limit, HistoryColumns* out) const;
+
+  // Starts a forward scan over from <= timestamp <= to, for callers that
+  // page through more rows than they want to hold (exports). Rows appended
+  // afterwards are not part of the scan.
+  HistoryCursor Seek(int64_t from, int64_t to) const;
+
+  // Copies the next max_rows rows of the scan (fewer at its end) into out,
+  // oldest first, and advances the cursor. Returns the number of rows.
+  size_t Read(HistoryCursor* cursor, size_t max_rows, HistoryColumns* out) const;
+
+  HistoryCacheStats Stats() const;
+
+ private:
+  struct Header;
+
+  Header* header() const { return reinterpret_cast<Header*>(base_); }
+  uint8_t* Segment(uint64_t index) const;
+  int64_t TimestampAt(uint64_t row) const;
+  uint64_t LowerBound(int64_t timestamp) const;  // first row with ts >= timestamp
+  void CopyRows(uint64_t first, uint64_t end, HistoryColumns* out) const;
+  bool Reserve(uint64_t rows);
+  bool Map(size_t bytes, std::string* error);
+
+  int fd_ = -1;
+  uint8_t* base_ = nullptr;
+  size_t mapped_bytes_ = 0;
+};
+
+}  // namespace smartfarm
+
+#endif  // SMARTFARM_NATIVE_HISTORY_CACHE_H_
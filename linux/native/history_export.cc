@@ -0,0 +1,239 @@
+#include "history_export.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace smartfarm {
+
+namespace {
+
+constexpr char kColumnarMagic[4] = {'S', 'F', 'H', 'X'};
+constexpr uint32_t kColumnarVersion = 1;
+constexpr size_t kWriteBufferBytes = 1 << 20;
+
+struct ColumnarHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t rows;
+  int64_t first_timestamp;
+  int64_t last_timestamp;
+};
+static_assert(sizeof(ColumnarHeader) == 32, "columnar header layout");
+
+struct ColumnarBlock {
+  uint32_t rows;
+  uint32_t reserved;
+};
+
+constexpr char kCsvHeader[] =
+    "timestamp,datetime,suhu,kelembaban_udara,kelembaban_tanah,kecerahan,umur_tanaman,"
+    "status_pompa,mode_operasi,waktu,tahapan_tanaman\n";
+
+// Same order as the stage index in HistoryFlags.
+constexpr const char* kStages[] = {"BIBIT", "VEGETATIF", "BERBUNGA", "PEMBUAHAN"};
+
+// A sensor value as a CSV field; a missing reading (NaN) is an empty field.
+const char* CsvValue(float value, char (&buffer)[24]) {
+  if (isnan(value)) return "";
+  snprintf(buffer, sizeof(buffer), "%.6g", value);
+  return buffer;
+}
+
+}  // namespace
+
+constexpr size_t HistoryExport::kPageRows;
+
+HistoryExport::~HistoryExport() { Abort(); }
+
+bool HistoryExport::Begin(const HistoryCache& cache, int64_t from, int64_t to,
+                          ExportFormat format, const std::string& path, std::string* error) {
+  Abort();
+  cache_ = &cache;
+  cursor_ = cache.Seek(from, to);
+  format_ = format;
+  path_ = path;
+  part_path_ = path + ".part";
+  rows_ = 0;
+  total_rows_ = cursor_.remaining();
+  bytes_ = 0;
+  first_timestamp_ = 0;
+  last_timestamp_ = 0;
+
+  file_ = fopen(part_path_.c_str(), "wbe");
+  if (file_ == nullptr) {
+    *error = "open " + part_path_ + ": " + strerror(errno);
+    return false;
+  }
+  buffer_.resize(kWriteBufferBytes);
+  setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+
+  bool written;
+  if (format_ == ExportFormat::kCsv) {
+    written = Write(kCsvHeader, sizeof(kCsvHeader) - 1);
+  } else {
+    // Rows and the time span are filled in by Finish().
+    ColumnarHeader header = {};
+    memcpy(header.magic, kColumnarMagic, sizeof(kColumnarMagic));
+    header.version = kColumnarVersion;
+    written = Write(&header, sizeof(header));
+  }
+  if (!written) {
+    *error = "write " + part_path_ + ": " + strerror(errno);
+    Abort();
+    return false;
+  }
+  return true;
+}
+
+bool HistoryExport::Step(std::string* error) {
+  if (file_ == nullptr) {
+    *error = "No export in progress";
+    return false;
+  }
+  if (done()) return true;
+  size_t count = cache_->Read(&cursor_, kPageRows, &page_);
+  if (count == 0) return true;
+  if (rows_ == 0) first_timestamp_ = page_.timestamp.front();
+  last_timestamp_ = page_.timestamp.back();
+
+  bool written = format_ == ExportFormat::kCsv ? WriteCsvPage() : WriteColumnarPage();
+  if (!written) {
+    *error = "write " + part_path_ + ": " + strerror(errno);
+    Abort();
+    return false;
+  }
+  rows_ += count;
+  return true;
+}
+
+bool HistoryExport::Finish(std::string* error) {
+  if (file_ == nullptr) {
+    *error = "No export in progress";
+    return false;
+  }
+  bool ok = true;
+  if (format_ == ExportFormat::kColumnar) {
+    ColumnarHeader header = {};
+    memcpy(header.magic, kColumnarMagic, sizeof(kColumnarMagic));
+    header.version = kColumnarVersion;
+    header.rows = rows_;
+    header.first_timestamp = first_timestamp_;
+    header.last_timestamp = last_timestamp_;
+    ok = fseek(file_, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file_) == 1;
+  }
+  ok = ok && fflush(file_) == 0;
+  ok = fclose(file_) == 0 && ok;
+  file_ = nullptr;
+  if (!ok) {
+    *error = "write " + part_path_ + ": " + strerror(errno);
+  } else if (rename(part_path_.c_str(), path_.c_str()) != 0) {
+    *error = "rename " + part_path_ + ": " + strerror(errno);
+    ok = false;
+  }
+  if (!ok) remove(part_path_.c_str());
+  cache_ = nullptr;
+  cursor_ = HistoryCursor();
+  // Drop the page and write buffer; an idle exporter holds nothing.
+  page_ = HistoryColumns();
+  std::vector<char>().swap(buffer_);
+  return ok;
+}
+
+void HistoryExport::Abort() {
+  if (file_ != nullptr) {
+    fclose(file_);
+    file_ = nullptr;
+    remove(part_path_.c_str());
+  }
+  cache_ = nullptr;
+  cursor_ = HistoryCursor();
+  page_ = HistoryColumns();
+  std::vector<char>().swap(buffer_);
+}
+
+bool HistoryExport::Write(const void* data, size_t bytes) {
+  if (fwrite(data, 1, bytes, file_) != bytes) return false;
+  bytes_ += bytes;
+  return true;
+}
+
+bool HistoryExport::WriteCsvPage() {
+  char line[256];
+  char temperature[24], humidity[24], soil[24], brightness[24];
+  for (size_t i = 0; i < page_.size(); i++) {
+    uint8_t flags = page_.flags[i];
+    int length = snprintf(line, sizeof(line), "%lld,%s,%s,%s,%s,%s,%u,%s,%s,%s,%s\n",
+                          (long long)page_.timestamp[i], DateTime(page_.timestamp[i]),
+                          CsvValue(page_.temperature[i], temperature),
+                          CsvValue(page_.humidity[i], humidity), CsvValue(page_.soil[i], soil),
+                          CsvValue(page_.brightness[i], brightness), (unsigned)page_.plant_age[i],
+                          (flags & kHistoryPumpOn) ? "ON" : "OFF",
+                          (flags & kHistoryManual) ? "MANUAL" : "AUTO",
+                          (flags & kHistoryDay) ? "Siang" : "Malam",
+                          kStages[(flags & kHistoryStageMask) >> kHistoryStageShift]);
+    if (length < 0 || (size_t)length >= sizeof(line) || !Write(line, (size_t)length)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool HistoryExport::WriteColumnarPage() {
+  size_t count = page_.size();
+  ColumnarBlock block = {(uint32_t)count, 0};
+  return Write(&block, sizeof(block)) &&
+         Write(page_.timestamp.data(), count * sizeof(int64_t)) &&
+         Write(page_.temperature.data(), count * sizeof(float)) &&
+         Write(page_.humidity.data(), count * sizeof(float)) &&
+         Write(page_.soil.data(), count * sizeof(float)) &&
+         Write(page_.brightness.data(), count * sizeof(float)) &&
+         Write(page_.plant_age.data(), count * sizeof(uint16_t)) &&
+         Write(page_.flags.data(), count * sizeof(uint8_t));
+}
+
+const char* HistoryExport::DateTime(int64_t timestamp_ms) {
+  // Floor division, so timestamps before 1970 land in the right second.
+  time_t seconds = (time_t)(timestamp_ms / 1000 - (timestamp_ms % 1000 < 0 ? 1 : 0));
+  struct tm local;
+  if (seconds < day_start_ || seconds >= day_end_) {
+    localtime_r(&seconds, &local);
+    strftime(date_, sizeof(date_), "%Y-%m-%d ", &local);
+    // Bounds of this local day. When the UTC offset holds all day, the time
+    // of day is the distance from midnight; on a DST change day it is not,
+    // and every row takes localtime_r.
+    struct tm midnight = local;
+    midnight.tm_hour = midnight.tm_min = midnight.tm_sec = 0;
+    midnight.tm_isdst = -1;
+    struct tm next = midnight;
+    next.tm_mday++;
+    day_start_ = mktime(&midnight);
+    day_end_ = mktime(&next);
+    day_uniform_ = day_start_ <= seconds && seconds < day_end_ &&
+                   day_end_ - day_start_ == 24 * 60 * 60 &&
+                   midnight.tm_gmtoff == local.tm_gmtoff && next.tm_gmtoff == local.tm_gmtoff;
+    if (day_start_ > seconds || seconds >= day_end_) {
+      day_start_ = seconds;  // mktime disagrees; cache this second only
+      day_end_ = seconds + 1;
+    }
+  }
+  if (!day_uniform_) {
+    localtime_r(&seconds, &local);
+    strftime(date_, sizeof(date_), "%Y-%m-%d %H:%M:%S", &local);
+    return date_;
+  }
+  // date_ holds "YYYY-MM-DD "; append the time of day.
+  int today = (int)(seconds - day_start_);
+  const int parts[3] = {today / 3600, today / 60 % 60, today % 60};
+  char* out = date_ + 11;
+  for (int part : parts) {
+    *out++ = (char)('0' + part / 10);
+    *out++ = (char)('0' + part % 10);
+    *out++ = ':';
+  }
+  out[-1] = '\0';
+  return date_;
+}
+
+}  // namespace smartfarm
@@ -0,0 +1,109 @@
+#ifndef SMARTFARM_NATIVE_HISTORY_EXPORT_H_
+#define SMARTFARM_NATIVE_HISTORY_EXPORT_H_
+
+// Streams a time range of a HistoryCache to a file one page at a time, so a
+// multi-month export holds one page of rows and one write buffer however
+// long the range is, and takes time linear in its row count. The caller
+// drives it with Step(), which lets the desktop runner interleave pages with
+// its GTK main loop and report progress between them.
+//
+// Formats:
+//   CSV       one row per sample, history_data field names in the header:
+//               timestamp,datetime,suhu,kelembaban_udara,kelembaban_tanah,
+//               kecerahan,umur_tanaman,status_pompa,mode_operasi,waktu,
+//               tahapan_tanaman
+//             datetime is local time, "YYYY-MM-DD HH:MM:SS".
+//   Columnar  the cache's own column layout, little-endian:
+//               header  char magic[4] = "SFHX", uint32 version = 1,
+//                       uint64 rows, int64 first_timestamp,
+//                       int64 last_timestamp
+//               blocks  uint32 rows, uint32 reserved, then that many
+//                       int64 timestamp | float suhu | float
+//                       kelembaban_udara | float kelembaban_tanah | float
+//                       kecerahan | uint16 umur_tanaman | uint8 flags
+//             flags are HistoryFlags (history_cache.h). About 27 bytes per
+//             row, and numpy.frombuffer reads each column directly.
+// The file is written as "<path>.part" and renamed on Finish(), so an
+// interrupted export never looks complete.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include "history_cache.h"
+
+namespace smartfarm {
+
+enum class ExportFormat {
+  kCsv,
+  kColumnar,
+};
+
+struct ExportProgress {
+  uint64_t rows;        // written so far
+  uint64_t total_rows;  // in the range when the export began
+  uint64_t bytes;       // written so far, including headers
+};
+
+class HistoryExport {
+ public:
+  static constexpr size_t kPageRows = HistoryCache::kSegmentRows;
+
+  HistoryExport() = default;
+  ~HistoryExport();  // aborts an unfinished export
+  HistoryExport(const HistoryExport&) = delete;
+  HistoryExport& operator=(const HistoryExport&) = delete;
+
+  // Creates "<path>.part" and writes the header. The cache must stay open
+  // until the export finishes or is aborted.
+  bool Begin(const HistoryCache& cache, int64_t from, int64_t to, ExportFormat format,
+             const std::string& path, std::string* error);
+
+  // Writes the next page. On error the export is aborted.
+  bool Step(std::string* error);
+
+  bool done() const { return cursor_.remaining() == 0; }
+
+  // Completes the header, flushes and renames the file into place.
+  bool Finish(std::string* error);
+
+  // Closes and deletes the partial file. Safe to call at any time.
+  void Abort();
+
+  ExportProgress progress() const { return ExportProgress{rows_, total_rows_, bytes_}; }
+
+ private:
+  bool Write(const void* data, size_t bytes);
+  bool WriteCsvPage();
+  bool WriteColumnarPage();
+  // "YYYY-MM-DD HH:MM:SS" for a ms timestamp, in local time.
+  const char* DateTime(int64_t timestamp_ms);
+
+  const HistoryCache* cache_ = nullptr;
+  HistoryCursor cursor_;
+  ExportFormat format_ = ExportFormat::kCsv;
+  FILE* file_ = nullptr;
+  std::string path_;
+  std::string part_path_;
+  std::vector<char> buffer_;  // stdio buffer for file_
+  HistoryColumns page_;
+  uint64_t rows_ = 0;
+  uint64_t total_rows_ = 0;
+  uint64_t bytes_ = 0;
+  int64_t first_timestamp_ = 0;
+  int64_t last_timestamp_ = 0;
+
+  // Local day of the last DateTime(), so localtime_r runs once per day
+  // rather than once per row.
+  time_t day_start_ = 1;
+  time_t day_end_ = 0;
+  bool day_uniform_ = false;  // one UTC offset all day
+  char date_[32] = {};
+};
+
+}  // namespace smartfarm
+
+#endif  // SMARTFARM_NATIVE_HISTORY_EXPORT_H_
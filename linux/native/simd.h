@@ -0,0 +1,58 @@
+#ifndef SMARTFARM_NATIVE_SIMD_H_
+#define SMARTFARM_NATIVE_SIMD_H_
+
+// 128-bit vector types for the native kernels (downsample.cc,
+// fleet_stats.cc). GCC and Clang lower these to SSE2 on x86-64 and NEON on
+// arm64 without any -m flags; wider types would need AVX for the same code.
+//
+// Internal to linux/native; not part of any library's public surface.
+
+#include <stdint.h>
+#include <string.h>
+
+namespace smartfarm {
+namespace simd {
+
+typedef float Float4 __attribute__((vector_size(16)));
+typedef int32_t Int4 __attribute__((vector_size(16)));
+typedef uint32_t UInt4 __attribute__((vector_size(16)));
+typedef int64_t Int64x2 __attribute__((vector_size(16)));
+
+inline Float4 Load4(const float* p) {
+  Float4 v;
+  memcpy(&v, p, sizeof(v));  // unaligned load
+  return v;
+}
+
+inline Int64x2 Load2(const int64_t* p) {
+  Int64x2 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline Float4 Splat(float f) { return Float4{f, f, f, f}; }
+
+inline Int64x2 Splat2(int64_t i) { return Int64x2{i, i}; }
+
+inline Int4 Select(Int4 mask, Int4 a, Int4 b) { return (mask & a) | (~mask & b); }
+
+inline Int64x2 Select(Int64x2 mask, Int64x2 a, Int64x2 b) { return (mask & a) | (~mask & b); }
+
+inline Float4 Select(Int4 mask, Float4 a, Float4 b) {
+  return (Float4)Select(mask, (Int4)a, (Int4)b);
+}
+
+inline Float4 Abs(Float4 v) {
+  const Int4 magnitude = {0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff};
+  return (Float4)((Int4)v & magnitude);
+}
+
+// Sign-extends lanes 0-1 / 2-3 of a 32-bit lane mask (0 / -1) to 64 bits.
+inline Int64x2 WidenLow(Int4 mask) { return Int64x2{mask[0], mask[1]}; }
+
+inline Int64x2 WidenHigh(Int4 mask) { return Int64x2{mask[2], mask[3]}; }
+
+}  // namespace simd
+}  // namespace smartfarm
+
+#endif  // SMARTFARM_NATIVE_SIMD_H_
@@ -0,0 +1,377 @@
+#include "history_cache_plugin.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "history_cache.h"
+#include "history_export.h"
+
+using smartfarm::ExportFormat;
+using smartfarm::HistoryCache;
+using smartfarm::HistoryColumns;
+using smartfarm::HistoryExport;
+using smartfarm::HistoryRow;
+
+namespace {
+
+constexpr char kChannelName[] = "smartfarm/history_cache";
+constexpr char kExportChannelName[] = "smartfarm/history_cache/export";
+
+// An export runs on the main loop in slices this long, so the UI keeps
+// drawing, and reports progress at most this often.
+constexpr gint64 kExportSliceUs = 8000;
+constexpr gint64 kExportProgressUs = 100000;
+
+// Column names match the history_data fields they come from.
+constexpr char kTimestamp[] = "timestamp";
+constexpr char kTemperature[] = "suhu";
+constexpr char kHumidity[] = "kelembaban_udara";
+constexpr char kSoil[] = "kelembaban_tanah";
+constexpr char kBrightness[] = "kecerahan";
+constexpr char kPlantAge[] = "umur_tanaman";
+constexpr char kFlags[] = "flags";
+
+}  // namespace
+
+struct _HistoryCachePlugin {
+  FlMethodChannel* channel;
+  FlEventChannel* export_channel;
+  std::string directory;
+  std::map<std::string, std::unique_ptr<HistoryCache>> caches;  // by RTDB path
+
+  // The export in progress, if any. It reads its cache from the idle
+  // callback on the main thread, the same thread that appends to it.
+  std::unique_ptr<HistoryExport> exporter;
+  std::string export_file;
+  guint export_source;
+  gint64 export_started_us;
+  gint64 export_reported_us;
+};
+
+// "zones/zona_1/history_data" -> "zones_zona_1_history_data".
+static std::string safe_name_for(const std::string& path) {
+  std::string name;
+  for (char c : path) {
+    bool safe = g_ascii_isalnum(c) || c == '-' || c == '_';
+    if (!safe && (name.empty() || name.back() == '_')) continue;
+    name.push_back(safe ? c : '_');
+  }
+  if (name.empty()) name = "history_data";
+  return name;
+}
+
+static std::string file_name_for(const std::string& path) { return safe_name_for(path) + ".sfh"; }
+
+static FlMethodResponse* error_response(const gchar* code, const std::string& message) {
+  return FL_METHOD_RESPONSE(fl_method_error_response_new(code, message.c_str(), nullptr));
+}
+
+static FlValue* lookup(FlValue* args, const gchar* key, FlValueType type) {
+  FlValue* value = fl_value_lookup_string(args, key);
+  return value != nullptr && fl_value_get_type(value) == type ? value : nullptr;
+}
+
+static gint64 lookup_int(FlValue* args, const gchar* key, gint64 fallback) {
+  FlValue* value = lookup(args, key, FL_VALUE_TYPE_INT);
+  return value != nullptr ? fl_value_get_int(value) : fallback;
+}
+
+// Opens the cache for args["path"] on first use. Returns null and sets
+// *response when the path is missing or the file cannot be opened.
+static HistoryCache* cache_for(HistoryCachePlugin* self, FlValue* args,
+                               FlMethodResponse** response) {
+  FlValue* path = args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                      ? lookup(args, "path", FL_VALUE_TYPE_STRING)
+                      : nullptr;
+  if (path == nullptr) {
+    *response = error_response("BAD_ARGS", "Missing history_data path");
+    return nullptr;
+  }
+  std::string key = fl_value_get_string(path);
+  auto it = self->caches.find(key);
+  if (it != self->caches.end()) return it->second.get();
+
+  if (g_mkdir_with_parents(self->directory.c_str(), 0700) != 0) {
+    *response = error_response("UNAVAILABLE", "Cannot create " + self->directory);
+    return nullptr;
+  }
+  g_autofree gchar* file = g_build_filename(self->directory.c_str(), file_name_for(key).c_str(),
+                                            nullptr);
+  std::unique_ptr<HistoryCache> cache(new HistoryCache());
+  std::string error;
+  if (!cache->Open(file, &error)) {
+    *response = error_response("UNAVAILABLE", error);
+    return nullptr;
+  }
+  HistoryCache* opened = cache.get();
+  self->caches[key] = std::move(cache);
+  return opened;
+}
+
+static FlMethodResponse* append(HistoryCache* cache, FlValue* args) {
+  FlValue* timestamp = lookup(args, kTimestamp, FL_VALUE_TYPE_INT64_LIST);
+  FlValue* temperature = lookup(args, kTemperature, FL_VALUE_TYPE_FLOAT32_LIST);
+  FlValue* humidity = lookup(args, kHumidity, FL_VALUE_TYPE_FLOAT32_LIST);
+  FlValue* soil = lookup(args, kSoil, FL_VALUE_TYPE_FLOAT32_LIST);
+  FlValue* brightness = lookup(args, kBrightness, FL_VALUE_TYPE_FLOAT32_LIST);
+  FlValue* plant_age = lookup(args, kPlantAge, FL_VALUE_TYPE_INT32_LIST);
+  FlValue* flags = lookup(args, kFlags, FL_VALUE_TYPE_UINT8_LIST);
+  FlValue* last_key = lookup(args, "lastKey", FL_VALUE_TYPE_STRING);
+  if (timestamp == nullptr || temperature == nullptr || humidity == nullptr || soil == nullptr ||
+      brightness == nullptr || plant_age == nullptr || flags == nullptr || last_key == nullptr) {
+    return error_response("BAD_ARGS", "append needs every column as a typed list and lastKey");
+  }
+  size_t count = fl_value_get_length(timestamp);
+  if (fl_value_get_length(temperature) != count || fl_value_get_length(humidity) != count ||
+      fl_value_get_length(soil) != count || fl_value_get_length(brightness) != count ||
+      fl_value_get_length(plant_age) != count || fl_value_get_length(flags) != count) {
+    return error_response("BAD_ARGS", "Columns differ in length");
+  }
+
+  // A concurrent sync from another screen got there first; appending again
+  // would duplicate its rows.
+  FlValue* after_key = lookup(args, "afterKey", FL_VALUE_TYPE_STRING);
+  if (after_key != nullptr && cache->LastKey() != fl_value_get_string(after_key)) {
+    g_autoptr(FlValue) result = fl_value_new_int(0);
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
+
+  const int64_t* timestamps = fl_value_get_int64_list(timestamp);
+  const float* temperatures = fl_value_get_float32_list(temperature);
+  const float* humidities = fl_value_get_float32_list(humidity);
+  const float* soils = fl_value_get_float32_list(soil);
+  const float* brightnesses = fl_value_get_float32_list(brightness);
+  const int32_t* ages = fl_value_get_int32_list(plant_age);
+  const uint8_t* flag_bytes = fl_value_get_uint8_list(flags);
+  std::vector<HistoryRow> rows(count);
+  for (size_t i = 0; i < count; i++) {
+    rows[i].timestamp = timestamps[i];
+    rows[i].temperature = temperatures[i];
+    rows[i].humidity = humidities[i];
+    rows[i].soil = soils[i];
+    rows[i].brightness = brightnesses[i];
+    rows[i].plant_age = static_cast<uint16_t>(CLAMP(ages[i], 0, G_MAXUINT16));
+    rows[i].flags = flag_bytes[i];
+  }
+  long appended = cache->Append(rows.data(), count, fl_value_get_string(last_key));
+  if (appended < 0) {
+    return error_response("IO", "Cannot grow the history cache file");
+  }
+  g_autoptr(FlValue) result = fl_value_new_int(appended);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* query(HistoryCache* cache, FlValue* args) {
+  gint64 from = lookup_int(args, "from", G_MININT64);
+  gint64 to = lookup_int(args, "to", G_MAXINT64);
+  gint64 limit = lookup_int(args, "limit", 0);
+  if (limit < 0) {
+    return error_response("BAD_ARGS", "limit must be >= 0");
+  }
+
+  HistoryColumns columns;
+  size_t count = cache->Query(from, to, static_cast<size_t>(limit), &columns);
+  // The channel has no uint16 list; plant age widens to int32.
+  std::vector<int32_t> ages(columns.plant_age.begin(), columns.plant_age.end());
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, kTimestamp,
+                           fl_value_new_int64_list(columns.timestamp.data(), count));
+  fl_value_set_string_take(result, kTemperature,
+                           fl_value_new_float32_list(columns.temperature.data(), count));
+  fl_value_set_string_take(result, kHumidity,
+                           fl_value_new_float32_list(columns.humidity.data(), count));
+  fl_value_set_string_take(result, kSoil, fl_value_new_float32_list(columns.soil.data(), count));
+  fl_value_set_string_take(result, kBrightness,
+                           fl_value_new_float32_list(columns.brightness.data(), count));
+  fl_value_set_string_take(result, kPlantAge, fl_value_new_int32_list(ages.data(), count));
+  fl_value_set_string_take(result, kFlags, fl_value_new_uint8_list(columns.flags.data(), count));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static FlMethodResponse* stats(HistoryCache* cache) {
+  smartfarm::HistoryCacheStats stats = cache->Stats();
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "rows", fl_value_new_int(stats.rows));
+  fl_value_set_string_take(result, "file_bytes", fl_value_new_int(stats.file_bytes));
+  fl_value_set_string_take(result, "first_timestamp", fl_value_new_int(stats.first_timestamp));
+  fl_value_set_string_take(result, "last_timestamp", fl_value_new_int(stats.last_timestamp));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Sends {file, rows, total, bytes, elapsed_ms, rows_per_s, done, error?}.
+static void send_export_progress(HistoryCachePlugin* self, gboolean done, const gchar* error) {
+  smartfarm::ExportProgress progress = self->exporter->progress();
+  gint64 now = g_get_monotonic_time();
+  gint64 elapsed_us = now - self->export_started_us;
+  self->export_reported_us = now;
+
+  g_autoptr(FlValue) event = fl_value_new_map();
+  fl_value_set_string_take(event, "file", fl_value_new_string(self->export_file.c_str()));
+  fl_value_set_string_take(event, "rows", fl_value_new_int(progress.rows));
+  fl_value_set_string_take(event, "total", fl_value_new_int(progress.total_rows));
+  fl_value_set_string_take(event, "bytes", fl_value_new_int(progress.bytes));
+  fl_value_set_string_take(event, "elapsed_ms", fl_value_new_int(elapsed_us / 1000));
+  fl_value_set_string_take(
+      event, "rows_per_s",
+      fl_value_new_float(elapsed_us > 0 ? progress.rows * 1e6 / elapsed_us : 0.0));
+  fl_value_set_string_take(event, "done", fl_value_new_bool(done));
+  if (error != nullptr) fl_value_set_string_take(event, "error", fl_value_new_string(error));
+
+  g_autoptr(GError) send_error = nullptr;
+  if (!fl_event_channel_send(self->export_channel, event, nullptr, &send_error)) {
+    g_warning("Failed to send history export progress: %s", send_error->message);
+  }
+}
+
+static void end_export(HistoryCachePlugin* self, const gchar* error) {
+  send_export_progress(self, TRUE, error);
+  self->exporter.reset();
+  self->export_source = 0;
+}
+
+static gboolean export_step_cb(gpointer user_data) {
+  HistoryCachePlugin* self = static_cast<HistoryCachePlugin*>(user_data);
+  std::string error;
+  gint64 slice_end = g_get_monotonic_time() + kExportSliceUs;
+  while (!self->exporter->done() && g_get_monotonic_time() < slice_end) {
+    if (!self->exporter->Step(&error)) {
+      end_export(self, error.c_str());
+      return G_SOURCE_REMOVE;
+    }
+  }
+  if (self->exporter->done()) {
+    bool finished = self->exporter->Finish(&error);
+    end_export(self, finished ? nullptr : error.c_str());
+    return G_SOURCE_REMOVE;
+  }
+  if (g_get_monotonic_time() - self->export_reported_us >= kExportProgressUs) {
+    send_export_progress(self, FALSE, nullptr);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+// $XDG_DOWNLOAD_DIR/<path>_<local time>.<csv|sfhx>.
+static std::string default_export_file(const std::string& path, ExportFormat format) {
+  const gchar* directory = g_get_user_special_dir(G_USER_DIRECTORY_DOWNLOAD);
+  if (directory == nullptr) directory = g_get_home_dir();
+  g_autoptr(GDateTime) now = g_date_time_new_now_local();
+  g_autofree gchar* stamp = g_date_time_format(now, "%Y%m%d-%H%M%S");
+  std::string name = safe_name_for(path) + "_" + stamp +
+                     (format == ExportFormat::kCsv ? ".csv" : ".sfhx");
+  g_autofree gchar* file = g_build_filename(directory, name.c_str(), nullptr);
+  return file;
+}
+
+static FlMethodResponse* start_export(HistoryCachePlugin* self, HistoryCache* cache,
+                                      FlValue* args) {
+  if (self->exporter != nullptr) {
+    return error_response("BUSY", "Another export is running: " + self->export_file);
+  }
+  FlValue* format_value = lookup(args, "format", FL_VALUE_TYPE_STRING);
+  const gchar* format_name = format_value != nullptr ? fl_value_get_string(format_value) : "csv";
+  ExportFormat format;
+  if (g_strcmp0(format_name, "csv") == 0) {
+    format = ExportFormat::kCsv;
+  } else if (g_strcmp0(format_name, "columnar") == 0) {
+    format = ExportFormat::kColumnar;
+  } else {
+    return error_response("BAD_ARGS", "format must be csv or columnar");
+  }
+  FlValue* file = lookup(args, "file", FL_VALUE_TYPE_STRING);
+  std::string path = fl_value_get_string(lookup(args, "path", FL_VALUE_TYPE_STRING));
+  std::string target = file != nullptr ? fl_value_get_string(file)
+                                       : default_export_file(path, format);
+
+  std::unique_ptr<HistoryExport> exporter(new HistoryExport());
+  std::string error;
+  if (!exporter->Begin(*cache, lookup_int(args, "from", G_MININT64),
+                       lookup_int(args, "to", G_MAXINT64), format, target, &error)) {
+    return error_response("IO", error);
+  }
+  self->exporter = std::move(exporter);
+  self->export_file = target;
+  self->export_started_us = g_get_monotonic_time();
+  self->export_reported_us = self->export_started_us;
+  self->export_source = g_idle_add(export_step_cb, self);
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "file", fl_value_new_string(target.c_str()));
+  fl_value_set_string_take(result, "total",
+                           fl_value_new_int(self->exporter->progress().total_rows));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Deletes the partial file. Returns whether an export was running.
+static bool cancel_export(HistoryCachePlugin* self) {
+  if (self->exporter == nullptr) return false;
+  g_source_remove(self->export_source);
+  self->exporter->Abort();
+  end_export(self, "cancelled");
+  return true;
+}
+
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  HistoryCachePlugin* self = static_cast<HistoryCachePlugin*>(user_data);
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  HistoryCache* cache = nullptr;
+  if (g_strcmp0(method, "cancelExport") == 0) {
+    // The only method without a path.
+    g_autoptr(FlValue) result = fl_value_new_bool(cancel_export(self));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if ((cache = cache_for(self, args, &response)) == nullptr) {
+    // response already holds the error.
+  } else if (g_strcmp0(method, "lastKey") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_string(cache->LastKey().c_str());
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (g_strcmp0(method, "append") == 0) {
+    response = append(cache, args);
+  } else if (g_strcmp0(method, "query") == 0) {
+    response = query(cache, args);
+  } else if (g_strcmp0(method, "stats") == 0) {
+    response = stats(cache);
+  } else if (g_strcmp0(method, "export") == 0) {
+    response = start_export(self, cache, args);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send history cache response: %s", error->message);
+  }
+}
+
+HistoryCachePlugin* history_cache_plugin_new(FlPluginRegistrar* registrar) {
+  HistoryCachePlugin* self = new HistoryCachePlugin();
+  g_autofree gchar* directory =
+      g_build_filename(g_get_user_cache_dir(), "smartfarmtomato", "history", nullptr);
+  self->directory = directory;
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel = fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                                        kChannelName, FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->channel, method_call_cb, self, nullptr);
+  // Progress only; listening starts nothing, so no stream handlers.
+  self->export_channel = fl_event_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                                              kExportChannelName, FL_METHOD_CODEC(codec));
+  return self;
+}
+
+void history_cache_plugin_free(HistoryCachePlugin* self) {
+  if (self->exporter != nullptr) {
+    // Deletes the partial file; nobody is left to tell.
+    g_source_remove(self->export_source);
+    self->exporter.reset();
+  }
+  fl_method_channel_set_method_call_handler(self->channel, nullptr, nullptr, nullptr);
+  g_clear_object(&self->channel);
+  g_clear_object(&self->export_channel);
+  delete self;  // unmaps and unlocks every open cache
+}
@@ -0,0 +1,39 @@
+#ifndef RUNNER_HISTORY_CACHE_PLUGIN_H_
+#define RUNNER_HISTORY_CACHE_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+// Serves the native history cache (linux/native/history_cache.h) to Dart
+// over the "smartfarm/history_cache" method channel. Each RTDB history_data
+// path gets its own file under $XDG_CACHE_HOME/smartfarmtomato/history, opened
+// on first use. Rows cross the channel as typed lists, one per column, so a
+// query result is a handful of memcpys rather than a map per row.
+//
+// Methods (all take {"path": String}, the RTDB history_data path):
+//   lastKey -> String                 key of the newest cached row, "" if none
+//   append  {lastKey, afterKey?, timestamp, suhu, kelembaban_udara,
+//            kelembaban_tanah, kecerahan, umur_tanaman, flags} -> int rows
+//            appended; 0 without writing when afterKey is not the cache's
+//            current last key
+//   query   {from?, to?, limit?} -> {timestamp, suhu, ...} oldest row first
+//   stats   -> {rows, file_bytes, first_timestamp, last_timestamp}
+//   export  {format?: "csv" | "columnar", file?, from?, to?} -> {file, total}
+//            starts writing the range to file (default: the XDG download
+//            directory) with linux/native/history_export.h and returns at
+//            once; BUSY while another export runs
+//   cancelExport (no path) -> bool whether an export was running; deletes
+//            its partial file
+// Export progress arrives on the "smartfarm/history_cache/export" event
+// channel at most every 100 ms and once more at the end, as {file, rows,
+// total, bytes, elapsed_ms, rows_per_s, done, error?}. The export runs on the
+// main loop in slices of a few milliseconds, between appends to the same
+// cache, so the cache file can grow (and be remapped) mid-export.
+// A cache another app instance holds fails with UNAVAILABLE; Dart then reads
+// from the network as before.
+typedef struct _HistoryCachePlugin HistoryCachePlugin;
+
+HistoryCachePlugin* history_cache_plugin_new(FlPluginRegistrar* registrar);
+
+void history_cache_plugin_free(HistoryCachePlugin* plugin);
+
+#endif  // RUNNER_HISTORY_CACHE_PLUGIN_H_
@@ -0,0 +1,191 @@
+#include "lan_telemetry_plugin.h"
+
+#include <gio/gio.h>
+
+#include <map>
+#include <string>
+
+#include "telemetry_frame.h"
+
+namespace {
+
+constexpr char kChannelName[] = "smartfarm/lan_telemetry";
+
+// Upper bound on datagrams handled per main-loop wakeup so a burst from a
+// large fleet cannot starve rendering.
+constexpr int kMaxFramesPerWake = 64;
+
+}  // namespace
+
+struct _LanTelemetryPlugin {
+  FlEventChannel* channel;
+  GSocket* socket;
+  GSource* source;
+  std::map<std::string, TelemetryPeer> peers;  // by device id
+};
+
+static FlValue* peer_to_value(const TelemetryPeer& peer) {
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "received", fl_value_new_int(peer.received));
+  fl_value_set_string_take(stats, "lost", fl_value_new_int(peer.lost));
+  fl_value_set_string_take(stats, "late", fl_value_new_int(peer.late));
+  fl_value_set_string_take(stats, "duplicates", fl_value_new_int(peer.duplicates));
+  fl_value_set_string_take(stats, "restarts", fl_value_new_int(peer.restarts));
+  return stats;
+}
+
+static FlValue* frame_to_value(const TelemetryFrame& frame, const TelemetryPeer& peer,
+                               TelemetryVerdict verdict, gint64 received_at_ms) {
+  FlValue* event = fl_value_new_map();
+  fl_value_set_string_take(event, "device", fl_value_new_string(frame.deviceId));
+  fl_value_set_string_take(event, "seq", fl_value_new_int(frame.seq));
+  fl_value_set_string_take(event, "boot", fl_value_new_int(frame.bootId));
+  fl_value_set_string_take(event, "restart", fl_value_new_bool(verdict == TELEMETRY_RESTART));
+  fl_value_set_string_take(event, "timestamp", fl_value_new_int(frame.timestamp));
+  fl_value_set_string_take(event, "received_at", fl_value_new_int(received_at_ms));
+  fl_value_set_string_take(event, "online", fl_value_new_bool(frame.online));
+  // NaN when the DHT22 had no reading (kNoReadingTenths).
+  fl_value_set_string_take(event, "suhu", fl_value_new_float(tenthsToFloat(frame.temperature)));
+  fl_value_set_string_take(event, "kelembaban_udara",
+                           fl_value_new_float(tenthsToFloat(frame.humidity)));
+
+  FlValue* zones = fl_value_new_list();
+  for (int i = 0; i < frame.zoneCount; i++) {
+    const TelemetryZone& zone = frame.zones[i];
+    FlValue* value = fl_value_new_map();
+    fl_value_set_string_take(value, "zona", fl_value_new_int(i + 1));
+    fl_value_set_string_take(value, "kelembaban_tanah", fl_value_new_float(tenthsToFloat(zone.soil)));
+    fl_value_set_string_take(value, "kecerahan", fl_value_new_float(tenthsToFloat(zone.brightness)));
+    fl_value_set_string_take(value, "pompa", fl_value_new_bool(zone.pumpOn));
+    fl_value_set_string_take(value, "manual", fl_value_new_bool(zone.manual));
+    fl_value_set_string_take(value, "pompa_sisa_s", fl_value_new_int(zone.pumpRemainingS));
+    fl_value_append_take(zones, value);
+  }
+  fl_value_set_string_take(event, "zones", zones);
+  fl_value_set_string_take(event, "stats", peer_to_value(peer));
+  return event;
+}
+
+static void handle_datagram(LanTelemetryPlugin* self, const guint8* data, gsize length) {
+  TelemetryFrame frame;
+  if (!decodeTelemetryFrame(data, length, &frame)) {
+    return;  // something else on the port
+  }
+  TelemetryPeer& peer = self->peers[frame.deviceId];
+  TelemetryVerdict verdict = telemetryTrack(peer, frame.bootId, frame.seq);
+  // Newer data is already on screen; the counters go out with the next frame.
+  if (verdict == TELEMETRY_LATE || verdict == TELEMETRY_DUPLICATE) return;
+
+  g_autoptr(FlValue) event = frame_to_value(frame, peer, verdict, g_get_real_time() / 1000);
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(self->channel, event, nullptr, &error)) {
+    g_warning("Failed to send LAN telemetry event: %s", error->message);
+  }
+}
+
+static gboolean socket_readable_cb(GSocket* socket, GIOCondition condition, gpointer user_data) {
+  LanTelemetryPlugin* self = static_cast<LanTelemetryPlugin*>(user_data);
+  guint8 buffer[512];
+  for (int i = 0; i < kMaxFramesPerWake; i++) {
+    g_autoptr(GError) error = nullptr;
+    gssize n = g_socket_receive(socket, reinterpret_cast<gchar*>(buffer), sizeof(buffer), nullptr,
+                                &error);
+    if (n < 0) {
+      if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+        g_warning("LAN telemetry receive failed: %s", error->message);
+      }
+      break;
+    }
+    handle_datagram(self, buffer, n);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+static void close_socket(LanTelemetryPlugin* self) {
+  if (self->source != nullptr) {
+    g_source_destroy(self->source);
+    g_clear_pointer(&self->source, g_source_unref);
+  }
+  if (self->socket != nullptr) {
+    g_socket_close(self->socket, nullptr);
+    g_clear_object(&self->socket);
+  }
+}
+
+static gboolean open_socket(LanTelemetryPlugin* self, guint16 port, GError** error) {
+  close_socket(self);
+  g_autoptr(GSocket) socket =
+      g_socket_new(G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, error);
+  if (socket == nullptr) {
+    return FALSE;
+  }
+  g_socket_set_blocking(socket, FALSE);
+
+  g_autoptr(GInetAddress) any = g_inet_address_new_any(G_SOCKET_FAMILY_IPV4);
+  g_autoptr(GSocketAddress) address = g_inet_socket_address_new(any, port);
+  if (!g_socket_bind(socket, address, TRUE, error)) {
+    return FALSE;
+  }
+
+  // Unicast frames still arrive if the group cannot be joined (e.g. no
+  // multicast route), so this is only a warning.
+  g_autoptr(GInetAddress) group = g_inet_address_new_from_string(kTelemetryGroup);
+  g_autoptr(GError) join_error = nullptr;
+  if (!g_socket_join_multicast_group(socket, group, FALSE, nullptr, &join_error)) {
+    g_warning("Failed to join %s: %s", kTelemetryGroup, join_error->message);
+  }
+
+  self->socket = G_SOCKET(g_object_ref(socket));
+  self->source = g_socket_create_source(self->socket, G_IO_IN, nullptr);
+  g_source_set_callback(self->source, reinterpret_cast<GSourceFunc>(socket_readable_cb), self,
+                        nullptr);
+  g_source_attach(self->source, nullptr);
+  return TRUE;
+}
+
+// Called when Dart starts listening; optional arguments: {"port": int}.
+static FlMethodErrorResponse* listen_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  LanTelemetryPlugin* self = static_cast<LanTelemetryPlugin*>(user_data);
+  gint64 port = kTelemetryPort;
+  if (args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    FlValue* value = fl_value_lookup_string(args, "port");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
+      port = fl_value_get_int(value);
+    }
+  }
+  if (port <= 0 || port > G_MAXUINT16) {
+    return fl_method_error_response_new("BAD_PORT", "Port must be 1-65535", nullptr);
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!open_socket(self, static_cast<guint16>(port), &error)) {
+    return fl_method_error_response_new("SOCKET", error->message, nullptr);
+  }
+  return nullptr;
+}
+
+static FlMethodErrorResponse* cancel_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  close_socket(static_cast<LanTelemetryPlugin*>(user_data));
+  return nullptr;
+}
+
+LanTelemetryPlugin* lan_telemetry_plugin_new(FlPluginRegistrar* registrar) {
+  LanTelemetryPlugin* self = new LanTelemetryPlugin();
+  self->socket = nullptr;
+  self->source = nullptr;
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel = fl_event_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                                       kChannelName, FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(self->channel, listen_cb, cancel_cb, self, nullptr);
+  return self;
+}
+
+void lan_telemetry_plugin_free(LanTelemetryPlugin* self) {
+  close_socket(self);
+  fl_event_channel_set_stream_handlers(self->channel, nullptr, nullptr, nullptr, nullptr);
+  g_clear_object(&self->channel);
+  delete self;
+}
@@ -0,0 +1,17 @@
+#ifndef RUNNER_LAN_TELEMETRY_PLUGIN_H_
+#define RUNNER_LAN_TELEMETRY_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+// Receives the UDP telemetry frames ESP32 nodes multicast on the LAN
+// (firmware/telemetry_frame.h) and streams them to Dart over the
+// "smartfarm/lan_telemetry" event channel. The socket is only open while
+// Dart is listening. Each event carries the decoded reading plus that
+// device's sequence counters (received, lost, late, duplicates, restarts).
+typedef struct _LanTelemetryPlugin LanTelemetryPlugin;
+
+LanTelemetryPlugin* lan_telemetry_plugin_new(FlPluginRegistrar* registrar);
+
+void lan_telemetry_plugin_free(LanTelemetryPlugin* plugin);
+
+#endif  // RUNNER_LAN_TELEMETRY_PLUGIN_H_
@@ -1,6 +1,8 @@
 #include "my_application.h"
+#include "startup_trace.h"
 
 int main(int argc, char** argv) {
+  startup_trace_init();
   g_autoptr(MyApplication) app = my_application_new();
   return g_application_run(G_APPLICATION(app), argc, argv);
 }
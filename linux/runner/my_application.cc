@@ -6,23 +6,44 @@
 #endif
 
 #include "flutter/generated_plugin_registrant.h"
+#include "history_cache_plugin.h"
+#include "lan_telemetry_plugin.h"
+#include "startup_trace.h"
 
 struct _MyApplication {
   GtkApplication parent_instance;
   char** dart_entrypoint_arguments;
+  LanTelemetryPlugin* lan_telemetry;
+  HistoryCachePlugin* history_cache;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
 
+// Opt-in warm start: with SMARTFARM_SINGLE_INSTANCE=1 the first launch owns
+// the application ID on the session bus and later launches only ask it to
+// raise its window, instead of cold-starting another Flutter engine.
+constexpr char kSingleInstanceVariable[] = "SMARTFARM_SINGLE_INSTANCE";
+
 // Called when first Flutter frame received.
 static void first_frame_cb(MyApplication* self, FlView *view)
 {
   gtk_widget_show(gtk_widget_get_toplevel(GTK_WIDGET(view)));
+  startup_trace_finish("first frame");
 }
 
 // Implements GApplication::activate.
 static void my_application_activate(GApplication* application) {
   MyApplication* self = MY_APPLICATION(application);
+
+  // Single-instance mode: a relaunch activates this process again. Raise the
+  // window we have; if it is still waiting for its first frame, that will
+  // show it.
+  GtkWindow* existing = gtk_application_get_active_window(GTK_APPLICATION(application));
+  if (existing != nullptr) {
+    if (gtk_widget_get_visible(GTK_WIDGET(existing))) gtk_window_present(existing);
+    return;
+  }
+
   GtkWindow* window =
       GTK_WINDOW(gtk_application_window_new(GTK_APPLICATION(application)));
 
@@ -54,9 +75,11 @@ static void my_application_activate(GApplication* application) {
   }
 
   gtk_window_set_default_size(window, 1280, 720);
+  startup_trace_mark("window");
 
   g_autoptr(FlDartProject) project = fl_dart_project_new();
   fl_dart_project_set_dart_entrypoint_arguments(project, self->dart_entrypoint_arguments);
+  startup_trace_mark("project");
 
   FlView* view = fl_view_new(project);
   GdkRGBA background_color;
@@ -70,9 +93,21 @@ static void my_application_activate(GApplication* application) {
   // Requires the view to be realized so we can start rendering.
   g_signal_connect_swapped(view, "first-frame", G_CALLBACK(first_frame_cb), self);
   gtk_widget_realize(GTK_WIDGET(view));
+  startup_trace_mark("engine");
 
   fl_register_plugins(FL_PLUGIN_REGISTRY(view));
 
+  // Live readings straight from ESP32 nodes on the LAN; see lan_telemetry_plugin.h.
+  g_autoptr(FlPluginRegistrar) lan_telemetry_registrar =
+      fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view), "LanTelemetryPlugin");
+  self->lan_telemetry = lan_telemetry_plugin_new(lan_telemetry_registrar);
+
+  // Local copy of history_data for instant charts; see history_cache_plugin.h.
+  g_autoptr(FlPluginRegistrar) history_cache_registrar =
+      fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view), "HistoryCachePlugin");
+  self->history_cache = history_cache_plugin_new(history_cache_registrar);
+  startup_trace_mark("plugins");
+
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }
 
@@ -92,6 +127,12 @@ static gboolean my_application_local_command_line(GApplication* application, gch
   g_application_activate(application);
   *exit_status = 0;
 
+  // The activation went to the instance that owns the application ID; this
+  // process exits without starting an engine.
+  if (g_application_get_is_remote(application)) {
+    startup_trace_finish("raised running instance");
+  }
+
   return TRUE;
 }
 
@@ -102,6 +143,7 @@ static void my_application_startup(GApplication* application) {
   // Perform any actions required at application startup.
 
   G_APPLICATION_CLASS(my_application_parent_class)->startup(application);
+  startup_trace_mark("gtk init");  // GtkApplication::startup runs gtk_init
 }
 
 // Implements GApplication::shutdown.
@@ -117,6 +159,8 @@ static void my_application_shutdown(GApplication* application) {
 static void my_application_dispose(GObject* object) {
   MyApplication* self = MY_APPLICATION(object);
   g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
+  g_clear_pointer(&self->lan_telemetry, lan_telemetry_plugin_free);
+  g_clear_pointer(&self->history_cache, history_cache_plugin_free);
   G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
 }
 
@@ -137,8 +181,12 @@ MyApplication* my_application_new() {
   // the application to be recognized beyond its binary name.
   g_set_prgname(APPLICATION_ID);
 
+  GApplicationFlags flags = G_APPLICATION_NON_UNIQUE;
+  if (g_strcmp0(g_getenv(kSingleInstanceVariable), "1") == 0) {
+    flags = static_cast<GApplicationFlags>(flags & ~G_APPLICATION_NON_UNIQUE);
+  }
   return MY_APPLICATION(g_object_new(my_application_get_type(),
                                      "application-id", APPLICATION_ID,
-                                     "flags", G_APPLICATION_NON_UNIQUE,
+                                     "flags", flags,
                                      nullptr));
 }
@@ -0,0 +1,112 @@
+#include "startup_trace.h"
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kTraceVariable[] = "SMARTFARM_STARTUP_TRACE";
+constexpr size_t kMaxMarks = 32;
+
+struct Mark {
+  const gchar* step;
+  gint64 time_us;  // g_get_monotonic_time()
+};
+
+struct Trace {
+  bool enabled = false;
+  bool finished = false;
+  gchar* path = nullptr;  // null: stderr
+  gint64 exec_us = 0;     // monotonic time of exec, estimated
+  Mark marks[kMaxMarks];
+  size_t count = 0;
+};
+
+Trace trace;
+
+}  // namespace
+
+// Monotonic time at which the process was exec'd. /proc/self/stat gives the
+// start in clock ticks since boot, so measure the age on CLOCK_BOOTTIME and
+// step back from now. Falls back to `now` if /proc is unreadable.
+static gint64 exec_time_us(gint64 now) {
+  g_autofree gchar* stat = nullptr;
+  if (!g_file_get_contents("/proc/self/stat", &stat, nullptr, nullptr)) return now;
+  // The command name (field 2) may hold spaces; count from its ')'.
+  const gchar* field = strrchr(stat, ')');
+  for (int index = 2; field != nullptr && index < 22; index++) {
+    field = strchr(field + 1, ' ');
+  }
+  long ticks_per_second = sysconf(_SC_CLK_TCK);
+  struct timespec boot;
+  if (field == nullptr || ticks_per_second <= 0 || clock_gettime(CLOCK_BOOTTIME, &boot) != 0) {
+    return now;
+  }
+  guint64 start_ticks = g_ascii_strtoull(field + 1, nullptr, 10);
+  gint64 boot_us = static_cast<gint64>(boot.tv_sec) * G_USEC_PER_SEC + boot.tv_nsec / 1000;
+  gint64 start_us = static_cast<gint64>(start_ticks * G_USEC_PER_SEC / ticks_per_second);
+  gint64 age_us = boot_us - start_us;
+  return age_us >= 0 ? now - age_us : now;
+}
+
+static void write_text() {
+  g_printerr("startup trace:\n  %-24s %10s %10s\n", "step", "ms @exec", "ms taken");
+  gint64 previous = trace.exec_us;
+  for (size_t i = 0; i < trace.count; i++) {
+    const Mark& mark = trace.marks[i];
+    g_printerr("  %-24s %10.1f %10.1f\n", mark.step, (mark.time_us - trace.exec_us) / 1000.0,
+               (mark.time_us - previous) / 1000.0);
+    previous = mark.time_us;
+  }
+}
+
+// Chrome trace event format: each step is a complete event ("X") running
+// from the previous mark to its own, on one thread of this process.
+static void write_json() {
+  g_autoptr(GString) json = g_string_new("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  const int pid = static_cast<int>(getpid());
+  gint64 previous = trace.exec_us;
+  for (size_t i = 0; i < trace.count; i++) {
+    const Mark& mark = trace.marks[i];
+    g_string_append_printf(json,
+                           "%s{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":%d,"
+                           "\"tid\":%d,\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT "}\n",
+                           i == 0 ? "" : ",", mark.step, pid, pid, previous - trace.exec_us,
+                           mark.time_us - previous);
+    previous = mark.time_us;
+  }
+  g_string_append(json, "]}\n");
+
+  g_autoptr(GError) error = nullptr;
+  if (!g_file_set_contents(trace.path, json->str, json->len, &error)) {
+    g_warning("Failed to write startup trace: %s", error->message);
+  }
+}
+
+void startup_trace_init() {
+  const gint64 now = g_get_monotonic_time();
+  const gchar* value = g_getenv(kTraceVariable);
+  if (value == nullptr || value[0] == '\0' || g_strcmp0(value, "0") == 0) return;
+  trace.enabled = true;
+  if (g_strcmp0(value, "1") != 0) trace.path = g_strdup(value);
+  trace.exec_us = exec_time_us(now);
+  trace.marks[trace.count++] = Mark{"main", now};
+}
+
+void startup_trace_mark(const gchar* step) {
+  if (!trace.enabled || trace.finished || trace.count == kMaxMarks) return;
+  trace.marks[trace.count++] = Mark{step, g_get_monotonic_time()};
+}
+
+void startup_trace_finish(const gchar* step) {
+  if (!trace.enabled || trace.finished) return;
+  startup_trace_mark(step);
+  trace.finished = true;
+  if (trace.path != nullptr) {
+    write_json();
+  } else {
+    write_text();
+  }
+  g_clear_pointer(&trace.path, g_free);
+}
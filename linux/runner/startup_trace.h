@@ -0,0 +1,27 @@
+#ifndef RUNNER_STARTUP_TRACE_H_
+#define RUNNER_STARTUP_TRACE_H_
+
+#include <glib.h>
+
+// Startup timeline of the desktop runner, for measuring cold start on slow
+// greenhouse PCs. Off unless SMARTFARM_STARTUP_TRACE is set:
+//   SMARTFARM_STARTUP_TRACE=1       one line per step on stderr
+//   SMARTFARM_STARTUP_TRACE=<file>  Chrome trace JSON (chrome://tracing or
+//                                   ui.perfetto.dev), one span per step
+// Steps are stamped with the monotonic clock and reported relative to exec,
+// which comes from /proc/self/stat and so has clock-tick (~10 ms)
+// resolution; every later step is exact.
+//
+// Process-wide and not thread-safe: call from the GTK main thread only.
+
+// Call first thing in main(). Reads the environment and marks "main".
+void startup_trace_init();
+
+// Records that `step` (a string literal) just completed. Does nothing when
+// tracing is off or already finished.
+void startup_trace_mark(const gchar* step);
+
+// Marks `step` and writes the trace. Later marks and finishes do nothing.
+void startup_trace_finish(const gchar* step);
+
+#endif  // RUNNER_STARTUP_TRACE_H_
@@ -0,0 +1,232 @@
+// Benchmarks the chart downsampling kernels (linux/native/downsample.h) on a
+// synthetic multi-month sensor series: a daily temperature cycle with noise,
+// sensor gaps and short spikes, sampled at the firmware's 5 s interval.
+// Each reducer runs with the vector and the scalar kernel so the SIMD gain
+// is visible. --check also requires both kernels to pick identical indices,
+// LTTB to keep the first and last sample, MinMax to keep every spike, and
+// the small-input edge cases to return every index.
+//
+// Usage:
+//   downsample_bench [--days 180] [--interval-s 5] [--width 1200]
+//                    [--iterations 5] [--check] [--seed S]
+//
+// Exit status: 0 on success, 1 when --check finds a mismatch, 2 on bad
+// arguments.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "downsample.h"
+
+namespace {
+
+using smartfarm::DownsampleKernel;
+
+struct Options {
+  int days = 180;
+  int interval_s = 5;
+  int width = 1200;  // on-screen points
+  int iterations = 5;
+  bool check = false;
+  uint64_t seed = 42;
+};
+
+struct Series {
+  std::vector<int64_t> x;
+  std::vector<float> y;
+  std::vector<uint32_t> spikes;  // indices of injected spikes
+};
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--days") == 0 && value) {
+      options->days = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--interval-s") == 0 && value) {
+      options->interval_s = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--width") == 0 && value) {
+      options->width = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--iterations") == 0 && value) {
+      options->iterations = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--seed") == 0 && value) {
+      options->seed = strtoull(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--check") == 0) {
+      options->check = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--days D] [--interval-s S] [--width W] [--iterations N] [--check] "
+              "[--seed S]\n",
+              argv[0]);
+      return false;
+    }
+  }
+  return options->days > 0 && options->interval_s > 0 && options->width >= 3 &&
+         options->iterations > 0;
+}
+
+Series Generate(const Options& options) {
+  std::mt19937_64 rng(options.seed);
+  std::normal_distribution<float> noise(0.0f, 0.3f);
+  std::uniform_int_distribution<int> chance(0, 99999);
+  size_t count = (size_t)options.days * 86400 / options.interval_s;
+  Series series;
+  series.x.reserve(count);
+  series.y.reserve(count);
+  int64_t t = 1735664400000LL;  // 2025-01-01 00:00 WIB
+  for (size_t i = 0; i < count; i++) {
+    t += options.interval_s * 1000LL;
+    if (chance(rng) < 5) t += 30 * 60 * 1000;  // WiFi outage: a 30 min gap
+    double hour = fmod(t / 3600000.0 + 7, 24.0);
+    float value = 27 + 5 * (float)sin((hour - 8) / 24.0 * 2 * M_PI) + noise(rng);
+    if (chance(rng) < 3) {
+      value += 15;  // spike the min/max envelope must keep
+      series.spikes.push_back((uint32_t)i);
+    }
+    series.x.push_back(t);
+    series.y.push_back(value);
+  }
+  return series;
+}
+
+// Best-of-N wall time in ms, so one scheduler hiccup does not skew a run.
+template <typename Fn>
+double BestMs(int iterations, Fn fn) {
+  double best = 1e30;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    best = std::min(best, ms);
+  }
+  return best;
+}
+
+bool Ascending(const std::vector<uint32_t>& indices, size_t count) {
+  for (size_t i = 1; i < count; i++) {
+    if (indices[i] <= indices[i - 1]) return false;
+  }
+  return true;
+}
+
+int CheckEdgeCases() {
+  int failures = 0;
+  int64_t x[5] = {0, 1000, 2000, 3000, 4000};
+  float y[5] = {1, 5, 2, 4, 3};
+  uint32_t out[10];
+  if (smartfarm::Lttb(x, y, 5, 5, out) != 5 || smartfarm::Lttb(x, y, 5, 2, out) != 5 ||
+      smartfarm::MinMax(y, 5, 3, out) != 5 || smartfarm::MinMax(y, 5, 0, out) != 5) {
+    fprintf(stderr, "  small inputs did not return every index\n");
+    failures++;
+  }
+  size_t n = smartfarm::Lttb(x, y, 5, 3, out);
+  if (n != 3 || out[0] != 0 || out[1] != 1 || out[2] != 4) {
+    fprintf(stderr, "  LTTB of 5 -> 3 kept the wrong middle point\n");
+    failures++;
+  }
+  return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+
+  Series series = Generate(options);
+  const size_t n = series.x.size();
+  const size_t width = (size_t)options.width;
+  printf("downsample_bench: %zu samples (%d days every %ds) -> %zu points\n", n, options.days,
+         options.interval_s, width);
+
+  std::vector<uint32_t> lttb_vector(n), lttb_scalar(n), minmax_vector(n), minmax_scalar(n);
+  size_t lttb_count = 0, lttb_scalar_count = 0, minmax_count = 0, minmax_scalar_count = 0;
+  const int64_t* x = series.x.data();
+  const float* y = series.y.data();
+  double lttb_ms = BestMs(options.iterations, [&] {
+    lttb_count = smartfarm::Lttb(x, y, n, width, lttb_vector.data(), DownsampleKernel::kVector);
+  });
+  double lttb_scalar_ms = BestMs(options.iterations, [&] {
+    lttb_scalar_count =
+        smartfarm::Lttb(x, y, n, width, lttb_scalar.data(), DownsampleKernel::kScalar);
+  });
+  // One min and one max per pixel column.
+  size_t buckets = width / 2;
+  double minmax_ms = BestMs(options.iterations, [&] {
+    minmax_count =
+        smartfarm::MinMax(y, n, buckets, minmax_vector.data(), DownsampleKernel::kVector);
+  });
+  double minmax_scalar_ms = BestMs(options.iterations, [&] {
+    minmax_scalar_count =
+        smartfarm::MinMax(y, n, buckets, minmax_scalar.data(), DownsampleKernel::kScalar);
+  });
+
+  printf("  %-7s %9s %9s %8s %8s\n", "kernel", "vector", "scalar", "speedup", "points");
+  printf("  %-7s %7.2fms %7.2fms %7.2fx %8zu\n", "lttb", lttb_ms, lttb_scalar_ms,
+         lttb_scalar_ms / lttb_ms, lttb_count);
+  printf("  %-7s %7.2fms %7.2fms %7.2fx %8zu\n", "minmax", minmax_ms, minmax_scalar_ms,
+         minmax_scalar_ms / minmax_ms, minmax_count);
+  printf("  %.1f M samples/s (lttb, vector)\n", n / (lttb_ms * 1000.0));
+
+  if (!options.check) return 0;
+
+  int failures = CheckEdgeCases();
+  if (lttb_count != std::min(width, n) || lttb_vector[0] != 0 ||
+      lttb_vector[lttb_count - 1] != n - 1 || !Ascending(lttb_vector, lttb_count)) {
+    fprintf(stderr, "  LTTB output is not %zu ascending indices from 0 to n-1\n",
+            std::min(width, n));
+    failures++;
+  }
+  if (lttb_scalar_count != lttb_count ||
+      !std::equal(lttb_vector.begin(), lttb_vector.begin() + lttb_count, lttb_scalar.begin())) {
+    fprintf(stderr, "  LTTB vector and scalar kernels disagree\n");
+    failures++;
+  }
+  if ((minmax_count > 2 * buckets && minmax_count != n) ||
+      !Ascending(minmax_vector, minmax_count)) {
+    fprintf(stderr, "  MinMax output is not at most %zu ascending indices\n", 2 * buckets);
+    failures++;
+  }
+  if (minmax_scalar_count != minmax_count ||
+      !std::equal(minmax_vector.begin(), minmax_vector.begin() + minmax_count,
+                  minmax_scalar.begin())) {
+    fprintf(stderr, "  MinMax vector and scalar kernels disagree\n");
+    failures++;
+  }
+
+  // A spike is the highest sample of its bucket unless another spike shares
+  // the bucket, so check that every bucket holding a spike kept one.
+  size_t missed = 0;
+  for (uint32_t spike : series.spikes) {
+    size_t bucket = (size_t)((uint64_t)spike * buckets / n);
+    size_t begin = (size_t)((uint64_t)bucket * n / buckets);
+    size_t end = (size_t)((uint64_t)(bucket + 1) * n / buckets);
+    bool kept = false;
+    for (size_t i = 0; i < minmax_count && !kept; i++) {
+      uint32_t at = minmax_vector[i];
+      kept = at >= begin && at < end && y[at] >= y[spike];
+    }
+    if (!kept) missed++;
+  }
+  if (missed > 0) {
+    fprintf(stderr, "  MinMax lost %zu of %zu spikes\n", missed, series.spikes.size());
+    failures++;
+  }
+
+  printf("downsample_bench: %s\n", failures == 0 ? "check passed" : "check FAILED");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,881 @@
+// Microbenchmarks for the firmware's per-sample hot paths, compiled on the
+// host from the same firmware/*.h the ESP32 runs: the data hash, the sensor
+// category and plant stage lookups, alert evaluation
+// (checkAndGenerateNotifications), the batch JSON built by sendToFirebase
+// the notification list parsed by checkFirebaseNotifications, the log
+// ring every log line passes through on the ESP32 and the DHT22 pulse
+// decoder behind the RMT capture. Absolute
+// numbers are host numbers; the point is comparing one commit with another.
+//
+// Each benchmark is calibrated to a batch of at least --min-sample-ms, then
+// timed over --samples batches. The report gives the median ns/op with a
+// distribution-free 95% confidence interval (order statistics), so two runs
+// differ meaningfully only when their intervals do not overlap. Heap
+// allocations are counted through operator new, as in soak_sim; the firmware
+// allocates nothing else on the ESP32.
+//
+// Usage:
+//   firmware_bench [--samples 30] [--min-sample-ms 5] [--filter TEXT]
+//                  [--json FILE|-] [--compare BASELINE.json] [--check]
+//                  [--seed S]
+//
+// --json writes one line per benchmark in a fixed key order, so two runs
+// diff cleanly; --compare reads such a file and prints the change per
+// benchmark. --check verifies each benchmark's result and that none of them
+// allocates.
+//
+// Exit status: 0 on success, 1 when --check fails, 2 on bad arguments or
+// I/O errors.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "device_log.h"
+#include "dht22_sensor.h"
+#include "host_platform.h"
+#include "rtdb_json.h"
+#include "sample_ring.h"
+#include "telemetry_frame.h"
+#include "tomato_device.h"
+#include "tomato_logic.h"
+
+namespace {
+
+// The tool is single-threaded; plain counters keep the hook cheap.
+uint64_t g_allocations = 0;
+uint64_t g_allocated_bytes = 0;
+
+}  // namespace
+
+// Counting allocator for the whole process.
+void* operator new(size_t size) {
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  g_allocations++;
+  g_allocated_bytes += size;
+  return p;
+}
+
+// Not inlined: GCC otherwise pairs the inlined free() with operator new and
+// reports -Wmismatched-new-delete.
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+namespace {
+
+const int kInputCount = 1024;  // power of two, cycled with a mask
+const unsigned long kSampleIntervalMs = 5000;
+
+struct Options {
+  int samples = 30;
+  double min_sample_ms = 5;
+  std::string filter;
+  std::string json_path;
+  std::string compare_path;
+  bool check = false;
+  uint64_t seed = 42;
+};
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--samples") == 0 && value) {
+      options->samples = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--min-sample-ms") == 0 && value) {
+      options->min_sample_ms = atof(value);
+      i++;
+    } else if (strcmp(arg, "--filter") == 0 && value) {
+      options->filter = value;
+      i++;
+    } else if (strcmp(arg, "--json") == 0 && value) {
+      options->json_path = value;
+      i++;
+    } else if (strcmp(arg, "--compare") == 0 && value) {
+      options->compare_path = value;
+      i++;
+    } else if (strcmp(arg, "--seed") == 0 && value) {
+      options->seed = strtoull(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--check") == 0) {
+      options->check = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--samples N] [--min-sample-ms MS] [--filter TEXT] [--json FILE|-] "
+              "[--compare BASELINE.json] [--check] [--seed S]\n",
+              argv[0]);
+      return false;
+    }
+  }
+  // Fewer than 6 samples leave no room for a confidence interval.
+  return options->samples >= 6 && options->min_sample_ms > 0;
+}
+
+// Keeps the compiler from discarding a result nobody reads.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+double NowNs() {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Benchmark {
+  const char* name;
+  // Runs the operation `iterations` times, continuing from op number `first`
+  // so inputs keep cycling across batches.
+  std::function<void(uint64_t first, uint64_t iterations)> run;
+};
+
+struct Result {
+  std::string name;
+  uint64_t iterations = 0;  // per sample
+  uint64_t ops = 0;         // timed, all samples
+  double median = 0;
+  double ci_low = 0;
+  double ci_high = 0;
+  double min = 0;
+  double mean = 0;
+  double stddev = 0;
+  double allocs_per_op = 0;
+  double bytes_per_op = 0;
+};
+
+Result Measure(const Benchmark& bench, const Options& options) {
+  Result result;
+  result.name = bench.name;
+  uint64_t op = 0;
+
+  // Double the batch until it is long enough to time; this also warms caches
+  // and any lazy one-time setup (tz data, stdio) before the counted samples.
+  uint64_t iterations = 1;
+  for (;;) {
+    double start = NowNs();
+    bench.run(op, iterations);
+    op += iterations;
+    double elapsed_ms = (NowNs() - start) / 1e6;
+    if (elapsed_ms >= options.min_sample_ms || iterations >= (1ULL << 40)) break;
+    iterations = elapsed_ms <= 0 ? iterations * 16
+                                 : std::max(iterations * 2,
+                                            (uint64_t)(iterations * options.min_sample_ms /
+                                                       elapsed_ms * 1.2));
+  }
+  result.iterations = iterations;
+
+  std::vector<double> ns_per_op(options.samples);
+  uint64_t allocations = g_allocations;
+  uint64_t bytes = g_allocated_bytes;
+  for (int s = 0; s < options.samples; s++) {
+    double start = NowNs();
+    bench.run(op, iterations);
+    ns_per_op[s] = (NowNs() - start) / iterations;
+    op += iterations;
+  }
+  result.ops = iterations * options.samples;
+  result.allocs_per_op = (double)(g_allocations - allocations) / result.ops;
+  result.bytes_per_op = (double)(g_allocated_bytes - bytes) / result.ops;
+
+  std::sort(ns_per_op.begin(), ns_per_op.end());
+  int n = options.samples;
+  result.median = n % 2 ? ns_per_op[n / 2] : (ns_per_op[n / 2 - 1] + ns_per_op[n / 2]) / 2;
+  // The median lies between these order statistics with ~95% probability
+  // whatever the distribution (normal approximation to Binomial(n, 1/2)).
+  double half_width = 0.98 * sqrt((double)n);
+  int low = std::max(0, (int)floor(n / 2.0 - half_width) - 1);
+  int high = std::min(n - 1, (int)ceil(n / 2.0 + half_width));
+  result.ci_low = ns_per_op[low];
+  result.ci_high = ns_per_op[high];
+  result.min = ns_per_op.front();
+  double sum = 0;
+  for (double v : ns_per_op) sum += v;
+  result.mean = sum / n;
+  double squares = 0;
+  for (double v : ns_per_op) squares += (v - result.mean) * (v - result.mean);
+  result.stddev = sqrt(squares / (n - 1));
+  return result;
+}
+
+// --- Fixtures ---
+
+// Answers like an idle backend without allocating, except that the
+// notification list holds five notifications, one of them unread.
+class BenchRtdb : public RtdbTransport {
+ public:
+  static constexpr const char* kNotifications =
+      "{\"notif_1733032800000_1001\":{\"createdAt\":\"2024-12-01 13:00:00\",\"isRead\":true,"
+      "\"message\":\"Tanah kering: 28%\\nThreshold: 40%\\nTahap: VEGETATIF\",\"timestamp\":"
+      "1733032800000,\"title\":\"\\ud83d\\udca7 Tanah Kering\",\"type\":\"warning\"},"
+      "\"notif_1733033100000_2002\":{\"createdAt\":\"2024-12-01 13:05:00\",\"isRead\":true,"
+      "\"message\":\"Durasi 15.0 detik selesai\\nKelembaban tanah: 46.0%\\nTahap: VEGETATIF\","
+      "\"timestamp\":1733033100000,\"title\":\"Penyiraman Selesai\",\"type\":\"success\"},"
+      "\"notif_1733033400000_3003\":{\"createdAt\":\"2024-12-01 13:10:00\",\"isRead\":true,"
+      "\"message\":\"Suhu 33.1\\u00b0C melebihi batas 32\\u00b0C\",\"timestamp\":1733033400000,"
+      "\"title\":\"Suhu Terlalu Tinggi\",\"type\":\"warning\",\"zona\":\"bed1\"},"
+      "\"notif_1733033700000_4004\":{\"createdAt\":\"2024-12-01 13:15:00\",\"isRead\":true,"
+      "\"message\":\"Pompa diaktifkan via Firebase\\nMode: MANUAL\",\"timestamp\":1733033700000,"
+      "\"title\":\"Pompa Manual\",\"type\":\"info\",\"zona\":\"bed2\"},"
+      "\"notif_1733034000000_5005\":{\"createdAt\":\"2024-12-01 13:20:00\",\"isRead\":false,"
+      "\"message\":\"Jadwal pemupukan minggu ini\",\"timestamp\":1733034000000,"
+      "\"title\":\"Pengingat\",\"type\":\"info\"}}";
+
+  bool connected() override { return true; }
+
+  int get(const char* path, char* body, size_t capacity, size_t* length) override {
+    const char* reply = "null";
+    if (strstr(path, "control.json")) {
+      reply = control;
+    } else if (strncmp(path, "/config/", 8) == 0) {
+      config_gets++;
+    } else if (strncmp(path, "/notifications.json", 19) == 0) {
+      reply = kNotifications;
+    }
+    snprintf(body, capacity, "%s", reply);
+    *length = strlen(body);
+    return 200;
+  }
+
+  int put(const char*, const char* body, size_t) override {
+    put_count++;
+    if (strstr(body, "Safety Timer")) safety_notices++;
+    return 200;
+  }
+
+  int patch(const char*, const char*, size_t length) override {
+    patch_count++;
+    patch_bytes += length;
+    return 200;
+  }
+
+  const char* control = "{\"operating_mode\":\"AUTO\",\"pompa_status\":\"OFF\"}";
+  unsigned long config_gets = 0;
+  unsigned long safety_notices = 0;
+  unsigned long put_count = 0;
+  unsigned long patch_count = 0;
+  uint64_t patch_bytes = 0;
+};
+
+// One virtual node with `zones` beds, already through one sample so every
+// status string is set.
+struct Device {
+  Device(int zones, uint64_t seed)
+      : platform(seed), host_zones(zones), sensors(platform) {
+    DeviceConfig config = defaultDeviceConfig();
+    config.diagnosticsInterval = 0;
+    device.reset(new TomatoDevice(platform, rtdb, pump, host_zones.zones(), host_zones.count(),
+                                  config));
+    device->begin();
+    device->state.timeInitialized = true;
+    platform.AdvanceTo(kSampleIntervalMs);
+    device->loop(sensors);
+  }
+
+  HostPlatform platform;
+  BenchRtdb rtdb;
+  CountingPump pump;
+  HostZones host_zones;
+  HostSensors sensors;
+  std::unique_ptr<TomatoDevice> device;
+};
+
+// Sensor readings spread over (and past) every category boundary.
+struct Inputs {
+  float temperature[kInputCount];
+  float humidity[kInputCount];
+  float soil[kInputCount];
+  float brightness[kInputCount];
+  int age[kInputCount];
+};
+
+void FillInputs(uint64_t seed, Inputs* in) {
+  HostPlatform random(seed);
+  for (int i = 0; i < kInputCount; i++) {
+    in->temperature[i] = random.random(50, 400) / 10.0f;
+    in->humidity[i] = random.random(300, 1000) / 10.0f;
+    in->soil[i] = random.random(0, 1000) / 10.0f;
+    in->brightness[i] = random.random(0, 1000) / 10.0f;
+    in->age[i] = (int)random.random(1, 90);
+  }
+}
+
+// --- Result checks, run before timing under --check ---
+
+const char kLogPadding[] =
+    "................................................................................"
+    "................................................................................"
+    "................................................................................";
+
+bool CheckLogic() {
+  bool ok = strcmp(getSoilCategory(29.9f), "SANGAT KERING") == 0 &&
+            strcmp(getSoilCategory(50.0f), "LEMBAB") == 0 &&
+            strcmp(getSoilCategory(70.1f), "BASAH") == 0 &&
+            strcmp(getBrightnessCategory(19.9f), "GELAP") == 0 &&
+            strcmp(getBrightnessCategory(80.0f), "SANGAT TERANG") == 0 &&
+            strcmp(getPlantStage(14), "BIBIT") == 0 && strcmp(getPlantStage(15), "VEGETATIF") == 0 &&
+            strcmp(getPlantStage(51), "PEMBUAHAN") == 0 &&
+            createDataHash(25.1f, 60.2f, 45.0f, 70.0f, false) ==
+                createDataHash(25.1f, 60.2f, 45.0f, 70.0f, false) &&
+            createDataHash(25.1f, 60.2f, 45.0f, 70.0f, false) !=
+                createDataHash(25.2f, 60.2f, 45.0f, 70.0f, false) &&
+            createDataHash(25.1f, 60.2f, 45.0f, 70.0f, false) !=
+                createDataHash(25.1f, 60.2f, 45.0f, 70.0f, true);
+  if (!ok) fprintf(stderr, "  tomato_logic results differ from the firmware's rules\n");
+  return ok;
+}
+
+// A missing DHT22 reading (NaN) must stay "no reading" through every
+// persepuluhan conversion and never pass for a real value or status.
+bool CheckNoReading() {
+  bool ok = sensorTenths(NAN) == kNoReadingTenths && sensorTenths(INFINITY) == kNoReadingTenths &&
+            sensorTenths(-3276.8f) == -32767 && sensorTenths(-25.06f) == -251 &&
+            isnan(tenthsToFloat(kNoReadingTenths)) && tenthsToFloat(251) == 25.1f &&
+            strcmp(getTempStatus(NAN, true), kSensorErrorStatus) == 0 &&
+            strcmp(getAirHumStatus(NAN), kSensorErrorStatus) == 0 &&
+            createDataHash(NAN, 60.2f, 45.0f, 70.0f, false) !=
+                createDataHash(0.0f, 60.2f, 45.0f, 70.0f, false) &&
+            createDataHash(NAN, 60.2f, 45.0f, 70.0f, false) !=
+                createDataHash(-1638.4f, 60.2f, 45.0f, 70.0f, false) &&
+            createDataHash(NAN, 60.2f, 45.0f, 70.0f, false) ==
+                createDataHash(NAN, 60.2f, 45.0f, 70.0f, false);
+
+  static SampleRing ring;
+  ring.push(kDefaultEpochMs, 0, NAN, NAN, 45.0f, 70.0f, false);
+  char json[256];
+  JsonWriter writer(json, sizeof(json));
+  ring.writeJson(writer, 0, 1);
+  ok = ok && strstr(json, "\"temp\":null,\"hum\":null,\"soil\":45.0") != nullptr;
+
+  TelemetryFrame frame = {};
+  frame.temperature = sensorTenths(NAN);
+  frame.humidity = sensorTenths(55.0f);
+  uint8_t bytes[kTelemetryMaxFrame];
+  TelemetryFrame decoded;
+  ok = ok && decodeTelemetryFrame(bytes, encodeTelemetryFrame(frame, bytes, sizeof(bytes)),
+                                  &decoded) &&
+       isnan(tenthsToFloat(decoded.temperature)) && tenthsToFloat(decoded.humidity) == 55.0f;
+  if (!ok) fprintf(stderr, "  a NaN reading turned into a number or a normal status\n");
+  return ok;
+}
+
+// Pump actuator with a cut-off timer that fires only when told to, like an
+// esp_timer expiring while loop() is busy elsewhere.
+class TimerPump : public PumpActuator {
+ public:
+  void setPump(int zone, bool on) override { on_[zone] = on; }
+  bool armCutoff(int zone, unsigned long) override {
+    fired_[zone] = false;
+    return true;
+  }
+  bool takeCutoff(int zone, unsigned long* offAtMs) override {
+    if (!fired_[zone]) return false;
+    fired_[zone] = false;
+    *offAtMs = offAt_[zone];
+    return true;
+  }
+
+  void Fire(int zone, unsigned long now) {
+    on_[zone] = false;
+    offAt_[zone] = now;
+    fired_[zone] = true;
+  }
+  bool on(int zone) const { return on_[zone]; }
+
+ private:
+  bool on_[TOMATO_MAX_ZONES] = {};
+  bool fired_[TOMATO_MAX_ZONES] = {};
+  unsigned long offAt_[TOMATO_MAX_ZONES] = {};
+};
+
+// A start() that lands after the hardware cut-off fired but before service()
+// consumed it must close the old run and switch the relay back on.
+bool CheckPumpCutoffRace() {
+  HostPlatform platform(1);
+  TimerPump pump;
+  PumpService pumps(pump, platform);
+  bool ok = pumps.start(0, 10000, PUMP_SOURCE_AUTO) && pump.on(0);
+  platform.AdvanceTo(10000);
+  pump.Fire(0, 10000);
+  ok = ok && pumps.start(0, 5000, PUMP_SOURCE_COMMAND) && pump.on(0) && pumps.running(0);
+  const PumpRun* first = pumps.lastRun(0);
+  ok = ok && first && first->end == PUMP_END_TIMER && first->actualMs == 10000 &&
+       pumps.stats().runs == 1 && pumps.remainingMs(0) == 5000;
+  pumps.service();
+  ok = ok && pumps.running(0) && pump.on(0);
+  platform.AdvanceTo(15000);
+  pump.Fire(0, 15000);
+  pumps.service();
+  ok = ok && !pumps.running(0) && pumps.stats().runs == 2 && pumps.stats().timerCutoffs == 2;
+  if (!ok) fprintf(stderr, "  pump start after an unconsumed cut-off left the relay off\n");
+  return ok;
+}
+
+// An app OFF that arrives in the same loop() pass as an already-fired
+// cut-off must not swallow the end of that run: the Safety Timer notice and
+// lastWateringTime still come from the timer.
+bool CheckCutoffBeforeAppOff() {
+  HostPlatform platform(3);
+  BenchRtdb rtdb;
+  TimerPump pump;
+  HostZones zones(1);
+  HostSensors sensors(platform);
+  DeviceConfig config = defaultDeviceConfig();
+  config.diagnosticsInterval = 0;
+  TomatoDevice device(platform, rtdb, pump, zones.zones(), zones.count(), config);
+  device.begin();
+  device.state.timeInitialized = true;
+
+  unsigned long now = device.tuning().interval;
+  rtdb.control = "{\"operating_mode\":\"MANUAL\",\"pompa_status\":\"ON\"}";
+  platform.AdvanceTo(now);
+  device.loop(sensors);
+  bool ok = pump.on(0) && device.zone(0).state.wateringInProgress;
+
+  pump.Fire(0, now + 1000);
+  now += device.tuning().interval;
+  rtdb.control = "{\"operating_mode\":\"MANUAL\",\"pompa_status\":\"OFF\"}";
+  platform.AdvanceTo(now);
+  device.loop(sensors);
+  const ZoneState& zs = device.zone(0).state;
+  const PumpRun* run = device.pumps().lastRun(0);
+  ok = ok && !pump.on(0) && !zs.wateringInProgress && !zs.currentPompaStatus &&
+       zs.lastWateringTime == now && rtdb.safety_notices == 1 && run &&
+       run->end == PUMP_END_TIMER;
+  if (!ok) fprintf(stderr, "  app OFF after a fired cut-off lost the Safety Timer run end\n");
+  return ok;
+}
+
+// config_version in the control node and "version" in /config are uint32
+// version numbers: anything else is ignored (control) or rejected (/config),
+// never cast. Out-of-range array entries are rejected before the int cast.
+bool CheckConfigVersion() {
+  Device fixture(1, 7);
+  TomatoDevice& device = *fixture.device;
+  unsigned long now = kSampleIntervalMs;
+  // Reads control with `value`, then gives the next sample a chance to
+  // fetch /config. Returns how many times it did.
+  auto fetches = [&](const char* value) {
+    static char control[128];
+    snprintf(control, sizeof(control), "{\"operating_mode\":\"AUTO\",\"config_version\":%s}",
+             value);
+    fixture.rtdb.control = control;
+    unsigned long before = fixture.rtdb.config_gets;
+    for (int i = 0; i < 2; i++) {
+      now += device.tuning().interval;
+      fixture.platform.AdvanceTo(now);
+      device.loop(fixture.sensors);
+    }
+    return fixture.rtdb.config_gets - before;
+  };
+  bool ok = fetches("7") == 1 && fetches("7") == 0;
+  const char* invalid[] = {"\"nan\"", "\"inf\"", "1e999", "-1", "0", "7.5", "4294967296"};
+  for (const char* value : invalid) ok = ok && fetches(value) == 0;
+  ok = ok && fetches("4294967295") == 1;
+
+  RemoteConfig config;
+  const char* error = "";
+  const RemoteConfig defaults = remoteConfigDefaults(5000, 60000, 15000);
+  const char* bad[] = {
+      "{\"version\":1.5}",
+      "{\"version\":\"nan\"}",
+      "{\"version\":2,\"stage_last_day\":[1e20,50,90]}",
+      "{\"version\":2,\"soil_threshold\":[30,-1e20,60,70]}",
+  };
+  for (const char* doc : bad) {
+    ok = ok && !parseRemoteConfig(jsonSpanOf(doc, strlen(doc)), defaults, &config, &error);
+  }
+  const char* good = "{\"version\":4294967295,\"stage_last_day\":[14,50,90]}";
+  ok = ok && parseRemoteConfig(jsonSpanOf(good, strlen(good)), defaults, &config, &error) &&
+       config.version == 4294967295u && config.crop.stageLastDay[0] == 14;
+  if (!ok) fprintf(stderr, "  a non-integer or out-of-range config version was accepted\n");
+  return ok;
+}
+
+// Every changed sample must produce one PATCH holding valid JSON per zone.
+bool CheckSend(Device& fixture, int zones) {
+  TomatoDevice& device = *fixture.device;
+  unsigned long patches = fixture.rtdb.patch_count;
+  device.state.currentTemperature += 0.5f;
+  device.sendToFirebase(kDefaultEpochMs);
+  bool ok = fixture.rtdb.patch_count == patches + 1 && fixture.rtdb.patch_bytes > 0;
+  if (!ok) fprintf(stderr, "  sendToFirebase (%d zones) did not send its batch\n", zones);
+  return ok;
+}
+
+bool CheckNotifications(Device& fixture) {
+  TomatoDevice& device = *fixture.device;
+  device.state.lastFirebaseNotification[0] = '\0';
+  unsigned long puts = fixture.rtdb.put_count;
+  device.checkFirebaseNotifications();
+  bool ok = fixture.rtdb.put_count == puts + 1 &&
+            strcmp(device.state.lastFirebaseNotification, "Jadwal pemupukan minggu ini") == 0;
+  if (!ok) fprintf(stderr, "  checkFirebaseNotifications did not find the unread notification\n");
+  return ok;
+}
+
+// Lines come back intact and in order across the wrap-around; a full ring
+// drops and counts the line instead of overwriting.
+bool CheckLogRing() {
+  static LogRing ring;
+  char line[LogRing::kMaxLine + 1];
+  char out[LogRing::kMaxLine + 1];
+  bool ok = true;
+  for (int i = 0; i < 1000 && ok; i++) {
+    int length = snprintf(line, sizeof(line), "baris %d %.*s", i, i % 200, kLogPadding);
+    ok = ring.push(line, (size_t)length) && ring.pop(out, sizeof(out)) == (size_t)length &&
+         strcmp(out, line) == 0;
+  }
+  int pushed = 0;
+  while (ok && ring.push(kLogPadding, 100)) pushed++;
+  ok = ok && pushed == (int)(LogRing::kCapacity / 102) && ring.dropped() == 1;
+  while (ok && pushed > 0 && ring.pop(out, sizeof(out)) == 100) pushed--;
+  ok = ok && pushed == 0 && ring.empty();
+  if (!ok) fprintf(stderr, "  LogRing lost, reordered or miscounted lines\n");
+  return ok;
+}
+
+// A DHT22 reply as the RMT receiver records it: the release high, the
+// 80/80 us response, then 40 bits of 50 us low plus a 26 or 70 us high.
+int EncodeDht22(float temperature, float humidity, bool corrupt, DhtPulse* out) {
+  int t = (int)lroundf(fabsf(temperature) * 10);
+  int h = (int)lroundf(humidity * 10);
+  uint8_t data[5] = {(uint8_t)(h >> 8), (uint8_t)h,
+                     (uint8_t)((t >> 8) | (temperature < 0 ? 0x80 : 0)), (uint8_t)t, 0};
+  data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3] + (corrupt ? 1 : 0));
+  int n = 0;
+  out[n++] = {1, 30};
+  out[n++] = {0, 80};
+  out[n++] = {1, 80};
+  for (int bit = 0; bit < 40; bit++) {
+    out[n++] = {0, 50};
+    out[n++] = {1, (uint16_t)((data[bit / 8] >> (7 - bit % 8)) & 1 ? 70 : 26)};
+  }
+  out[n++] = {0, 50};
+  out[n++] = {1, 0};  // RMT end marker
+  return n;
+}
+
+// Replays one scripted reply per startRead(): a good frame, a frame with a
+// bad checksum, or silence.
+class ScriptedDhtBus : public DhtBus {
+ public:
+  enum Reply { GOOD, BAD_CHECKSUM, SILENT };
+
+  void set_reply(Reply reply) { reply_ = reply; }
+  int starts() const { return starts_; }
+
+  bool startRead() override {
+    starts_++;
+    pending_ = true;
+    return true;
+  }
+  int takePulses(DhtPulse* out, size_t capacity) override {
+    if (!pending_ || reply_ == SILENT || capacity < 96) return 0;
+    pending_ = false;
+    return EncodeDht22(-10.1f, 65.2f, reply_ == BAD_CHECKSUM, out);
+  }
+  void cancelRead() override { pending_ = false; }
+
+ private:
+  Reply reply_ = GOOD;
+  bool pending_ = false;
+  int starts_ = 0;
+};
+
+// Decoding covers negative temperatures and rejects bad checksums and
+// truncated captures; the sensor caches, rate-limits to 2 s, retries after
+// a failure and reports NaN once its value is stale.
+bool CheckDht22() {
+  DhtPulse pulses[Dht22Sensor::kMaxPulses];
+  float t = 0, h = 0;
+  int n = EncodeDht22(-10.1f, 65.2f, false, pulses);
+  bool ok = decodeDht22(pulses, (size_t)n, &t, &h) == DHT_OK && fabsf(t + 10.1f) < 0.01f &&
+            fabsf(h - 65.2f) < 0.01f;
+  n = EncodeDht22(23.4f, 99.9f, false, pulses);
+  ok = ok && decodeDht22(pulses, (size_t)n, &t, &h) == DHT_OK && fabsf(t - 23.4f) < 0.01f;
+  n = EncodeDht22(23.4f, 55.0f, true, pulses);
+  ok = ok && decodeDht22(pulses, (size_t)n, &t, &h) == DHT_ERR_CHECKSUM;
+  ok = ok && decodeDht22(pulses, 60, &t, &h) == DHT_ERR_SHORT;
+  n = EncodeDht22(23.4f, 55.0f, false, pulses);
+  pulses[n - 5].us = 400;
+  ok = ok && decodeDht22(pulses, (size_t)n, &t, &h) == DHT_ERR_TIMING;
+
+  HostPlatform platform(1);
+  ScriptedDhtBus bus;
+  Dht22Sensor sensor(bus, platform, 5000, 15000);
+  sensor.begin();
+  sensor.service();
+  ok = ok && sensor.read(&t, &h) && fabsf(t + 10.1f) < 0.01f && bus.starts() == 1;
+  platform.AdvanceTo(4999);
+  sensor.service();
+  ok = ok && bus.starts() == 1;  // cached until the refresh interval
+  bus.set_reply(ScriptedDhtBus::BAD_CHECKSUM);
+  platform.AdvanceTo(5000);
+  sensor.service();
+  sensor.service();
+  ok = ok && sensor.stats().checksumErrors == 1 && sensor.read(&t, &h);
+  bus.set_reply(ScriptedDhtBus::SILENT);
+  platform.AdvanceTo(6999);
+  sensor.service();
+  ok = ok && bus.starts() == 2;  // never faster than 2 s
+  platform.AdvanceTo(7000);
+  sensor.service();
+  platform.AdvanceTo(7030);
+  sensor.service();
+  ok = ok && bus.starts() == 3 && sensor.stats().retries == 1 && sensor.stats().timeouts == 1;
+  platform.AdvanceTo(15001);
+  ok = ok && !sensor.read(&t, &h) && isnan(t) && isnan(h);
+  bus.set_reply(ScriptedDhtBus::GOOD);
+  platform.AdvanceTo(16000);
+  sensor.service();
+  sensor.service();
+  ok = ok && sensor.read(&t, &h) && sensor.stats().ok == 2 && sensor.stats().reads == 4;
+  if (!ok) fprintf(stderr, "  DHT22 decoding, caching or retry accounting is wrong\n");
+  return ok;
+}
+
+// --- Report ---
+
+void PrintResult(FILE* out, const Result& r) {
+  fprintf(out, "  %-36s %10.1f ns/op  [%.1f, %.1f]  %6.2f allocs/op %8.1f B/op\n", r.name.c_str(),
+         r.median, r.ci_low, r.ci_high, r.allocs_per_op, r.bytes_per_op);
+}
+
+bool WriteJson(const std::string& path, const Options& options,
+               const std::vector<Result>& results) {
+  FILE* out = path == "-" ? stdout : fopen(path.c_str(), "w");
+  if (out == nullptr) {
+    perror(path.c_str());
+    return false;
+  }
+  fprintf(out, "{\"tool\":\"firmware_bench\",\"schema\":1,\"samples\":%d,\"min_sample_ms\":%g,",
+          options.samples, options.min_sample_ms);
+  fprintf(out, "\"benchmarks\":[\n");
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    fprintf(out,
+            "{\"name\":\"%s\",\"ns_per_op\":%.3f,\"ci95_low\":%.3f,\"ci95_high\":%.3f,"
+            "\"min\":%.3f,\"mean\":%.3f,\"stddev\":%.3f,\"allocs_per_op\":%.4f,"
+            "\"bytes_per_op\":%.2f,\"iterations\":%llu,\"ops\":%llu}%s\n",
+            r.name.c_str(), r.median, r.ci_low, r.ci_high, r.min, r.mean, r.stddev,
+            r.allocs_per_op, r.bytes_per_op, (unsigned long long)r.iterations,
+            (unsigned long long)r.ops, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(out, "]}\n");
+  bool ok = !ferror(out);
+  if (out != stdout) ok = fclose(out) == 0 && ok;
+  return ok;
+}
+
+bool ReadFile(const std::string& path, std::string* contents) {
+  FILE* in = fopen(path.c_str(), "rb");
+  if (in == nullptr) return false;
+  char chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) contents->append(chunk, n);
+  fclose(in);
+  return true;
+}
+
+// Prints the change against a --json file from another build. The JSON is
+// read with the firmware's own parser (rtdb_json.h).
+bool Compare(FILE* out, const std::string& path, const std::vector<Result>& results) {
+  std::string text;
+  if (!ReadFile(path, &text)) {
+    perror(path.c_str());
+    return false;
+  }
+  JsonSpan list;
+  if (!jsonFindMember(jsonSpanOf(text.data(), text.size()), "benchmarks", &list)) {
+    fprintf(stderr, "firmware_bench: %s is not a firmware_bench --json file\n", path.c_str());
+    return false;
+  }
+  fprintf(out, "compared with %s:\n", path.c_str());
+  for (const Result& r : results) {
+    JsonArrayIterator it(list);
+    JsonSpan entry, field;
+    bool found = false;
+    double median = 0, low = 0, high = 0, allocs = 0;
+    while (!found && it.next(&entry)) {
+      char name[64];
+      found = jsonFindMember(entry, "name", &field) &&
+              jsonCopyString(field, name, sizeof(name)) > 0 && r.name == name &&
+              jsonFindMember(entry, "ns_per_op", &field) && jsonToDouble(field, &median) &&
+              jsonFindMember(entry, "ci95_low", &field) && jsonToDouble(field, &low) &&
+              jsonFindMember(entry, "ci95_high", &field) && jsonToDouble(field, &high) &&
+              jsonFindMember(entry, "allocs_per_op", &field) && jsonToDouble(field, &allocs);
+    }
+    if (!found || median <= 0) {
+      fprintf(out, "  %-36s (new)\n", r.name.c_str());
+      continue;
+    }
+    // Disjoint intervals: the change is beyond run-to-run noise.
+    const char* verdict = r.ci_high < low ? "faster" : r.ci_low > high ? "slower" : "same";
+    fprintf(out, "  %-36s %10.1f -> %10.1f ns/op %+7.1f%%  %-6s  allocs/op %.2f -> %.2f\n",
+            r.name.c_str(), median, r.median, (r.median / median - 1) * 100, verdict, allocs,
+            r.allocs_per_op);
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+  UseWibTimezone();
+
+  Inputs inputs;
+  FillInputs(options.seed, &inputs);
+  const int mask = kInputCount - 1;
+  Device one_zone(1, options.seed);
+  Device four_zones(4, options.seed);
+
+  int failures = 0;
+  if (options.check) {
+    if (!CheckLogic()) failures++;
+    if (!CheckNoReading()) failures++;
+    if (!CheckSend(one_zone, 1)) failures++;
+    if (!CheckSend(four_zones, 4)) failures++;
+    if (!CheckNotifications(one_zone)) failures++;
+    if (!CheckLogRing()) failures++;
+    if (!CheckPumpCutoffRace()) failures++;
+    if (!CheckCutoffBeforeAppOff()) failures++;
+    if (!CheckConfigVersion()) failures++;
+    if (!CheckDht22()) failures++;
+  }
+
+  // Sets every zone to input i and moves the virtual clock one sample on,
+  // the way processSample leaves the device before its alert and upload steps.
+  auto set_sample = [&](Device& fixture, uint64_t i) {
+    TomatoDevice& device = *fixture.device;
+    int at = (int)(i & mask);
+    device.state.currentTemperature = inputs.temperature[at];
+    device.state.currentHumidity = inputs.humidity[at];
+    for (int z = 0; z < device.zoneCount(); z++) {
+      ZoneState& zs = device.zone(z).state;
+      zs.currentSoilPercent = inputs.soil[(at + z) & mask];
+      zs.currentBrightnessPercent = inputs.brightness[(at + z) & mask];
+      zs.isDay = zs.currentBrightnessPercent > 25.0f;
+    }
+    fixture.platform.AdvanceTo((unsigned long)((i + 2) * kSampleIntervalMs));
+  };
+  auto send = [&](Device& fixture) {
+    return [&fixture, &set_sample](uint64_t first, uint64_t iterations) {
+      for (uint64_t i = first; i < first + iterations; i++) {
+        set_sample(fixture, i);
+        fixture.device->sendToFirebase(kDefaultEpochMs + (long long)i * kSampleIntervalMs);
+      }
+    };
+  };
+  auto alerts = [&](Device& fixture) {
+    return [&fixture, &set_sample](uint64_t first, uint64_t iterations) {
+      for (uint64_t i = first; i < first + iterations; i++) {
+        set_sample(fixture, i);
+        fixture.device->checkAndGenerateNotifications();
+      }
+    };
+  };
+
+  const Benchmark benchmarks[] = {
+      {"createDataHash",
+       [&](uint64_t first, uint64_t iterations) {
+         for (uint64_t i = first; i < first + iterations; i++) {
+           int at = (int)(i & mask);
+           DoNotOptimize(createDataHash(inputs.temperature[at], inputs.humidity[at],
+                                        inputs.soil[at], inputs.brightness[at], i & 1));
+         }
+       }},
+      {"getSoilCategory",
+       [&](uint64_t first, uint64_t iterations) {
+         for (uint64_t i = first; i < first + iterations; i++) {
+           DoNotOptimize(getSoilCategory(inputs.soil[i & mask]));
+         }
+       }},
+      {"getBrightnessCategory",
+       [&](uint64_t first, uint64_t iterations) {
+         for (uint64_t i = first; i < first + iterations; i++) {
+           DoNotOptimize(getBrightnessCategory(inputs.brightness[i & mask]));
+         }
+       }},
+      {"getPlantStage",
+       [&](uint64_t first, uint64_t iterations) {
+         for (uint64_t i = first; i < first + iterations; i++) {
+           DoNotOptimize(getPlantStage(inputs.age[i & mask]));
+         }
+       }},
+      {"checkAndGenerateNotifications/1zone", alerts(one_zone)},
+      {"checkAndGenerateNotifications/4zones", alerts(four_zones)},
+      {"sendToFirebase/1zone", send(one_zone)},
+      {"sendToFirebase/4zones", send(four_zones)},
+      {"checkFirebaseNotifications/5",
+       [&](uint64_t first, uint64_t iterations) {
+         for (uint64_t i = first; i < first + iterations; i++) {
+           one_zone.device->checkFirebaseNotifications();
+         }
+       }},
+      // One typical notification line in and out, as log() and the drain task.
+      {"LogRing push+pop",
+       [&](uint64_t first, uint64_t iterations) {
+         static LogRing ring;
+         static char out[LogRing::kMaxLine + 1];
+         for (uint64_t i = first; i < first + iterations; i++) {
+           ring.push(kLogPadding, 48 + (i & 31));
+           DoNotOptimize(ring.pop(out, sizeof(out)));
+         }
+       }},
+      // One captured reply decoded, as Dht22Sensor::service() per read.
+      {"decodeDht22",
+       [&](uint64_t first, uint64_t iterations) {
+         static DhtPulse pulses[Dht22Sensor::kMaxPulses];
+         static int count = EncodeDht22(24.6f, 71.3f, false, pulses);
+         float t = 0, h = 0;
+         for (uint64_t i = first; i < first + iterations; i++) {
+           DoNotOptimize(decodeDht22(pulses, (size_t)count, &t, &h));
+           DoNotOptimize(t + h);
+         }
+       }},
+  };
+
+  // With --json -, stdout carries the JSON and the table moves to stderr.
+  FILE* report = options.json_path == "-" ? stderr : stdout;
+  fprintf(report, "firmware_bench: %d samples of >= %g ms each, median ns/op [95%% CI]\n",
+          options.samples, options.min_sample_ms);
+  std::vector<Result> results;
+  for (const Benchmark& bench : benchmarks) {
+    if (!options.filter.empty() && strstr(bench.name, options.filter.c_str()) == nullptr) {
+      continue;
+    }
+    results.push_back(Measure(bench, options));
+    PrintResult(report, results.back());
+    if (options.check && results.back().allocs_per_op > 0) {
+      fprintf(stderr, "  %s allocates on the heap\n", bench.name);
+      failures++;
+    }
+  }
+
+  if (!options.json_path.empty() && !WriteJson(options.json_path, options, results)) return 2;
+  if (!options.compare_path.empty() && !Compare(report, options.compare_path, results)) {
+    return 2;
+  }
+  if (options.check) {
+    fprintf(report, "firmware_bench: %s\n", failures == 0 ? "check passed" : "check FAILED");
+  }
+  return failures == 0 ? 0 : 1;
+}
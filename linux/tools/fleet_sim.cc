@@ -0,0 +1,204 @@
+// Fleet simulator: runs N virtual SmartFarm Tomato nodes (the real firmware
+// logic from firmware/tomato_device.h) on a thread pool against an in-process
+// RTDB stand-in, and reports the write load the backend would see.
+//
+// Usage:
+//   fleet_sim [--devices 1,10,100,1000] [--zones 1] [--minutes 60]
+//             [--threads N] [--seed S] [--verbose]
+//
+// Rates are per simulated second, i.e. what Firebase would receive from a
+// real fleet of that size; wall time only tells how long the run took.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "host_platform.h"
+#include "memory_rtdb.h"
+#include "tomato_device.h"
+
+namespace {
+
+// Granularity of the virtual loop(); the firmware spins much faster, but all
+// of its timers are multiples of 100 ms.
+const unsigned long kStepMs = 100;
+
+struct Options {
+  std::vector<int> device_counts = {1, 10, 100, 1000};
+  int zones = 1;
+  unsigned long minutes = 60;
+  int threads = 0;
+  uint64_t seed = 42;
+  bool verbose = false;
+};
+
+struct VirtualDevice {
+  VirtualDevice(MemoryRtdb& store, const HostZones& zones, uint64_t seed)
+      : platform(seed),
+        sensors(platform),
+        rtdb(store),
+        device(platform, rtdb, pump, zones.zones(), zones.count()) {}
+
+  HostPlatform platform;
+  HostSensors sensors;
+  CountingPump pump;
+  MemoryRtdbTransport rtdb;
+  TomatoDevice device;
+  unsigned long phase_ms = 0;
+};
+
+struct RunResult {
+  int devices = 0;
+  double simulated_s = 0;
+  double wall_s = 0;
+  RtdbCounters counters;
+  unsigned long pump_switches = 0;
+};
+
+std::vector<int> ParseList(const char* text) {
+  std::vector<int> values;
+  for (const char* p = text; *p;) {
+    values.push_back(atoi(p));
+    const char* comma = strchr(p, ',');
+    if (!comma) break;
+    p = comma + 1;
+  }
+  return values;
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--devices") == 0 && value) {
+      options->device_counts = ParseList(value);
+      i++;
+    } else if (strcmp(arg, "--zones") == 0 && value) {
+      options->zones = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--minutes") == 0 && value) {
+      options->minutes = strtoul(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--threads") == 0 && value) {
+      options->threads = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--seed") == 0 && value) {
+      options->seed = strtoull(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--verbose") == 0) {
+      options->verbose = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--devices 1,10,100] [--zones Z] [--minutes M] "
+              "[--threads N] [--seed S] [--verbose]\n",
+              argv[0]);
+      return false;
+    }
+  }
+  return !options->device_counts.empty() && options->minutes > 0 && options->zones > 0 &&
+         options->zones <= TOMATO_MAX_ZONES;
+}
+
+// Runs each device's whole simulated timeline on whichever pool thread
+// claims it next.
+void RunDevices(std::vector<std::unique_ptr<VirtualDevice>>& fleet, unsigned long duration_ms,
+                int threads) {
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < fleet.size(); i = next++) {
+      VirtualDevice& node = *fleet[i];
+      node.platform.AdvanceTo(node.phase_ms);
+      node.device.begin();
+      for (unsigned long t = node.phase_ms; t < node.phase_ms + duration_ms; t += kStepMs) {
+        node.platform.AdvanceTo(t);
+        node.device.loop(node.sensors);
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int i = 0; i < threads; i++) pool.emplace_back(worker);
+  for (auto& thread : pool) thread.join();
+}
+
+RunResult RunFleet(int devices, const Options& options, int threads) {
+  // Keep a bounded window of each collection; load figures do not depend on
+  // retaining every history row.
+  MemoryRtdb store(2000);
+  HostZones zones(options.zones);
+  std::vector<std::unique_ptr<VirtualDevice>> fleet;
+  fleet.reserve(devices);
+  for (int i = 0; i < devices; i++) {
+    std::unique_ptr<VirtualDevice> node(
+        new VirtualDevice(store, zones, options.seed * 1000003ULL + i));
+    node->platform.set_verbose(options.verbose);
+    node->device.state.timeInitialized = true;
+    // Spread boot times so nodes do not sample in lockstep.
+    node->phase_ms = (unsigned long)node->platform.random(0, 5000) / kStepMs * kStepMs;
+    fleet.push_back(std::move(node));
+  }
+
+  const unsigned long duration_ms = options.minutes * 60UL * 1000UL;
+  auto start = std::chrono::steady_clock::now();
+  RunDevices(fleet, duration_ms, threads);
+  auto wall = std::chrono::steady_clock::now() - start;
+
+  RunResult result;
+  result.devices = devices;
+  result.simulated_s = duration_ms / 1000.0;
+  result.wall_s = std::chrono::duration<double>(wall).count();
+  for (auto& node : fleet) {
+    result.counters.Merge(node->rtdb.counters());
+    result.pump_switches += node->pump.switches();
+  }
+  return result;
+}
+
+double PercentileUs(std::vector<uint32_t>* samples, double fraction) {
+  if (samples->empty()) return 0;
+  size_t index = (size_t)(fraction * (samples->size() - 1));
+  std::nth_element(samples->begin(), samples->begin() + index, samples->end());
+  return (*samples)[index] / 1000.0;
+}
+
+void PrintResult(RunResult* result) {
+  const RtdbCounters& c = result->counters;
+  double seconds = result->simulated_s;
+  double p50 = PercentileUs(&result->counters.write_latency_ns, 0.50);
+  double p99 = PercentileUs(&result->counters.write_latency_ns, 0.99);
+  printf("%8d %10.2f %10.2f %10.2f %12.0f %12.0f %9.2f %9.2f %8.2f\n", result->devices,
+         (c.gets + c.puts + c.patches) / seconds, (c.puts + c.patches) / seconds, c.gets / seconds,
+         c.bytes_up / seconds, c.bytes_down / seconds, p50, p99, result->wall_s);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+  UseWibTimezone();
+
+  int threads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+  if (threads <= 0) threads = 1;
+
+  printf("fleet_sim: %lu simulated minutes per device, %d zone(s), %d threads\n", options.minutes,
+         options.zones, threads);
+  printf("%8s %10s %10s %10s %12s %12s %9s %9s %8s\n", "devices", "req/s", "write/s", "read/s",
+         "up B/s", "down B/s", "p50 us", "p99 us", "wall s");
+  for (int devices : options.device_counts) {
+    if (devices <= 0) continue;
+    RunResult result = RunFleet(devices, options, threads);
+    PrintResult(&result);
+    fflush(stdout);
+  }
+  return 0;
+}
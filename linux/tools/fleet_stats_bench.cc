@@ -0,0 +1,351 @@
+// Benchmarks the admin dashboard aggregates (linux/native/fleet_stats.h) on a
+// synthetic fleet: every device reports temperature at a fixed interval with
+// a daily cycle, noise, failed reads (NaN) and offline gaps, laid out device
+// after device as the columnar cache stores it. A separate alert column
+// stands in for a busy week of `alerts`. Each aggregate runs with the vector
+// and the scalar kernel so the SIMD gain is visible, and top-k is compared
+// against sorting every alert, which is what the dashboard used to do.
+// --check also requires both kernels to agree bit for bit and every result to
+// match a straightforward reference implementation.
+//
+// Usage:
+//   fleet_stats_bench [--devices 100] [--days 30] [--interval-s 60]
+//                     [--alerts 1000000] [--top 10] [--iterations 5]
+//                     [--check] [--seed S]
+//
+// Exit status: 0 on success, 1 when --check finds a mismatch, 2 on bad
+// arguments.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "fleet_stats.h"
+
+namespace {
+
+using smartfarm::StatsKernel;
+
+// The farmer dashboard's comfortable band for tomatoes.
+constexpr float kLow = 18.0f;
+constexpr float kHigh = 32.0f;
+constexpr int64_t kMaxGapMs = 10 * 60 * 1000;
+
+struct Options {
+  int devices = 100;
+  int days = 30;
+  int interval_s = 60;
+  int alerts = 1000000;
+  int top = 10;
+  int iterations = 5;
+  bool check = false;
+  uint64_t seed = 42;
+};
+
+struct Fleet {
+  std::vector<int64_t> t;
+  std::vector<float> y;
+  std::vector<uint64_t> offsets;  // devices + 1
+  std::vector<int64_t> alerts;    // alert timestamps in push order
+};
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--devices") == 0 && value) {
+      options->devices = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--days") == 0 && value) {
+      options->days = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--interval-s") == 0 && value) {
+      options->interval_s = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--alerts") == 0 && value) {
+      options->alerts = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--top") == 0 && value) {
+      options->top = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--iterations") == 0 && value) {
+      options->iterations = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--seed") == 0 && value) {
+      options->seed = strtoull(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--check") == 0) {
+      options->check = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--devices N] [--days D] [--interval-s S] [--alerts A] [--top K] "
+              "[--iterations N] [--check] [--seed S]\n",
+              argv[0]);
+      return false;
+    }
+  }
+  return options->devices > 0 && options->days > 0 && options->interval_s > 0 &&
+         options->alerts >= 0 && options->top >= 0 && options->iterations > 0;
+}
+
+Fleet Generate(const Options& options) {
+  std::mt19937_64 rng(options.seed);
+  std::normal_distribution<float> noise(0.0f, 0.8f);
+  std::uniform_int_distribution<int> chance(0, 99999);
+  const size_t per_device = (size_t)options.days * 86400 / options.interval_s;
+  const int64_t start = 1735664400000LL;  // 2025-01-01 00:00 WIB
+  Fleet fleet;
+  fleet.t.reserve(per_device * options.devices);
+  fleet.y.reserve(per_device * options.devices);
+  fleet.offsets.push_back(0);
+  for (int device = 0; device < options.devices; device++) {
+    // Greenhouses differ: some run hot, some cool.
+    const float bias = (float)(device % 7) - 3.0f;
+    int64_t t = start + device * 1000LL;
+    for (size_t i = 0; i < per_device; i++) {
+      t += options.interval_s * 1000LL;
+      if (chance(rng) < 10) t += 45 * 60 * 1000;  // offline for 45 min
+      double hour = fmod(t / 3600000.0 + 7, 24.0);
+      float value = 25 + bias + 8 * (float)sin((hour - 8) / 24.0 * 2 * M_PI) + noise(rng);
+      if (chance(rng) < 50) value = NAN;  // DHT22 read failure
+      fleet.t.push_back(t);
+      fleet.y.push_back(value);
+    }
+    fleet.offsets.push_back(fleet.t.size());
+  }
+
+  // Push order is roughly time order; writers racing each other shuffle
+  // neighbours by a few seconds.
+  std::uniform_int_distribution<int64_t> jitter(-5000, 5000);
+  const int64_t week = 7LL * 86400 * 1000;
+  fleet.alerts.reserve(options.alerts);
+  for (int i = 0; i < options.alerts; i++) {
+    fleet.alerts.push_back(start + week * i / std::max(1, options.alerts) + jitter(rng));
+  }
+  return fleet;
+}
+
+// Best-of-N wall time in ms, so one scheduler hiccup does not skew a run.
+template <typename Fn>
+double BestMs(int iterations, Fn fn) {
+  double best = 1e30;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    best = std::min(best, ms);
+  }
+  return best;
+}
+
+bool SameBytes(const void* a, const void* b, size_t bytes) { return memcmp(a, b, bytes) == 0; }
+
+// Sorts a copy of the series: slow, but obviously right.
+bool MatchesReference(const float* y, size_t begin, size_t end, const SmartfarmSummary& s) {
+  std::vector<float> values;
+  double sum = 0;
+  for (size_t i = begin; i < end; i++) {
+    if (isnan(y[i])) continue;
+    values.push_back(y[i]);
+    sum += y[i];
+  }
+  if (s.count != values.size()) return false;
+  if (values.empty()) return s.mean == 0 && s.min == 0 && s.max == 0 && s.p99 == 0;
+  std::sort(values.begin(), values.end());
+  auto at = [&](double p) { return values[(size_t)std::max(1.0, ceil(p * values.size())) - 1]; };
+  double mean = sum / values.size();
+  return fabs(s.mean - mean) <= 1e-4 * std::max(1.0, fabs(mean)) && s.min == values.front() &&
+         s.max == values.back() && s.p50 == at(0.5) && s.p90 == at(0.9) && s.p99 == at(0.99);
+}
+
+SmartfarmExceedance ReferenceExceedance(const int64_t* t, const float* y, size_t n) {
+  SmartfarmExceedance r;
+  memset(&r, 0, sizeof(r));
+  bool was_above = false, was_below = false;
+  for (size_t i = 0; i < n; i++) {
+    int64_t dt = i + 1 < n ? std::min(std::max<int64_t>(t[i + 1] - t[i], 0), kMaxGapMs) : 0;
+    bool above = y[i] > kHigh, below = y[i] < kLow;
+    if (above) r.above_ms += dt;
+    if (below) r.below_ms += dt;
+    if (above && !was_above) r.above_runs++;
+    if (below && !was_below) r.below_runs++;
+    was_above = above;
+    was_below = below;
+  }
+  return r;
+}
+
+// Newest first, ties in input order: a stable sort of every row.
+std::vector<uint32_t> ReferenceTop(const std::vector<int64_t>& t, size_t k) {
+  std::vector<uint32_t> order(t.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint32_t a, uint32_t b) { return t[a] > t[b]; });
+  order.resize(std::min(k, t.size()));
+  return order;
+}
+
+int CheckEdgeCases() {
+  int failures = 0;
+  const float nans[3] = {NAN, NAN, NAN};
+  SmartfarmSummary empty = smartfarm::Summarize(nans, 3);
+  SmartfarmSummary none = smartfarm::Summarize(nans, 0);
+  if (empty.count != 0 || empty.mean != 0 || none.count != 0) {
+    fprintf(stderr, "  all-NaN or empty series did not summarise to zero\n");
+    failures++;
+  }
+  const float one[1] = {21.5f};
+  SmartfarmSummary single = smartfarm::Summarize(one, 1);
+  if (single.count != 1 || single.min != 21.5f || single.p50 != 21.5f || single.p99 != 21.5f) {
+    fprintf(stderr, "  single sample summary is wrong\n");
+    failures++;
+  }
+  const int64_t t[3] = {0, 1000, 2000};
+  const float y[3] = {40, 40, 10};
+  SmartfarmExceedance e = smartfarm::Exceedance(t, y, 3, kLow, kHigh, kMaxGapMs);
+  if (e.above_ms != 2000 || e.above_runs != 1 || e.below_ms != 0 || e.below_runs != 1) {
+    fprintf(stderr, "  exceedance of a 3-sample series is wrong\n");
+    failures++;
+  }
+  uint32_t out[4];
+  const int64_t ties[3] = {5, 5, 5};
+  if (smartfarm::TopRecent(ties, 3, 4, out) != 3 || out[0] != 0 || out[1] != 1 || out[2] != 2 ||
+      smartfarm::TopRecent(ties, 3, 0, out) != 0) {
+    fprintf(stderr, "  top-k of equal timestamps is not in input order\n");
+    failures++;
+  }
+  return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+
+  Fleet fleet = Generate(options);
+  const size_t n = fleet.y.size();
+  const size_t devices = (size_t)options.devices;
+  const size_t k = (size_t)options.top;
+  printf("fleet_stats_bench: %zu devices x %d days every %ds = %zu samples, %zu alerts\n",
+         devices, options.days, options.interval_s, n, fleet.alerts.size());
+
+  std::vector<SmartfarmSummary> groups_vector(devices + 1), groups_scalar(devices + 1);
+  double groups_ms = BestMs(options.iterations, [&] {
+    smartfarm::SummarizeGroups(fleet.y.data(), fleet.offsets.data(), devices,
+                               groups_vector.data(), StatsKernel::kVector);
+  });
+  double groups_scalar_ms = BestMs(options.iterations, [&] {
+    smartfarm::SummarizeGroups(fleet.y.data(), fleet.offsets.data(), devices,
+                               groups_scalar.data(), StatsKernel::kScalar);
+  });
+
+  // Exceedance is per device; time the whole fleet.
+  std::vector<SmartfarmExceedance> exceed_vector(devices), exceed_scalar(devices);
+  auto exceed_all = [&](std::vector<SmartfarmExceedance>* out, StatsKernel kernel) {
+    for (size_t g = 0; g < devices; g++) {
+      size_t begin = fleet.offsets[g], count = fleet.offsets[g + 1] - begin;
+      (*out)[g] = smartfarm::Exceedance(fleet.t.data() + begin, fleet.y.data() + begin, count,
+                                        kLow, kHigh, kMaxGapMs, kernel);
+    }
+  };
+  double exceed_ms =
+      BestMs(options.iterations, [&] { exceed_all(&exceed_vector, StatsKernel::kVector); });
+  double exceed_scalar_ms =
+      BestMs(options.iterations, [&] { exceed_all(&exceed_scalar, StatsKernel::kScalar); });
+
+  const size_t alerts = fleet.alerts.size();
+  std::vector<uint32_t> top_vector(k), top_scalar(k), top_sorted;
+  size_t top_count = 0, top_scalar_count = 0;
+  double top_ms = BestMs(options.iterations, [&] {
+    top_count = smartfarm::TopRecent(fleet.alerts.data(), alerts, k, top_vector.data(),
+                                     StatsKernel::kVector);
+  });
+  double top_scalar_ms = BestMs(options.iterations, [&] {
+    top_scalar_count = smartfarm::TopRecent(fleet.alerts.data(), alerts, k, top_scalar.data(),
+                                            StatsKernel::kScalar);
+  });
+  double sort_ms =
+      BestMs(options.iterations, [&] { top_sorted = ReferenceTop(fleet.alerts, k); });
+
+  printf("  %-11s %9s %9s %8s\n", "aggregate", "vector", "scalar", "speedup");
+  printf("  %-11s %7.2fms %7.2fms %7.2fx\n", "summaries", groups_ms, groups_scalar_ms,
+         groups_scalar_ms / groups_ms);
+  printf("  %-11s %7.2fms %7.2fms %7.2fx\n", "exceedance", exceed_ms, exceed_scalar_ms,
+         exceed_scalar_ms / exceed_ms);
+  printf("  %-11s %7.2fms %7.2fms %7.2fx  (full sort %.2fms)\n", "top-k", top_ms, top_scalar_ms,
+         top_scalar_ms / top_ms, sort_ms);
+  const SmartfarmSummary& all = groups_vector[devices];
+  printf("  fleet: n=%llu mean=%.2f min=%.2f max=%.2f p50=%.2f p90=%.2f p99=%.2f\n",
+         (unsigned long long)all.count, all.mean, all.min, all.max, all.p50, all.p90, all.p99);
+  printf("  %.1f M samples/s (summaries incl. percentiles), %.1f M samples/s (exceedance)\n",
+         n / (groups_ms * 1000.0), n / (exceed_ms * 1000.0));
+
+  if (!options.check) return 0;
+
+  int failures = CheckEdgeCases();
+  if (!SameBytes(groups_vector.data(), groups_scalar.data(),
+                 groups_vector.size() * sizeof(SmartfarmSummary))) {
+    fprintf(stderr, "  summary vector and scalar kernels disagree\n");
+    failures++;
+  }
+  size_t wrong = 0;
+  for (size_t g = 0; g < devices; g++) {
+    if (!MatchesReference(fleet.y.data(), fleet.offsets[g], fleet.offsets[g + 1],
+                          groups_vector[g])) {
+      wrong++;
+    }
+  }
+  if (!MatchesReference(fleet.y.data(), 0, n, groups_vector[devices])) wrong++;
+  if (wrong > 0) {
+    fprintf(stderr, "  %zu of %zu summaries differ from the sorted reference\n", wrong,
+            devices + 1);
+    failures++;
+  }
+
+  if (!SameBytes(exceed_vector.data(), exceed_scalar.data(),
+                 exceed_vector.size() * sizeof(SmartfarmExceedance))) {
+    fprintf(stderr, "  exceedance vector and scalar kernels disagree\n");
+    failures++;
+  }
+  wrong = 0;
+  for (size_t g = 0; g < devices; g++) {
+    size_t begin = fleet.offsets[g], count = fleet.offsets[g + 1] - begin;
+    SmartfarmExceedance r =
+        ReferenceExceedance(fleet.t.data() + begin, fleet.y.data() + begin, count);
+    if (!SameBytes(&r, &exceed_vector[g], sizeof(r))) wrong++;
+  }
+  if (wrong > 0) {
+    fprintf(stderr, "  %zu of %zu exceedance results differ from the reference\n", wrong,
+            devices);
+    failures++;
+  }
+
+  if (top_count != top_sorted.size() || top_scalar_count != top_count ||
+      !std::equal(top_sorted.begin(), top_sorted.end(), top_vector.begin()) ||
+      !std::equal(top_sorted.begin(), top_sorted.end(), top_scalar.begin())) {
+    fprintf(stderr, "  top-k differs from a stable sort of every alert\n");
+    failures++;
+  }
+  // Shuffled input takes the heap path for most rows instead of the prefilter.
+  std::vector<int64_t> shuffled = fleet.alerts;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937_64(options.seed));
+  std::vector<uint32_t> expected = ReferenceTop(shuffled, k), got(k);
+  size_t got_count = smartfarm::TopRecent(shuffled.data(), shuffled.size(), k, got.data());
+  if (got_count != expected.size() || !std::equal(expected.begin(), expected.end(), got.begin())) {
+    fprintf(stderr, "  top-k of shuffled alerts differs from the reference\n");
+    failures++;
+  }
+
+  printf("fleet_stats_bench: %s\n", failures == 0 ? "check passed" : "check FAILED");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,428 @@
+// Fills the desktop app's history cache (linux/native/history_cache.h) with
+// months of synthetic history_data rows, then times the queries the history
+// screen makes: the newest N rows, and day / week ranges anywhere in the
+// file. --check also verifies every query against an in-memory copy,
+// reopens the file to confirm rows and the sync key persist, and confirms a
+// second open is refused while the first holds the lock. Finally it exports
+// the whole file to CSV and to the columnar format (history_export.h),
+// reporting throughput and how much anonymous memory the export added;
+// --check reads both files back and bounds that growth.
+//
+// Usage:
+//   history_cache_sim [--days 180] [--interval-s 30] [--batch 500]
+//                     [--queries 200] [--path FILE] [--check] [--seed S]
+//
+// Exit status: 0 on success, 1 when --check finds a mismatch, 2 on bad
+// arguments or I/O errors.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "history_cache.h"
+#include "history_export.h"
+
+namespace {
+
+using smartfarm::HistoryCache;
+using smartfarm::ExportFormat;
+using smartfarm::HistoryColumns;
+using smartfarm::HistoryExport;
+using smartfarm::HistoryRow;
+
+const int64_t kDayMs = 24LL * 60 * 60 * 1000;
+// An export holds one page of rows plus its write buffer, whatever the range.
+const long kExportMemoryBudgetKiB = 8 * 1024;
+
+struct Options {
+  int days = 180;
+  int interval_s = 30;
+  int batch = 500;
+  int queries = 200;
+  std::string path;
+  bool check = false;
+  uint64_t seed = 42;
+};
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--days") == 0 && value) {
+      options->days = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--interval-s") == 0 && value) {
+      options->interval_s = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--batch") == 0 && value) {
+      options->batch = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--queries") == 0 && value) {
+      options->queries = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--path") == 0 && value) {
+      options->path = value;
+      i++;
+    } else if (strcmp(arg, "--seed") == 0 && value) {
+      options->seed = strtoull(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--check") == 0) {
+      options->check = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--days D] [--interval-s S] [--batch N] [--queries Q] [--path FILE] "
+              "[--check] [--seed S]\n",
+              argv[0]);
+      return false;
+    }
+  }
+  return options->days > 0 && options->interval_s > 0 && options->batch > 0 &&
+         options->queries >= 0;
+}
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Same key shape the firmware writes: data_<timestamp>_<random>.
+std::string KeyFor(const HistoryRow& row, std::mt19937_64& rng) {
+  char key[48];
+  snprintf(key, sizeof(key), "data_%lld_%d", (long long)row.timestamp,
+           (int)(1000 + rng() % 9000));
+  return key;
+}
+
+std::vector<HistoryRow> Generate(const Options& options, int64_t start_ms, std::mt19937_64& rng) {
+  std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+  std::uniform_int_distribution<int> jitter(0, 1500);
+  size_t count = (size_t)options.days * 86400 / options.interval_s;
+  std::vector<HistoryRow> rows(count);
+  for (size_t i = 0; i < count; i++) {
+    HistoryRow& row = rows[i];
+    row.timestamp = start_ms + (int64_t)i * options.interval_s * 1000 + jitter(rng);
+    double hour = fmod((double)(row.timestamp - start_ms) / 3600000.0, 24.0);
+    float day_curve = (float)sin((hour - 8) / 24.0 * 2 * M_PI);
+    row.temperature = 27 + 5 * day_curve + noise(rng);
+    row.humidity = 70 - 15 * day_curve + noise(rng);
+    row.soil = 55 + 10 * (float)cos(i / 900.0) + noise(rng);
+    row.brightness = std::max(0.0f, 80 * day_curve) + noise(rng);
+    row.plant_age = (uint16_t)((row.timestamp - start_ms) / kDayMs);
+    row.flags = (row.soil < 50 ? smartfarm::kHistoryPumpOn : 0) |
+                (i % 5000 < 50 ? smartfarm::kHistoryManual : 0);
+  }
+  return rows;
+}
+
+bool Matches(const std::vector<HistoryRow>& rows, size_t first, const HistoryColumns& got) {
+  for (size_t i = 0; i < got.size(); i++) {
+    const HistoryRow& want = rows[first + i];
+    if (got.timestamp[i] != want.timestamp || got.temperature[i] != want.temperature ||
+        got.humidity[i] != want.humidity || got.soil[i] != want.soil ||
+        got.brightness[i] != want.brightness || got.plant_age[i] != want.plant_age ||
+        got.flags[i] != want.flags) {
+      fprintf(stderr, "  row %zu differs (ts %lld vs %lld)\n", first + i,
+              (long long)got.timestamp[i], (long long)want.timestamp);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs one query and, under --check, compares it with the reference rows.
+bool RunQuery(const HistoryCache& cache, const std::vector<HistoryRow>& rows, int64_t from,
+              int64_t to, size_t limit, bool check, HistoryColumns* out) {
+  cache.Query(from, to, limit, out);
+  if (!check) return true;
+  auto by_ts = [](const HistoryRow& row, int64_t ts) { return row.timestamp < ts; };
+  size_t first = std::lower_bound(rows.begin(), rows.end(), from, by_ts) - rows.begin();
+  auto after = [](int64_t ts, const HistoryRow& row) { return ts < row.timestamp; };
+  size_t end = std::upper_bound(rows.begin(), rows.end(), to, after) - rows.begin();
+  if (limit > 0 && end - first > limit) first = end - limit;
+  if (out->size() != end - first) {
+    fprintf(stderr, "  query [%lld, %lld] limit %zu: %zu rows, want %zu\n", (long long)from,
+            (long long)to, limit, out->size(), end - first);
+    return false;
+  }
+  return Matches(rows, first, *out);
+}
+
+// Anonymous resident memory, which the mmap'd cache pages do not count
+// towards. 0 if /proc is unavailable.
+long RssAnonKiB() {
+  FILE* status = fopen("/proc/self/status", "r");
+  if (status == nullptr) return 0;
+  char line[128];
+  long kib = 0;
+  while (fgets(line, sizeof(line), status) != nullptr) {
+    if (sscanf(line, "RssAnon: %ld kB", &kib) == 1) break;
+  }
+  fclose(status);
+  return kib;
+}
+
+struct ExportRun {
+  uint64_t rows = 0;
+  uint64_t bytes = 0;
+  double ms = 0;
+  long peak_growth_kib = 0;  // RssAnon above its value before the export
+};
+
+bool RunExport(const HistoryCache& cache, ExportFormat format, const std::string& path,
+               ExportRun* run) {
+  long base_kib = RssAnonKiB();
+  auto start = std::chrono::steady_clock::now();
+  HistoryExport exporter;
+  std::string error;
+  bool ok = exporter.Begin(cache, INT64_MIN, INT64_MAX, format, path, &error);
+  while (ok && !exporter.done()) {
+    ok = exporter.Step(&error);
+    run->peak_growth_kib = std::max(run->peak_growth_kib, RssAnonKiB() - base_kib);
+  }
+  smartfarm::ExportProgress progress = exporter.progress();
+  ok = ok && exporter.Finish(&error);
+  run->ms = MsSince(start);
+  run->rows = progress.rows;
+  run->bytes = progress.bytes;
+  if (!ok) fprintf(stderr, "  export %s: %s\n", path.c_str(), error.c_str());
+  return ok;
+}
+
+// Reads a CSV export back: the header, then one line per row with the
+// row's timestamp first and its decoded flags last.
+bool CheckCsv(const std::string& path, const std::vector<HistoryRow>& rows) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (file == nullptr) return false;
+  char line[512];
+  bool ok = fgets(line, sizeof(line), file) != nullptr && strncmp(line, "timestamp,", 10) == 0;
+  size_t count = 0;
+  while (ok && fgets(line, sizeof(line), file) != nullptr) {
+    if (count >= rows.size()) {
+      ok = false;
+      break;
+    }
+    const HistoryRow& want = rows[count];
+    long long timestamp = strtoll(line, nullptr, 10);
+    const char* pump = (want.flags & smartfarm::kHistoryPumpOn) ? ",ON," : ",OFF,";
+    const char* mode = (want.flags & smartfarm::kHistoryManual) ? ",MANUAL," : ",AUTO,";
+    ok = timestamp == want.timestamp && strstr(line, pump) != nullptr &&
+         strstr(line, mode) != nullptr;
+    if (!ok) fprintf(stderr, "  csv line %zu differs: %s", count + 2, line);
+    count++;
+  }
+  fclose(file);
+  if (ok && count != rows.size()) {
+    fprintf(stderr, "  csv has %zu rows, want %zu\n", count, rows.size());
+    ok = false;
+  }
+  return ok;
+}
+
+// Reads a columnar export back block by block and compares every column.
+bool CheckColumnar(const std::string& path, const std::vector<HistoryRow>& rows) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == nullptr) return false;
+  struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t rows;
+    int64_t first_timestamp;
+    int64_t last_timestamp;
+  } header;
+  bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "SFHX", 4) == 0 &&
+            header.version == 1 && header.rows == rows.size() &&
+            header.first_timestamp == rows.front().timestamp &&
+            header.last_timestamp == rows.back().timestamp;
+  if (!ok) fprintf(stderr, "  columnar header is wrong\n");
+  HistoryColumns block;
+  size_t first = 0;
+  uint32_t counts[2];
+  while (ok && fread(counts, sizeof(counts), 1, file) == 1) {
+    size_t count = counts[0];
+    block.Resize(count);
+    ok = first + count <= rows.size() &&
+         fread(block.timestamp.data(), sizeof(int64_t), count, file) == count &&
+         fread(block.temperature.data(), sizeof(float), count, file) == count &&
+         fread(block.humidity.data(), sizeof(float), count, file) == count &&
+         fread(block.soil.data(), sizeof(float), count, file) == count &&
+         fread(block.brightness.data(), sizeof(float), count, file) == count &&
+         fread(block.plant_age.data(), sizeof(uint16_t), count, file) == count &&
+         fread(block.flags.data(), sizeof(uint8_t), count, file) == count &&
+         Matches(rows, first, block);
+    first += count;
+  }
+  fclose(file);
+  if (ok && first != rows.size()) {
+    fprintf(stderr, "  columnar has %zu rows, want %zu\n", first, rows.size());
+    ok = false;
+  }
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+  bool temp_path = options.path.empty();
+  if (temp_path) {
+    char path[] = "/tmp/history_cache_simXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+      perror("mkstemp");
+      return 2;
+    }
+    close(fd);
+    options.path = path;
+  }
+
+  std::mt19937_64 rng(options.seed);
+  const int64_t start_ms = 1735664400000LL;  // 2025-01-01 00:00 WIB
+  std::vector<HistoryRow> rows = Generate(options, start_ms, rng);
+  int failures = 0;
+
+  std::string error;
+  HistoryCache cache;
+  if (!cache.Open(options.path, &error)) {
+    fprintf(stderr, "history_cache_sim: %s\n", error.c_str());
+    return 2;
+  }
+  if (cache.Stats().rows > 0) {
+    fprintf(stderr, "history_cache_sim: %s is not empty\n", options.path.c_str());
+    return 2;
+  }
+
+  // Sync the way the app does: one batch per page of RTDB children.
+  auto start = std::chrono::steady_clock::now();
+  std::string last_key;
+  for (size_t at = 0; at < rows.size(); at += options.batch) {
+    size_t count = std::min<size_t>(options.batch, rows.size() - at);
+    last_key = KeyFor(rows[at + count - 1], rng);
+    if (cache.Append(&rows[at], count, last_key) != (long)count) {
+      fprintf(stderr, "history_cache_sim: append failed at row %zu\n", at);
+      return 2;
+    }
+  }
+  double fill_ms = MsSince(start);
+  smartfarm::HistoryCacheStats stats = cache.Stats();
+  printf("history_cache_sim: %llu rows (%d days every %ds) in %.1f ms, file %.1f MiB\n",
+         (unsigned long long)stats.rows, options.days, options.interval_s, fill_ms,
+         stats.file_bytes / (1024.0 * 1024.0));
+
+  if (options.check) {
+    HistoryRow stale = rows.front();
+    if (cache.Append(&stale, 1, std::string()) != 0 || cache.Stats().rows != rows.size()) {
+      fprintf(stderr, "  out-of-order row was not skipped\n");
+      failures++;
+    }
+    HistoryCache second;
+    if (second.Open(options.path, &error)) {
+      fprintf(stderr, "  second open succeeded while the first holds the lock\n");
+      failures++;
+    }
+  }
+
+  // The history screen's default view, then random day and week windows.
+  HistoryColumns out;
+  const int64_t end_ms = rows.back().timestamp;
+  start = std::chrono::steady_clock::now();
+  if (!RunQuery(cache, rows, INT64_MIN, INT64_MAX, 100, options.check, &out)) failures++;
+  double latest_ms = MsSince(start);
+
+  std::uniform_int_distribution<int64_t> when(start_ms, end_ms);
+  double range_ms = 0;
+  size_t range_rows = 0;
+  for (int i = 0; i < options.queries; i++) {
+    int64_t span = i % 2 == 0 ? kDayMs : 7 * kDayMs;
+    int64_t from = when(rng);
+    start = std::chrono::steady_clock::now();
+    if (!RunQuery(cache, rows, from, from + span, 0, options.check, &out)) failures++;
+    range_ms += MsSince(start);
+    range_rows += out.size();
+  }
+  printf("  latest 100: %.3f ms\n", latest_ms);
+  if (options.queries > 0) {
+    printf("  %d day/week ranges: %.3f ms avg, %.0f rows avg\n", options.queries,
+           range_ms / options.queries, (double)range_rows / options.queries);
+  }
+
+  // What a restarted app sees before it touches the network.
+  cache.Close();
+  start = std::chrono::steady_clock::now();
+  if (!cache.Open(options.path, &error)) {
+    fprintf(stderr, "history_cache_sim: reopen: %s\n", error.c_str());
+    return 2;
+  }
+  if (!RunQuery(cache, rows, INT64_MIN, INT64_MAX, 100, options.check, &out)) failures++;
+  printf("  reopen + latest 100: %.3f ms\n", MsSince(start));
+  if (options.check) {
+    if (cache.LastKey() != last_key || cache.Stats().rows != rows.size()) {
+      fprintf(stderr, "  reopened cache lost rows or the sync key\n");
+      failures++;
+    }
+    if (!RunQuery(cache, rows, INT64_MIN, INT64_MAX, 0, true, &out)) failures++;
+  }
+  out = HistoryColumns();
+
+  // The history screen's export button, for the whole file.
+  const struct {
+    ExportFormat format;
+    const char* name;
+    const char* extension;
+  } kExports[] = {{ExportFormat::kCsv, "csv", ".csv"}, {ExportFormat::kColumnar, "columnar", ".sfhx"}};
+  for (const auto& format : kExports) {
+    std::string path = options.path + format.extension;
+    ExportRun run;
+    if (!RunExport(cache, format.format, path, &run)) {
+      failures++;
+      continue;
+    }
+    printf("  export %-8s: %llu rows, %.1f MiB in %.1f ms (%.2f M rows/s), +%ld KiB anon\n",
+           format.name, (unsigned long long)run.rows, run.bytes / (1024.0 * 1024.0), run.ms,
+           run.rows / std::max(run.ms, 1e-3) / 1000.0, run.peak_growth_kib);
+    if (options.check) {
+      bool ok = run.rows == rows.size() && (format.format == ExportFormat::kCsv
+                                                ? CheckCsv(path, rows)
+                                                : CheckColumnar(path, rows));
+      if (!ok) failures++;
+      if (run.peak_growth_kib > kExportMemoryBudgetKiB) {
+        fprintf(stderr, "  export %s grew anonymous memory by %ld KiB\n", format.name,
+                run.peak_growth_kib);
+        failures++;
+      }
+      if (access((path + ".part").c_str(), F_OK) == 0) {
+        fprintf(stderr, "  export %s left its .part file behind\n", format.name);
+        failures++;
+      }
+    }
+    unlink(path.c_str());
+  }
+  if (options.check) {
+    // A range with no rows still produces a valid, empty file.
+    HistoryExport empty;
+    std::string path = options.path + ".empty.csv";
+    if (!empty.Begin(cache, start_ms - 2 * kDayMs, start_ms - kDayMs, ExportFormat::kCsv, path,
+                     &error) ||
+        !empty.done() || !empty.Finish(&error) || empty.progress().rows != 0) {
+      fprintf(stderr, "  empty export failed: %s\n", error.c_str());
+      failures++;
+    }
+    unlink(path.c_str());
+  }
+  cache.Close();
+  if (temp_path) unlink(options.path.c_str());
+
+  if (options.check) {
+    printf("history_cache_sim: %s\n", failures == 0 ? "check passed" : "check FAILED");
+  }
+  return failures == 0 ? 0 : 1;
+}
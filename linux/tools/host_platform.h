@@ -0,0 +1,165 @@
+#ifndef SMARTFARM_TOOLS_HOST_PLATFORM_H_
+#define SMARTFARM_TOOLS_HOST_PLATFORM_H_
+
+// Host implementations of the firmware platform interfaces: a virtual clock
+// that tools advance explicitly, a deterministic random source and the same
+// simulated sensors the Wokwi sketch uses.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+
+#include "device_platform.h"
+#include "tomato_device.h"
+
+// The firmware formats local time in WIB (GMT+7); make mktime/localtime_r on
+// the host agree with it.
+inline void UseWibTimezone() {
+  setenv("TZ", "WIB-7", 1);
+  tzset();
+}
+
+// 2024-12-01 13:00:00 WIB, the firmware's manual fallback time.
+const long long kDefaultEpochMs = 1733032800000LL;
+
+class HostPlatform : public DevicePlatform {
+ public:
+  explicit HostPlatform(uint64_t seed, long long epoch_start_ms = kDefaultEpochMs)
+      : now_(0), epoch_start_ms_(epoch_start_ms), rng_(seed ? seed : 1), verbose_(false) {}
+
+  void AdvanceTo(unsigned long now_ms) { now_ = now_ms; }
+  void set_verbose(bool verbose) { verbose_ = verbose; }
+  long long epoch_ms() const { return epoch_start_ms_ + (long long)now_; }
+
+  unsigned long millis() override { return now_; }
+
+  // Durasi tahap diukur dengan jam sungguhan, bukan jam virtual, supaya
+  // histogram loop_profiler.h menunjukkan biaya CPU di host.
+  unsigned long micros() override {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  int64_t monotonicUs() override { return (int64_t)now_ * 1000; }
+
+  bool wallClockMs(long long* out) override {
+    *out = epoch_ms();
+    return true;
+  }
+
+  long random(long low, long high) override {
+    if (high <= low) return low;
+    return low + (long)(NextRandom() % (uint64_t)(high - low));
+  }
+
+  bool logEnabled() override { return verbose_; }
+  void log(const char* line) override { fprintf(stderr, "%s\n", line); }
+
+  uint64_t NextRandom() {
+    // xorshift64*: fast and reproducible across runs.
+    rng_ ^= rng_ >> 12;
+    rng_ ^= rng_ << 25;
+    rng_ ^= rng_ >> 27;
+    return rng_ * 2685821657736338717ULL;
+  }
+
+ private:
+  unsigned long now_;
+  long long epoch_start_ms_;
+  uint64_t rng_;
+  bool verbose_;
+};
+
+// Same value ranges as SimulatedSensors in the sketch.
+class HostSensors : public SensorSource {
+ public:
+  explicit HostSensors(HostPlatform& platform) : platform_(platform) {}
+
+  void read(RawSample* sample, int zone_count) override {
+    sample->temperature = platform_.random(220, 320) / 10.0f;
+    sample->humidity = platform_.random(450, 850) / 10.0f;
+    for (int i = 0; i < zone_count; i++) {
+      sample->soilRaw[i] = (int)platform_.random(2800, 3500);
+      sample->ldrRaw[i] = (int)platform_.random(500, 4000);
+    }
+  }
+
+ private:
+  HostPlatform& platform_;
+};
+
+class CountingPump : public PumpActuator {
+ public:
+  CountingPump() : switches_(0) {
+    for (int i = 0; i < TOMATO_MAX_ZONES; i++) on_[i] = false;
+  }
+
+  void setPump(int zone, bool on) override {
+    if (zone < 0 || zone >= TOMATO_MAX_ZONES) return;
+    if (on != on_[zone]) switches_++;
+    on_[zone] = on;
+  }
+
+  bool on(int zone) const { return on_[zone]; }
+  unsigned long switches() const { return switches_; }
+
+ private:
+  bool on_[TOMATO_MAX_ZONES];
+  unsigned long switches_;
+};
+
+// Answers like an idle backend: AUTO mode, pump OFF, no notifications.
+class IdleRtdb : public RtdbTransport {
+ public:
+  bool connected() override { return true; }
+
+  int get(const char* path, char* body, size_t capacity, size_t* length) override {
+    const char* reply = strstr(path, "control.json")
+                            ? "{\"operating_mode\":\"AUTO\",\"pompa_status\":\"OFF\"}"
+                            : "null";
+    snprintf(body, capacity, "%s", reply);
+    *length = strlen(body);
+    return 200;
+  }
+
+  int put(const char*, const char*, size_t) override { return 200; }
+  int patch(const char*, const char*, size_t) override { return 200; }
+};
+
+// Zone table for host runs: the first zone uses the legacy nodes like the
+// sketch, the rest live under /zones/bedN.
+class HostZones {
+ public:
+  explicit HostZones(int count) : count_(count < TOMATO_MAX_ZONES ? count : TOMATO_MAX_ZONES) {
+    for (int i = 0; i < count_; i++) {
+      snprintf(ids_[i], sizeof(ids_[i]), "bed%d", i + 1);
+      if (i == 0) {
+        paths_[i][0] = '\0';
+      } else {
+        snprintf(paths_[i], sizeof(paths_[i]), "/zones/bed%d", i + 1);
+      }
+      ZoneConfig& zone = zones_[i];
+      zone.id = ids_[i];
+      zone.basePath = paths_[i];
+      zone.soilPin = zone.ldrPin = zone.relayPin = zone.servoPin = -1;
+      zone.initialAgeDays = 1;
+      for (int stage = 0; stage < 4; stage++) zone.soilThresholds[stage] = 0;
+    }
+  }
+
+  const ZoneConfig* zones() const { return zones_; }
+  int count() const { return count_; }
+
+ private:
+  int count_;
+  char ids_[TOMATO_MAX_ZONES][16];
+  char paths_[TOMATO_MAX_ZONES][24];
+  ZoneConfig zones_[TOMATO_MAX_ZONES];
+};
+
+#endif  // SMARTFARM_TOOLS_HOST_PLATFORM_H_
@@ -0,0 +1,308 @@
+// LAN API host run: one virtual SmartFarm Tomato node (the real firmware
+// logic from firmware/tomato_device.h) with the firmware's local HTTP server
+// (firmware/local_http_server.h + local_api.h) on a POSIX socket. Point a
+// dashboard or curl at it while the device runs in (optionally accelerated)
+// real time, or use --check to exercise every endpoint over loopback.
+//
+// Usage:
+//   lan_server_sim --key K [--port 8080] [--zones 1] [--speed 1] [--any]
+//   lan_server_sim --check [--zones 2]
+//
+// --key is required: like the firmware, the server does not start without
+// the X-SmartFarm-Key that pump commands must carry.
+//
+// Exit status: 0 on success, 1 when a --check expectation fails, 2 on bad
+// arguments or when the port cannot be bound.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "host_platform.h"
+#include "local_api.h"
+#include "posix_lan.h"
+#include "tomato_device.h"
+
+namespace {
+
+struct Options {
+  int port = 8080;
+  int zones = 1;
+  double speed = 1.0;
+  bool any = false;
+  bool check = false;
+  const char* key = "";
+};
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--port") == 0 && value) {
+      options->port = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--zones") == 0 && value) {
+      options->zones = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--speed") == 0 && value) {
+      options->speed = atof(value);
+      i++;
+    } else if (strcmp(arg, "--key") == 0 && value) {
+      options->key = value;
+      i++;
+    } else if (strcmp(arg, "--any") == 0) {
+      options->any = true;
+    } else if (strcmp(arg, "--check") == 0) {
+      options->check = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s --key K [--port P] [--zones Z] [--speed X] [--any]\n"
+              "       %s --check [--zones Z]\n",
+              argv[0], argv[0]);
+      return false;
+    }
+  }
+  if (!options->check && !options->key[0]) {
+    fprintf(stderr, "lan_server_sim: --key is required, pump commands are refused without it\n");
+    return false;
+  }
+  return options->port >= 0 && options->port < 65536 && options->speed > 0 &&
+         options->zones > 0 && options->zones <= TOMATO_MAX_ZONES;
+}
+
+struct Response {
+  int status = 0;
+  std::string headers;
+  std::string body;
+  double ms = 0;
+};
+
+// Sends one request over loopback while driving the server from this same
+// thread, exactly as loop() would on the ESP32.
+bool Exchange(LocalHttpServer& server, uint16_t port, const std::string& request,
+              Response* response) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) return false;
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + std::chrono::seconds(5);
+  size_t sent = 0;
+  std::string raw;
+  bool closed = false;
+  while (!closed && std::chrono::steady_clock::now() < deadline) {
+    if (sent < request.size()) {
+      ssize_t n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+      if (n > 0) sent += (size_t)n;
+    }
+    server.poll();
+    char buffer[2048];
+    ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n > 0) raw.append(buffer, (size_t)n);
+    if (n == 0) closed = true;
+  }
+  close(fd);
+  response->ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  size_t body = raw.find("\r\n\r\n");
+  if (!closed || body == std::string::npos || raw.compare(0, 9, "HTTP/1.0 ") != 0) return false;
+  response->status = atoi(raw.c_str() + 9);
+  response->headers = raw.substr(0, body);
+  response->body = raw.substr(body + 4);
+  return true;
+}
+
+long long JsonNumber(const std::string& body, const char* key) {
+  std::string needle = std::string("\"") + key + "\":";
+  size_t at = body.find(needle);
+  return at == std::string::npos ? -1 : strtoll(body.c_str() + at + needle.size(), nullptr, 10);
+}
+
+class Checker {
+ public:
+  Checker(LocalHttpServer& server, uint16_t port) : server_(server), port_(port) {}
+
+  // Runs one request and checks its status and that `expect` appears in the
+  // body. Returns the body for follow-up checks; headers() has its headers.
+  std::string Expect(const char* method, const std::string& target, int status,
+                     const char* expect, const char* headers = "") {
+    std::string request = std::string(method) + " " + target + " HTTP/1.1\r\nHost: sim\r\n" +
+                          headers + "\r\n";
+    Response response;
+    bool ok = Exchange(server_, port_, request, &response);
+    ok = ok && response.status == status &&
+         (!expect || response.body.find(expect) != std::string::npos);
+    headers_ = response.headers;
+    printf("%-4s %-7s %-44s %3d %6zu B %7.2f ms\n", ok ? "ok" : "FAIL", method, target.c_str(),
+           response.status, response.body.size(), response.ms);
+    if (!ok) {
+      failures_++;
+      printf("     expected %d with %s, body: %.200s\n", status, expect ? expect : "-",
+             response.body.c_str());
+    }
+    return response.body;
+  }
+
+  // Checks a property of the last response's headers.
+  void ExpectHeaders(bool ok, const char* what) {
+    printf("%-4s %s\n", ok ? "ok" : "FAIL", what);
+    if (!ok) failures_++;
+  }
+
+  const std::string& headers() const { return headers_; }
+  int failures() const { return failures_; }
+
+ private:
+  LocalHttpServer& server_;
+  uint16_t port_;
+  std::string headers_;
+  int failures_ = 0;
+};
+
+int RunCheck(HostPlatform& platform, HostSensors& sensors, TomatoDevice& device,
+             LocalHttpServer& server, uint16_t port, const char* key) {
+  // Ten virtual minutes put 121 rounds per zone into the ring (capped at 240).
+  unsigned long now = 0;
+  for (; now <= 10UL * 60 * 1000; now += 500) {
+    platform.AdvanceTo(now);
+    device.loop(sensors);
+  }
+
+  Checker check(server, port);
+  check.Expect("GET", "/api/snapshot", 200, "\"zones\":[{\"zona\":\"bed1\"");
+  check.Expect("GET", "/api/stats", 200, "\"local_http\":{\"requests\":");
+  check.ExpectHeaders(check.headers().find("Access-Control-Allow-Origin: *") != std::string::npos,
+                      "GET responses may be read cross-origin");
+  check.Expect("OPTIONS", "/api/pump", 405, "\"error\"");
+  check.ExpectHeaders(check.headers().find("Access-Control-") == std::string::npos,
+                      "pump preflight gets no CORS headers");
+  check.Expect("GET", "/api/nope", 404, "\"error\"");
+  check.Expect("POST", "/api/snapshot", 405, "\"error\"");
+
+  // Page through the ring with since/next until "more" is false.
+  long long since = 0;
+  int pages = 0;
+  int samples = 0;
+  for (; pages < 100; pages++) {
+    std::string body =
+        check.Expect("GET", "/api/samples?since=" + std::to_string(since) + "&limit=50", 200,
+                     "\"samples\":[");
+    long long next = JsonNumber(body, "next");
+    for (size_t at = body.find("{\"t\":"); at != std::string::npos;
+         at = body.find("{\"t\":", at + 1)) {
+      samples++;
+    }
+    if (next <= since && body.find("\"more\":true") != std::string::npos) {
+      printf("FAIL next did not advance past %lld\n", since);
+      return 1;
+    }
+    since = next;
+    if (body.find("\"more\":false") != std::string::npos) break;
+  }
+  bool paged = samples == device.recentSamples().count();
+  printf("%-4s paged %d samples in %d page(s)\n", paged ? "ok" : "FAIL", samples, pages + 1);
+  int failures = check.failures() + (paged ? 0 : 1);
+
+  // Pump commands need the key; the header name is matched case-insensitively.
+  std::string auth = std::string("x-smartfarm-key: ") + key + "\r\n";
+  const char* h = auth.c_str();
+  check.Expect("POST", "/api/pump?zone=1&action=on", 401, "\"error\"");
+  check.Expect("POST", "/api/pump?zone=1&action=on", 401, "\"error\"",
+               "X-SmartFarm-Key: check\r\n");
+  check.Expect("POST", "/api/pump?zone=1&action=on&seconds=30", 200, "\"running\":true", h);
+  check.ExpectHeaders(check.headers().find("Access-Control-") == std::string::npos,
+                      "pump response is not readable cross-origin");
+  check.Expect("GET", "/api/snapshot", 200, "\"status_pompa\":\"ON\"");
+  check.Expect("POST", "/api/pump?zone=1&action=off", 200, "\"running\":false", h);
+  check.Expect("POST", "/api/pump?zone=1&action=off", 409, "\"error\"", h);
+  check.Expect("POST", "/api/pump?zone=9&action=on", 409, "\"error\"", h);
+  check.Expect("POST", "/api/pump?zone=1&action=spin", 400, "\"error\"", h);
+  check.Expect("POST", "/api/pump?action=on", 400, "\"error\"", h);
+  failures += check.failures();
+
+  // Without a key every POST is refused, even one that sends an empty header.
+  {
+    LocalApi keyless(device, platform, "");
+    char path[] = "/api/pump";
+    char query[] = "zone=1&action=on";
+    HttpRequest request = {"POST", path, query, ""};
+    char body[128];
+    JsonWriter json(body, sizeof(body));
+    bool ok = keyless.handle(request, json) == 403 && !device.pumps().running(0);
+    printf("%-4s keyless API refuses pump commands\n", ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+  }
+
+  const LocalHttpStats& stats = server.stats();
+  printf("server: %u requests, %u errors, %u timeouts, max poll %u us\n", stats.requests,
+         stats.errors, stats.timeouts, stats.maxPollUs);
+  if (failures) {
+    printf("FAIL: %d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("OK: local API answered every request\n");
+  return 0;
+}
+
+void Serve(HostPlatform& platform, HostSensors& sensors, TomatoDevice& device,
+           LocalHttpServer& server, double speed) {
+  auto start = std::chrono::steady_clock::now();
+  for (;;) {
+    double real_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    platform.AdvanceTo((unsigned long)(real_ms * speed));
+    device.loop(sensors);
+    server.poll();
+    if (!server.busy()) {
+      struct timespec pause = {0, 1000000};
+      nanosleep(&pause, nullptr);
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+  UseWibTimezone();
+
+  HostPlatform platform(42);
+  HostSensors sensors(platform);
+  CountingPump pump;
+  IdleRtdb rtdb;
+  HostZones zones(options.zones);
+  std::unique_ptr<TomatoDevice> device(
+      new TomatoDevice(platform, rtdb, pump, zones.zones(), zones.count()));
+  device->state.timeInitialized = true;
+  device->begin();
+
+  PosixLanListener listener;
+  if (!listener.Listen(options.check ? 0 : (uint16_t)options.port, options.any && !options.check)) {
+    perror("lan_server_sim: listen");
+    return 2;
+  }
+  // --check always runs with a key so the 401 path is covered too.
+  const char* key = options.check && !options.key[0] ? "check-key" : options.key;
+  std::unique_ptr<LocalApi> api(new LocalApi(*device, platform, key));
+  std::unique_ptr<LocalHttpServer> server(new LocalHttpServer(listener, platform, *api));
+  api->attach(*server);
+
+  if (options.check) return RunCheck(platform, sensors, *device, *server, listener.port(), key);
+
+  printf("lan_server_sim: %d zone(s) at %.1fx on http://%s:%u/api/snapshot\n", options.zones,
+         options.speed, options.any ? "0.0.0.0" : "127.0.0.1", listener.port());
+  fflush(stdout);
+  Serve(platform, sensors, *device, *server, options.speed);
+  return 0;
+}
@@ -0,0 +1,368 @@
+// LAN telemetry host run: N virtual SmartFarm Tomato nodes (the real
+// firmware logic from firmware/tomato_device.h) publishing the firmware's
+// UDP telemetry frames (firmware/udp_telemetry.h), so the desktop receiver
+// in linux/runner/lan_telemetry_plugin.cc can be exercised without
+// hardware. --drop and --reorder inject loss and reordering between sender
+// and network. --check receives the frames on loopback with the same
+// sequence tracker the runner uses and verifies its loss accounting, plus
+// one extra node with telemetry off that must stay silent.
+//
+// Usage:
+//   lan_telemetry_sim [--devices 3] [--zones 1] [--speed 1] [--drop PCT]
+//                     [--reorder PCT] [--target 239.255.77.70] [--port 47700]
+//   lan_telemetry_sim --check [--devices 4] [--drop 10] [--reorder 5]
+//
+// Exit status: 0 on success, 1 when --check finds a mismatch, 2 on bad
+// arguments or socket errors.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "host_platform.h"
+#include "posix_lan.h"
+#include "telemetry_frame.h"
+#include "tomato_device.h"
+#include "udp_telemetry.h"
+
+namespace {
+
+const unsigned long kStepMs = 500;
+
+struct Options {
+  int devices = 0;     // default 3, --check 4
+  int zones = 1;
+  double speed = 1.0;
+  double drop = -1;     // percent; default 0, --check 10
+  double reorder = -1;  // percent; default 0, --check 5
+  const char* target = kTelemetryGroup;
+  int port = kTelemetryPort;
+  bool check = false;
+  int rounds = 200;  // --check: sample rounds per device
+  uint64_t seed = 42;
+};
+
+// Loses or delays frames on their way to the real socket. A reordered frame
+// is held back and sent right after the next one.
+class FaultySink : public DatagramSink {
+ public:
+  FaultySink(DatagramSink& inner, double drop, double reorder, uint64_t seed)
+      : inner_(inner), drop_(drop / 100.0), reorder_(reorder / 100.0), rng_(seed ? seed : 1) {}
+
+  bool send(const uint8_t* data, size_t length) override {
+    frames++;
+    if (faults_ && Chance(drop_)) {
+      dropped++;
+      return true;  // lost on the air; the sender cannot tell
+    }
+    if (faults_ && held_length_ == 0 && length <= sizeof(held_) && Chance(reorder_)) {
+      memcpy(held_, data, length);
+      held_length_ = length;
+      reordered++;
+      return true;
+    }
+    bool ok = inner_.send(data, length);
+    Flush();
+    return ok;
+  }
+
+  void Flush() {
+    if (held_length_ == 0) return;
+    inner_.send(held_, held_length_);
+    held_length_ = 0;
+  }
+
+  void set_faults(bool faults) { faults_ = faults; }
+
+  unsigned long frames = 0;
+  unsigned long dropped = 0;
+  unsigned long reordered = 0;
+
+ private:
+  bool Chance(double p) {
+    rng_ ^= rng_ >> 12;
+    rng_ ^= rng_ << 25;
+    rng_ ^= rng_ >> 27;
+    return p > 0 && (double)((rng_ * 2685821657736338717ULL) >> 11) / 9007199254740992.0 < p;
+  }
+
+  DatagramSink& inner_;
+  double drop_;
+  double reorder_;
+  uint64_t rng_;
+  bool faults_ = true;
+  uint8_t held_[kTelemetryMaxFrame];
+  size_t held_length_ = 0;
+};
+
+struct VirtualNode {
+  VirtualNode(int index, DatagramSink& socket, const HostZones& zones, const Options& options)
+      : platform(options.seed * 1000003ULL + index),
+        sensors(platform),
+        config(NodeConfig(index)),
+        device(platform, rtdb, pump, zones.zones(), zones.count(), config),
+        sink(socket, options.drop, options.reorder, options.seed * 7919ULL + index),
+        telemetry(sink, platform) {}
+
+  DeviceConfig NodeConfig(int index) {
+    snprintf(id, sizeof(id), "tomato_%02d", index + 1);
+    DeviceConfig node = defaultDeviceConfig();
+    node.deviceId = id;
+    node.diagnosticsInterval = 0;
+    return node;
+  }
+
+  char id[24];
+  HostPlatform platform;
+  HostSensors sensors;
+  CountingPump pump;
+  IdleRtdb rtdb;
+  DeviceConfig config;
+  TomatoDevice device;
+  FaultySink sink;
+  UdpTelemetry telemetry;
+};
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--devices") == 0 && value) {
+      options->devices = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--zones") == 0 && value) {
+      options->zones = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--speed") == 0 && value) {
+      options->speed = atof(value);
+      i++;
+    } else if (strcmp(arg, "--drop") == 0 && value) {
+      options->drop = atof(value);
+      i++;
+    } else if (strcmp(arg, "--reorder") == 0 && value) {
+      options->reorder = atof(value);
+      i++;
+    } else if (strcmp(arg, "--target") == 0 && value) {
+      options->target = value;
+      i++;
+    } else if (strcmp(arg, "--port") == 0 && value) {
+      options->port = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--rounds") == 0 && value) {
+      options->rounds = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--seed") == 0 && value) {
+      options->seed = strtoull(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--check") == 0) {
+      options->check = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--devices N] [--zones Z] [--speed X] [--drop PCT] [--reorder PCT] "
+              "[--target IP] [--port P] [--check [--rounds R]] [--seed S]\n",
+              argv[0]);
+      return false;
+    }
+  }
+  if (options->devices == 0) options->devices = options->check ? 4 : 3;
+  if (options->drop < 0) options->drop = options->check ? 10 : 0;
+  if (options->reorder < 0) options->reorder = options->check ? 5 : 0;
+  return options->devices > 0 && options->zones > 0 && options->zones <= TOMATO_MAX_ZONES &&
+         options->speed > 0 && options->drop >= 0 && options->drop < 100 &&
+         options->reorder >= 0 && options->reorder < 100 && options->port > 0 &&
+         options->port < 65536 && options->rounds > 0;
+}
+
+// The last |silent| nodes never start their UdpTelemetry, like a sketch
+// built with LAN_TELEMETRY_ENABLED 0.
+std::vector<std::unique_ptr<VirtualNode>> StartNodes(DatagramSink& socket,
+                                                     const HostZones& zones,
+                                                     const Options& options, int silent = 0) {
+  std::vector<std::unique_ptr<VirtualNode>> nodes;
+  for (int i = 0; i < options.devices + silent; i++) {
+    std::unique_ptr<VirtualNode> node(new VirtualNode(i, socket, zones, options));
+    node->device.state.timeInitialized = true;
+    node->device.begin();
+    if (i < options.devices) node->telemetry.begin(node->device);
+    nodes.push_back(std::move(node));
+  }
+  return nodes;
+}
+
+void Step(std::vector<std::unique_ptr<VirtualNode>>& nodes, unsigned long now) {
+  for (auto& node : nodes) {
+    node->platform.AdvanceTo(now);
+    node->device.loop(node->sensors);
+  }
+}
+
+// Loopback receiver for --check, tracking sequence numbers per device.
+class Receiver {
+ public:
+  ~Receiver() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  bool Open() {
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) return false;
+    int size = 1 << 20;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) return false;
+    getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &length);
+    port_ = ntohs(addr.sin_port);
+    return true;
+  }
+
+  uint16_t port() const { return port_; }
+
+  void Drain() {
+    uint8_t buffer[512];
+    for (;;) {
+      ssize_t n = recv(fd_, buffer, sizeof(buffer), 0);
+      if (n < 0) return;
+      TelemetryFrame frame;
+      if (!decodeTelemetryFrame(buffer, (size_t)n, &frame)) {
+        rejected++;
+        continue;
+      }
+      telemetryTrack(peers[frame.deviceId], frame.bootId, frame.seq);
+    }
+  }
+
+  std::map<std::string, TelemetryPeer> peers;
+  unsigned long rejected = 0;
+
+ private:
+  int fd_ = -1;
+  uint16_t port_ = 0;
+};
+
+int RunCheck(const Options& options) {
+  Receiver receiver;
+  PosixDatagramSink socket;
+  if (!receiver.Open() || !socket.Open("127.0.0.1", receiver.port())) {
+    perror("lan_telemetry_sim: socket");
+    return 2;
+  }
+  HostZones zones(options.zones);
+  std::vector<std::unique_ptr<VirtualNode>> nodes = StartNodes(socket, zones, options, 1);
+
+  const unsigned long interval = defaultDeviceConfig().interval;
+  const unsigned long end = (unsigned long)options.rounds * interval;
+  unsigned long now = 0;
+  // A receiver cannot tell frames lost before the first one it sees from
+  // frames sent before it started listening, so the first and last rounds
+  // go out clean.
+  for (auto& node : nodes) node->sink.set_faults(false);
+  for (; now < end; now += kStepMs) {
+    if (now == interval) {
+      for (auto& node : nodes) node->sink.set_faults(true);
+    }
+    Step(nodes, now);
+    receiver.Drain();
+  }
+  for (auto& node : nodes) node->sink.set_faults(false);
+  for (unsigned long stop = now + interval; now <= stop; now += kStepMs) Step(nodes, now);
+  for (auto& node : nodes) node->sink.Flush();
+  receiver.Drain();
+
+  printf("%-10s %7s %7s %7s %7s %7s %7s %5s\n", "device", "sent", "dropped", "reorder", "recv",
+         "lost", "late", "dup");
+  int failures = 0;
+  for (size_t i = options.devices; i < nodes.size(); i++) {
+    const VirtualNode& node = *nodes[i];
+    bool ok = node.sink.frames == 0 && receiver.peers.count(node.id) == 0 &&
+              node.device.recentSamples().count() > 0;
+    printf("%-10s %7lu %7s %7s %7s %7s %7s %5s %s\n", node.id, node.sink.frames, "-", "-", "-",
+           "-", "-", "-", ok ? "off" : "FAIL");
+    if (!ok) failures++;
+  }
+  nodes.resize(options.devices);
+  for (auto& node : nodes) {
+    const TelemetryPeer& peer = receiver.peers[node->id];
+    const FaultySink& sink = node->sink;
+    bool ok = peer.received + peer.lost == node->telemetry.stats().sent &&
+              peer.lost == sink.dropped && peer.late == sink.reordered && peer.duplicates == 0 &&
+              peer.restarts == 0;
+    printf("%-10s %7lu %7lu %7lu %7u %7u %7u %5u %s\n", node->id, sink.frames, sink.dropped,
+           sink.reordered, peer.received, peer.lost, peer.late, peer.duplicates,
+           ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+  }
+  if (receiver.rejected) {
+    printf("FAIL: %lu datagram(s) did not decode\n", receiver.rejected);
+    failures++;
+  }
+  if (failures) {
+    printf("FAIL: loss accounting disagrees with injected faults, or a node with telemetry "
+           "off sent frames\n");
+    return 1;
+  }
+  printf("OK: %d device(s), loss and reordering accounted exactly; telemetry off sends "
+         "nothing\n",
+         options.devices);
+  return 0;
+}
+
+void Serve(const Options& options, PosixDatagramSink& socket) {
+  HostZones zones(options.zones);
+  std::vector<std::unique_ptr<VirtualNode>> nodes = StartNodes(socket, zones, options);
+  auto start = std::chrono::steady_clock::now();
+  unsigned long now = 0;
+  unsigned long next_report = 10000;
+  for (;;) {
+    double real_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    unsigned long target = (unsigned long)(real_ms * options.speed);
+    for (; now <= target; now += kStepMs) Step(nodes, now);
+    if (real_ms >= next_report) {
+      unsigned long frames = 0, dropped = 0, failed = 0;
+      for (auto& node : nodes) {
+        frames += node->sink.frames;
+        dropped += node->sink.dropped;
+        failed += node->telemetry.stats().failed;
+      }
+      printf("%6.0f s: %lu frames, %lu dropped on purpose, %lu send errors\n", real_ms / 1000,
+             frames, dropped, failed);
+      fflush(stdout);
+      next_report += 10000;
+    }
+    struct timespec pause = {0, 5000000};
+    nanosleep(&pause, nullptr);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+  UseWibTimezone();
+  if (options.check) return RunCheck(options);
+
+  PosixDatagramSink socket;
+  if (!socket.Open(options.target, (uint16_t)options.port)) {
+    fprintf(stderr, "lan_telemetry_sim: cannot send to %s:%d\n", options.target, options.port);
+    return 2;
+  }
+  printf("lan_telemetry_sim: %d device(s) x %d zone(s) at %.1fx -> %s:%d (drop %.1f%%, reorder "
+         "%.1f%%)\n",
+         options.devices, options.zones, options.speed, options.target, options.port,
+         options.drop, options.reorder);
+  fflush(stdout);
+  Serve(options, socket);
+  return 0;
+}
@@ -0,0 +1,225 @@
+#ifndef SMARTFARM_TOOLS_MEMORY_RTDB_H_
+#define SMARTFARM_TOOLS_MEMORY_RTDB_H_
+
+// In-process stand-in for Firebase RTDB used by the host tools. Documents are
+// stored per path in an ordered map so collection reads (limitToLast) and
+// nested field writes (.../isRead) behave like the real REST API closely
+// enough for load measurements.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "device_platform.h"
+#include "rtdb_json.h"
+
+class MemoryRtdb {
+ public:
+  // Collections (history_data, notifications) keep at most this many
+  // children so long simulations stay within host memory; 0 keeps all.
+  explicit MemoryRtdb(size_t max_children = 0) : max_children_(max_children) {}
+
+  // Returns an HTTP status code like the REST API.
+  int Get(const std::string& path, int limit_to_last, std::string* out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto exact = docs_.find(path);
+    if (exact != docs_.end()) {
+      *out = exact->second;
+      return 200;
+    }
+
+    // Collection read: assemble direct children, newest keys last.
+    const std::string prefix = path + "/";
+    auto begin = docs_.lower_bound(prefix);
+    auto end = docs_.lower_bound(path + "0");  // '0' sorts right after '/'
+    std::vector<std::map<std::string, std::string>::const_iterator> children;
+    for (auto it = begin; it != end; ++it) {
+      if (it->first.find('/', prefix.size()) == std::string::npos) children.push_back(it);
+    }
+    if (children.empty()) {
+      *out = "null";
+      return 200;
+    }
+    size_t first = 0;
+    if (limit_to_last > 0 && children.size() > (size_t)limit_to_last) {
+      first = children.size() - limit_to_last;
+    }
+    out->assign("{");
+    for (size_t i = first; i < children.size(); i++) {
+      if (i != first) out->push_back(',');
+      out->push_back('"');
+      out->append(children[i]->first, prefix.size(), std::string::npos);
+      out->append("\":");
+      out->append(children[i]->second);
+    }
+    out->push_back('}');
+    return 200;
+  }
+
+  int Put(const std::string& path, const char* body, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Field write into an existing document (e.g. /notifications/<key>/isRead).
+    size_t slash = path.rfind('/');
+    if (slash != std::string::npos && slash > 0) {
+      auto parent = docs_.find(path.substr(0, slash));
+      if (parent != docs_.end()) {
+        SetMember(&parent->second, path.substr(slash + 1), std::string(body, length));
+        return 200;
+      }
+    }
+    auto inserted = docs_.insert(std::make_pair(path, std::string()));
+    inserted.first->second.assign(body, length);
+    if (inserted.second && max_children_ > 0 && slash != std::string::npos && slash > 0) {
+      TrimCollection(path.substr(0, slash));
+    }
+    return 200;
+  }
+
+  // Multi-location update: every top-level member of body replaces the value
+  // at path/<member>.
+  int Patch(const std::string& path, const char* body, size_t length) {
+    JsonObjectIterator it(jsonSpanOf(body, length));
+    if (!it.valid()) return 400;
+    std::string base = path == "/" ? "" : path;
+    JsonSpan key, value;
+    while (it.next(&key, &value)) {
+      Put(base + "/" + std::string(key.begin, key.size()), value.begin, value.size());
+    }
+    return 200;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return docs_.size();
+  }
+
+ private:
+  static void SetMember(std::string* doc, const std::string& name, const std::string& value) {
+    JsonSpan object = jsonSpanOf(doc->data(), doc->size());
+    JsonSpan member;
+    if (jsonFindMember(object, name.c_str(), &member)) {
+      size_t offset = member.begin - doc->data();
+      doc->replace(offset, member.size(), value);
+      return;
+    }
+    size_t close = doc->rfind('}');
+    if (close == std::string::npos) return;
+    std::string insert = (close > 1 ? "," : "") + ("\"" + name + "\":" + value);
+    doc->insert(close, insert);
+  }
+
+  void TrimCollection(const std::string& parent) {
+    size_t& count = collection_sizes_[parent];
+    if (++count <= max_children_) return;
+    auto oldest = docs_.lower_bound(parent + "/");
+    if (oldest != docs_.end() && oldest->first.compare(0, parent.size() + 1, parent + "/") == 0) {
+      docs_.erase(oldest);
+      count--;
+    }
+  }
+
+  size_t max_children_;
+  std::mutex mutex_;
+  std::map<std::string, std::string> docs_;
+  std::map<std::string, size_t> collection_sizes_;
+};
+
+struct RtdbCounters {
+  uint64_t gets = 0;
+  uint64_t puts = 0;
+  uint64_t patches = 0;
+  uint64_t bytes_up = 0;    // request bodies + request lines
+  uint64_t bytes_down = 0;  // response bodies
+  std::vector<uint32_t> write_latency_ns;
+
+  void Merge(const RtdbCounters& other) {
+    gets += other.gets;
+    puts += other.puts;
+    patches += other.patches;
+    bytes_up += other.bytes_up;
+    bytes_down += other.bytes_down;
+    write_latency_ns.insert(write_latency_ns.end(), other.write_latency_ns.begin(),
+                            other.write_latency_ns.end());
+  }
+};
+
+// One device's connection to the shared store. Counters are per transport so
+// worker threads never contend on them.
+class MemoryRtdbTransport : public RtdbTransport {
+ public:
+  explicit MemoryRtdbTransport(MemoryRtdb& store) : store_(store) {}
+
+  bool connected() override { return true; }
+
+  int get(const char* path, char* body, size_t capacity, size_t* length) override {
+    int limit = 0;
+    std::string key = NormalizePath(path, &limit);
+    int code = store_.Get(key, limit, &scratch_);
+    counters_.gets++;
+    counters_.bytes_up += strlen(path);
+    counters_.bytes_down += scratch_.size();
+
+    size_t n = std::min(scratch_.size(), capacity ? capacity - 1 : 0);
+    if (capacity) {
+      memcpy(body, scratch_.data(), n);
+      body[n] = '\0';
+    }
+    *length = n;
+    return code;
+  }
+
+  int put(const char* path, const char* body, size_t length) override {
+    int limit = 0;
+    std::string key = NormalizePath(path, &limit);
+    auto start = std::chrono::steady_clock::now();
+    int code = store_.Put(key, body, length);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    counters_.puts++;
+    counters_.bytes_up += strlen(path) + length;
+    counters_.write_latency_ns.push_back(
+        (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    return code;
+  }
+
+  int patch(const char* path, const char* body, size_t length) override {
+    int limit = 0;
+    std::string key = NormalizePath(path, &limit);
+    auto start = std::chrono::steady_clock::now();
+    int code = store_.Patch(key, body, length);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    counters_.patches++;
+    counters_.bytes_up += strlen(path) + length;
+    counters_.write_latency_ns.push_back(
+        (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    return code;
+  }
+
+  const RtdbCounters& counters() const { return counters_; }
+
+  // "/a/b.json?orderBy=..&limitToLast=5" -> "/a/b", limit 5.
+  static std::string NormalizePath(const char* path, int* limit_to_last) {
+    std::string key(path);
+    size_t query = key.find('?');
+    if (query != std::string::npos) {
+      size_t limit = key.find("limitToLast=", query);
+      if (limit != std::string::npos) *limit_to_last = atoi(key.c_str() + limit + 12);
+      key.resize(query);
+    }
+    if (key.size() >= 5 && key.compare(key.size() - 5, 5, ".json") == 0) key.resize(key.size() - 5);
+    return key;
+  }
+
+ private:
+  MemoryRtdb& store_;
+  RtdbCounters counters_;
+  std::string scratch_;
+};
+
+#endif  // SMARTFARM_TOOLS_MEMORY_RTDB_H_
@@ -0,0 +1,1190 @@
+// Local firmware update host. Builds delta patches (firmware/firmware_delta.h)
+// between ESP32 app images, writes the manifest firmware/ota_update.h reads,
+// and serves both over plain HTTP with Range support so a board on the LAN
+// (or a test) can update without the real update host.
+//
+// Usage:
+//   ota_server --keygen KEYFILE
+//   ota_server --publish DIR --key KEYFILE --build N --image NEW.bin [--from B=OLD.bin ...]
+//   ota_server --serve DIR [--port 8070] [--any]
+//   ota_server --check [--image-kb 1280]
+//
+// --keygen writes a new Ed25519 seed (hex) to KEYFILE and prints the public
+// key to put in OTA_PUBLIC_KEY; keep KEYFILE off the update host.
+// --publish writes DIR/<N>.sfdp (full image), DIR/<B>-<N>.sfdp per --from
+// and DIR/manifest.json, whose "sig" signs build, size and SHA-512 of the
+// image with KEYFILE; --serve answers GET /firmware/<file> from DIR.
+// Point OtaConfig::manifestPath at /firmware/manifest.json on this host.
+// --check builds synthetic images, serves them on loopback and runs the
+// firmware's OtaUpdater through a delta update, a resumed download, a
+// mismatched base, a corrupted patch, bad signatures and both rollback paths.
+//
+// Exit status: 0 on success, 1 when --check fails, 2 on bad arguments or
+// I/O errors.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ed25519.h"
+#include "firmware_delta.h"
+#include "host_platform.h"
+#include "memory_rtdb.h"
+#include "ota_update.h"
+#include "tomato_device.h"
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Options {
+  std::string publish_dir;
+  std::string serve_dir;
+  std::string image_path;
+  std::string key_path;
+  std::string keygen_path;
+  std::vector<std::pair<uint32_t, std::string>> bases;
+  uint32_t build = 0;
+  int port = 8070;
+  bool any = false;
+  bool check = false;
+  int image_kb = 1280;
+};
+
+bool Usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s --keygen KEYFILE\n"
+          "       %s --publish DIR --key KEYFILE --build N --image NEW.bin [--from B=OLD.bin ...]\n"
+          "       %s --serve DIR [--port P] [--any]\n"
+          "       %s --check [--image-kb KB]\n",
+          program, program, program, program);
+  return false;
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--publish") == 0 && value) {
+      options->publish_dir = value;
+      i++;
+    } else if (strcmp(arg, "--serve") == 0 && value) {
+      options->serve_dir = value;
+      i++;
+    } else if (strcmp(arg, "--keygen") == 0 && value) {
+      options->keygen_path = value;
+      i++;
+    } else if (strcmp(arg, "--key") == 0 && value) {
+      options->key_path = value;
+      i++;
+    } else if (strcmp(arg, "--image") == 0 && value) {
+      options->image_path = value;
+      i++;
+    } else if (strcmp(arg, "--build") == 0 && value) {
+      options->build = (uint32_t)strtoul(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--from") == 0 && value && strchr(value, '=')) {
+      options->bases.emplace_back((uint32_t)strtoul(value, nullptr, 10), strchr(value, '=') + 1);
+      i++;
+    } else if (strcmp(arg, "--port") == 0 && value) {
+      options->port = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--image-kb") == 0 && value) {
+      options->image_kb = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--any") == 0) {
+      options->any = true;
+    } else if (strcmp(arg, "--check") == 0) {
+      options->check = true;
+    } else {
+      return Usage(argv[0]);
+    }
+  }
+  bool ok;
+  if (!options->keygen_path.empty()) {
+    ok = true;
+  } else if (!options->publish_dir.empty()) {
+    ok = options->build > 0 && !options->image_path.empty() && !options->key_path.empty();
+    for (const auto& base : options->bases) {
+      if (base.first == 0 || base.first >= options->build) ok = false;
+    }
+  } else if (!options->serve_dir.empty()) {
+    ok = options->port > 0 && options->port < 65536;
+  } else {
+    ok = options->check && options->image_kb >= 64;
+  }
+  return ok || Usage(argv[0]);
+}
+
+bool ReadFile(const std::string& path, std::string* contents) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) return false;
+  contents->clear();
+  char buffer[65536];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) contents->append(buffer, n);
+  bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+bool WriteFile(const std::string& path, const std::string& contents) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) return false;
+  bool ok = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+  return fclose(file) == 0 && ok;
+}
+
+uint32_t Crc(const Bytes& data) { return crc32Update(0, data.data(), data.size()); }
+
+// --- Signing ---
+
+std::string Hex(const uint8_t* data, size_t length) {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string hex;
+  for (size_t i = 0; i < length; i++) {
+    hex.push_back(kDigits[data[i] >> 4]);
+    hex.push_back(kDigits[data[i] & 15]);
+  }
+  return hex;
+}
+
+bool ParseHex(const std::string& hex, uint8_t* out, size_t length) {
+  if (hex.size() != length * 2) return false;
+  auto nibble = [](char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  };
+  for (size_t i = 0; i < length; i++) {
+    int high = nibble(hex[2 * i]);
+    int low = nibble(hex[2 * i + 1]);
+    if (high < 0 || low < 0) return false;
+    out[i] = (uint8_t)(high << 4 | low);
+  }
+  return true;
+}
+
+std::string PublicKeyHex(const uint8_t seed[32]) {
+  uint8_t public_key[kEd25519KeySize];
+  ed25519PublicKey(public_key, seed);
+  return Hex(public_key, sizeof(public_key));
+}
+
+// The "sig" manifest field: one signature covers the full image and every
+// delta to it, because it is over the image they rebuild.
+std::string SignImage(const Bytes& image, uint32_t build, const uint8_t seed[32]) {
+  Sha512 sha;
+  sha.update(image.data(), image.size());
+  uint8_t digest[Sha512::kDigestSize];
+  sha.finish(digest);
+  uint8_t message[kFirmwareSignedMessageSize];
+  firmwareSignedMessage(build, (uint32_t)image.size(), digest, message);
+  uint8_t signature[kEd25519SignatureSize];
+  ed25519Sign(signature, message, sizeof(message), seed);
+  return Hex(signature, sizeof(signature));
+}
+
+// --- Patch builder ---
+
+void PutVarint(std::string* out, uint32_t value) {
+  while (value >= 0x80) {
+    out->push_back((char)(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back((char)value);
+}
+
+class PatchWriter {
+ public:
+  explicit PatchWriter(const DeltaHeader& header) {
+    uint8_t bytes[kDeltaHeaderSize];
+    encodeDeltaHeader(header, bytes);
+    out_.assign((const char*)bytes, sizeof(bytes));
+  }
+
+  void Insert(const uint8_t* data, size_t length) {
+    while (length > 0) {
+      size_t n = length < kDeltaMaxCopy ? length : kDeltaMaxCopy;
+      out_.push_back((char)DELTA_OP_INSERT);
+      PutVarint(&out_, (uint32_t)n);
+      out_.append((const char*)data, n);
+      data += n;
+      length -= n;
+    }
+  }
+
+  void Copy(uint32_t offset, uint32_t length) {
+    while (length > 0) {
+      uint32_t n = length < kDeltaMaxCopy ? length : kDeltaMaxCopy;
+      int32_t delta = (int32_t)(offset - copy_end_);
+      out_.push_back((char)DELTA_OP_COPY);
+      PutVarint(&out_, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+      PutVarint(&out_, n);
+      offset += n;
+      length -= n;
+      copy_end_ = offset;
+    }
+  }
+
+  std::string Finish() {
+    out_.push_back((char)DELTA_OP_END);
+    return out_;
+  }
+
+  uint32_t copy_end() const { return copy_end_; }
+
+ private:
+  std::string out_;
+  uint32_t copy_end_ = 0;
+};
+
+// Greedy copy/insert diff. Source positions are indexed by an 8-byte hash
+// chain (like deflate); at each target position the longest of the chain
+// candidates and the "same alignment as the last copy" candidate wins. The
+// alignment candidate is what turns a changed call address or literal into
+// INSERT(4) between two cheap COPYs with offset delta 0.
+std::string MakePatch(const Bytes& source, const Bytes& target, uint32_t from, uint32_t to) {
+  DeltaHeader header;
+  header.sourceSize = (uint32_t)source.size();
+  header.sourceCrc = source.empty() ? 0 : Crc(source);
+  header.targetSize = (uint32_t)target.size();
+  header.targetCrc = Crc(target);
+  header.fromBuild = source.empty() ? 0 : from;
+  header.toBuild = to;
+  PatchWriter patch(header);
+  if (source.empty()) {
+    patch.Insert(target.data(), target.size());
+    return patch.Finish();
+  }
+
+  const int kHashBits = 20;
+  const size_t kKey = 8;
+  const int kMaxChain = 24;
+  auto hash = [&](const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return (uint32_t)((v * 0x9E3779B97F4A7C15ULL) >> (64 - kHashBits));
+  };
+  std::vector<int32_t> head((size_t)1 << kHashBits, -1);
+  std::vector<int32_t> prev(source.size(), -1);
+  for (size_t p = 0; p + kKey <= source.size(); p++) {
+    uint32_t h = hash(&source[p]);
+    prev[p] = head[h];
+    head[h] = (int32_t)p;
+  }
+  auto match = [&](size_t s, size_t t) {
+    size_t n = 0;
+    while (s + n < source.size() && t + n < target.size() && source[s + n] == target[t + n]) n++;
+    return n;
+  };
+
+  size_t t = 0;
+  size_t literal = 0;
+  while (t < target.size()) {
+    size_t best = 0;
+    size_t best_at = 0;
+    size_t aligned = patch.copy_end() + (t - literal);
+    if (aligned < source.size()) {
+      best = match(aligned, t);
+      best_at = aligned;
+    }
+    if (best < 6) best = 0;
+    if (t + kKey <= target.size()) {
+      int depth = 0;
+      for (int32_t p = head[hash(&target[t])]; p >= 0 && depth < kMaxChain; p = prev[p], depth++) {
+        size_t n = match((size_t)p, t);
+        if (n >= 12 && n > best) {
+          best = n;
+          best_at = (size_t)p;
+        }
+      }
+    }
+    if (best == 0) {
+      t++;
+      continue;
+    }
+    patch.Insert(&target[literal], t - literal);
+    patch.Copy((uint32_t)best_at, (uint32_t)best);
+    t += best;
+    literal = t;
+  }
+  patch.Insert(&target[literal], t - literal);
+  return patch.Finish();
+}
+
+// --- Publishing ---
+
+std::string ManifestEntry(const std::string& path, size_t bytes) {
+  return "\"path\":\"" + path + "\",\"bytes\":" + std::to_string(bytes);
+}
+
+int Keygen(const Options& options) {
+  uint8_t seed[32];
+  FILE* random = fopen("/dev/urandom", "rb");
+  bool ok = random && fread(seed, 1, sizeof(seed), random) == sizeof(seed);
+  if (random) fclose(random);
+  if (!ok) {
+    perror("/dev/urandom");
+    return 2;
+  }
+  if (!WriteFile(options.keygen_path, Hex(seed, sizeof(seed)) + "\n")) {
+    perror(options.keygen_path.c_str());
+    return 2;
+  }
+  printf("#define OTA_PUBLIC_KEY \"%s\"\n", PublicKeyHex(seed).c_str());
+  return 0;
+}
+
+int Publish(const Options& options) {
+  std::string contents;
+  uint8_t seed[32];
+  if (!ReadFile(options.key_path, &contents)) {
+    perror(options.key_path.c_str());
+    return 2;
+  }
+  contents.erase(contents.find_last_not_of(" \r\n") + 1);
+  if (!ParseHex(contents, seed, sizeof(seed))) {
+    fprintf(stderr, "ota_server: %s is not a key written by --keygen\n", options.key_path.c_str());
+    return 2;
+  }
+  if (!ReadFile(options.image_path, &contents)) {
+    perror(options.image_path.c_str());
+    return 2;
+  }
+  Bytes image(contents.begin(), contents.end());
+  std::string build = std::to_string(options.build);
+  std::string full = MakePatch(Bytes(), image, 0, options.build);
+  std::string manifest = "{\"build\":" + build + ",\"size\":" + std::to_string(image.size()) +
+                         ",\"crc\":" + std::to_string(Crc(image)) + ",\"sig\":\"" +
+                         SignImage(image, options.build, seed) + "\",\"image\":{" +
+                         ManifestEntry("/firmware/" + build + ".sfdp", full.size()) +
+                         "},\"deltas\":{";
+  if (!WriteFile(options.publish_dir + "/" + build + ".sfdp", full)) {
+    perror(options.publish_dir.c_str());
+    return 2;
+  }
+  printf("%-24s %9zu B\n", (build + ".sfdp").c_str(), full.size());
+  for (size_t i = 0; i < options.bases.size(); i++) {
+    if (!ReadFile(options.bases[i].second, &contents)) {
+      perror(options.bases[i].second.c_str());
+      return 2;
+    }
+    Bytes base(contents.begin(), contents.end());
+    std::string from = std::to_string(options.bases[i].first);
+    std::string name = from + "-" + build + ".sfdp";
+    std::string delta = MakePatch(base, image, options.bases[i].first, options.build);
+    if (!WriteFile(options.publish_dir + "/" + name, delta)) {
+      perror(options.publish_dir.c_str());
+      return 2;
+    }
+    printf("%-24s %9zu B  %5.1f%% of the image\n", name.c_str(), delta.size(),
+           100.0 * delta.size() / image.size());
+    manifest += (i ? ",\"" : "\"") + from + "\":{" +
+                ManifestEntry("/firmware/" + name, delta.size()) +
+                ",\"source_size\":" + std::to_string(base.size()) +
+                ",\"source_crc\":" + std::to_string(Crc(base)) + "}";
+  }
+  manifest += "}}";
+  if (manifest.size() >= OtaUpdater::kManifestSize) {
+    fprintf(stderr, "ota_server: manifest is %zu bytes, the firmware reads at most %zu\n",
+            manifest.size(), OtaUpdater::kManifestSize - 1);
+    return 2;
+  }
+  if (!WriteFile(options.publish_dir + "/manifest.json", manifest)) {
+    perror(options.publish_dir.c_str());
+    return 2;
+  }
+  printf("manifest.json            %9zu B\n", manifest.size());
+  return 0;
+}
+
+// --- HTTP server ---
+
+// Blocking HTTP/1.1 file server, one connection at a time (a board downloads
+// one file at a time). Supports "Range: bytes=N-" so interrupted downloads
+// resume.
+class UpdateServer {
+ public:
+  typedef std::function<bool(const std::string& path, std::string* body)> Lookup;
+
+  ~UpdateServer() { Stop(); }
+
+  bool Listen(uint16_t port, bool any) {
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) return false;
+    int one = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(any ? INADDR_ANY : INADDR_LOOPBACK);
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd_, 8) != 0) {
+      return false;
+    }
+    socklen_t length = sizeof(addr);
+    getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &length);
+    port_ = ntohs(addr.sin_port);
+    return true;
+  }
+
+  uint16_t port() const { return port_; }
+  void set_verbose(bool verbose) { verbose_ = verbose; }
+
+  // The next file response closes the connection after this many body bytes.
+  void DropNextAfter(long bytes) { drop_after_ = bytes; }
+  uint64_t body_bytes() const { return body_bytes_; }
+
+  // Serves on the calling thread until Stop().
+  void Serve(const Lookup& lookup) {
+    while (!stop_) {
+      pollfd p = {fd_, POLLIN, 0};
+      if (poll(&p, 1, 100) <= 0) continue;
+      int client = accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (client < 0) continue;
+      Handle(client, lookup);
+      close(client);
+    }
+  }
+
+  void Start(const Lookup& lookup) {
+    thread_ = std::thread([this, lookup] { Serve(lookup); });
+  }
+
+  void Stop() {
+    stop_ = true;
+    if (thread_.joinable()) thread_.join();
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+  }
+
+ private:
+  void Handle(int client, const Lookup& lookup) {
+    timeval timeout = {2, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 4096) {
+      ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+      if (n <= 0) return;
+      request.append(buffer, (size_t)n);
+    }
+    char method[8] = "";
+    char target[256] = "";
+    if (sscanf(request.c_str(), "%7s %255s", method, target) != 2) return;
+    size_t offset = 0;
+    size_t range = request.find("\r\nRange: bytes=");
+    if (range != std::string::npos) offset = strtoul(request.c_str() + range + 15, nullptr, 10);
+
+    std::string body;
+    int status = strcmp(method, "GET") != 0 ? 405 : lookup(target, &body) ? 200 : 404;
+    if (status == 200 && range != std::string::npos) status = offset < body.size() ? 206 : 416;
+    char header[256];
+    size_t length = status == 206 ? body.size() - offset : status == 200 ? body.size() : 0;
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %d %s\r\nContent-Type: application/octet-stream\r\n"
+                     "Content-Length: %zu\r\nAccept-Ranges: bytes\r\nConnection: close\r\n",
+                     status, status < 300 ? "OK" : "Error", length);
+    if (status == 206) {
+      n += snprintf(header + n, sizeof(header) - n, "Content-Range: bytes %zu-%zu/%zu\r\n",
+                    offset, body.size() - 1, body.size());
+    }
+    n += snprintf(header + n, sizeof(header) - n, "\r\n");
+    if (!SendAll(client, header, (size_t)n)) return;
+    if (verbose_) {
+      printf("GET %-32s %d %zu B\n", target, status, length);
+      fflush(stdout);
+    }
+
+    const char* data = body.data() + (status == 206 ? offset : 0);
+    long drop = drop_after_.exchange(-1);
+    if (drop >= 0 && (size_t)drop < length) length = (size_t)drop;
+    else if (drop >= 0) drop_after_ = drop;  // not this response; keep it armed
+    if (length > 0 && SendAll(client, data, length)) body_bytes_ += length;
+  }
+
+  static bool SendAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+      ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+      if (n <= 0) return false;
+      data += n;
+      length -= (size_t)n;
+    }
+    return true;
+  }
+
+  int fd_ = -1;
+  uint16_t port_ = 0;
+  bool verbose_ = false;
+  std::atomic<bool> stop_{false};
+  std::atomic<long> drop_after_{-1};
+  std::atomic<uint64_t> body_bytes_{0};
+  std::thread thread_;
+};
+
+int Serve(const Options& options) {
+  UpdateServer server;
+  if (!server.Listen((uint16_t)options.port, options.any)) {
+    perror("ota_server: listen");
+    return 2;
+  }
+  std::string dir = options.serve_dir;
+  server.set_verbose(true);
+  printf("ota_server: serving %s on http://%s:%u/firmware/manifest.json\n", dir.c_str(),
+         options.any ? "0.0.0.0" : "127.0.0.1", server.port());
+  fflush(stdout);
+  server.Serve([dir](const std::string& path, std::string* body) {
+    const std::string prefix = "/firmware/";
+    if (path.compare(0, prefix.size(), prefix) != 0) return false;
+    std::string name = path.substr(prefix.size());
+    if (name.empty() || name.find('/') != std::string::npos || name[0] == '.') return false;
+    return ReadFile(dir + "/" + name, body);
+  });
+  return 0;
+}
+
+// --- Host side of the firmware interfaces (--check) ---
+
+// Blocking client: the virtual clock does not move while it waits, so stall
+// timeouts in OtaUpdater only fire when the server really hangs up.
+class HttpUpdateTransport : public UpdateTransport {
+ public:
+  explicit HttpUpdateTransport(uint16_t port) : port_(port) {}
+  ~HttpUpdateTransport() override { closeStream(); }
+
+  int get(const char* path, char* body, size_t capacity, size_t* length) override {
+    uint32_t size = 0;
+    int code = openStream(path, 0, &size);
+    std::string data;
+    uint8_t buffer[1024];
+    int n;
+    while (code > 0 && data.size() < size && (n = read(buffer, sizeof(buffer))) > 0) {
+      data.append((const char*)buffer, (size_t)n);
+    }
+    closeStream();
+    size_t copied = data.size() < capacity - 1 ? data.size() : capacity - 1;
+    memcpy(body, data.data(), copied);
+    body[copied] = '\0';
+    *length = copied;
+    return code;
+  }
+
+  int openStream(const char* path, uint32_t offset, uint32_t* length) override {
+    closeStream();
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    timeval timeout = {2, 0};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) return -1;
+    std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: ota\r\n";
+    if (offset > 0) request += "Range: bytes=" + std::to_string(offset) + "-\r\n";
+    request += "\r\n";
+    if (send(fd_, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size()) {
+      return -1;
+    }
+    pending_.clear();
+    size_t end;
+    char buffer[1024];
+    while ((end = pending_.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = recv(fd_, buffer, sizeof(buffer), 0);
+      if (n <= 0) return -1;
+      pending_.append(buffer, (size_t)n);
+    }
+    int code = atoi(pending_.c_str() + 9);
+    size_t at = pending_.find("Content-Length: ");
+    *length = at < end ? (uint32_t)strtoul(pending_.c_str() + at + 16, nullptr, 10) : 0;
+    pending_.erase(0, end + 4);
+    return code;
+  }
+
+  int read(uint8_t* buffer, size_t capacity) override {
+    if (!pending_.empty()) {
+      size_t n = pending_.size() < capacity ? pending_.size() : capacity;
+      memcpy(buffer, pending_.data(), n);
+      pending_.erase(0, n);
+      return (int)n;
+    }
+    if (fd_ < 0) return -1;
+    ssize_t n = recv(fd_, buffer, capacity, 0);
+    return n > 0 ? (int)n : -1;
+  }
+
+  void closeStream() override {
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+    pending_.clear();
+  }
+
+ private:
+  uint16_t port_;
+  int fd_ = -1;
+  std::string pending_;
+};
+
+// Two app partitions and the ESP-IDF rollback states, in memory.
+class HostSlots : public FirmwareSlots {
+ public:
+  enum State { VALID, NEW, PENDING, INVALID };
+
+  // The largest app partition a 16 MB ESP32 flash can hold.
+  static const uint32_t kDefaultCapacity = 16 * 1024 * 1024;
+
+  explicit HostSlots(const Bytes& image, uint32_t capacity = kDefaultCapacity)
+      : capacity_(capacity) {
+    partition_[0] = image;
+    state_[0] = VALID;
+    state_[1] = INVALID;
+  }
+
+  bool readRunning(uint32_t offset, uint8_t* out, size_t length) override {
+    const Bytes& image = partition_[running_];
+    if ((size_t)offset + length > image.size()) return false;
+    memcpy(out, image.data() + offset, length);
+    return true;
+  }
+
+  uint32_t updateCapacity() override { return capacity_; }
+
+  bool beginUpdate(uint32_t size) override {
+    if (size > capacity_) return false;
+    staging_.clear();
+    staging_.reserve(size);
+    expected_ = size;
+    return true;
+  }
+
+  bool writeUpdate(const uint8_t* data, size_t length) override {
+    if (staging_.size() + length > expected_) return false;
+    staging_.insert(staging_.end(), data, data + length);
+    return true;
+  }
+
+  bool finishUpdate() override {
+    if (staging_.size() != expected_) return false;
+    int other = 1 - running_;
+    partition_[other].swap(staging_);
+    state_[other] = NEW;
+    boot_ = other;
+    return true;
+  }
+
+  void abortUpdate() override {
+    staging_.clear();
+    aborts_++;
+  }
+
+  bool pendingVerify() override { return state_[running_] == PENDING; }
+  void markValid() override { state_[running_] = VALID; }
+
+  void rollback() override {
+    state_[running_] = INVALID;
+    boot_ = 1 - running_;
+    restart_ = true;
+  }
+
+  void restart() override { restart_ = true; }
+
+  // Reboot as the bootloader would. A crash before markValid() makes the
+  // bootloader fall back to the other partition.
+  void Boot(bool crash) {
+    restart_ = false;
+    if (state_[boot_] == NEW) state_[boot_] = PENDING;
+    running_ = boot_;
+    if (crash && state_[running_] == PENDING) {
+      state_[running_] = INVALID;
+      running_ = boot_ = 1 - running_;
+    }
+  }
+
+  const Bytes& running() const { return partition_[running_]; }
+  Bytes& mutable_running() { return partition_[running_]; }
+  bool restart_requested() const { return restart_; }
+  int aborts() const { return aborts_; }
+
+ private:
+  uint32_t capacity_;
+  Bytes partition_[2];
+  State state_[2];
+  int running_ = 0;
+  int boot_ = 0;
+  Bytes staging_;
+  uint32_t expected_ = 0;
+  bool restart_ = false;
+  int aborts_ = 0;
+};
+
+// NVS that survives the simulated reboots.
+class NvsPlatform : public HostPlatform {
+ public:
+  explicit NvsPlatform(std::map<std::string, std::string>& nvs) : HostPlatform(7), nvs_(nvs) {}
+
+  bool loadBlob(const char* key, void* data, size_t size) override {
+    auto it = nvs_.find(key);
+    if (it == nvs_.end() || it->second.size() != size) return false;
+    memcpy(data, it->second.data(), size);
+    return true;
+  }
+
+  bool saveBlob(const char* key, const void* data, size_t size) override {
+    nvs_[key].assign((const char*)data, size);
+    return true;
+  }
+
+ private:
+  std::map<std::string, std::string>& nvs_;
+};
+
+// One boot of a board: everything below the slots and NVS starts fresh.
+// Firebase that can be taken down while WiFi stays up: every request fails
+// the way an unreachable host does.
+class SwitchableRtdb : public RtdbTransport {
+ public:
+  explicit SwitchableRtdb(RtdbTransport& inner) : inner_(inner) {}
+
+  void set_down(bool down) { down_ = down; }
+
+  bool connected() override { return inner_.connected(); }
+  int get(const char* path, char* body, size_t capacity, size_t* length) override {
+    if (!down_) return inner_.get(path, body, capacity, length);
+    *length = 0;
+    if (capacity > 0) body[0] = '\0';
+    return -1;
+  }
+  int put(const char* path, const char* body, size_t length) override {
+    return down_ ? -1 : inner_.put(path, body, length);
+  }
+  int patch(const char* path, const char* body, size_t length) override {
+    return down_ ? -1 : inner_.patch(path, body, length);
+  }
+
+ private:
+  RtdbTransport& inner_;
+  bool down_ = false;
+};
+
+// Release key of the --check boards; real builds get theirs from --keygen.
+const uint8_t kCheckSeed[32] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+                                17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32};
+
+struct Board {
+  Board(std::map<std::string, std::string>& nvs, MemoryRtdb& store, HostSlots& slots,
+        UpdateTransport& transport, uint32_t build)
+      : platform(nvs), memory(store), rtdb(memory), zones(1) {
+    device.reset(new TomatoDevice(platform, rtdb, pump, zones.zones(), zones.count()));
+    device->state.online = true;
+    std::string public_key = PublicKeyHex(kCheckSeed);
+    OtaConfig config = defaultOtaConfig(build, public_key.c_str());
+    ota.reset(new OtaUpdater(*device, platform, transport, slots, config));
+    ota->begin();
+  }
+
+  NvsPlatform platform;
+  MemoryRtdbTransport memory;
+  SwitchableRtdb rtdb;
+  CountingPump pump;
+  HostZones zones;
+  std::unique_ptr<TomatoDevice> device;
+  std::unique_ptr<OtaUpdater> ota;
+};
+
+// --- Check ---
+
+// Synthetic app image: functions of pseudo-random code, each followed by a
+// literal pool of absolute addresses of other functions, like Xtensa code.
+// Inserting a function shifts everything after it and rewrites those
+// addresses, which is what makes real firmware deltas non-trivial.
+Bytes MakeImage(size_t target_size, int inserted_at, int edited) {
+  const int kNewFunction = 100000;
+  std::vector<std::pair<int, size_t>> functions;  // id, body size
+  for (int id = 0, total = 0; total < (int)target_size; id++) {
+    HostPlatform body(1000 + id);
+    size_t size = (size_t)body.random(64, 1024);
+    functions.emplace_back(id, size);
+    total += (int)size + 16;
+    if (id == inserted_at) functions.emplace_back(kNewFunction, 2048);
+  }
+  std::map<int, uint32_t> starts;  // by id, so callees survive the insertion
+  uint32_t at = 24;
+  for (const auto& f : functions) {
+    starts[f.first] = at;
+    at += (uint32_t)f.second + 16;
+  }
+  long callees = (long)functions.size() - (inserted_at >= 0 ? 1 : 0);
+  Bytes image(24, 0xE9);
+  for (const auto& f : functions) {
+    HostPlatform body(1000 + f.first);
+    for (size_t b = 0; b < f.second; b++) image.push_back((uint8_t)(body.NextRandom() >> 24));
+    if (f.first == edited) image[image.size() - 40] ^= 0x5A;
+    for (int k = 0; k < 4; k++) {
+      uint32_t callee = 0x400D0000 + starts[(int)body.random(0, callees)];
+      for (int byte = 0; byte < 4; byte++) image.push_back((uint8_t)(callee >> (8 * byte)));
+    }
+  }
+  return image;
+}
+
+class Checker {
+ public:
+  void Expect(bool ok, const char* what) {
+    printf("%-4s %s\n", ok ? "ok" : "FAIL", what);
+    if (!ok) failures_++;
+  }
+  int failures() const { return failures_; }
+
+ private:
+  int failures_ = 0;
+};
+
+// Drives one boot until it asks for a restart or `done` holds.
+void RunBoard(Board& board, HostSlots& slots, const std::function<bool()>& done,
+              unsigned long limit_ms = 30UL * 60 * 1000) {
+  for (unsigned long now = 0; now < limit_ms && !slots.restart_requested() && !done(); now += 10) {
+    board.platform.AdvanceTo(now);
+    board.ota->service();
+  }
+}
+
+std::string OtaState(MemoryRtdb& store) {
+  std::string state;
+  store.Get("/ota/tomato_01/state", 0, &state);
+  return state;
+}
+
+int RunCheck(const Options& options) {
+  Checker check;
+  const uint8_t digits[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  check.Expect(crc32Update(0, digits, sizeof(digits)) == 0xCBF43926, "crc32 matches zlib");
+  {
+    // RFC 8032 section 7.1, test 1 (empty message).
+    uint8_t seed[32], expected[kEd25519SignatureSize], public_key[kEd25519KeySize];
+    uint8_t signature[kEd25519SignatureSize];
+    ParseHex("9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60", seed, 32);
+    ParseHex("e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+             "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b",
+             expected, sizeof(expected));
+    ed25519PublicKey(public_key, seed);
+    ed25519Sign(signature, nullptr, 0, seed);
+    bool ok = Hex(public_key, sizeof(public_key)) ==
+                  "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a" &&
+              memcmp(signature, expected, sizeof(signature)) == 0 &&
+              ed25519Verify(signature, nullptr, 0, public_key);
+    signature[10] ^= 1;
+    check.Expect(ok && !ed25519Verify(signature, nullptr, 0, public_key),
+                 "ed25519 matches RFC 8032 and rejects a flipped bit");
+  }
+
+  size_t size = (size_t)options.image_kb * 1024;
+  Bytes v1 = MakeImage(size, -1, -1);
+  Bytes v2 = MakeImage(size, 700, 40);
+  auto start = std::chrono::steady_clock::now();
+  std::string delta = MakePatch(v1, v2, 1, 2);
+  double diff_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                            start).count();
+  std::string full = MakePatch(Bytes(), v2, 0, 2);
+  printf("     image %zu B, delta %zu B (%.2f%%), full %zu B, diff %.0f ms\n", v2.size(),
+         delta.size(), 100.0 * delta.size() / v2.size(), full.size(), diff_ms);
+  check.Expect(delta.size() * 10 < v2.size(), "delta is under 10% of the image");
+
+  // Apply offline in odd-sized pieces.
+  {
+    HostSlots slots(v1);
+    DeltaPatcher patcher(slots);
+    start = std::chrono::steady_clock::now();
+    DeltaStatus status = DELTA_MORE;
+    for (size_t at = 0; at < delta.size() && status == DELTA_MORE; at += 333) {
+      size_t n = std::min<size_t>(333, delta.size() - at);
+      status = patcher.feed((const uint8_t*)delta.data() + at, n);
+    }
+    double apply_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start).count();
+    Bytes digest(patcher.targetDigest(), patcher.targetDigest() + Sha512::kDigestSize);
+    Sha512 sha;
+    sha.update(v2.data(), v2.size());
+    Bytes expected(Sha512::kDigestSize);
+    sha.finish(expected.data());
+    check.Expect(patcher.install() && digest == expected, "patcher hashes the image it wrote");
+    slots.Boot(false);
+    printf("     applied delta at %.0f MB/s of image\n", v2.size() / 1e3 / apply_ms);
+    check.Expect(status == DELTA_DONE && slots.running() == v2, "delta rebuilds the new image");
+  }
+
+  // Served files; the patches can be swapped per scenario.
+  std::map<std::string, std::string> files;
+  std::string signature = SignImage(v2, 2, kCheckSeed);
+  auto publish = [&](const std::string& delta_body, const std::string& sig) {
+    files["/firmware/2.sfdp"] = full;
+    files["/firmware/1-2.sfdp"] = delta_body;
+    files["/firmware/manifest.json"] =
+        "{\"build\":2,\"size\":" + std::to_string(v2.size()) + ",\"crc\":" +
+        std::to_string(Crc(v2)) + (sig.empty() ? "" : ",\"sig\":\"" + sig + "\"") +
+        ",\"image\":{" + ManifestEntry("/firmware/2.sfdp", full.size()) +
+        "},\"deltas\":{\"1\":{" + ManifestEntry("/firmware/1-2.sfdp", delta_body.size()) +
+        ",\"source_size\":" + std::to_string(v1.size()) +
+        ",\"source_crc\":" + std::to_string(Crc(v1)) + "}}}";
+  };
+  publish(delta, signature);
+  std::mutex files_mutex;
+  UpdateServer server;
+  if (!server.Listen(0, false)) {
+    perror("ota_server: listen");
+    return 2;
+  }
+  server.Start([&](const std::string& path, std::string* body) {
+    std::lock_guard<std::mutex> lock(files_mutex);
+    auto it = files.find(path);
+    if (it == files.end()) return false;
+    *body = it->second;
+    return true;
+  });
+  HttpUpdateTransport transport(server.port());
+
+  // Installs build 2 on a board running `running` and reboots into it.
+  struct Outcome {
+    bool installed;
+    uint64_t downloaded;
+    uint8_t reconnects;
+    bool delta;
+  };
+  auto update = [&](HostSlots& slots, std::map<std::string, std::string>& nvs, MemoryRtdb& store,
+                    uint32_t build) {
+    uint64_t before = server.body_bytes();
+    Board board(nvs, store, slots, transport, build);
+    board.ota->requestCheck();
+    RunBoard(board, slots, [] { return false; });
+    Outcome outcome;
+    outcome.installed = slots.restart_requested();
+    outcome.downloaded = server.body_bytes() - before;
+    outcome.reconnects = board.ota->progress().reconnects;
+    outcome.delta = board.ota->progress().delta;
+    return outcome;
+  };
+
+  {
+    HostSlots slots(v1);
+    std::map<std::string, std::string> nvs;
+    MemoryRtdb store;
+    Outcome outcome = update(slots, nvs, store, 1);
+    check.Expect(outcome.installed && outcome.delta, "build 1 installs build 2 from the delta");
+    check.Expect(outcome.downloaded < delta.size() + 2048,
+                 "download is the delta plus the manifest");
+    slots.Boot(false);
+    check.Expect(slots.running() == v2 && slots.pendingVerify(), "boots build 2 pending verify");
+    Board board(nvs, store, slots, transport, 2);
+    board.device->sendToFirebase(kDefaultEpochMs);
+    RunBoard(board, slots, [&] { return !board.ota->active(); });
+    check.Expect(!slots.pendingVerify() && OtaState(store) == "\"confirmed\"",
+                 "first upload confirms the image and reports it");
+  }
+  {
+    HostSlots slots(v1);
+    std::map<std::string, std::string> nvs;
+    MemoryRtdb store;
+    server.DropNextAfter((long)delta.size() / 2);
+    Outcome outcome = update(slots, nvs, store, 1);
+    check.Expect(outcome.installed && outcome.reconnects == 1 &&
+                     outcome.downloaded < delta.size() + 2048,
+                 "dropped download resumes with Range");
+  }
+  {
+    HostSlots slots(v1);
+    slots.mutable_running()[5000] ^= 1;
+    std::map<std::string, std::string> nvs;
+    MemoryRtdb store;
+    Outcome outcome = update(slots, nvs, store, 1);
+    slots.Boot(false);
+    check.Expect(outcome.installed && !outcome.delta && slots.running() == v2,
+                 "mismatched base falls back to the full image");
+  }
+  {
+    std::string corrupt = delta;
+    corrupt[corrupt.size() / 2] ^= 0x40;
+    {
+      std::lock_guard<std::mutex> lock(files_mutex);
+      publish(corrupt, signature);
+    }
+    HostSlots slots(v1);
+    std::map<std::string, std::string> nvs;
+    MemoryRtdb store;
+    Outcome outcome = update(slots, nvs, store, 1);
+    check.Expect(!outcome.installed && slots.aborts() == 1 && OtaState(store) == "\"failed\"" &&
+                     slots.running() == v1,
+                 "corrupted patch is rejected before switching partitions");
+    std::lock_guard<std::mutex> lock(files_mutex);
+    publish(delta, signature);
+  }
+  {
+    // An update host that is not ours: same image, CRCs all consistent,
+    // signed with some other key.
+    uint8_t other[32];
+    memcpy(other, kCheckSeed, sizeof(other));
+    other[0] ^= 0xFF;
+    {
+      std::lock_guard<std::mutex> lock(files_mutex);
+      publish(delta, SignImage(v2, 2, other));
+    }
+    HostSlots slots(v1);
+    std::map<std::string, std::string> nvs;
+    MemoryRtdb store;
+    Outcome outcome = update(slots, nvs, store, 1);
+    check.Expect(!outcome.installed && slots.aborts() == 1 && OtaState(store) == "\"failed\"" &&
+                     slots.running() == v1,
+                 "image signed with another key is not installed");
+    {
+      std::lock_guard<std::mutex> lock(files_mutex);
+      publish(delta, "");
+    }
+    HostSlots unsigned_slots(v1);
+    outcome = update(unsigned_slots, nvs, store, 1);
+    check.Expect(!outcome.installed && outcome.downloaded < 1024 && unsigned_slots.aborts() == 0,
+                 "unsigned manifest is ignored without downloading");
+    std::lock_guard<std::mutex> lock(files_mutex);
+    publish(delta, signature);
+  }
+  {
+    // The manifest is read before its signature can be checked, so every
+    // number in it is untrusted: each malformed one must stop the update
+    // before anything is downloaded or written.
+    const std::string manifest = files["/firmware/manifest.json"];
+    auto with_field = [&](const char* key, const std::string& value) {
+      std::string text = manifest;
+      size_t at = text.find(std::string("\"") + key + "\":") + strlen(key) + 3;
+      text.replace(at, text.find_first_of(",}", at) - at, value);
+      return text;
+    };
+    struct Case {
+      const char* key;
+      std::string value;
+      const char* what;
+    };
+    const Case cases[] = {
+        {"build", "\"nan\"", "NaN build is ignored without downloading"},
+        {"build", "-1", "negative build is ignored without downloading"},
+        {"build", "2.5", "fractional build is ignored without downloading"},
+        {"build", "4294967298", "build above UINT32_MAX is ignored without downloading"},
+        {"size", "1e999", "infinite size is ignored without downloading"},
+        {"size", "-1", "negative size is ignored without downloading"},
+        {"size", std::to_string(v2.size()) + ".5",
+         "fractional size is ignored without downloading"},
+        {"size", "4294967296", "size above UINT32_MAX is ignored without downloading"},
+        {"crc", "\"inf\"", "infinite crc is ignored without downloading"},
+        {"crc", "-1", "negative crc is ignored without downloading"},
+        {"crc", "1.5", "fractional crc is ignored without downloading"},
+        {"crc", "4294967296", "crc above UINT32_MAX is ignored without downloading"},
+    };
+    for (const Case& c : cases) {
+      {
+        std::lock_guard<std::mutex> lock(files_mutex);
+        files["/firmware/manifest.json"] = with_field(c.key, c.value);
+      }
+      HostSlots slots(v1);
+      std::map<std::string, std::string> nvs;
+      MemoryRtdb store;
+      Outcome outcome = update(slots, nvs, store, 1);
+      check.Expect(!outcome.installed && outcome.downloaded < 1024 && slots.aborts() == 0,
+                   c.what);
+    }
+    {
+      std::lock_guard<std::mutex> lock(files_mutex);
+      files["/firmware/manifest.json"] = manifest;
+    }
+    HostSlots small_slots(v1, (uint32_t)v2.size() - 1);
+    std::map<std::string, std::string> nvs;
+    MemoryRtdb store;
+    Outcome outcome = update(small_slots, nvs, store, 1);
+    check.Expect(!outcome.installed && outcome.downloaded < 1024 && small_slots.aborts() == 0,
+                 "image larger than the partition is ignored without downloading");
+  }
+  {
+    HostSlots slots(v1);
+    std::map<std::string, std::string> nvs;
+    MemoryRtdb store;
+    update(slots, nvs, store, 1);
+    slots.Boot(true);
+    check.Expect(slots.running() == v1, "crash before confirmation boots build 1 again");
+    Outcome again = update(slots, nvs, store, 1);
+    check.Expect(OtaState(store) == "\"rolled_back\"" && !again.installed &&
+                     again.downloaded < 1024,
+                 "rolled-back build is reported and not downloaded again");
+  }
+  {
+    HostSlots slots(v1);
+    std::map<std::string, std::string> nvs;
+    MemoryRtdb store;
+    update(slots, nvs, store, 1);
+    slots.Boot(false);
+    {
+      Board board(nvs, store, slots, transport, 2);
+      RunBoard(board, slots, [] { return false; });
+      check.Expect(slots.restart_requested() && OtaState(store) == "\"rolling_back\"",
+                   "unhealthy image rolls itself back after the timeout");
+    }
+    slots.Boot(false);
+    Outcome again = update(slots, nvs, store, 1);
+    check.Expect(slots.running() == v1 && !again.installed, "build 1 stays after the rollback");
+  }
+  {
+    // Data written while Firebase is down only lands in the local write
+    // buffer; that must not count as a healthy boot.
+    HostSlots slots(v1);
+    std::map<std::string, std::string> nvs;
+    MemoryRtdb store;
+    update(slots, nvs, store, 1);
+    slots.Boot(false);
+    {
+      Board board(nvs, store, slots, transport, 2);
+      board.rtdb.set_down(true);
+      for (int i = 0; i < 3; i++) {
+        board.device->state.currentTemperature += 0.5f;
+        board.device->sendToFirebase(kDefaultEpochMs + i * 5000);
+      }
+      RunBoard(board, slots, [] { return false; });
+      check.Expect(board.device->dataUploads() == 0 && slots.restart_requested(),
+                   "buffered uploads with Firebase down do not confirm the image");
+    }
+    slots.Boot(false);
+    check.Expect(slots.running() == v1, "Firebase down after the update rolls back to build 1");
+  }
+
+  server.Stop();
+  if (check.failures()) {
+    printf("FAIL: %d check(s) failed\n", check.failures());
+    return 1;
+  }
+  printf("OK: delta OTA installs, resumes, verifies signatures and rolls back\n");
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+  UseWibTimezone();
+  if (options.check) return RunCheck(options);
+  if (!options.keygen_path.empty()) return Keygen(options);
+  if (!options.publish_dir.empty()) return Publish(options);
+  return Serve(options);
+}
@@ -0,0 +1,119 @@
+#ifndef SMARTFARM_TOOLS_POSIX_LAN_H_
+#define SMARTFARM_TOOLS_POSIX_LAN_H_
+
+// Non-blocking POSIX sockets behind the firmware's LanListener/LanConnection
+// and DatagramSink interfaces, so firmware/local_http_server.h and
+// firmware/udp_telemetry.h run unchanged on the host.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "local_http_server.h"
+#include "udp_telemetry.h"
+
+class PosixLanConnection : public LanConnection {
+ public:
+  int read(char* buffer, size_t capacity) override {
+    if (capacity == 0) return 0;
+    ssize_t n = recv(fd_, buffer, capacity, MSG_DONTWAIT);
+    if (n > 0) return (int)n;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    return -1;  // orderly shutdown or error
+  }
+
+  int write(const char* data, size_t length) override {
+    ssize_t n = send(fd_, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n >= 0) return (int)n;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+    return -1;
+  }
+
+  void close() override {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+  }
+
+  int fd_ = -1;
+};
+
+class PosixLanListener : public LanListener {
+ public:
+  ~PosixLanListener() override {
+    connection_.close();
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  // Binds to loopback only unless `any` is set. Port 0 picks a free port.
+  bool Listen(uint16_t port, bool any) {
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) return false;
+    int one = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(any ? INADDR_ANY : INADDR_LOOPBACK);
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd_, 8) != 0) {
+      return false;
+    }
+    socklen_t length = sizeof(addr);
+    getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &length);
+    port_ = ntohs(addr.sin_port);
+    return true;
+  }
+
+  uint16_t port() const { return port_; }
+
+  LanConnection* accept() override {
+    int fd = accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return nullptr;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    connection_.fd_ = fd;
+    return &connection_;
+  }
+
+ private:
+  int fd_ = -1;
+  uint16_t port_ = 0;
+  PosixLanConnection connection_;
+};
+
+// UDP sender for telemetry frames. Multicast destinations stay on the local
+// link (TTL 1) and loop back so a receiver on the same host sees them.
+class PosixDatagramSink : public DatagramSink {
+ public:
+  ~PosixDatagramSink() override {
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  bool Open(const char* host, uint16_t port) {
+    addr_.sin_family = AF_INET;
+    addr_.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &addr_.sin_addr) != 1) return false;
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) return false;
+    unsigned char ttl = 1;
+    unsigned char loop = 1;
+    setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    return true;
+  }
+
+  bool send(const uint8_t* data, size_t length) override {
+    ssize_t n = sendto(fd_, data, length, MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&addr_),
+                       sizeof(addr_));
+    return n == (ssize_t)length;
+  }
+
+ private:
+  int fd_ = -1;
+  sockaddr_in addr_ = {};
+};
+
+#endif  // SMARTFARM_TOOLS_POSIX_LAN_H_
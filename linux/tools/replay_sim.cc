@@ -0,0 +1,923 @@
+// Replays recorded history_data through the firmware's control logic
+// (firmware/tomato_device.h) on a virtual clock, far faster than real time,
+// and reports every pump switch, alert and upload the firmware would have
+// produced, plus the REST traffic it would have sent. Use it to see what a
+// change to the watering rules, the stage thresholds or the alert table
+// would have done on months of production data.
+//
+// Input is the desktop app's history export (CSV or .sfhx, see
+// linux/native/history_export.h) or a Firebase JSON export of history_data
+// (or of the whole database). Each recorded sample is held until the next
+// one; the device samples on its own schedule, in AUTO mode, with plant age
+// starting from the first row's umur_tanaman. Gaps longer than --max-gap-s
+// (device offline) are skipped rather than replayed as stale readings.
+//
+// Two ways to compare:
+//   --config-b FILE     replay a second device side by side with a
+//                       /config/<device> document (format in
+//                       firmware/remote_config.h); --config sets device A's
+//   --log FILE          write every event as JSON lines, then run another
+//                       build with --baseline FILE to compare against it
+// Either way the report shows counts side by side and the first pump or
+// alert decision where the two runs part.
+//
+// Usage:
+//   replay_sim --input FILE [--config FILE] [--config-b FILE] [--log FILE]
+//              [--baseline FILE] [--speed X] [--step-ms 100]
+//              [--max-gap-s 600]
+//   replay_sim --check
+//
+// --speed caps the replay at X times real time (e.g. 1000); by default it
+// runs as fast as it can.
+//
+// --check replays a synthetic week with dry spells and an offline gap through
+// a CSV round trip and checks that it waters, alerts and uploads, that two
+// identical devices decide identically, that --log reads back, and that the
+// replay runs at least 1000x real time.
+//
+// Exit status: 0 on success, 1 if --check fails, 2 on bad arguments or
+// unreadable input.
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "host_platform.h"
+#include "net_stats.h"
+#include "rtdb_json.h"
+#include "tomato_device.h"
+#include "tomato_logic.h"
+
+namespace {
+
+const char kDeviceId[] = "tomato_replay";
+
+struct Options {
+  std::string input;
+  std::string config_a;
+  std::string config_b;
+  std::string log_path;
+  std::string baseline_path;
+  double speed = 0;  // 0 = unthrottled
+  unsigned long step_ms = 100;
+  long long max_gap_ms = 10 * 60 * 1000;
+  bool check = false;
+};
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--input") == 0 && value) {
+      options->input = value;
+      i++;
+    } else if (strcmp(arg, "--config") == 0 && value) {
+      options->config_a = value;
+      i++;
+    } else if (strcmp(arg, "--config-b") == 0 && value) {
+      options->config_b = value;
+      i++;
+    } else if (strcmp(arg, "--log") == 0 && value) {
+      options->log_path = value;
+      i++;
+    } else if (strcmp(arg, "--baseline") == 0 && value) {
+      options->baseline_path = value;
+      i++;
+    } else if (strcmp(arg, "--speed") == 0 && value) {
+      options->speed = atof(value);
+      i++;
+    } else if (strcmp(arg, "--step-ms") == 0 && value) {
+      options->step_ms = strtoul(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--max-gap-s") == 0 && value) {
+      options->max_gap_ms = atoll(value) * 1000;
+      i++;
+    } else if (strcmp(arg, "--check") == 0) {
+      options->check = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s --input FILE [--config FILE] [--config-b FILE] [--log FILE] "
+              "[--baseline FILE] [--speed X] [--step-ms MS] [--max-gap-s S] | --check\n",
+              argv[0]);
+      return false;
+    }
+  }
+  return (options->check || !options->input.empty()) && options->speed >= 0 &&
+         options->step_ms > 0 && options->max_gap_ms > 0;
+}
+
+// One recorded history_data row, as much of it as the firmware reads.
+struct Sample {
+  int64_t timestamp;
+  float temperature;
+  float humidity;
+  float soil;
+  float brightness;
+  int plant_age;
+};
+
+// --- Input ---
+
+// Read-only view of a whole file.
+class MappedFile {
+ public:
+  ~MappedFile() {
+    if (data_ != nullptr) munmap((void*)data_, size_);
+  }
+
+  bool Open(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0 && info.st_size > 0;
+    if (ok) {
+      size_ = (size_t)info.st_size;
+      void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      ok = data != MAP_FAILED;
+      data_ = ok ? (const char*)data : nullptr;
+    }
+    close(fd);
+    return ok;
+  }
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Header row naming the columns, as written by history_export.cc.
+bool ReadCsv(const MappedFile& file, std::vector<Sample>* out) {
+  const char* p = file.data();
+  const char* end = p + file.size();
+  const char* const kColumns[] = {"timestamp", "suhu", "kelembaban_udara", "kelembaban_tanah",
+                                  "kecerahan", "umur_tanaman"};
+  int index[6] = {-1, -1, -1, -1, -1, -1};
+  int column = 0;
+  const char* field = p;
+  for (; p <= end; p++) {
+    if (p < end && *p != ',' && *p != '\n' && *p != '\r') continue;
+    for (int c = 0; c < 6; c++) {
+      size_t n = strlen(kColumns[c]);
+      if ((size_t)(p - field) == n && memcmp(field, kColumns[c], n) == 0) index[c] = column;
+    }
+    column++;
+    field = p + 1;
+    if (p == end || *p == '\n') break;
+  }
+  for (int c = 0; c < 5; c++) {
+    if (index[c] < 0) {
+      fprintf(stderr, "replay_sim: CSV has no %s column\n", kColumns[c]);
+      return false;
+    }
+  }
+
+  char* next;
+  while (++p < end) {
+    double values[6] = {0, 0, 0, 0, 0, 0};
+    column = 0;
+    while (p < end && *p != '\n') {
+      for (int c = 0; c < 6; c++) {
+        if (index[c] == column) values[c] = strtod(p, &next);
+      }
+      while (p < end && *p != ',' && *p != '\n') p++;
+      if (p < end && *p == ',') p++;
+      column++;
+    }
+    if (column == 0 || values[0] <= 0) continue;
+    out->push_back(Sample{(int64_t)values[0], (float)values[1], (float)values[2],
+                          (float)values[3], (float)values[4], (int)values[5]});
+  }
+  return true;
+}
+
+// Blocks of column arrays, as written by history_export.cc.
+bool ReadColumnar(const MappedFile& file, std::vector<Sample>* out) {
+  const size_t kHeaderBytes = 32;
+  const char* p = file.data() + kHeaderBytes;
+  const char* end = file.data() + file.size();
+  while (p + 8 <= end) {
+    uint32_t rows;
+    memcpy(&rows, p, sizeof(rows));
+    p += 8;
+    if ((size_t)(end - p) < (size_t)rows * 27) {
+      fprintf(stderr, "replay_sim: truncated .sfhx block\n");
+      return false;
+    }
+    const char* timestamp = p;
+    const char* temperature = timestamp + rows * 8;
+    const char* humidity = temperature + rows * 4;
+    const char* soil = humidity + rows * 4;
+    const char* brightness = soil + rows * 4;
+    const char* plant_age = brightness + rows * 4;
+    for (uint32_t i = 0; i < rows; i++) {
+      Sample sample;
+      uint16_t age;
+      memcpy(&sample.timestamp, timestamp + i * 8, 8);
+      memcpy(&sample.temperature, temperature + i * 4, 4);
+      memcpy(&sample.humidity, humidity + i * 4, 4);
+      memcpy(&sample.soil, soil + i * 4, 4);
+      memcpy(&sample.brightness, brightness + i * 4, 4);
+      memcpy(&age, plant_age + i * 2, 2);
+      sample.plant_age = age;
+      out->push_back(sample);
+    }
+    p += (size_t)rows * 27;
+  }
+  return true;
+}
+
+double NumberField(JsonSpan row, const char* name) {
+  JsonSpan field;
+  double value = 0;
+  if (jsonFindMember(row, name, &field)) jsonToDouble(field, &value);
+  return value;
+}
+
+// {"data_<ts>_<rand>": {...}, ...}, or a database export holding
+// "history_data". Rows without a timestamp field take it from their key, as
+// the app does.
+bool ReadRtdbJson(const MappedFile& file, std::vector<Sample>* out) {
+  JsonSpan root = jsonSpanOf(file.data(), file.size());
+  JsonSpan history;
+  if (jsonFindMember(root, "history_data", &history)) root = history;
+  JsonObjectIterator it(root);
+  if (!it.valid()) {
+    fprintf(stderr, "replay_sim: JSON input is not an object\n");
+    return false;
+  }
+  JsonSpan key, row;
+  while (it.next(&key, &row)) {
+    int64_t timestamp = (int64_t)NumberField(row, "timestamp");
+    if (timestamp <= 0 && key.size() > 5 && memcmp(key.begin, "data_", 5) == 0) {
+      timestamp = strtoll(key.begin + 5, nullptr, 10);
+    }
+    if (timestamp <= 0) continue;
+    out->push_back(Sample{timestamp, (float)NumberField(row, "suhu"),
+                          (float)NumberField(row, "kelembaban_udara"),
+                          (float)NumberField(row, "kelembaban_tanah"),
+                          (float)NumberField(row, "kecerahan"),
+                          (int)NumberField(row, "umur_tanaman")});
+  }
+  return true;
+}
+
+bool ReadSamples(const std::string& path, std::vector<Sample>* out) {
+  MappedFile file;
+  if (!file.Open(path)) {
+    fprintf(stderr, "replay_sim: cannot read %s\n", path.c_str());
+    return false;
+  }
+  const char* p = jsonSkipWs(file.data(), file.data() + file.size());
+  bool ok;
+  if (file.size() >= 32 && memcmp(file.data(), "SFHX", 4) == 0) {
+    ok = ReadColumnar(file, out);
+  } else if (p < file.data() + file.size() && *p == '{') {
+    ok = ReadRtdbJson(file, out);
+  } else {
+    ok = ReadCsv(file, out);
+  }
+  // RTDB keys sort by timestamp only within one device's clock; be sure.
+  std::stable_sort(out->begin(), out->end(),
+                   [](const Sample& a, const Sample& b) { return a.timestamp < b.timestamp; });
+  return ok;
+}
+
+// --- Replay ---
+
+enum EventKind {
+  EVENT_PUMP_ON,
+  EVENT_PUMP_OFF,
+  EVENT_ALERT,
+  EVENT_UPLOAD,
+};
+
+struct Event {
+  int64_t time;   // ms epoch, virtual
+  EventKind kind;
+  int zone;       // pump events
+  uint32_t bytes; // uploads
+  int title;      // alerts: index into Run::titles
+};
+
+// Traffic per NetEndpoint, 64-bit so months of uploads do not wrap.
+struct Traffic {
+  uint64_t requests[NET_ENDPOINT_COUNT] = {};
+  uint64_t sent[NET_ENDPOINT_COUNT] = {};
+  uint64_t received[NET_ENDPOINT_COUNT] = {};
+};
+
+class Run;
+
+// The wire under the firmware's own REST layers: always online, AUTO mode,
+// pump OFF, and the --config document if any.
+class ReplayRtdb : public RtdbTransport {
+ public:
+  explicit ReplayRtdb(Run& run) : run_(run) {}
+
+  bool connected() override { return true; }
+  int get(const char* path, char* body, size_t capacity, size_t* length) override;
+  int put(const char* path, const char* body, size_t length) override;
+  int patch(const char* path, const char* body, size_t length) override;
+
+  std::string config;  // /config/<device> document, "" = none
+
+ private:
+  Run& run_;
+};
+
+class RecordingPump : public PumpActuator {
+ public:
+  explicit RecordingPump(Run& run) : run_(run) {}
+  void setPump(int zone, bool on) override;
+
+ private:
+  Run& run_;
+};
+
+// Holds each recorded sample until the next one is due.
+class ReplaySensors : public SensorSource {
+ public:
+  ReplaySensors(const std::vector<Sample>& samples, HostPlatform& platform)
+      : samples_(samples), platform_(platform) {}
+
+  void read(RawSample* sample, int zone_count) override {
+    long long now = platform_.epoch_ms();
+    while (next_ < samples_.size() && samples_[next_].timestamp <= now) next_++;
+    const Sample& s = samples_[next_ > 0 ? next_ - 1 : 0];
+    sample->temperature = s.temperature;
+    sample->humidity = s.humidity;
+    // Inverse of soilRawToPercent / ldrRawToPercent in tomato_logic.h.
+    for (int i = 0; i < zone_count; i++) {
+      sample->soilRaw[i] = (int)lroundf((100.0f - s.soil) * 40.95f);
+      sample->ldrRaw[i] = (int)lroundf(s.brightness * 40.95f);
+    }
+  }
+
+ private:
+  const std::vector<Sample>& samples_;
+  HostPlatform& platform_;
+  size_t next_ = 0;
+};
+
+class Run {
+ public:
+  Run(const char* label, const std::vector<Sample>& samples, const std::string& config)
+      : label(label), platform(1, samples.front().timestamp), rtdb(*this), pump(*this),
+        sensors(samples, platform) {
+    rtdb.config = config;
+    zone_.id = "zona_1";
+    zone_.basePath = "";
+    zone_.soilPin = zone_.ldrPin = zone_.relayPin = zone_.servoPin = -1;
+    zone_.initialAgeDays = std::max(1, samples.front().plant_age);
+    memset(zone_.soilThresholds, 0, sizeof(zone_.soilThresholds));
+    DeviceConfig device_config = defaultDeviceConfig();
+    device_config.deviceId = kDeviceId;
+    device.reset(new TomatoDevice(platform, rtdb, pump, &zone_, 1, device_config));
+    device->begin();
+    device->state.timeInitialized = true;
+  }
+
+  void Record(EventKind kind, int zone, uint32_t bytes, int title) {
+    events.push_back(Event{platform.epoch_ms(), kind, zone, bytes, title});
+  }
+
+  int TitleIndex(const std::string& title) {
+    auto it = std::find(titles.begin(), titles.end(), title);
+    if (it != titles.end()) return (int)(it - titles.begin());
+    titles.push_back(title);
+    return (int)titles.size() - 1;
+  }
+
+  const char* label;
+  HostPlatform platform;
+  ReplayRtdb rtdb;
+  RecordingPump pump;
+  ReplaySensors sensors;
+  std::unique_ptr<TomatoDevice> device;
+  std::vector<Event> events;
+  std::vector<std::string> titles;
+  Traffic traffic;
+  bool pump_on = false;
+
+ private:
+  ZoneConfig zone_;
+};
+
+int ReplayRtdb::get(const char* path, char* body, size_t capacity, size_t* length) {
+  const char* reply = "null";
+  if (strstr(path, "control.json")) {
+    reply = "{\"operating_mode\":\"AUTO\",\"pompa_status\":\"OFF\"}";
+  } else if (strncmp(path, "/config/", 8) == 0 && !config.empty()) {
+    reply = config.c_str();
+  }
+  snprintf(body, capacity, "%s", reply);
+  *length = strlen(body);
+  int endpoint = classifyRtdbPath(path);
+  run_.traffic.requests[endpoint]++;
+  run_.traffic.sent[endpoint] += strlen(path);
+  run_.traffic.received[endpoint] += *length;
+  return 200;
+}
+
+int ReplayRtdb::put(const char* path, const char* body, size_t length) {
+  int endpoint = classifyRtdbPath(path);
+  run_.traffic.requests[endpoint]++;
+  run_.traffic.sent[endpoint] += strlen(path) + length;
+  if (endpoint == NET_NOTIFICATIONS) {
+    char title[128] = "";
+    JsonSpan field;
+    if (jsonFindMember(jsonSpanOf(body, length), "title", &field)) {
+      jsonCopyString(field, title, sizeof(title));
+    }
+    run_.Record(EVENT_ALERT, 0, (uint32_t)length, run_.TitleIndex(title));
+  }
+  return 200;
+}
+
+int ReplayRtdb::patch(const char* path, const char* /*body*/, size_t length) {
+  int endpoint = classifyRtdbPath(path);
+  run_.traffic.requests[endpoint]++;
+  run_.traffic.sent[endpoint] += strlen(path) + length;
+  if (endpoint == NET_DATA) run_.Record(EVENT_UPLOAD, 0, (uint32_t)length, -1);
+  return 200;
+}
+
+void RecordingPump::setPump(int zone, bool on) {
+  if (on == run_.pump_on) return;
+  run_.pump_on = on;
+  run_.Record(on ? EVENT_PUMP_ON : EVENT_PUMP_OFF, zone, 0, -1);
+}
+
+// Steps every run through the recording together. Returns virtual ms
+// replayed; *skipped counts gaps jumped over.
+long long Replay(const std::vector<Sample>& samples, std::vector<Run*>& runs,
+                 const Options& options, int* skipped) {
+  const long long start = samples.front().timestamp;
+  const long long end = samples.back().timestamp;
+  auto wall_start = std::chrono::steady_clock::now();
+  size_t next = 0;  // first sample after the virtual clock
+  unsigned long now = 0;
+  for (unsigned long step = 0; start + (long long)now <= end; step++) {
+    for (Run* run : runs) {
+      run->platform.AdvanceTo(now);
+      run->device->loop(run->sensors);
+    }
+
+    long long epoch = start + (long long)now;
+    while (next < samples.size() && samples[next].timestamp <= epoch) next++;
+    // Offline stretch in the recording: jump to just before it resumes,
+    // unless a pump run still has to time out.
+    bool pumping = false;
+    for (Run* run : runs) pumping = pumping || run->pump_on;
+    if (next < samples.size() && samples[next].timestamp - epoch > options.max_gap_ms &&
+        !pumping) {
+      now = (unsigned long)(samples[next].timestamp - start) - options.step_ms;
+      (*skipped)++;
+    }
+    now += options.step_ms;
+
+    if (options.speed > 0 && step % 1000 == 0) {
+      auto due = wall_start + std::chrono::duration<double, std::milli>(now / options.speed);
+      std::this_thread::sleep_until(due);
+    }
+  }
+  return end - start;
+}
+
+// --- Reports ---
+
+// What two replays are compared on; built from a Run or read back from a
+// --log file.
+struct Summary {
+  std::string label;
+  uint64_t samples = 0;
+  uint64_t pump_starts = 0;
+  double pump_minutes = 0;
+  uint64_t alerts = 0;
+  std::map<std::string, uint64_t> alerts_by_title;
+  uint64_t uploads = 0;
+  uint64_t upload_bytes = 0;
+  uint64_t requests = 0;
+  uint64_t bytes_sent = 0;
+  uint64_t bytes_received = 0;
+  // Pump and alert decisions in order, for the first divergence.
+  std::vector<std::pair<int64_t, std::string>> decisions;
+};
+
+std::string PumpDecision(bool on, int zone) {
+  char text[32];
+  snprintf(text, sizeof(text), "pump %s zone %d", on ? "ON" : "OFF", zone + 1);
+  return text;
+}
+
+Summary Summarize(const Run& run, uint64_t samples) {
+  Summary s;
+  s.label = run.label;
+  s.samples = samples;
+  int64_t on_since = -1;
+  for (const Event& e : run.events) {
+    switch (e.kind) {
+      case EVENT_PUMP_ON:
+        s.pump_starts++;
+        on_since = e.time;
+        s.decisions.emplace_back(e.time, PumpDecision(true, e.zone));
+        break;
+      case EVENT_PUMP_OFF:
+        if (on_since >= 0) s.pump_minutes += (e.time - on_since) / 60000.0;
+        on_since = -1;
+        s.decisions.emplace_back(e.time, PumpDecision(false, e.zone));
+        break;
+      case EVENT_ALERT:
+        s.alerts++;
+        s.alerts_by_title[run.titles[e.title]]++;
+        s.decisions.emplace_back(e.time, "alert " + run.titles[e.title]);
+        break;
+      case EVENT_UPLOAD:
+        s.uploads++;
+        s.upload_bytes += e.bytes;
+        break;
+    }
+  }
+  for (int i = 0; i < NET_ENDPOINT_COUNT; i++) {
+    s.requests += run.traffic.requests[i];
+    s.bytes_sent += run.traffic.sent[i];
+    s.bytes_received += run.traffic.received[i];
+  }
+  return s;
+}
+
+// One JSON object per line: each event, then a summary line with traffic
+// per endpoint. Written with the firmware's JsonWriter.
+bool WriteLog(const std::string& path, const Run& run, const Summary& summary) {
+  FILE* out = fopen(path.c_str(), "w");
+  if (out == nullptr) {
+    perror(path.c_str());
+    return false;
+  }
+  static const char* const kKinds[] = {"pump_on", "pump_off", "alert", "upload"};
+  char line[512];
+  for (const Event& e : run.events) {
+    JsonWriter json(line, sizeof(line));
+    json.beginObject().key("t").value((long long)e.time).key("kind").value(kKinds[e.kind]);
+    if (e.kind == EVENT_PUMP_ON || e.kind == EVENT_PUMP_OFF) json.key("zone").value(e.zone + 1);
+    if (e.kind == EVENT_ALERT) json.key("title").value(run.titles[e.title].c_str());
+    if (e.kind == EVENT_UPLOAD) json.key("bytes").value((long long)e.bytes);
+    json.endObject();
+    fprintf(out, "%s\n", line);
+  }
+  JsonWriter json(line, sizeof(line));
+  json.beginObject()
+      .key("kind").value("summary")
+      .key("samples").value((long long)summary.samples)
+      .key("requests").value((long long)summary.requests)
+      .key("bytes_sent").value((long long)summary.bytes_sent)
+      .key("bytes_received").value((long long)summary.bytes_received)
+      .key("endpoints").beginObject();
+  for (int i = 0; i < NET_ENDPOINT_COUNT; i++) {
+    if (run.traffic.requests[i] == 0) continue;
+    json.key(netEndpointName(i)).beginArray()
+        .value((long long)run.traffic.requests[i])
+        .value((long long)run.traffic.sent[i])
+        .value((long long)run.traffic.received[i])
+        .endArray();
+  }
+  json.endObject().endObject();
+  fprintf(out, "%s\n", line);
+  bool ok = !ferror(out);
+  return fclose(out) == 0 && ok;
+}
+
+bool ReadLog(const std::string& path, Summary* s) {
+  FILE* in = fopen(path.c_str(), "r");
+  if (in == nullptr) {
+    perror(path.c_str());
+    return false;
+  }
+  s->label = "baseline";
+  char line[1024];
+  char kind[16], title[128];
+  int64_t on_since = -1;
+  JsonSpan field;
+  while (fgets(line, sizeof(line), in) != nullptr) {
+    JsonSpan row = jsonSpanOf(line, strlen(line));
+    if (!jsonFindMember(row, "kind", &field)) continue;
+    jsonCopyString(field, kind, sizeof(kind));
+    int64_t t = (int64_t)NumberField(row, "t");
+    if (strcmp(kind, "pump_on") == 0 || strcmp(kind, "pump_off") == 0) {
+      bool on = kind[5] == 'o' && kind[6] == 'n';
+      int zone = (int)NumberField(row, "zone") - 1;
+      if (on) {
+        s->pump_starts++;
+        on_since = t;
+      } else if (on_since >= 0) {
+        s->pump_minutes += (t - on_since) / 60000.0;
+        on_since = -1;
+      }
+      s->decisions.emplace_back(t, PumpDecision(on, zone));
+    } else if (strcmp(kind, "alert") == 0) {
+      title[0] = '\0';
+      if (jsonFindMember(row, "title", &field)) jsonCopyString(field, title, sizeof(title));
+      s->alerts++;
+      s->alerts_by_title[title]++;
+      s->decisions.emplace_back(t, std::string("alert ") + title);
+    } else if (strcmp(kind, "upload") == 0) {
+      s->uploads++;
+      s->upload_bytes += (uint64_t)NumberField(row, "bytes");
+    } else if (strcmp(kind, "summary") == 0) {
+      s->samples = (uint64_t)NumberField(row, "samples");
+      s->requests = (uint64_t)NumberField(row, "requests");
+      s->bytes_sent = (uint64_t)NumberField(row, "bytes_sent");
+      s->bytes_received = (uint64_t)NumberField(row, "bytes_received");
+    }
+  }
+  fclose(in);
+  return true;
+}
+
+std::string LocalTime(int64_t ms) {
+  time_t seconds = (time_t)(ms / 1000);
+  struct tm local;
+  localtime_r(&seconds, &local);
+  char text[32];
+  strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+  return text;
+}
+
+// Terminal columns taken by a UTF-8 string; alert titles start with emoji,
+// which take two.
+int DisplayWidth(const std::string& text) {
+  int width = 0;
+  for (unsigned char c : text) {
+    if ((c & 0xC0) != 0x80) width += c >= 0xE0 ? 2 : 1;
+  }
+  return width;
+}
+
+void PrintRow(const char* name, const std::vector<Summary>& runs, double (*get)(const Summary&),
+              const char* format) {
+  printf("  %-28s", name);
+  for (const Summary& s : runs) printf(format, get(s));
+  printf("\n");
+}
+
+// First pump or alert decision where b parts from a.
+void PrintDivergence(const Summary& a, const Summary& b) {
+  size_t common = std::min(a.decisions.size(), b.decisions.size());
+  for (size_t i = 0; i < common; i++) {
+    if (a.decisions[i] == b.decisions[i]) continue;
+    printf("  %s vs %s: first divergence at decision %zu\n", a.label.c_str(), b.label.c_str(),
+           i + 1);
+    printf("    %-8s %s  %s\n", a.label.c_str(), LocalTime(a.decisions[i].first).c_str(),
+           a.decisions[i].second.c_str());
+    printf("    %-8s %s  %s\n", b.label.c_str(), LocalTime(b.decisions[i].first).c_str(),
+           b.decisions[i].second.c_str());
+    return;
+  }
+  if (a.decisions.size() == b.decisions.size()) {
+    printf("  %s vs %s: pump and alert decisions identical (%zu)\n", a.label.c_str(),
+           b.label.c_str(), common);
+  } else {
+    const Summary& longer = a.decisions.size() > b.decisions.size() ? a : b;
+    printf("  %s vs %s: decisions identical for %zu, then %s continues: %s  %s\n",
+           a.label.c_str(), b.label.c_str(), common, longer.label.c_str(),
+           LocalTime(longer.decisions[common].first).c_str(),
+           longer.decisions[common].second.c_str());
+  }
+}
+
+void PrintComparison(const std::vector<Summary>& runs) {
+  printf("  %-28s", "");
+  for (const Summary& s : runs) printf(" %16s", s.label.c_str());
+  printf("\n");
+  PrintRow("pump starts", runs, [](const Summary& s) { return (double)s.pump_starts; }, " %16.0f");
+  PrintRow("pump on (min)", runs, [](const Summary& s) { return s.pump_minutes; }, " %16.1f");
+  PrintRow("alerts", runs, [](const Summary& s) { return (double)s.alerts; }, " %16.0f");
+  std::map<std::string, bool> titles;
+  for (const Summary& s : runs) {
+    for (const auto& entry : s.alerts_by_title) titles[entry.first] = true;
+  }
+  for (const auto& title : titles) {
+    printf("    %s%*s", title.first.c_str(), std::max(0, 26 - DisplayWidth(title.first)), "");
+    for (const Summary& s : runs) {
+      auto it = s.alerts_by_title.find(title.first);
+      printf(" %16llu", (unsigned long long)(it == s.alerts_by_title.end() ? 0 : it->second));
+    }
+    printf("\n");
+  }
+  PrintRow("uploads", runs, [](const Summary& s) { return (double)s.uploads; }, " %16.0f");
+  PrintRow("upload KiB", runs, [](const Summary& s) { return s.upload_bytes / 1024.0; },
+           " %16.1f");
+  PrintRow("requests (all)", runs, [](const Summary& s) { return (double)s.requests; },
+           " %16.0f");
+  PrintRow("sent KiB", runs, [](const Summary& s) { return s.bytes_sent / 1024.0; }, " %16.1f");
+  PrintRow("received KiB", runs, [](const Summary& s) { return s.bytes_received / 1024.0; },
+           " %16.1f");
+
+  for (size_t i = 1; i < runs.size(); i++) PrintDivergence(runs[0], runs[i]);
+}
+
+bool ReadConfig(const std::string& path, std::string* out) {
+  if (path.empty()) return true;
+  MappedFile file;
+  if (!file.Open(path)) {
+    fprintf(stderr, "replay_sim: cannot read %s\n", path.c_str());
+    return false;
+  }
+  out->assign(file.data(), file.size());
+  if (out->size() >= TomatoDevice::kBodySize) {
+    fprintf(stderr, "replay_sim: %s is larger than the firmware's %zu-byte body buffer\n",
+            path.c_str(), TomatoDevice::kBodySize);
+    return false;
+  }
+  // The device would log and ignore a bad document; refuse it here instead
+  // of silently replaying the defaults.
+  const DeviceConfig defaults = defaultDeviceConfig();
+  RemoteConfig parsed;
+  const char* error = "";
+  if (!parseRemoteConfig(jsonSpanOf(out->data(), out->size()),
+                         remoteConfigDefaults(defaults.interval, defaults.notificationInterval,
+                                              defaults.wateringDuration),
+                         &parsed, &error)) {
+    fprintf(stderr, "replay_sim: %s: %s\n", path.c_str(), error);
+    return false;
+  }
+  return true;
+}
+
+struct ReplayResult {
+  std::vector<Summary> summaries;  // A, then B if configured
+  long long virtual_ms = 0;
+  double wall_ms = 0;
+  int skipped = 0;
+};
+
+ReplayResult ReplayAll(const std::vector<Sample>& samples, const std::string& config_a,
+                       const std::string* config_b, const Options& options,
+                       const std::string& log_path) {
+  std::unique_ptr<Run> a(new Run("A", samples, config_a));
+  std::unique_ptr<Run> b;
+  std::vector<Run*> runs = {a.get()};
+  if (config_b != nullptr) {
+    b.reset(new Run("B", samples, *config_b));
+    runs.push_back(b.get());
+  }
+
+  ReplayResult result;
+  auto wall_start = std::chrono::steady_clock::now();
+  result.virtual_ms = Replay(samples, runs, options, &result.skipped);
+  result.wall_ms =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start)
+          .count();
+  for (Run* run : runs) result.summaries.push_back(Summarize(*run, samples.size()));
+  if (!log_path.empty() && !WriteLog(log_path, *a, result.summaries[0])) {
+    result.summaries.clear();
+  }
+  return result;
+}
+
+void PrintReplay(const std::vector<Sample>& samples, const ReplayResult& result) {
+  printf("replay_sim: %zu samples, %s .. %s (%.1f days, %d offline gaps skipped)\n",
+         samples.size(), LocalTime(samples.front().timestamp).c_str(),
+         LocalTime(samples.back().timestamp).c_str(), result.virtual_ms / 86400000.0,
+         result.skipped);
+  printf("  replayed in %.2f s wall, %.0fx real time\n", result.wall_ms / 1000,
+         result.virtual_ms / std::max(result.wall_ms, 1e-3));
+}
+
+// A week sampled once a minute, as history_data records it: soil dries from
+// 70% to 20% over ten hours and is then watered back, air peaks at 38 C in
+// the afternoon, and the device is offline for three hours on day 3.
+std::vector<Sample> SyntheticWeek() {
+  std::vector<Sample> samples;
+  const int64_t start = kDefaultEpochMs;
+  for (int minute = 0; minute < 7 * 24 * 60; minute++) {
+    if (minute >= 3 * 24 * 60 && minute < 3 * 24 * 60 + 180) continue;
+    int hour = (13 + minute / 60) % 24;  // kDefaultEpochMs is 13:00 WIB
+    Sample s;
+    s.timestamp = start + minute * 60000LL;
+    s.temperature = 26.0f + 12.0f * (float)std::max(0.0, sin((hour - 8) * M_PI / 12));
+    s.humidity = 65.0f;
+    s.soil = 70.0f - (minute % 600) * 50.0f / 600;
+    s.brightness = hour >= 6 && hour < 18 ? 80.0f : 5.0f;
+    s.plant_age = 30;
+    samples.push_back(s);
+  }
+  return samples;
+}
+
+bool Check(const Options& options) {
+  bool ok = true;
+  auto expect = [&ok](bool condition, const char* what) {
+    if (!condition) {
+      fprintf(stderr, "check failed: %s\n", what);
+      ok = false;
+    }
+  };
+
+  // Through the CSV reader, as an exported history would arrive.
+  std::vector<Sample> week = SyntheticWeek();
+  char csv_path[] = "/tmp/replay_sim_XXXXXX";
+  int fd = mkstemp(csv_path);
+  if (fd < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  FILE* csv = fdopen(fd, "w");
+  fprintf(csv, "timestamp,datetime,suhu,kelembaban_udara,kelembaban_tanah,kecerahan,"
+               "umur_tanaman,status_pompa\n");
+  for (const Sample& s : week) {
+    fprintf(csv, "%lld,x,%.6g,%.6g,%.6g,%.6g,%d,OFF\n", (long long)s.timestamp, s.temperature,
+            s.humidity, s.soil, s.brightness, s.plant_age);
+  }
+  fclose(csv);
+  std::vector<Sample> samples;
+  expect(ReadSamples(csv_path, &samples), "CSV input read");
+  unlink(csv_path);
+  expect(samples.size() == week.size(), "every CSV row read back");
+  if (samples.empty()) return false;
+  expect(samples[100].timestamp == week[100].timestamp &&
+             fabsf(samples[100].soil - week[100].soil) < 1e-3f,
+         "CSV values read back");
+
+  std::string log_path = std::string(csv_path) + ".jsonl";
+  const std::string same;
+  ReplayResult result = ReplayAll(samples, "", &same, options, log_path);
+  PrintReplay(samples, result);
+  if (result.summaries.size() != 2) {
+    fprintf(stderr, "check failed: replay log not written\n");
+    return false;
+  }
+  PrintComparison(result.summaries);
+  const Summary& a = result.summaries[0];
+  const Summary& b = result.summaries[1];
+  expect(a.pump_starts > 0, "dry spells start the pump");
+  expect(a.alerts_by_title.size() >= 3, "heat, dry-soil and watering alerts");
+  expect(a.uploads > 0 && a.upload_bytes > 0, "samples uploaded");
+  expect(result.skipped == 1, "offline gap skipped once");
+  // Diagnostics carry host CPU timings, so only data uploads must match.
+  expect(a.decisions == b.decisions && a.upload_bytes == b.upload_bytes,
+         "identical devices decide identically");
+  double speed = result.virtual_ms / std::max(result.wall_ms, 1e-3);
+  expect(speed >= 1000, "replay at least 1000x real time");
+
+  Summary logged;
+  expect(ReadLog(log_path, &logged), "log read back");
+  unlink(log_path.c_str());
+  expect(logged.decisions == a.decisions && logged.uploads == a.uploads &&
+             logged.requests == a.requests && logged.bytes_sent == a.bytes_sent,
+         "log matches the replay");
+
+  printf(ok ? "replay_sim: check passed\n" : "replay_sim: check FAILED\n");
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+  UseWibTimezone();
+  if (options.check) return Check(options) ? 0 : 1;
+
+  std::vector<Sample> samples;
+  if (!ReadSamples(options.input, &samples)) return 2;
+  if (samples.empty()) {
+    fprintf(stderr, "replay_sim: %s holds no samples\n", options.input.c_str());
+    return 2;
+  }
+  std::string config_a, config_b;
+  if (!ReadConfig(options.config_a, &config_a) || !ReadConfig(options.config_b, &config_b)) {
+    return 2;
+  }
+
+  ReplayResult result = ReplayAll(samples, config_a,
+                                  options.config_b.empty() ? nullptr : &config_b, options,
+                                  options.log_path);
+  if (result.summaries.empty()) return 2;
+  PrintReplay(samples, result);
+  if (!options.baseline_path.empty()) {
+    Summary baseline;
+    if (!ReadLog(options.baseline_path, &baseline)) return 2;
+    // Baseline first, so a divergence reads "baseline did X, this build Y".
+    result.summaries.insert(result.summaries.begin(), baseline);
+  }
+  PrintComparison(result.summaries);
+  return 0;
+}
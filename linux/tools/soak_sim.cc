@@ -0,0 +1,234 @@
+// Soak test: runs one SmartFarm Tomato node (the real firmware logic from
+// firmware/tomato_device.h) for months of virtual time and fails if its
+// memory drifts. Every heap allocation in the process is counted, so any
+// allocation the firmware makes per cycle shows up as allocs/loop, and any
+// leak shows up as live bytes growing from one simulated day to the next.
+//
+// Usage:
+//   soak_sim [--days 90] [--zones 4] [--step-ms 500] [--tolerance BYTES]
+//            [--seed S]
+//
+// Exit status: 0 when live heap stayed within tolerance of the day-1
+// baseline, 1 on drift, 2 on bad arguments.
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+
+#include "host_platform.h"
+#include "tomato_device.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations(0);
+std::atomic<int64_t> g_live_bytes(0);
+std::atomic<int64_t> g_live_blocks(0);
+
+}  // namespace
+
+// Counting allocator for the whole process. Sizes come from
+// malloc_usable_size so sized and unsized deletes agree.
+void* operator new(size_t size) {
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  g_allocations++;
+  g_live_blocks++;
+  g_live_bytes += (int64_t)malloc_usable_size(p);
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  if (!p) return;
+  g_live_blocks--;
+  g_live_bytes -= (int64_t)malloc_usable_size(p);
+  free(p);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+namespace {
+
+// Same DRAM budget an ESP32 sketch typically has left after WiFi is up.
+const uint32_t kModelHeapBytes = 200 * 1024;
+const unsigned long kDayMs = 24UL * 60 * 60 * 1000;
+
+struct Options {
+  int days = 90;
+  int zones = 4;
+  unsigned long step_ms = 500;
+  long long tolerance = 0;
+  uint64_t seed = 42;
+};
+
+// HostPlatform plus a heap model backed by the counting allocator, so the
+// firmware's MemoryTelemetry sees host allocations as ESP32 heap usage.
+class SoakPlatform : public HostPlatform {
+ public:
+  explicit SoakPlatform(uint64_t seed) : HostPlatform(seed), min_free_(kModelHeapBytes) {}
+
+  bool heapStats(HeapStats* out) override {
+    int64_t live = g_live_bytes.load();
+    uint32_t free_bytes = live >= kModelHeapBytes ? 0 : kModelHeapBytes - (uint32_t)live;
+    if (free_bytes < min_free_) min_free_ = free_bytes;
+    out->freeBytes = free_bytes;
+    out->largestFreeBlock = free_bytes;
+    out->minFreeBytes = min_free_;
+    out->liveBlocks = (uint32_t)g_live_blocks.load();
+    return true;
+  }
+
+  uint32_t allocationCount() override { return (uint32_t)g_allocations.load(); }
+
+ private:
+  uint32_t min_free_;
+};
+
+// Answers like an idle backend without allocating: AUTO mode, pump OFF,
+// no notifications. Keeps the measurement limited to what the firmware
+// itself allocates.
+class CannedRtdb : public RtdbTransport {
+ public:
+  bool connected() override { return true; }
+
+  int get(const char* path, char* body, size_t capacity, size_t* length) override {
+    get_count++;
+    const char* reply = strstr(path, "control.json")
+                            ? "{\"operating_mode\":\"AUTO\",\"pompa_status\":\"OFF\"}"
+                            : "null";
+    snprintf(body, capacity, "%s", reply);
+    *length = strlen(body);
+    return 200;
+  }
+
+  int put(const char*, const char*, size_t) override {
+    put_count++;
+    return 200;
+  }
+
+  int patch(const char*, const char*, size_t) override {
+    patch_count++;
+    return 200;
+  }
+
+  unsigned long get_count = 0;
+  unsigned long put_count = 0;
+  unsigned long patch_count = 0;
+};
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--days") == 0 && value) {
+      options->days = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--zones") == 0 && value) {
+      options->zones = atoi(value);
+      i++;
+    } else if (strcmp(arg, "--step-ms") == 0 && value) {
+      options->step_ms = strtoul(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--tolerance") == 0 && value) {
+      options->tolerance = strtoll(value, nullptr, 10);
+      i++;
+    } else if (strcmp(arg, "--seed") == 0 && value) {
+      options->seed = strtoull(value, nullptr, 10);
+      i++;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--days N] [--zones Z] [--step-ms MS] [--tolerance BYTES] "
+              "[--seed S]\n",
+              argv[0]);
+      return false;
+    }
+  }
+  return options->days > 1 && options->step_ms > 0 && options->zones > 0 &&
+         options->zones <= TOMATO_MAX_ZONES;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+  UseWibTimezone();
+
+  // Everything the run needs is allocated up front; the baseline is taken
+  // after day 1 so one-time lazy allocations (tz data, stdio) are excluded.
+  SoakPlatform platform(options.seed);
+  HostSensors sensors(platform);
+  CountingPump pump;
+  CannedRtdb rtdb;
+  HostZones zones(options.zones);
+  std::unique_ptr<TomatoDevice> device(
+      new TomatoDevice(platform, rtdb, pump, zones.zones(), zones.count()));
+  device->state.timeInitialized = true;
+  device->begin();
+
+  printf("soak_sim: %d days, %d zone(s), %lu ms steps, tolerance %lld B\n", options.days,
+         options.zones, options.step_ms, options.tolerance);
+  printf("%5s %12s %12s %12s %12s %10s\n", "day", "live B", "live blocks", "allocs", "allocs/loop",
+         "trend B/h");
+
+  auto start = std::chrono::steady_clock::now();
+  int64_t baseline_bytes = 0;
+  uint64_t baseline_allocs = 0;
+  int64_t worst_drift = 0;
+  int drift_day = 0;
+  unsigned long loops = 0;
+  unsigned long now = 0;
+
+  for (int day = 1; day <= options.days; day++) {
+    const unsigned long day_end = (unsigned long)day * kDayMs;
+    unsigned long day_loops = 0;
+    uint64_t day_allocs = g_allocations.load();
+    for (; now < day_end; now += options.step_ms) {
+      platform.AdvanceTo(now);
+      device->loop(sensors);
+      day_loops++;
+    }
+    loops += day_loops;
+    day_allocs = g_allocations.load() - day_allocs;
+
+    int64_t live = g_live_bytes.load();
+    if (day == 1) {
+      baseline_bytes = live;
+      baseline_allocs = g_allocations.load();
+    } else if (live - baseline_bytes > worst_drift) {
+      worst_drift = live - baseline_bytes;
+      if (worst_drift > options.tolerance && drift_day == 0) drift_day = day;
+    }
+
+    if (day == 1 || day % 10 == 0 || day == options.days) {
+      printf("%5d %12lld %12lld %12llu %12.4f %10.1f\n", day, (long long)live,
+             (long long)g_live_blocks.load(), (unsigned long long)day_allocs,
+             (double)day_allocs / day_loops, device->memory().trendBytesPerHour());
+      fflush(stdout);
+    }
+  }
+
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  uint64_t soak_allocs = g_allocations.load() - baseline_allocs;
+  printf("loops %lu, GET %lu PUT %lu PATCH %lu, plant age %d days, wall %.1f s\n", loops,
+         rtdb.get_count, rtdb.put_count, rtdb.patch_count, device->zone(0).state.plantAgeDays, wall);
+  printf("allocations after day 1: %llu, live drift: %lld B\n", (unsigned long long)soak_allocs,
+         (long long)worst_drift);
+
+  if (drift_day) {
+    printf("FAIL: live heap grew %lld B over the day-1 baseline (first exceeded on day %d)\n",
+           (long long)worst_drift, drift_day);
+    return 1;
+  }
+  printf("OK: no memory drift\n");
+  return 0;
+}